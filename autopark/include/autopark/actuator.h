@@ -0,0 +1,134 @@
+/******************************************************************
+ * Filename: actuator.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-29
+ * Description: declare CAN frame layout of speed and steering
+ * commands, buses (SocketCAN and in-process loopback) and the
+ * batched non-blocking writer of the actuator backend
+ * 
+ ******************************************************************/
+
+#ifndef ACTUATOR_H_
+#define ACTUATOR_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include <linux/can.h>
+
+// CAN ids of actuator commands
+#define ACTUATOR_SPEED_ID           0x120
+#define ACTUATOR_STEERING_ID        0x121
+
+// layout of command frames (dlc 8, little endian):
+//   byte 0-1: int16 value, speed [0.01 m/s] or steering angle [0.001 rad], positive forward or left
+//   byte 2:   mode, ACTUATOR_*
+//   byte 3-5: reserved, 0
+//   byte 6:   alive counter 0 ... 15, incremented with each frame
+//   byte 7:   checksum, xor of byte 0-6
+#define ACTUATOR_SPEED_SCALE        100.0
+#define ACTUATOR_STEERING_SCALE     1000.0
+
+enum ActuatorMode
+{
+    ACTUATOR_STOP = 0,
+    ACTUATOR_FORWARD = 1,
+    ACTUATOR_BACKWARD = 2,
+    ACTUATOR_STEER = 3
+};
+
+typedef struct can_frame CanFrame;
+
+
+// encode command frame, return false if value is out of range (it is saturated)
+bool encode_speed(float speed, uint8_t mode, uint8_t counter, CanFrame& frame);
+bool encode_steering(float steering, uint8_t counter, CanFrame& frame);
+// decode command frame, return false if id, length or checksum is wrong
+bool decode_command(const CanFrame& frame, float& value, uint8_t& mode, uint8_t& counter);
+
+
+// bus of the actuator backend: write never blocks
+class ActuatorBus
+{
+public:
+    virtual ~ActuatorBus() {}
+
+    // write frames in order, return number of frames accepted (rest is retried later), -1 on error
+    virtual int write(const CanFrame* frames, int count) = 0;
+    virtual const char* name() const = 0;
+};
+
+// SocketCAN raw socket in non-blocking mode, a batch is sent with one system call
+class SocketCanBus : public ActuatorBus
+{
+private:
+    int socket_;
+    char name_[16];
+
+public:
+    SocketCanBus();
+
+    bool open(const char* interface);
+    void close();
+    bool is_open() const { return socket_ >= 0; }
+
+    int write(const CanFrame* frames, int count);
+    const char* name() const { return name_; }
+
+    ~SocketCanBus();
+};
+
+// in-process bus for tests and benchmarks: ring buffer of frames
+class LoopbackBus : public ActuatorBus
+{
+private:
+    boost::mutex mutex_;
+    std::vector<CanFrame> ring_;
+    size_t head_;               // next frame to read
+    size_t size_;               // frames in ring
+
+public:
+    LoopbackBus(size_t capacity);
+
+    int write(const CanFrame* frames, int count);
+    // read at most count frames, return number of frames read
+    int read(CanFrame* frames, int count);
+    const char* name() const { return "loopback"; }
+
+    ~LoopbackBus();
+};
+
+// open SocketCAN interface, or loopback bus only if interface is "loopback", NULL if it cannot be opened
+ActuatorBus* create_actuator_bus(const char* interface);
+
+
+// batched writer: at most one pending frame per CAN id, a newer command replaces an older
+// one which is not written yet, so a slow bus never sends stale commands
+class ActuatorWriter
+{
+private:
+    ActuatorBus* bus_;
+    std::vector<CanFrame> pending_;
+    uint64_t written_;          // frames accepted by bus
+    uint64_t replaced_;         // pending frames replaced by newer ones
+    uint64_t errors_;
+
+public:
+    ActuatorWriter(ActuatorBus* bus);
+
+    // queue frame, replace pending frame with the same id
+    void submit(const CanFrame& frame);
+    // write pending frames in one batch without blocking, return number of frames written
+    int flush();
+
+    size_t pending() const { return pending_.size(); }
+    uint64_t written() const { return written_; }
+    uint64_t replaced() const { return replaced_; }
+    uint64_t errors() const { return errors_; }
+
+    ~ActuatorWriter();
+};
+
+#endif
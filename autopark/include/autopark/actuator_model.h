@@ -0,0 +1,94 @@
+/******************************************************************
+ * Filename: actuator_model.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-30
+ * Description: declare models of steering and drive actuators (dead
+ * time, rate limit, ramps) and a simulated vehicle driven by them
+ * 
+ ******************************************************************/
+
+#ifndef ACTUATOR_MODEL_H_
+#define ACTUATOR_MODEL_H_
+
+#include <deque>
+
+#include "autopark/path_tracking.h"
+
+
+// dynamics of an actuator: output follows the command after dead time with limited rate
+struct ActuatorDynamics
+{
+    double dead_time;   // [s] delay between command and start of response
+    double rise_max;    // [unit/s] maximum rate when magnitude increases, 0: unlimited
+    double fall_max;    // [unit/s] maximum rate when magnitude decreases, 0: unlimited
+};
+
+// dynamics of the actuators of the car and ideal ones (instant response)
+ActuatorDynamics steering_dynamics();
+ActuatorDynamics drive_dynamics();
+ActuatorDynamics ideal_dynamics();
+
+
+// model of one actuator: commands pass a delay line, output is rate limited
+class ActuatorModel
+{
+private:
+    struct Command
+    {
+        double time;
+        double value;
+    };
+
+    ActuatorDynamics dynamics_;
+    std::deque<Command> delay_;     // commands which are not effective yet
+    double time_;                   // [s] time of model
+    double target_;                 // effective command
+    double value_;                  // output
+
+public:
+    ActuatorModel(const ActuatorDynamics& dynamics);
+
+    // set output and command to value, clear pending commands
+    void reset(double value);
+    // command a new target, it becomes effective after dead time
+    void command(double target);
+    // advance model by dt [s], return output
+    double update(double dt);
+
+    double value() const { return value_; }
+    double target() const { return target_; }
+    // output reached the last command
+    bool settled() const { return delay_.empty() && value_ == target_; }
+
+    ~ActuatorModel();
+};
+
+// simulated vehicle: speed and steering commands pass actuator models, pose follows
+// the kinematic bicycle model with the actuator outputs
+class VehicleSimulator
+{
+private:
+    ActuatorModel steering_;
+    ActuatorModel drive_;
+    CarPose pose_;
+    double odometer_;           // [m] driven distance
+
+public:
+    VehicleSimulator(const ActuatorDynamics& steering, const ActuatorDynamics& drive);
+
+    void reset(const CarPose& pose);
+    void command_speed(double speed) { drive_.command(speed); }
+    void command_steering(double steering) { steering_.command(steering); }
+    // advance simulation by dt [s]
+    void step(double dt);
+
+    const CarPose& pose() const { return pose_; }
+    double speed() const { return drive_.value(); }
+    double steering() const { return steering_.value(); }
+    double odometer() const { return odometer_; }
+
+    ~VehicleSimulator();
+};
+
+#endif
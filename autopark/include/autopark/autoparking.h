@@ -12,6 +12,8 @@
 
 #include <stdint.h>
 
+#include "autopark/parameters.h"
+
 #define setbit(x, y) x|=(1<<y)
 #define clrbit(x, y) x&=~(1<<y)
 //  x   x   x   x     x   x   x   x
@@ -24,36 +26,23 @@
 // 2 bit: parking space on the right side
 // 1 bit: parking type is parallel parking
 // 0 bit: parking type is perpendicular parking
-#define SPACE_LEFT_PARALLEL             0x96    // 0 1 1 0  0 0 0 0
-#define SPACE_LEFT_PERPENDICULAR        0x80    // 0 1 0 1  0 0 0 0
+#define SPACE_LEFT_PARALLEL             0x60    // 0 1 1 0  0 0 0 0
+#define SPACE_LEFT_PERPENDICULAR        0x50    // 0 1 0 1  0 0 0 0
 #define SPACE_RIGHT_PARALLEL            0x06    // 0 0 0 0  0 1 1 0
 #define SPACE_RIGHT_PERPENDICULAR       0x05    // 0 0 0 0  0 1 0 1
 
-extern uint32_t parking_space;                  // global variable for saving parking space
-
-extern const float range_diff;                  // [m] range difference to distinguish turn point 
-extern const float distance_search;             // [m] maximum distance between car and parking space
-extern const float parallel_width;              // [m] minimum width of parallel parking space
-extern const float parallel_length;             // [m] minimum length of parallel parking space
-extern const float perpendicular_width;         // [m] minimum width of perpendicular parking space
-extern const float perpendicular_length;        // [m] minimum length of perpendicular parking space
-extern const float car_width;                   // [m] minimum width of car
-extern const float car_length;                  // [m] minimum length of car
-extern const float distance_apa;                // [m] distance between two apas at front and back
-extern const float apa_width;                   // [m] lateral range of apa
-extern const float apa_tolerance;               // [m] measuring tolerance of apa 
-
-extern const float brake_distance_default;      // [m] default brake distance
-extern const float move_distance_perpendicular; // [m] move distance before perpendicular parking in
-extern const float parking_distance_min;        // [m] minimum distance between car and parkwall (car)
-extern const float parking_distance_max;        // [m] maximum distance between car and parkwall (car)
-extern const float distance_perpendicular_out;  // [m] move distance for perpendicular parking out
-extern const float distance_parallel_out;       // [m] safe distance for parallel parking out
-
-extern const float speed_search_parking;        // [m/s] car speed when search parking space
-extern const float speed_parking_forward;       // [m/s] car speed when move forward for parking
-extern const float speed_parking_backward;      // [m/s] car speed when move backward for parking
-
-extern const float parking_time;                // [s] total time for parking
+// command of cmd_turn which keeps the steering angle: it renews the lease of the source
+// in controller_arbiter after an incremental turn 'l' or 'r'
+#define TURN_HOLD                       'H'
+
+// tunable parameters are in the vehicle profile (parameters.h), read them with params()
+extern const char* const parameter_file;        // file of vehicle profile, reloaded when it changes
+extern const char* const maneuver_table_file;   // file of precomputed maneuver table
+extern const char* const heuristic_table_file;  // file of cached heuristic table of Hybrid A*
+extern const char* const odometry_shm_name;     // shared memory of odometry
+extern const int odometry_history;              // number of odometry samples in shared memory
+extern const char* const trajectory_cache_file; // file of cached trajectory of parking in
+extern const char* const session_store_file;    // file of parking session shared by all processes
+extern const char* const actuator_bus;          // CAN interface of actuators, "loopback": in-process bus
 
 #endif
\ No newline at end of file
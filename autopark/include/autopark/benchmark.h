@@ -0,0 +1,175 @@
+/******************************************************************
+ * Filename: benchmark.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-19
+ * Description: small helpers for benchmark programs: wall clock,
+ * statistics of measured durations, micro benchmarks with time
+ * and allocations per operation and quoting for json reports
+ * 
+ ******************************************************************/
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <new>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+
+// monotonic clock in seconds
+inline double benchmark_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// quote a string for json reports
+inline std::string json_string(const std::string& text)
+{
+    std::string quoted = "\"";
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '"' || text[i] == '\\')
+        {
+            quoted += '\\';
+        }
+        if ((unsigned char)text[i] >= 0x20)
+        {
+            quoted += text[i];
+        }
+    }
+    return quoted + "\"";
+}
+
+// allocations of the calling thread, counted only in the program which defines
+// BENCHMARK_COUNT_ALLOCATIONS before including this header
+inline unsigned long& benchmark_allocations()
+{
+    static thread_local unsigned long count = 0;
+    return count;
+}
+
+#ifdef BENCHMARK_COUNT_ALLOCATIONS
+// replace the global operator new of the program, operator new[] calls it
+void* operator new(size_t size)
+{
+    benchmark_allocations()++;
+    void* memory = malloc(size ? size : 1);
+    if (memory == NULL)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+    free(memory);
+}
+#endif
+
+// collect durations of one benchmark and print statistics
+class BenchmarkStats
+{
+private:
+    std::string name_;
+    std::vector<double> samples_;
+
+public:
+    BenchmarkStats(const std::string& name) : name_(name) {}
+
+    void add(double duration) { samples_.push_back(duration); }
+    size_t size() const { return samples_.size(); }
+
+    // duration at percentile [0, 100]
+    double percentile(double p) const
+    {
+        if (samples_.empty())
+        {
+            return 0;
+        }
+        std::vector<double> sorted(samples_);
+        std::sort(sorted.begin(), sorted.end());
+        size_t index = std::min(sorted.size() - 1, (size_t)(p / 100 * sorted.size()));
+        return sorted[index];
+    }
+
+    double mean() const
+    {
+        double sum = 0;
+        for (size_t i = 0; i < samples_.size(); i++)
+        {
+            sum += samples_[i];
+        }
+        return samples_.empty() ? 0 : sum / samples_.size();
+    }
+
+    // print one line: count, mean, median, p99 and maximum in [ms]
+    void print() const
+    {
+        printf("%-32s n=%-6u mean=%9.3fms p50=%9.3fms p99=%9.3fms max=%9.3fms\n", name_.c_str(), \
+        (unsigned)samples_.size(), mean() * 1e3, percentile(50) * 1e3, percentile(99) * 1e3, percentile(100) * 1e3);
+    }
+};
+
+// run one operation in batches for at least min_time [s], batches grow until
+// the clock is read rarely enough, print time and allocations per operation
+class MicroBenchmark
+{
+private:
+    std::string name_;
+    double min_time_;
+    unsigned long operations_;
+    double duration_;
+    unsigned long allocations_;
+
+public:
+    MicroBenchmark(const std::string& name, double min_time = 0.5) : \
+    name_(name), min_time_(min_time), operations_(0), duration_(0), allocations_(0) {}
+
+    // op(i) is called with the index i of the operation, counted from 0
+    template <class Operation>
+    void run(Operation op)
+    {
+        unsigned long batch = 1;
+        operations_ = 0;
+        duration_ = 0;
+        allocations_ = 0;
+        while (duration_ < min_time_)
+        {
+            unsigned long allocations_start = benchmark_allocations();
+            double time_start = benchmark_now();
+            for (unsigned long i = 0; i < batch; i++)
+            {
+                op(operations_ + i);
+            }
+            double duration = benchmark_now() - time_start;
+            allocations_ += benchmark_allocations() - allocations_start;
+            duration_ += duration;
+            operations_ += batch;
+            if (duration < min_time_ / 100)
+            {
+                batch *= 2;
+            }
+        }
+    }
+
+    unsigned long operations() const { return operations_; }
+    double ns_per_op() const { return operations_ ? duration_ / operations_ * 1e9 : 0; }
+    double allocs_per_op() const { return operations_ ? (double)allocations_ / operations_ : 0; }
+
+    // print one line: operations, time and allocations per operation
+    void print() const
+    {
+        printf("%-44s n=%-10lu %10.1fns/op %8.2f allocs/op\n", name_.c_str(), operations_, \
+        ns_per_op(), allocs_per_op());
+    }
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include <queue>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <sstream>
 
@@ -22,6 +23,10 @@
 #include <std_msgs/Bool.h>
 #include <std_msgs/Float32.h>
 #include <std_msgs/Header.h>
+#include "autopark/ParkingSpace.h"
+#include "autopark/session_store.h"
+#include "autopark/time_alignment.h"
+#include "autopark/CarSpeed.h"
 
 
 class ChooseParkingSpace
@@ -38,24 +43,27 @@ private:
     ros::Publisher pub_search_done_;
 
     std_msgs::Bool msg_search_done_;
-    std_msgs::Float32 msg_car_speed_;
-    std_msgs::Header msg_parking_space_;
-    std_msgs::Header msg_parking_space_lf_;
-    std_msgs::Header msg_parking_space_lb_;
-    std_msgs::Header msg_parking_space_rf_;
-    std_msgs::Header msg_parking_space_rb_;
-    std::queue<std_msgs::Header> que_parking_space_lf_;
-    std::queue<std_msgs::Header> que_parking_space_rf_;
+
+    SessionStore session_;
+    TimeAlignment alignment_;
+    autopark::ParkingSpace msg_parking_space_;
+    autopark::ParkingSpace msg_parking_space_lf_;
+    autopark::ParkingSpace msg_parking_space_lb_;
+    autopark::ParkingSpace msg_parking_space_rf_;
+    autopark::ParkingSpace msg_parking_space_rb_;
+    std::queue<autopark::ParkingSpace> que_parking_space_lf_;
+    std::queue<autopark::ParkingSpace> que_parking_space_rf_;
 
 
 public:
     ChooseParkingSpace(ros::NodeHandle* nodehandle);
-    void callback_car_speed(const std_msgs::Float32::ConstPtr& msg);
-    void callback_parking_space_lf(const std_msgs::Header::ConstPtr& msg);
-    void callback_parking_space_lb(const std_msgs::Header::ConstPtr& msg);
-    void callback_parking_space_rf(const std_msgs::Header::ConstPtr& msg);
-    void callback_parking_space_rb(const std_msgs::Header::ConstPtr& msg);
+    void callback_car_speed(const autopark::CarSpeed::ConstPtr& msg);
+    void callback_parking_space_lf(const autopark::ParkingSpace::ConstPtr& msg);
+    void callback_parking_space_lb(const autopark::ParkingSpace::ConstPtr& msg);
+    void callback_parking_space_rf(const autopark::ParkingSpace::ConstPtr& msg);
+    void callback_parking_space_rb(const autopark::ParkingSpace::ConstPtr& msg);
     void choose_parking_space();
+    void save_session();
     ~ChooseParkingSpace();
 };
 
@@ -0,0 +1,66 @@
+/******************************************************************
+ * Filename: command_arbiter.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-27
+ * Description: declare class for arbitrating commands of several
+ * sources by fixed priority levels with lease timeouts
+ * 
+ ******************************************************************/
+
+#ifndef COMMAND_ARBITER_H_
+#define COMMAND_ARBITER_H_
+
+#include <stdint.h>
+
+// priority levels of command sources, higher level overrides lower level
+enum CommandPriority
+{
+    PRIORITY_SEARCH,            // search_parking_space
+    PRIORITY_MANEUVER,          // parking_in, parking_out, controller_path_tracking
+    PRIORITY_AEB,               // surround_monitor
+    PRIORITY_LEVELS
+};
+
+// last command of one level: it holds until expire unless it is renewed
+struct CommandLease
+{
+    float value;
+    double expire;              // [s] end of lease
+    bool valid;
+};
+
+
+// arbiter of one command: the output is the command of the highest level with a
+// valid lease, or the default value if no lease is held
+class CommandArbiter
+{
+private:
+    CommandLease lease_[PRIORITY_LEVELS];
+    double duration_[PRIORITY_LEVELS];  // [s] lease of each level
+    float default_value_;
+    float output_;
+    int active_;                        // level of output, -1: default value
+
+    int highest(double now) const;
+
+public:
+    CommandArbiter();
+
+    void set_lease(int priority, double duration) { duration_[priority] = duration; }
+    void set_default(float value) { default_value_ = value; output_ = value; }
+
+    // command of a source at time now [s]: true if it is applied to the output
+    bool command(int priority, float value, double now);
+    // expire leases at time now [s]: true if the output changes to a lower level
+    bool update(double now);
+    // drop all leases and set output to the default value
+    void reset();
+
+    float output() const { return output_; }
+    int active() const { return active_; }
+
+    ~CommandArbiter();
+};
+
+#endif
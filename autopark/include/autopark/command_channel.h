@@ -0,0 +1,129 @@
+/******************************************************************
+ * Filename: command_channel.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-28
+ * Description: declare template class for publishing commands of a
+ * control loop only on change, with a heartbeat to keep the lease
+ * of the command in controller_arbiter
+ * 
+ ******************************************************************/
+
+#ifndef COMMAND_CHANNEL_H_
+#define COMMAND_CHANNEL_H_
+
+#include <stdint.h>
+#include <string>
+
+#include <ros/ros.h>
+
+
+// channel of one command topic (message with field data): commands set during a control
+// step are coalesced, flush() publishes the last one if it differs from the published one
+template <class M>
+class CommandChannel
+{
+private:
+    ros::Publisher pub_;
+    M pending_;                 // last command set in this step
+    M sent_;                    // last published command
+    M hold_;                    // command of the heartbeat after an event
+    bool has_hold_;
+    bool has_pending_;
+    bool pending_event_;
+    bool has_sent_;
+    bool sent_event_;
+    double heartbeat_;          // [s] period of repeating the last command, 0: no heartbeat
+    ros::WallTime sent_time_;
+    uint64_t published_;
+    uint64_t suppressed_;
+
+    void publish(const M& msg, bool event, const ros::WallTime& now)
+    {
+        pub_.publish(msg);
+        sent_ = msg;
+        sent_event_ = event;
+        sent_time_ = now;
+        has_sent_ = true;
+        published_++;
+    }
+
+public:
+    CommandChannel() : has_hold_(false), heartbeat_(0)
+    {
+        reset();
+    }
+
+    void advertise(ros::NodeHandle& nh, const std::string& topic, double heartbeat)
+    {
+        pub_ = nh.advertise<M>(topic, 1);
+        heartbeat_ = heartbeat;
+    }
+
+    // command repeated by the heartbeat after an event: it renews the lease without applying
+    // the event again. Without it the event itself is repeated
+    void set_hold(const M& msg)
+    {
+        hold_ = msg;
+        has_hold_ = true;
+    }
+
+    // set command of this step; an event (incremental command) is published each time
+    // it is flushed, the heartbeat repeats the hold command after it
+    void set(const M& msg, bool event = false)
+    {
+        if (has_pending_)
+        {
+            suppressed_++;      // coalesced with the previous command of this step
+        }
+        pending_ = msg;
+        pending_event_ = event;
+        has_pending_ = true;
+    }
+
+    // end of step: publish changed command, or repeat the last one if heartbeat is due
+    void flush(bool heartbeat = true)
+    {
+        ros::WallTime now = ros::WallTime::now();
+        if (has_pending_)
+        {
+            has_pending_ = false;
+            if (pending_event_ || !has_sent_ || pending_.data != sent_.data)
+            {
+                publish(pending_, pending_event_, now);
+                return;
+            }
+            suppressed_++;
+        }
+        // the lease of the last command is renewed whether it was an event or not
+        if (heartbeat && heartbeat_ > 0 && has_sent_ && (now - sent_time_).toSec() >= heartbeat_)
+        {
+            if (sent_event_ && has_hold_)
+            {
+                pub_.publish(hold_);
+                sent_time_ = now;
+                published_++;
+            }
+            else
+            {
+                publish(sent_, sent_event_, now);
+            }
+        }
+    }
+
+    // forget the last command and clear the counters, the next command is published
+    void reset()
+    {
+        has_pending_ = false;
+        pending_event_ = false;
+        has_sent_ = false;
+        sent_event_ = false;
+        published_ = 0;
+        suppressed_ = 0;
+    }
+
+    uint64_t published() const { return published_; }
+    uint64_t suppressed() const { return suppressed_; }
+};
+
+#endif
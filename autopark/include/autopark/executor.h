@@ -0,0 +1,120 @@
+/******************************************************************
+ * Filename: executor.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-10
+ * Description: declare classes for running the callbacks of a node
+ * on a fixed number of threads: a work-stealing thread pool, and
+ * strands which run the callbacks of one object one at a time
+ * 
+ ******************************************************************/
+
+#ifndef EXECUTOR_H_
+#define EXECUTOR_H_
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <ros/callback_queue_interface.h>
+
+
+typedef boost::function<void()> ExecutorTask;
+
+class Strand;
+
+// fixed pool of threads, each with its own queue of tasks: a task posted by a thread
+// of the pool stays in its queue, idle threads steal tasks from the others
+class Executor
+{
+private:
+    struct Worker
+    {
+        boost::mutex mutex;
+        std::deque<ExecutorTask> tasks;
+    };
+
+    std::vector<Worker*> workers_;
+    boost::thread_group threads_;
+
+    boost::mutex mutex_;                    // idle threads wait for posted tasks
+    boost::condition_variable wakeup_;
+    boost::atomic<size_t> pending_;         // tasks posted and not taken yet
+    size_t next_;                           // queue of next task posted by another thread
+    bool stopping_;
+    std::vector<Strand*> strands_;          // strands running on this executor, guarded by mutex_
+
+    bool take(size_t index, ExecutorTask& task);
+    void work(size_t index);
+
+public:
+    explicit Executor(unsigned threads);
+
+    // run task on a thread of the pool
+    void post(const ExecutorTask& task);
+    size_t threads() const { return workers_.size(); }
+
+    // strands register themselves while they live
+    void attach(Strand* strand);
+    void detach(Strand* strand);
+
+    // tasks not started yet are dropped: the strands still attached lose their posted
+    // run and are stopped, they run no more callbacks. Destroy the strands first
+    ~Executor();
+};
+
+
+// callbacks of ROS subscriptions and timers, run one at a time by the executor:
+// set as callback queue of a node handle instead of a CallbackQueue and AsyncSpinner
+class Strand : public ros::CallbackQueueInterface
+{
+private:
+    struct Entry
+    {
+        ros::CallbackInterfacePtr callback;
+        uint64_t owner;
+    };
+
+    Executor& executor_;
+    boost::mutex mutex_;
+    boost::condition_variable idle_;
+    std::deque<Entry> queue_;
+    std::deque<Entry> retry_;               // callbacks not ready, queued again by addCallback
+    bool enabled_;                          // callbacks are run, like a started spinner
+    bool scheduled_;                        // a run is posted to the executor or running
+    bool calling_;                          // a callback is running
+    bool detached_;                         // the executor is destroyed
+    uint64_t calling_owner_;
+    boost::thread::id calling_thread_;
+
+    void schedule();
+    void run();
+    static void remove_owner(std::deque<Entry>& entries, uint64_t owner_id);
+
+    friend class Executor;
+    // the executor is destroyed: its posted run is dropped
+    void abandon();
+
+public:
+    explicit Strand(Executor& executor);
+
+    virtual void addCallback(const ros::CallbackInterfacePtr& callback, uint64_t owner_id = 0);
+    virtual void removeByID(uint64_t owner_id);
+
+    // start or stop running callbacks, stop waits for the running callback:
+    // it must not be called from a callback of this strand
+    void start();
+    void stop();
+    // drop callbacks not run yet
+    void clear();
+
+    // must be destroyed before its executor
+    virtual ~Strand();
+};
+
+#endif
@@ -0,0 +1,79 @@
+/******************************************************************
+ * Filename: firing_scheduler.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-17
+ * Description: declare scheduler of firing the ultrasonic sensors in
+ * time slots without crosstalk, weighted by the current driving mode,
+ * and a pseudo-device measuring the channels it fires
+ * 
+ ******************************************************************/
+
+#ifndef FIRING_SCHEDULER_H_
+#define FIRING_SCHEDULER_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
+#include "autopark/ultrasonic.h"
+
+// need of the sensors: weights of the channels in firing_weights
+enum FiringMode
+{
+    FIRING_IDLE,                        // all sensors alike
+    FIRING_SEARCH,                      // side apas measure parking spaces
+    FIRING_FORWARD,                     // front upas watch the way
+    FIRING_BACKWARD,                    // rear upas and apas watch the way
+    FIRING_MODES
+};
+
+extern const char* const firing_mode_names[FIRING_MODES];
+
+// channels which hear the echo of each other: must not fire in the same slot
+bool crosstalk(int channel_a, int channel_b);
+
+// [s] time a channel listens after firing: echo of the maximum range and ring-down
+double echo_time(int channel);
+
+// assigns time slots to the channels by stride scheduling: the channel fired least relative
+// to its weight leads a slot and sets its duration, channels without crosstalk to the fired
+// ones join the slot if their echo fits in it. Thread-safe
+class FiringScheduler
+{
+private:
+    boost::mutex mutex_;
+    FiringMode mode_;
+    double pass_[ULTRASONIC_CHANNELS];  // virtual time of the next firing of each channel
+
+public:
+    FiringScheduler();
+
+    void set_mode(FiringMode mode);
+    FiringMode mode();
+
+    // channels to fire in the next slot, return duration [s] of the slot
+    double next_slot(std::vector<int>& channels);
+
+    // [Hz] rates of the channels in the current mode: simulate slots of duration [s]
+    // on a copy, the scheduler is not changed
+    void rates(double duration, float rates[ULTRASONIC_CHANNELS]);
+};
+
+// pseudo-device firing the channels by the scheduler, each slot is written when it ends
+// with the given ranges of the channels and uniform noise as of a real sensor
+class FiringDevice : public PseudoDevice
+{
+private:
+    FiringScheduler& scheduler_;
+    std::vector<float> ranges_;         // [m] of each channel
+    float noise_;                       // [m] maximum deviation from the ranges
+
+    virtual void run();
+
+public:
+    FiringDevice(FiringScheduler& scheduler, const float ranges[ULTRASONIC_CHANNELS], float noise);
+    ~FiringDevice(void);
+};
+
+#endif
@@ -0,0 +1,130 @@
+/******************************************************************
+ * Filename: hybrid_astar.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-19
+ * Description: declare class for Hybrid A* path planning over a
+ * local occupancy grid, for tight parking spaces and narrow aisles
+ * 
+ ******************************************************************/
+
+#ifndef HYBRID_ASTAR_H_
+#define HYBRID_ASTAR_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "autopark/path_tracking.h"
+#include "autopark/parking_planner.h"
+
+
+// node of search tree
+struct SearchNode
+{
+    CarPose pose;
+    float cost;                 // cost from start
+    float total;                // cost from start + heuristic
+    SearchNode* parent;
+    uint32_t index;             // index of discrete state (cell and yaw)
+    int8_t direction;           // move from parent: 1 forward, -1 backward
+    int8_t steer;               // move from parent: index of steering angle
+};
+
+// arena for search nodes: memory is allocated in blocks and reused by each search
+class NodeArena
+{
+private:
+    std::vector<SearchNode*> blocks_;
+    size_t used_;
+
+public:
+    NodeArena();
+
+    SearchNode* allocate();
+    void reset() { used_ = 0; }
+    size_t size() const { return used_; }
+
+    ~NodeArena();
+};
+
+// local occupancy grid with distance to the nearest obstacle
+class OccupancyGrid
+{
+private:
+    double x_min_;
+    double y_min_;
+    double resolution_;
+    int width_;
+    int height_;
+    std::vector<float> distance_;   // [m] distance from cell to nearest obstacle
+
+public:
+    OccupancyGrid();
+
+    // rasterize boxes in the area [x_min, x_max] x [y_min, y_max], then compute distances
+    void set(const std::vector<Box>& obstacles, double x_min, double x_max, double y_min, double y_max, double resolution);
+
+    // distance to the nearest obstacle, 0 outside of grid
+    float distance(double x, double y) const;
+
+    double x_min() const { return x_min_; }
+    double y_min() const { return y_min_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    double resolution() const { return resolution_; }
+
+    ~OccupancyGrid();
+};
+
+// Hybrid A*: search over continuous poses with discrete states for pruning,
+// heuristic is the maximum of the non-holonomic cost without obstacles (cached table)
+// and the holonomic cost with obstacles (computed for each search)
+class HybridAStar
+{
+private:
+    OccupancyGrid grid_;
+    NodeArena arena_;
+    std::vector<Box> obstacles_;
+
+    // cost of the best node of each discrete state, valid if stamp is equal to search_
+    std::vector<float> state_cost_;
+    std::vector<uint32_t> state_stamp_;
+    uint32_t search_;
+
+    // holonomic cost to goal with obstacles on the coarse grid
+    std::vector<float> holonomic_;
+    int cells_x_;
+    int cells_y_;
+
+    // non-holonomic cost without obstacles, from origin to relative pose (y >= 0)
+    std::vector<float> heuristic_;
+
+    size_t expanded_;
+    double duration_;
+
+    bool free(const CarPose& pose) const;
+    bool move(CarPose& pose, double steering, double length) const;
+    uint32_t state_index(const CarPose& pose) const;
+    float heuristic(const CarPose& pose, const CarPose& goal) const;
+    void compute_holonomic(const CarPose& goal);
+    void compute_heuristic();
+
+public:
+    HybridAStar();
+
+    // load non-holonomic heuristic table from file, compute and save it if missing or outdated
+    bool load_heuristic(const char* filename);
+    // heuristic table is loaded or computed: searches are guided by it
+    bool heuristic_valid() const;
+
+    // search a path from start to goal within time_budget [s], return false if no path is found
+    bool plan(const std::vector<Box>& obstacles, const CarPose& start, const CarPose& goal, \
+    double time_budget, std::vector<PathSegment>& segments);
+
+    size_t expanded() const { return expanded_; }       // nodes expanded in last search
+    double duration() const { return duration_; }       // [s] duration of last search
+
+    ~HybridAStar();
+};
+
+#endif
@@ -0,0 +1,79 @@
+/******************************************************************
+ * Filename: lifecycle.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-13
+ * Description: declare stages of the parking pipeline and class for
+ * nodes following the stage published by lifecycle_manager
+ * 
+ ******************************************************************/
+
+#ifndef LIFECYCLE_H_
+#define LIFECYCLE_H_
+
+#include <stdint.h>
+
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <ros/ros.h>
+#include "autopark/PipelineStage.h"
+#include "autopark/StageAck.h"
+
+// stages of the pipeline, a session runs search -> park in -> done, or park out -> done
+#define STAGE_IDLE          0       // nothing runs
+#define STAGE_SEARCH        1       // search parking space, choose it and prepare parking in
+#define STAGE_PARK_IN       2       // parking space is chosen, parking in runs
+#define STAGE_DONE          3       // parking in or out is finished
+#define STAGE_PARK_OUT      4       // parking out runs
+#define STAGE_COUNT         5
+
+#define STAGE_BIT(stage)    (1u << (stage))
+
+extern const char* const stage_names[];         // names of STAGE_*, for logging
+
+// name of a stage for logging, "unknown" for a stage out of range, e.g. from a newer node
+const char* stage_name(uint8_t stage);
+
+// wall time [s] when this process was launched, 0 if /proc is not readable
+double process_launch_time();
+
+// stage of the pipeline and the time of all nodes until they are ready to search are
+// published latched on pipeline_stage and pipeline_ready by lifecycle_manager
+
+// handler of a node: called with true when the node becomes active, false when inactive
+typedef boost::function<void(bool)> StageHandler;
+
+// stage of the pipeline in a node: subscribes the latched stage, calls the handler when the
+// node becomes active or inactive, and acknowledges each stage to lifecycle_manager
+class LifecycleNode
+{
+private:
+    ros::NodeHandle nh_;
+    ros::Subscriber sub_stage_;
+    ros::Publisher pub_ack_;
+
+    uint32_t stages_;                   // bits of stages in which the node is active
+    StageHandler handler_;
+
+    boost::mutex mutex_;
+    boost::condition_variable changed_;
+    bool active_;
+    uint32_t session_;
+    double launch_;                     // [s] wall time when the process was launched
+
+    void callback_stage(const autopark::PipelineStage::ConstPtr& msg);
+
+public:
+    // stages: STAGE_BIT() of the stages in which the node is active,
+    // the handler is called on the thread spinning the global callback queue
+    LifecycleNode(uint32_t stages, const StageHandler& handler);
+
+    bool active();
+    uint32_t session();
+
+    // wait until the node is active (or inactive), at most timeout [s]: true if it is
+    bool wait_until(bool active, double timeout);
+};
+
+#endif
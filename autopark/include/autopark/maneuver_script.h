@@ -0,0 +1,94 @@
+/******************************************************************
+ * Filename: maneuver_script.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-20
+ * Description: declare maneuvers written as a script of steps "do X
+ * until condition, then Y": a stackless coroutine which the node
+ * resumes with each new measurement, so that a maneuver holds no
+ * thread and no polling loop
+ * 
+ ******************************************************************/
+
+#ifndef MANEUVER_SCRIPT_H_
+#define MANEUVER_SCRIPT_H_
+
+#include <cmath>
+
+#include <boost/asio/coroutine.hpp>
+#include "autopark/side_traits.h"
+
+// latest measurements, the input of a step of a maneuver
+struct ManeuverInput
+{
+    double distance;                    // [m] driven distance, forward positive
+    float speed;                        // [m/s] car speed
+    float range[RANGE_SENSORS];         // [m] in order of RangeSensor, +inf is no echo
+};
+
+// commands of a step, valid if set in the step
+struct ManeuverCommand
+{
+    float move;                         // [m/s] car speed, 0 is stop
+    char turn;                          // 'D' straight, 'L' 'R' full, 'l' 'r' a little
+    bool move_set;
+    bool turn_set;
+};
+
+// base of maneuvers: step() is the script of the maneuver between MANEUVER_BEGIN and
+// the end of its block. A variable living across a wait is a member of the maneuver,
+// local variables are lost at each wait. A return without a wait ends the maneuver
+class Maneuver
+{
+private:
+    const ManeuverInput* input_;
+    ManeuverCommand command_;
+    bool succeeded_;
+    unsigned int steps_;
+
+protected:
+    boost::asio::coroutine coroutine_;  // line of the script to resume
+    double travel_start_;               // [m] driven distance at the start of MANEUVER_TRAVEL
+
+    virtual void step() = 0;
+
+    float range(int sensor) const { return input_->range[sensor]; }
+    float speed() const { return input_->speed; }
+    double distance() const { return input_->distance; }
+
+    // commands of this step, the last one of a step is published
+    void move(float speed);
+    void turn(char turn);
+    // the maneuver reached its goal, it ends at the end of the script
+    void succeed() { succeeded_ = true; }
+
+public:
+    Maneuver();
+    virtual ~Maneuver() {}
+
+    // run the script until the next wait with the latest measurements, false if it is over
+    bool resume(const ManeuverInput& input);
+
+    bool done() const { return coroutine_.is_complete(); }
+    bool succeeded() const { return succeeded_; }
+    unsigned int steps() const { return steps_; }
+    // commands set by the last resume
+    const ManeuverCommand& command() const { return command_; }
+};
+
+// statements of a script, each one on a line of its own: a wait is resumed at its line
+#define MANEUVER_BEGIN BOOST_ASIO_CORO_REENTER(coroutine_)
+
+// wait for the next measurements
+#define MANEUVER_YIELD BOOST_ASIO_CORO_YIELD return
+
+// wait until the condition holds, it is checked with each measurement
+#define MANEUVER_UNTIL(condition) \
+    while (!(condition)) { MANEUVER_YIELD; }
+
+// wait until the car has driven length [m] forward or backward
+#define MANEUVER_TRAVEL(length) \
+    travel_start_ = distance(); \
+    MANEUVER_UNTIL(fabs(distance() - travel_start_) >= (length))
+
+#endif
@@ -0,0 +1,89 @@
+/******************************************************************
+ * Filename: maneuver_table.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-15
+ * Description: declare binary layout of the precomputed maneuver
+ * table and class for looking up maneuvers in memory-mapped table
+ * 
+ ******************************************************************/
+
+#ifndef MANEUVER_TABLE_H_
+#define MANEUVER_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+#include "autopark/parking_planner.h"
+
+#define MANEUVER_TABLE_MAGIC        "APMTBL"
+#define MANEUVER_TABLE_VERSION      1
+#define MANEUVER_SEGMENTS_MAX       16      // maximum number of segments in one cell
+#define MANEUVER_TYPES              4       // SPACE_* types in one table
+#define MANEUVER_AXES               4       // width, length, distance, heading
+
+// axis of table: value = min + i * step, i = 0 ... count - 1
+struct TableAxis
+{
+    float min;
+    float step;
+    uint32_t count;
+};
+
+// cells of one SPACE_* type, stored in order of width, length, distance, heading (heading fastest)
+struct ManeuverBlock
+{
+    uint32_t type;                      // SPACE_* type
+    TableAxis axis[MANEUVER_AXES];      // width, length, distance [m] and heading [rad]
+    uint32_t cells;                     // byte offset of first cell from begin of file
+};
+
+// header at begin of file
+struct ManeuverTableHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t segments_max;
+    float offset;                       // [m] offset of parking space used for planning
+    float car_length;                   // [m] car parameters used for planning
+    float car_width;
+    float wheel_base;
+    float steering_angle_max;
+    ManeuverBlock block[MANEUVER_TYPES];
+};
+
+// maneuver of one cell, count = 0: no maneuver found
+struct ManeuverCell
+{
+    uint8_t count;
+    uint8_t reserved[3];
+    PathSegment segment[MANEUVER_SEGMENTS_MAX];
+};
+
+
+// read-only table of maneuvers mapped into memory
+class ManeuverTable
+{
+private:
+    const uint8_t* data_;
+    size_t size_;
+
+    const ManeuverTableHeader* header() const { return (const ManeuverTableHeader*)data_; }
+    const ManeuverCell* cell(const ManeuverBlock& block, const uint32_t index[]) const;
+
+public:
+    ManeuverTable();
+
+    // map table file into memory, return false if it is missing or invalid
+    bool open(const char* filename);
+    void close();
+    bool is_open() const { return data_ != NULL; }
+
+    // look up maneuver with interpolation between the neighbor cells
+    bool lookup(uint32_t type, const SpaceGeometry& space, double heading, std::vector<PathSegment>& segments) const;
+
+    ~ManeuverTable();
+};
+
+#endif
@@ -0,0 +1,110 @@
+/******************************************************************
+ * Filename: odometry.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-22
+ * Description: declare class for integrating car pose from car speed
+ * and steering angle, and shared memory with the history of poses
+ * 
+ ******************************************************************/
+
+#ifndef ODOMETRY_H_
+#define ODOMETRY_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "autopark/path_tracking.h"
+
+#define ODOMETRY_SHM_MAGIC          "APODOM"
+#define ODOMETRY_SHM_VERSION        1
+
+// integrated car state at a time stamp
+struct OdometrySample
+{
+    double stamp;       // [s] ROS time
+    double x;           // [m] pose of rear axle in odometry frame
+    double y;
+    double yaw;         // [rad]
+    double distance;    // [m] signed driven distance: forward positive, backward negative
+    double odometer;    // [m] total driven distance
+    float speed;        // [m/s]
+    float steering;     // [rad] steering angle of front wheels
+};
+
+// slot of ring buffer: sequence is the index + 1 of the sample, 0 while it is written
+struct OdometrySlot
+{
+    volatile uint64_t sequence;
+    OdometrySample sample;
+};
+
+// shared memory: header and ring buffer of samples
+struct OdometryShared
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t capacity;
+    volatile uint64_t count;            // number of samples written
+    OdometrySlot slots[1];              // capacity slots
+};
+
+
+// integrate car pose exactly along arcs, speed and steering angle are constant
+// between two updates
+class Odometry
+{
+private:
+    OdometrySample state_;
+    bool started_;
+
+public:
+    Odometry();
+
+    // integrate up to time stamp, then apply new speed or steering angle
+    void update(double stamp);
+    void set_speed(double stamp, float speed);
+    void set_steering(double stamp, float steering);
+
+    const OdometrySample& state() const { return state_; }
+    void reset();
+
+    ~Odometry();
+};
+
+
+// shared memory of odometry: one writer (sensor_odometry), any number of readers
+// without locks; a reader retries if the slot is overwritten while it is read
+class OdometryShm
+{
+private:
+    OdometryShared* shared_;
+    size_t size_;
+    bool writer_;
+
+    bool read_slot(uint64_t index, OdometrySample& sample) const;
+
+public:
+    OdometryShm();
+
+    // writer: create shared memory with capacity samples
+    bool create(const char* name, uint32_t capacity);
+    // reader: open existing shared memory, can be retried until the writer is running
+    bool open(const char* name);
+    void close();
+    bool is_open() const { return shared_ != NULL; }
+
+    void write(const OdometrySample& sample);
+
+    // latest sample, false if none is written
+    bool latest(OdometrySample& sample) const;
+    // sample interpolated at time stamp, false if stamp is out of history or more than
+    // odometry_timeout after the latest sample
+    bool at(double stamp, OdometrySample& sample) const;
+    // signed distance driven between two time stamps, false if a stamp is out of history
+    bool distance(double begin, double end, double& distance) const;
+
+    ~OdometryShm();
+};
+
+#endif
@@ -0,0 +1,123 @@
+/******************************************************************
+ * Filename: parameters.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-01
+ * Description: declare parameters of the vehicle profile, loaded at
+ * startup and reloaded when the profile file changes
+ * 
+ ******************************************************************/
+
+#ifndef PARAMETERS_H_
+#define PARAMETERS_H_
+
+#include <boost/atomic.hpp>
+
+
+// snapshot of all parameters: a snapshot is never changed after it is published, a reload
+// publishes a new one. Geometry of the car (car_width ... steering_angle_max) and rates are
+// only loaded at startup: cached tables depend on the geometry, timers are created with the rates.
+struct Parameters
+{
+    float range_diff;                           // [m] range difference to distinguish turn point
+    float distance_search;                      // [m] maximum distance between car and parking space
+    float parallel_width;                       // [m] minimum width of parallel parking space
+    float parallel_length;                      // [m] minimum length of parallel parking space
+    float perpendicular_width;                  // [m] minimum width of perpendicular parking space
+    float perpendicular_length;                 // [m] minimum length of perpendicular parking space
+    float car_width;                            // [m] minimum width of car
+    float car_length;                           // [m] minimum length of car
+    float distance_apa;                         // [m] distance between two apas at front and back
+    float apa_width;                            // [m] lateral range of apa
+    float apa_tolerance;                        // [m] measuring tolerance of apa
+    float distance_apa_rear;                    // [m] distance between rear axle and apas at back
+    float rear_overhang;                        // [m] distance between rear axle and rear of car
+    float wheel_base;                           // [m] distance between front and rear axle
+    float steering_angle_max;                   // [rad] maximum steering angle of front wheels
+    float steering_angle_step;                  // [rad] steering angle of a little turn ('l' or 'r')
+
+    float brake_distance_default;               // [m] default brake distance
+    float move_distance_perpendicular;          // [m] move distance before perpendicular parking in
+    float parking_distance_min;                 // [m] minimum distance between car and parkwall (car)
+    float parking_distance_max;                 // [m] maximum distance between car and parkwall (car)
+    float distance_perpendicular_out;           // [m] move distance for perpendicular parking out
+    float distance_parallel_out;                // [m] safe distance for parallel parking out
+
+    float speed_search_parking;                 // [m/s] car speed when search parking space
+    float speed_parking_forward;                // [m/s] car speed when move forward for parking
+    float speed_parking_backward;               // [m/s] car speed when move backward for parking
+
+    float planner_margin;                       // [m] safety margin around car for path planning
+    float planner_step;                         // [m] step length to check collision of planned path
+    float path_sample_step;                     // [m] distance between points of published path
+    float lookahead_distance;                   // [m] lookahead distance of path tracking
+    float path_goal_tolerance;                  // [m] tolerance to reach the end of a path segment
+    float path_tracking_rate;                   // [Hz] loop rate of path tracking controller
+    float tracking_decel;                       // [m/s^2] deceleration of path tracking before cusps
+    float tracking_speed_min;                   // [m/s] creep speed of path tracking to reach cusps
+    float steering_lag_max;                     // [rad] steering lag of path tracking where the car stops
+    float hybrid_astar_time_budget;             // [s] maximum search time of Hybrid A*
+    float aisle_range_max;                      // [m] maximum apa range to obstacles on the other side of aisle
+    float odometry_rate;                        // [Hz] rate of integrating and publishing odometry
+    float odometry_timeout;                     // [s] maximum extrapolation of odometry after its latest sample
+    float trajectory_tolerance;                 // [m] tolerance of replaying cached trajectory for parking out
+
+    float parking_time;                         // [s] total time for parking
+    float parking_control_rate;                 // [Hz] rate of steps of parking in
+    float executor_threads;                     // number of threads running the callbacks of a node
+    float lifecycle_transition_max;             // [s] maximum time until all nodes applied a stage of the pipeline
+    float startup_ready_max;                    // [s] maximum time from launch until all nodes are ready to search
+
+    float arbiter_rate;                         // [Hz] rate of expiring leases of commands
+    float arbiter_report_period;                // [s] period of reporting latency of arbitration
+    float lease_aeb;                            // [s] lease of commands of surround_monitor
+    float lease_maneuver;                       // [s] lease of commands of parking in and out
+    float lease_search;                         // [s] lease of commands of searching parking space
+    float command_heartbeat;                    // [s] period of repeating unchanged commands
+    float actuator_rate;                        // [Hz] rate of sending command frames to actuators
+    float steering_dead_time;                   // [s] dead time of steering actuator
+    float steering_rate_max;                    // [rad/s] maximum rate of steering angle
+    float drive_dead_time;                      // [s] dead time of drive actuator
+    float drive_accel_max;                      // [m/s^2] maximum acceleration of drive
+    float drive_decel_max;                      // [m/s^2] maximum deceleration of drive
+
+    float speed_of_sound;                       // [m/s] speed of sound for echo time of ultrasonic sensors
+    float firing_guard_time;                    // [s] ring-down of ultrasonic sensors added to a firing slot
+    float health_rate;                          // [Hz] rate of publishing the health of the sensors
+    float health_smoothing;                     // weight of a measurement in the statistics of sensor health
+    float health_timeout;                       // [s] time without measurement until a sensor is stale
+    float health_rate_min;                      // [Hz] minimum rate of a healthy sensor
+    float health_jitter_max;                    // maximum jitter of a healthy sensor relative to its interval
+    float health_noise_max;                     // [m] maximum difference of successive ranges of a healthy sensor
+    float health_stuck_samples;                 // successive unchanged ranges until a sensor is stuck
+    float health_moving_speed;                  // [m/s] car speed above which unchanged ranges count as stuck
+    float health_out_of_range_max;              // maximum ratio of ranges of a healthy sensor outside its range
+    float alignment_history;                    // [s] history of car speed to align measurements with
+    float alignment_hold;                       // [s] car speed is held after its latest sample
+    float alignment_delay;                      // [s] odometry waits for late samples of car speed
+
+    Parameters();       // default profile
+};
+
+// current snapshot, replaced by reload
+extern boost::atomic<const Parameters*> parameters_snapshot;
+
+// parameters of the current snapshot: one atomic load, no lock
+inline const Parameters& params()
+{
+    return *parameters_snapshot.load(boost::memory_order_acquire);
+}
+
+// load profile file ("name: value" per line, '#' comment) on top of the current snapshot
+// and publish it, return false and keep the current snapshot if the file is invalid
+bool load_parameters(const char* filename);
+
+// load profile file if it exists, then reload it in a background thread whenever it changes;
+// the file is ~profile if set, else a relative filename is in the package directory.
+// Parameters which are not reloadable are only loaded before watch_parameters() returns
+void watch_parameters(const char* filename);
+
+// number of snapshots published by load_parameters()
+unsigned parameters_version();
+
+#endif
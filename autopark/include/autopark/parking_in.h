@@ -11,8 +11,15 @@
 #define PARKING_IN_H_
 
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <algorithm>
+#include <vector>
 
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <ros/ros.h>
 #include <ros/spinner.h>
 #include <ros/callback_queue.h>
@@ -22,6 +29,32 @@
 #include <std_msgs/Float32.h>
 #include <std_msgs/Header.h>
 #include <sensor_msgs/Range.h>
+#include <nav_msgs/Path.h>
+#include "autopark/ParkingSpace.h"
+#include "autopark/parking_planner.h"
+#include "autopark/maneuver_table.h"
+#include "autopark/hybrid_astar.h"
+#include "autopark/executor.h"
+#include "autopark/odometry.h"
+#include "autopark/side_traits.h"
+#include "autopark/sensor_health.h"
+#include "autopark/trajectory_cache.h"
+#include "autopark/session_store.h"
+#include "autopark/command_channel.h"
+
+
+// state of parking in, stepped by the control timer
+enum ParkingInState
+{
+    PARKING_IDLE,               // wait for a parking space
+    PARKING_MOVE_BEFORE,        // move forward before perpendicular parking in
+    PARKING_TURN_IN,            // move backward with full steering until car rear is in parking space
+    PARKING_ALIGN,              // align car to the parked cars and move backward to the end
+    PARKING_SEARCH_PATH,        // Hybrid A* searches a path on its own thread, car is stopped
+    PARKING_FOLLOW_PATH,        // follow planned path with controller_path_tracking
+    PARKING_FINISHED,
+    PARKING_ABORTED             // cancelled or timed out: car is stopped
+};
 
 
 class ParkingIn
@@ -31,6 +64,7 @@ private:
 
     ros::Subscriber sub_parking_space_;
     ros::Subscriber sub_car_speed_;
+    ros::Subscriber sub_path_done_;
     ros::Subscriber sub_apa_lf_;
     ros::Subscriber sub_apa_lb_;
     ros::Subscriber sub_apa_lb2_;
@@ -46,27 +80,46 @@ private:
     ros::Subscriber sub_upa_bcr_;
     ros::Subscriber sub_upa_br_;
 
-    ros::Publisher pub_move_;
-    ros::Publisher pub_turn_;
+    CommandChannel<std_msgs::Float32> channel_move_;
+    CommandChannel<std_msgs::Char> channel_turn_;
+    ros::Publisher pub_path_;
+    ros::Publisher pub_parking_in_done_;
 
     ros::WallTimer timer_;
-
-    std_msgs::Header msg_parking_space_;
+    ros::WallTimer timer_control_;
+
+    // state machine: all steps and transitions are done with mutex_ locked
+    boost::mutex mutex_;
+    ParkingInState state_;
+    double moved_distance_;     // [m] distance moved in state PARKING_MOVE_BEFORE
+    ros::Time move_begin_;      // time of entering state PARKING_MOVE_BEFORE
+    ros::Time move_last_;       // time of last step in state PARKING_MOVE_BEFORE
+
+    OdometryShm odometry_;
+    TrajectoryCache trajectory_;
+    SessionStore session_;
+
+    ManeuverTable table_;
+    ParkingPlanner planner_;
+    HybridAStar astar_;
+    boost::thread heuristic_loader_;    // loads the heuristic of astar_ after startup
+    boost::atomic<bool> heuristic_ready_;
+    Executor searcher_;                 // own thread of the searches of astar_: the strand goes on
+
+    // search of astar_: posted by parking_planned, its result is picked up by callback_control
+    boost::mutex search_mutex_;
+    boost::condition_variable search_idle_;
+    bool search_running_;
+    unsigned search_posted_;            // number of the last search posted
+    unsigned search_finished_;          // number of the last search finished
+    bool search_found_;
+    std::vector<PathSegment> search_segments_;
+    bool path_done_;
+
+    autopark::ParkingSpace msg_parking_space_;
     std_msgs::Float32 msg_car_speed_;
-    sensor_msgs::Range msg_apa_lf_;
-    sensor_msgs::Range msg_apa_lb_;
-    sensor_msgs::Range msg_apa_lb2_;
-    sensor_msgs::Range msg_apa_rf_;
-    sensor_msgs::Range msg_apa_rb_;
-    sensor_msgs::Range msg_apa_rb2_;
-    sensor_msgs::Range msg_upa_fl_;
-    sensor_msgs::Range msg_upa_fcl_;
-    sensor_msgs::Range msg_upa_fcr_;
-    sensor_msgs::Range msg_upa_fr_;
-    sensor_msgs::Range msg_upa_bl_;
-    sensor_msgs::Range msg_upa_bcl_;
-    sensor_msgs::Range msg_upa_bcr_;
-    sensor_msgs::Range msg_upa_br_;
+    sensor_msgs::Range msg_range_[RANGE_SENSORS];
+    HealthFilter health_;               // degraded sensors read as blocked in msg_range_
 
     std_msgs::Float32 msg_cmd_move_;
     std_msgs::Char msg_cmd_turn_;
@@ -74,8 +127,9 @@ private:
 public:
     ParkingIn(ros::NodeHandle* nodehandle);
 
-    void callback_parking_space(const std_msgs::Header::ConstPtr& msg);
+    void callback_parking_space(const autopark::ParkingSpace::ConstPtr& msg);
     void callback_car_speed(const std_msgs::Float32::ConstPtr& msg);
+    void callback_path_done(const std_msgs::Bool::ConstPtr& msg);
 
     void callback_apa_lf(const sensor_msgs::Range::ConstPtr& msg);
     void callback_apa_lb(const sensor_msgs::Range::ConstPtr& msg);
@@ -95,12 +149,31 @@ public:
     void callback_upa_br(const sensor_msgs::Range::ConstPtr& msg);
 
     void callback_timer(const ros::WallTimerEvent& event);
-
-    void move_before_parking(float move_distance);
-    void parking_left_perpendicular();
-    void parking_left_parallel();
-    void parking_right_perpendicular();
-    void parking_right_parallel();
+    void callback_control(const ros::WallTimerEvent& event);
+
+    void start_parking();
+    void cancel_parking();
+    void stop_parking(ParkingInState state);
+    ParkingInState state() const { return state_; }
+    bool parking_active() const { return state_ != PARKING_IDLE && state_ != PARKING_FINISHED && state_ != PARKING_ABORTED; }
+
+    void command_move();
+    void command_turn();
+    void flush_commands(bool heartbeat);
+    bool driven_distance(const ros::Time& begin, const ros::Time& end, double& distance);
+    bool moved_pose(const ros::Time& begin, const ros::Time& end, CarPose& pose);
+    void record_trajectory();
+    void save_trajectory();
+    void save_session();
+    void start_move_before();
+    bool move_before_parking(float move_distance);
+    void start_perpendicular();
+    template <ParkingSide side>
+    void parking_perpendicular();
+    void load_heuristic();
+    bool parking_planned();
+    void search_path(const std::vector<Box>& obstacles, const CarPose& start, const CarPose& goal, unsigned search);
+    void follow_path(const std::vector<PathSegment>& segments);
 
     ~ParkingIn();
 };
@@ -0,0 +1,165 @@
+/******************************************************************
+ * Filename: parking_kernels.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-02
+ * Description: kernels of searching parking spaces, monitoring the
+ * surround and checking maneuvers, instantiated per vehicle profile
+ * 
+ ******************************************************************/
+
+#ifndef PARKING_KERNELS_H_
+#define PARKING_KERNELS_H_
+
+#include <cmath>
+
+#include "autopark/vehicle_profile.h"
+#include "autopark/path_tracking.h"
+#include "autopark/parking_planner.h"
+
+
+// trend of apa range between two messages
+enum RangeTrend
+{
+    RANGE_DECREASE = -1,        // away from parking space (parking gap)
+    RANGE_STABLE = 0,
+    RANGE_INCREASE = 1          // close to parking space (parking gap)
+};
+
+// kind of parking space from measured lengths
+enum SpaceKind
+{
+    KIND_NONE = 0,
+    KIND_PERPENDICULAR = 1,
+    KIND_PARALLEL = 2
+};
+
+
+// search: trend of range from front to back of the queue of apa messages
+template <class P>
+inline int range_trend(float front, float back)
+{
+    if (back - front > P::range_diff())
+    {
+        return RANGE_INCREASE;
+    }
+    if (front - back > P::range_diff())
+    {
+        return RANGE_DECREASE;
+    }
+    return RANGE_STABLE;
+}
+
+// search: kind of parking space from the length of the parked object (a car)
+template <class P>
+inline int object_kind(double length)
+{
+    if (length < P::perpendicular_width() && length > P::car_width())
+    {
+        return KIND_PERPENDICULAR;
+    }
+    if (length < P::parallel_width() && length > P::car_length())
+    {
+        return KIND_PARALLEL;
+    }
+    return KIND_NONE;
+}
+
+// search: a measured gap is large enough for perpendicular or parallel parking
+template <class P>
+inline bool space_valid(double width, double length)
+{
+    return (width > P::perpendicular_width() && length > P::perpendicular_length()) || \
+    (width > P::parallel_width() && length > P::parallel_length());
+}
+
+// search: kind of a valid space with 3 walls, KIND_NONE: the kind of the parked object applies
+template <class P>
+inline int space_kind(double width, double length)
+{
+    if (length < P::perpendicular_length())
+    {
+        return KIND_PARALLEL;
+    }
+    if (width < P::parallel_width())
+    {
+        return KIND_PERPENDICULAR;
+    }
+    return KIND_NONE;
+}
+
+
+// monitor: brake distance at speed [m/s], 0.1v + v²/(2µg) with µ=0.8, g=9.8 m/s²
+inline float brake_distance_at(float speed)
+{
+    return 0.1 * fabs(speed) + speed * speed / 15.68;
+}
+
+// monitor: one of the upas at front or back is within distance
+inline bool ranges_blocked(const float* ranges, int count, float distance)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (ranges[i] < distance)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// monitor: all upas at front or back are beyond the default brake distance
+template <class P>
+inline bool ranges_clear(const float* ranges, int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (ranges[i] <= P::brake_distance_default())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// maneuver: collision between car (with safety margin) and box, separating axis test
+template <class P>
+inline bool car_collision_box(const CarPose& pose, const Box& box)
+{
+    double ux = cos(pose.yaw), uy = sin(pose.yaw);      // car axis along
+    double vx = -uy, vy = ux;                           // car axis across
+    double half_length = P::car_length() / 2 + P::planner_margin();
+    double half_width = P::car_width() / 2 + P::planner_margin();
+    double center_x = pose.x + ux * (P::car_length() / 2 - P::rear_overhang());
+    double center_y = pose.y + uy * (P::car_length() / 2 - P::rear_overhang());
+
+    double box_x = (box.x_max - box.x_min) / 2;
+    double box_y = (box.y_max - box.y_min) / 2;
+    double dx = (box.x_max + box.x_min) / 2 - center_x;
+    double dy = (box.y_max + box.y_min) / 2 - center_y;
+
+    return !(fabs(dx) > box_x + half_length * fabs(ux) + half_width * fabs(vx) || \
+    fabs(dy) > box_y + half_length * fabs(uy) + half_width * fabs(vy) || \
+    fabs(dx * ux + dy * uy) > half_length + box_x * fabs(ux) + box_y * fabs(uy) || \
+    fabs(dx * vx + dy * vy) > half_width + box_x * fabs(vx) + box_y * fabs(vy));
+}
+
+// maneuver: move car pose exactly along an arc with constant steering angle
+template <class P>
+inline void car_move_arc(CarPose& pose, double steering, double length)
+{
+    double curvature = tan(steering) / P::wheel_base();
+    if (fabs(curvature) < 1e-6)
+    {
+        pose.x += length * cos(pose.yaw);
+        pose.y += length * sin(pose.yaw);
+        return;
+    }
+    double yaw = pose.yaw + curvature * length;
+    pose.x += (sin(yaw) - sin(pose.yaw)) / curvature;
+    pose.y -= (cos(yaw) - cos(pose.yaw)) / curvature;
+    pose.yaw = normalize_angle(yaw);
+}
+
+#endif
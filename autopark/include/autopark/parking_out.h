@@ -11,10 +11,15 @@
 #define PARKING_OUT_H_
 
 #include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <algorithm>
 #include <string>
 #include <sstream>
 
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include <ros/ros.h>
 #include <ros/spinner.h>
 #include <ros/callback_queue.h>
@@ -24,6 +29,14 @@
 #include <std_msgs/Float32.h>
 #include <std_msgs/Header.h>
 #include <sensor_msgs/Range.h>
+#include <nav_msgs/Path.h>
+#include "autopark/odometry.h"
+#include "autopark/side_traits.h"
+#include "autopark/sensor_health.h"
+#include "autopark/trajectory_cache.h"
+#include "autopark/session_store.h"
+#include "autopark/command_channel.h"
+#include "autopark/parking_out_maneuvers.h"
 
 
 class ParkingOut
@@ -31,6 +44,7 @@ class ParkingOut
 private:
     ros::NodeHandle nh_;
     ros::Subscriber sub_car_speed_;
+    ros::Subscriber sub_path_done_;
     ros::Subscriber sub_apa_lf_;
     ros::Subscriber sub_apa_lb_;
     ros::Subscriber sub_apa_rf_;
@@ -44,30 +58,36 @@ private:
     ros::Subscriber sub_upa_bcr_;
     ros::Subscriber sub_upa_br_;
 
-    ros::Publisher pub_move_;
-    ros::Publisher pub_turn_;
+    CommandChannel<std_msgs::Float32> channel_move_;
+    CommandChannel<std_msgs::Char> channel_turn_;
+    ros::Publisher pub_path_;
 
     std_msgs::Float32 msg_car_speed_;
-    sensor_msgs::Range msg_apa_lf_;
-    sensor_msgs::Range msg_apa_lb_;
-    sensor_msgs::Range msg_apa_rf_;
-    sensor_msgs::Range msg_apa_rb_;
-    sensor_msgs::Range msg_upa_fl_;
-    sensor_msgs::Range msg_upa_fcl_;
-    sensor_msgs::Range msg_upa_fcr_;
-    sensor_msgs::Range msg_upa_fr_;
-    sensor_msgs::Range msg_upa_bl_;
-    sensor_msgs::Range msg_upa_bcl_;
-    sensor_msgs::Range msg_upa_bcr_;
-    sensor_msgs::Range msg_upa_br_;
+    sensor_msgs::Range msg_range_[RANGE_SENSORS];
+    HealthFilter health_;               // degraded sensors read as blocked in msg_range_
 
     std_msgs::Float32 msg_cmd_move_;
     std_msgs::Char msg_cmd_turn_;
 
+    OdometryShm odometry_;
+    TrajectoryCache trajectory_;
+    SessionStore session_;
+    boost::atomic<bool> path_done_;
+    boost::atomic<bool> cancelled_;     // parking out is disabled while it runs
+
+    Maneuver* maneuver_;                // running maneuver, resumed by the callbacks
+    boost::mutex mutex_;                // measurements and running maneuver: callbacks and main thread
+    boost::condition_variable maneuver_over_;
+
+    void resume_maneuver();
+    void stop_path(nav_msgs::Path& msg_path);
+
 public:
     ParkingOut(ros::NodeHandle* nodehandle);
 
     void callback_car_speed(const std_msgs::Float32::ConstPtr& msg);
+    void callback_path_done(const std_msgs::Bool::ConstPtr& msg);
+    bool driven_distance(const ros::Time& begin, const ros::Time& end, double& distance);
 
     void callback_apa_lf(const sensor_msgs::Range::ConstPtr& msg);
     void callback_apa_lb(const sensor_msgs::Range::ConstPtr& msg);
@@ -84,10 +104,18 @@ public:
     void callback_upa_bcr(const sensor_msgs::Range::ConstPtr& msg);
     void callback_upa_br(const sensor_msgs::Range::ConstPtr& msg);
 
-    void parking_out_left_perpendicular();
-    void parking_out_left_parallel();
-    void parking_out_right_perpendicular();
-    void parking_out_right_parallel();
+    // cancel parking out when it is disabled, called from the stage handler
+    void cancel(bool cancelled) { cancelled_ = cancelled; }
+    bool cancelled() const { return cancelled_; }
+
+    uint32_t parked_space() const;
+    void finish_session();
+    void command_move();
+    void command_turn();
+    void flush_commands();
+    bool parking_out_replay();
+    bool path_blocked() const;
+    bool run_maneuver(Maneuver& maneuver);
 
     ~ParkingOut();
 };
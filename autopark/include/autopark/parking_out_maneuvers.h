@@ -0,0 +1,163 @@
+/******************************************************************
+ * Filename: parking_out_maneuvers.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-20
+ * Description: declare the maneuvers of getting out of perpendicular
+ * or parallel parking space with sensors, mirrored for the left and
+ * right side by SideTraits
+ * 
+ ******************************************************************/
+
+#ifndef PARKING_OUT_MANEUVERS_H_
+#define PARKING_OUT_MANEUVERS_H_
+
+#include "autopark/maneuver_script.h"
+#include "autopark/parameters.h"
+
+
+// ************************************************************************
+// getting out of perpendicular parking space
+// ************************************************************************
+template <ParkingSide side>
+class PerpendicularOut : public Maneuver
+{
+protected:
+    virtual void step();
+};
+
+template <ParkingSide side>
+void PerpendicularOut<side>::step()
+{
+    typedef SideTraits<side> Side;
+    const Parameters& p = params();
+
+    MANEUVER_BEGIN
+    {
+        // move forward straight until a half of car is out of parking space
+        turn('D');
+        move(p.speed_parking_forward);
+        MANEUVER_TRAVEL(p.distance_perpendicular_out);
+
+        // PLAN A would stop here: driver can get into car easily, but car is not parallel
+        // to the street. PLAN B: turn full to the parking side until car is complete out
+        turn(Side::turn_full);
+        MANEUVER_UNTIL(range(Side::apa_back_other) > p.distance_search);
+
+        // until car head is close to object (car) on the parking side of street or car rear
+        // is complete out of parking space, straight while car is too close to parkwall (car)
+        while (!(range(Side::apa_front) < p.distance_search || \
+        (range(Side::upa_back_center) > p.perpendicular_width && \
+        range(Side::upa_back_center_other) > p.perpendicular_width)))
+        {
+            turn((range(Side::apa_back) < p.brake_distance_default) ? 'D' : Side::turn_full);
+            MANEUVER_YIELD;
+        }
+
+        // stop, turn straight
+        move(0);
+        turn('D');
+        succeed();
+    }
+}
+
+
+// ************************************************************************
+// getting out of parallel parking space
+// ************************************************************************
+template <ParkingSide side>
+class ParallelOut : public Maneuver
+{
+private:
+    typedef SideTraits<side> Side;
+
+protected:
+    virtual void step();
+
+    // car rear is too close to parkwall (car) at back: the corner on the parking side
+    // sweeps toward the curb when car turns, it keeps a larger distance
+    bool rear_blocked() const
+    {
+        const Parameters& p = params();
+        return range(Side::upa_back) < p.parking_distance_min || \
+        range(Side::upa_back_center) < p.brake_distance_default || \
+        range(Side::upa_back_center_other) < p.brake_distance_default || \
+        range(Side::upa_back_other) < p.brake_distance_default;
+    }
+
+    // car head is too close to parkwall (car) at front, likewise for the corner
+    bool front_blocked() const
+    {
+        const Parameters& p = params();
+        return range(Side::upa_front) < p.parking_distance_min || \
+        range(Side::upa_front_center) < p.brake_distance_default || \
+        range(Side::upa_front_center_other) < p.brake_distance_default || \
+        range(Side::upa_front_other) < p.brake_distance_default;
+    }
+
+    // car head is out of parking space
+    bool head_out() const
+    {
+        return range(Side::apa_front) > params().distance_search && range(Side::upa_front) > params().distance_search;
+    }
+};
+
+template <ParkingSide side>
+void ParallelOut<side>::step()
+{
+    const Parameters& p = params();
+
+    MANEUVER_BEGIN
+    {
+        // move backward straight until distance between car and parkwall (car) at front
+        // is larger than safe distance or car rear is too close to parkwall (car) at back
+        turn('D');
+        move(p.speed_parking_backward);
+        MANEUVER_UNTIL(range(Side::upa_front_center_other) > p.distance_parallel_out || rear_blocked());
+
+        // turn full to the other side and move forward until car head is out of parking space
+        while (!head_out())
+        {
+            // car head is too close to parkwall (car): move backward turning full to the
+            // parking side until car rear is too close, give up if it is already
+            if (front_blocked())
+            {
+                if (rear_blocked())
+                {
+                    move(0);
+                    return;
+                }
+                turn(Side::turn_full);
+                move(p.speed_parking_backward);
+                MANEUVER_UNTIL(rear_blocked());
+            }
+            turn(Side::turn_full_other);
+            move(p.speed_parking_forward);
+            MANEUVER_UNTIL(head_out() || front_blocked());
+        }
+
+        // move forward straight until half of car rear is out of parking space
+        turn('D');
+        move(p.speed_parking_forward);
+        MANEUVER_UNTIL(range(Side::upa_back_center) > p.parallel_length / 2);
+
+        // PLAN B: turn full to the parking side until car is complete out of parking space,
+        // straight when car head is too close to object (car) at side of street
+        turn(Side::turn_full);
+        while (!(range(Side::upa_back) > p.parallel_length))
+        {
+            if (range(Side::upa_front) < p.parking_distance_min)
+            {
+                turn('D');
+            }
+            MANEUVER_YIELD;
+        }
+
+        // stop, turn straight
+        move(0);
+        turn('D');
+        succeed();
+    }
+}
+
+#endif
@@ -0,0 +1,105 @@
+/******************************************************************
+ * Filename: parking_planner.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-12
+ * Description: declare class for planning a parking path from the
+ * measured geometry of the parking space
+ * 
+ ******************************************************************/
+
+#ifndef PARKING_PLANNER_H_
+#define PARKING_PLANNER_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "autopark/path_tracking.h"
+
+
+// measured parking space in car frame at planning time (rear axle at origin)
+struct SpaceGeometry
+{
+    double width;       // [m] width of parking space along the street
+    double length;      // [m] length of parking space from the parked cars to the curb
+    double distance;    // [m] lateral distance between car side and parked cars
+    double offset;      // [m] longitudinal position of the front end of parking space
+    double aisle;       // [m] lateral distance between car side and obstacles on the other side, 0: free
+};
+
+// segment of a maneuver with constant steering angle
+struct PathSegment
+{
+    float steering;     // [rad] positive: left
+    float length;       // [m] positive: forward, negative: backward
+};
+
+// axis aligned box of an obstacle in car frame
+struct Box
+{
+    double x_min;
+    double x_max;
+    double y_min;
+    double y_max;
+};
+
+// side of the parking space
+enum ParkingSide
+{
+    SIDE_LEFT = 1,
+    SIDE_RIGHT = -1
+};
+
+
+// move car pose exactly along an arc with constant steering angle
+void move_car_arc(CarPose& pose, double steering, double length);
+
+// check collision between car (with safety margin) and box
+bool collision_box(const CarPose& pose, const Box& box);
+
+// sample a path with step [m] from maneuver segments, starting at pose start
+void sample_path(const std::vector<PathSegment>& segments, const CarPose& start, double step, Path& path);
+
+
+// geometric planner: the path of getting out of the parking space is planned
+// from the goal (forward and backward moves with full steering until the car
+// can turn to the street), parking in is the reversed path
+class ParkingPlanner
+{
+private:
+    std::vector<Box> obstacles_;
+    double radius_min_;         // [m] minimal turning radius of rear axle
+
+    bool collision(const CarPose& pose) const;
+    double drive(CarPose& pose, double steering, double length, std::vector<PathSegment>& segments) const;
+    bool exit_parallel(const CarPose& start, std::vector<PathSegment>& segments) const;
+    bool exit_perpendicular(const CarPose& start, std::vector<PathSegment>& segments) const;
+    bool plan_out(const CarPose& goal, bool perpendicular, bool back_first, std::vector<PathSegment>& segments) const;
+    bool plan_in(const CarPose& goal, bool perpendicular, int8_t side, std::vector<PathSegment>& segments) const;
+    void set_obstacles(const SpaceGeometry& space, double neighbor_length);
+    void mirror_obstacles(int8_t side);
+    CarPose goal_parallel(const SpaceGeometry& space) const;
+    CarPose goal_perpendicular(const SpaceGeometry& space) const;
+
+public:
+    ParkingPlanner();
+
+    // plan parallel or perpendicular parking: return false if no path is found
+    bool plan_parallel(const SpaceGeometry& space, int8_t side, std::vector<PathSegment>& segments);
+    bool plan_perpendicular(const SpaceGeometry& space, int8_t side, std::vector<PathSegment>& segments);
+
+    // plan parking into a parking space of type SPACE_*, starting with heading [rad] to the parked cars
+    bool plan(uint32_t type, const SpaceGeometry& space, double heading, std::vector<PathSegment>& segments);
+
+    // set obstacles and goal of a parking space of type SPACE_* in car frame
+    bool set_space(uint32_t type, const SpaceGeometry& space, CarPose& goal);
+    // check a path from the car with heading [rad] to the parked cars against the obstacles
+    // set by the last call
+    bool check(const std::vector<PathSegment>& segments, double heading = 0) const;
+
+    const std::vector<Box>& obstacles() const { return obstacles_; }
+
+    ~ParkingPlanner();
+};
+
+#endif
\ No newline at end of file
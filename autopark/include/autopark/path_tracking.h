@@ -0,0 +1,97 @@
+/******************************************************************
+ * Filename: path_tracking.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-08
+ * Description: declare types of car pose and path, and class for
+ * tracking a path with continuous steering angle (pure pursuit)
+ * 
+ ******************************************************************/
+
+#ifndef PATH_TRACKING_H_
+#define PATH_TRACKING_H_
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+
+#include <nav_msgs/Path.h>
+
+
+// pose of the car: middle of rear axle in a local frame
+struct CarPose
+{
+    double x;           // [m]
+    double y;           // [m]
+    double yaw;         // [rad] heading, counterclockwise from x axis
+};
+
+// one sampled point of a planned path
+struct PathPoint
+{
+    double x;           // [m]
+    double y;           // [m]
+    double yaw;         // [rad]
+    int8_t direction;   // 1: forward, -1: backward (from this point to the next one)
+};
+
+typedef std::vector<PathPoint> Path;
+
+
+// normalize angle to [-pi, pi)
+double normalize_angle(double angle);
+
+// move car pose with kinematic bicycle model: speed [m/s], steering [rad], dt [s]
+void move_car_pose(CarPose& pose, double speed, double steering, double dt);
+
+// speed [m/s] of path tracking within the limits of the actuators: brake in time before the
+// end of segment remaining [m], slow down while the steering angle lags behind the command
+double tracking_speed(double speed, double remaining, double steering_lag);
+
+// convert path to and from ROS message (direction is derived from heading and next point)
+void path_to_msg(const Path& path, nav_msgs::Path& msg);
+void path_from_msg(const nav_msgs::Path& msg, Path& path);
+
+
+// pure pursuit controller for the rear axle, forward and backward segments
+class PathTracker
+{
+private:
+    Path path_;
+
+    size_t index_;              // index of the nearest path point
+    size_t segment_begin_;      // first point of current segment
+    size_t segment_end_;        // last point of current segment (cusp or end of path)
+
+    double lateral_error_;      // [m] signed cross track error, positive: car left of path
+    double heading_error_;      // [rad] heading error, positive: car turned left of path
+    double steering_angle_;     // [rad] last steering command, positive: left
+    bool finished_;
+
+    void find_segment_end();
+    bool segment_reached(const CarPose& pose) const;
+
+public:
+    PathTracker();
+
+    void set_path(const Path& path);
+    void reset();
+
+    // compute steering angle for current pose, call it with a fixed rate
+    double update(const CarPose& pose);
+
+    int8_t direction() const;
+    // [m] distance from pose to the end of current segment (cusp or end of path)
+    double remaining(const CarPose& pose) const;
+    bool finished() const { return finished_; }
+    bool empty() const { return path_.empty(); }
+
+    double lateral_error() const { return lateral_error_; }
+    double heading_error() const { return heading_error_; }
+    double steering_angle() const { return steering_angle_; }
+    const Path& path() const { return path_; }
+
+    ~PathTracker();
+};
+
+#endif
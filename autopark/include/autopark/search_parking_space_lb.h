@@ -25,6 +25,9 @@
 #include <std_msgs/Float32.h>
 #include <std_msgs/Header.h>
 #include <sensor_msgs/Range.h>
+#include "autopark/ParkingSpace.h"
+#include "autopark/CarSpeed.h"
+#include "autopark/time_alignment.h"
 
 
 class SearchParkingSpaceLB
@@ -36,16 +39,18 @@ private:
     ros::Publisher pub_parking_space_;
 
     sensor_msgs::Range msg_apa_lb_;
-    std_msgs::Float32 msg_car_speed_;
-    std_msgs::Header msg_parking_space_;
+    autopark::ParkingSpace msg_parking_space_;
 
     std::queue<sensor_msgs::Range> que_apa_lb_;
     std::vector<sensor_msgs::Range> vec_turnpoint_;
 
+    TimeAlignment alignment_;
+
 public:
     SearchParkingSpaceLB(ros::NodeHandle* nodehandle);
     void callback_apa_lb(const sensor_msgs::Range::ConstPtr& msg);
-    void callback_car_speed(const std_msgs::Float32::ConstPtr& msg);
+    void callback_car_speed(const autopark::CarSpeed::ConstPtr& msg);
+    bool driven_distance(const ros::Time& begin, const ros::Time& end, double& distance);
     void check_parking_space();
     ~SearchParkingSpaceLB();
 };
@@ -25,6 +25,9 @@
 #include <std_msgs/Float32.h>
 #include <std_msgs/Header.h>
 #include <sensor_msgs/Range.h>
+#include "autopark/ParkingSpace.h"
+#include "autopark/CarSpeed.h"
+#include "autopark/time_alignment.h"
 
 
 class SearchParkingSpaceRF
@@ -36,16 +39,18 @@ private:
     ros::Publisher pub_parking_space_;
 
     sensor_msgs::Range msg_apa_rf_;
-    std_msgs::Float32 msg_car_speed_;
-    std_msgs::Header msg_parking_space_;
+    autopark::ParkingSpace msg_parking_space_;
 
     std::queue<sensor_msgs::Range> que_apa_rf_;
     std::vector<sensor_msgs::Range> vec_turnpoint_;
 
+    TimeAlignment alignment_;
+
 public:
     SearchParkingSpaceRF(ros::NodeHandle* nodehandle);
     void callback_apa_rf(const sensor_msgs::Range::ConstPtr& msg);
-    void callback_car_speed(const std_msgs::Float32::ConstPtr& msg);
+    void callback_car_speed(const autopark::CarSpeed::ConstPtr& msg);
+    bool driven_distance(const ros::Time& begin, const ros::Time& end, double& distance);
     void check_parking_space();
     ~SearchParkingSpaceRF();
 };
@@ -0,0 +1,93 @@
+/******************************************************************
+ * Filename: sensor_health.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-18
+ * Description: declare streaming statistics of the health of an
+ * ultrasonic sensor, and the filter of the nodes which excludes the
+ * sensors reported degraded by health_monitor
+ * 
+ ******************************************************************/
+
+#ifndef SENSOR_HEALTH_H_
+#define SENSOR_HEALTH_H_
+
+#include <stdint.h>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+#include <sensor_msgs/Range.h>
+#include "autopark/SensorHealth.h"
+
+// bits of the status of a sensor, all but HEALTH_JITTER exclude it
+#define HEALTH_STALE        0x01        // no measurement for health_timeout
+#define HEALTH_RATE         0x02        // rate below health_rate_min
+#define HEALTH_JITTER       0x04        // interval varies more than health_jitter_max of it
+#define HEALTH_NOISE        0x08        // successive ranges differ more than health_noise_max
+#define HEALTH_STUCK        0x10        // range unchanged for health_stuck_samples
+#define HEALTH_RANGE        0x20        // more than health_out_of_range_max outside min_range ... max_range
+
+#define HEALTH_DEGRADED     (HEALTH_STALE | HEALTH_RATE | HEALTH_NOISE | HEALTH_STUCK | HEALTH_RANGE)
+
+// statistics of one sensor in constant memory: exponentially weighted moving averages
+// with weight health_smoothing of each measurement
+class ChannelHealth
+{
+private:
+    uint32_t samples_;
+    double time_last_;                  // [s] time of the last measurement
+    float range_last_;                  // [m]
+    double interval_;                   // [s] mean interval between measurements
+    double interval_var_;               // [s^2] variance of the interval
+    double difference_var_;             // [m^2] mean square difference of successive ranges
+    double out_of_range_;               // ratio of ranges outside min_range ... max_range
+    uint32_t unchanged_;                // successive measurements with unchanged range while car moves
+
+public:
+    ChannelHealth();
+
+    // add a measurement: time [s] of acquisition, range [m], +inf is no echo. A standing car
+    // sees the same ranges: unchanged ranges count as stuck only while the car moves
+    void update(double time, float range, float min_range, float max_range, bool moving);
+
+    // HEALTH_* bits at time [s]
+    uint8_t status(double time) const;
+
+    uint32_t samples() const { return samples_; }
+    float rate() const;                 // [Hz]
+    float jitter() const;               // [s] standard deviation of the interval
+    float noise() const;                // [m] standard deviation of the difference of successive ranges
+    float out_of_range() const { return out_of_range_; }
+};
+
+// sensors excluded in a node: a degraded sensor reads as blocked (0), so the monitor and the
+// maneuvers do not move toward what it cannot see. Without health_monitor no sensor is excluded
+class HealthFilter
+{
+private:
+    ros::Subscriber sub_health_;
+    ros::WallTimer timer_expire_;
+    boost::atomic<uint32_t> degraded_;  // bit of each sensor in order of RangeSensor
+    sensor_msgs::Range* ranges_;
+    boost::mutex* mutex_;               // lock of the node guarding ranges_, or own_mutex_
+    boost::mutex own_mutex_;
+    ros::WallTime received_;            // latest summary of health_monitor
+
+    void callback_health(const autopark::SensorHealth::ConstPtr& msg);
+    void callback_expire(const ros::WallTimerEvent& event);
+
+public:
+    // ranges: latest measurements of the node in order of RangeSensor, the ranges of
+    // sensors becoming degraded are set blocked, or NULL; mutex: lock of the node held
+    // while ranges are written, or NULL.
+    // Without summaries of health_monitor for a few periods all sensors are used again
+    HealthFilter(ros::NodeHandle& nh, sensor_msgs::Range* ranges, boost::mutex* mutex);
+
+    bool degraded(int sensor) const { return (degraded_ >> sensor) & 1; }
+
+    // range [m] of a measurement of the sensor as the node uses it
+    float range(int sensor, float range) const;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/******************************************************************
+ * Filename: session_store.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-26
+ * Description: declare memory-mapped store of the parking session,
+ * shared by all processes and kept over restarts
+ * 
+ ******************************************************************/
+
+#ifndef SESSION_STORE_H_
+#define SESSION_STORE_H_
+
+#include <stdint.h>
+
+#define SESSION_STORE_MAGIC         "APSESS"
+#define SESSION_STORE_VERSION       1
+
+// state of parking session
+enum SessionState
+{
+    SESSION_NONE = 0,           // car is not parked by autopark
+    SESSION_CHOSEN = 1,         // parking space is chosen, parking in is running
+    SESSION_PARKED = 2          // parking in is finished, waiting for parking out
+};
+
+// parking session: chosen parking space, its geometry and the final pose
+struct ParkingSession
+{
+    uint32_t state;             // SESSION_*
+    uint32_t type;              // SPACE_* type of parking space, 0: unknown
+    float width;                // [m] geometry of parking space when it was found
+    float length;
+    float distance;
+    float reserved;
+    double stamp;               // [s] ROS time of last update
+    double x;                   // [m] final pose of rear axle in odometry frame
+    double y;
+    double yaw;                 // [rad]
+    double odometer;            // [m] odometer at final pose
+};
+
+// record of session: sequence is 0 while it is written, checksum detects torn writes
+struct SessionRecord
+{
+    volatile uint64_t sequence;
+    uint32_t checksum;
+    uint32_t reserved;
+    ParkingSession session;
+};
+
+// file: two records are written alternately, so the last complete one survives a crash
+struct SessionFile
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t size;              // size of ParkingSession
+    SessionRecord record[2];
+};
+
+
+// store of parking session mapped from a file: one writer at a time (parking in or
+// parking out), any number of readers without locks
+class SessionStore
+{
+private:
+    SessionFile* file_;
+
+    bool read_record(int index, ParkingSession& session, uint64_t& sequence) const;
+
+public:
+    SessionStore();
+
+    // map file, create or reset it if it is missing or invalid
+    bool open(const char* filename);
+    void close();
+    bool is_open() const { return file_ != NULL; }
+
+    // latest complete session, false if none is stored
+    bool load(ParkingSession& session) const;
+    // write session over the older record and flush it to disk
+    bool store(const ParkingSession& session);
+
+    ~SessionStore();
+};
+
+#endif
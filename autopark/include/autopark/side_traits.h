@@ -0,0 +1,101 @@
+/******************************************************************
+ * Filename: side_traits.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-24
+ * Description: declare index of range sensors and traits of the side
+ * of a parking space, to write a maneuver once for both sides
+ * 
+ ******************************************************************/
+
+#ifndef SIDE_TRAITS_H_
+#define SIDE_TRAITS_H_
+
+#include <stdint.h>
+
+#include "autopark/autoparking.h"
+#include "autopark/parking_planner.h"
+
+
+// index of range sensors: apas at the sides, upas at front and back
+enum RangeSensor
+{
+    APA_LF,
+    APA_LB,
+    APA_LB2,
+    APA_RF,
+    APA_RB,
+    APA_RB2,
+    UPA_FL,
+    UPA_FCL,
+    UPA_FCR,
+    UPA_FR,
+    UPA_BL,
+    UPA_BCL,
+    UPA_BCR,
+    UPA_BR,
+    RANGE_SENSORS
+};
+
+// sensors and steering commands on the side of the parking space and on the other
+// side: a maneuver written with SideTraits<side> is mirrored at compile time
+template <ParkingSide side>
+struct SideTraits;
+
+template <>
+struct SideTraits<SIDE_LEFT>
+{
+    static const RangeSensor apa_front = APA_LF;
+    static const RangeSensor apa_back = APA_LB;
+    static const RangeSensor apa_back2 = APA_LB2;
+    static const RangeSensor upa_front = UPA_FL;
+    static const RangeSensor upa_front_center = UPA_FCL;
+    static const RangeSensor upa_back = UPA_BL;
+    static const RangeSensor upa_back_center = UPA_BCL;
+
+    static const RangeSensor apa_front_other = APA_RF;
+    static const RangeSensor apa_back_other = APA_RB;
+    static const RangeSensor apa_back2_other = APA_RB2;
+    static const RangeSensor upa_front_other = UPA_FR;
+    static const RangeSensor upa_front_center_other = UPA_FCR;
+    static const RangeSensor upa_back_other = UPA_BR;
+    static const RangeSensor upa_back_center_other = UPA_BCR;
+
+    static const char turn_full = 'L';          // turn full to the side of parking space
+    static const char turn_full_other = 'R';
+    static const char turn_step = 'l';          // turn a little to the side of parking space
+    static const char turn_step_other = 'r';
+
+    static const uint32_t space_perpendicular = SPACE_LEFT_PERPENDICULAR;
+    static const uint32_t space_parallel = SPACE_LEFT_PARALLEL;
+};
+
+template <>
+struct SideTraits<SIDE_RIGHT>
+{
+    static const RangeSensor apa_front = APA_RF;
+    static const RangeSensor apa_back = APA_RB;
+    static const RangeSensor apa_back2 = APA_RB2;
+    static const RangeSensor upa_front = UPA_FR;
+    static const RangeSensor upa_front_center = UPA_FCR;
+    static const RangeSensor upa_back = UPA_BR;
+    static const RangeSensor upa_back_center = UPA_BCR;
+
+    static const RangeSensor apa_front_other = APA_LF;
+    static const RangeSensor apa_back_other = APA_LB;
+    static const RangeSensor apa_back2_other = APA_LB2;
+    static const RangeSensor upa_front_other = UPA_FL;
+    static const RangeSensor upa_front_center_other = UPA_FCL;
+    static const RangeSensor upa_back_other = UPA_BL;
+    static const RangeSensor upa_back_center_other = UPA_BCL;
+
+    static const char turn_full = 'R';
+    static const char turn_full_other = 'L';
+    static const char turn_step = 'r';
+    static const char turn_step_other = 'l';
+
+    static const uint32_t space_perpendicular = SPACE_RIGHT_PERPENDICULAR;
+    static const uint32_t space_parallel = SPACE_RIGHT_PARALLEL;
+};
+
+#endif
@@ -24,6 +24,10 @@
 #include <std_msgs/String.h>
 #include <std_msgs/Header.h>
 #include <sensor_msgs/Range.h>
+#include <boost/thread/mutex.hpp>
+#include "autopark/MoveCommand.h"
+#include "autopark/sensor_health.h"
+#include "autopark/side_traits.h"
 
 
 class SurroundMonitor
@@ -53,8 +57,10 @@ private:
     sensor_msgs::Range msg_upa_bcl_;
     sensor_msgs::Range msg_upa_bcr_;
     sensor_msgs::Range msg_upa_br_;
+    HealthFilter health_;               // degraded upas read as blocked in check_signals
+    boost::mutex mutex_;                // callbacks run on several threads
 
-    std_msgs::Float32 msg_cmd_move_;
+    autopark::MoveCommand msg_cmd_move_;
     std_msgs::Bool msg_cmd_forward_;
     std_msgs::Bool msg_cmd_backward_;
 
@@ -73,6 +79,7 @@ public:
     void callback_upa_br(const sensor_msgs::Range::ConstPtr& msg);
 
     void check_signals();
+    void publish_stop(const sensor_msgs::Range* ranges[], int count);
 
     ~SurroundMonitor();
 };
@@ -0,0 +1,70 @@
+/******************************************************************
+ * Filename: time_alignment.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-19
+ * Description: declare the history of a signal by its time of
+ * acquisition, and the alignment of car speed and pose with the
+ * time of acquisition of range measurements
+ * 
+ ******************************************************************/
+
+#ifndef TIME_ALIGNMENT_H_
+#define TIME_ALIGNMENT_H_
+
+#include <deque>
+
+#include <ros/ros.h>
+#include "autopark/odometry.h"
+
+// sample of a signal at its time of acquisition
+struct TimedValue
+{
+    double stamp;       // [s]
+    float value;
+};
+
+// samples of a signal in order of acquisition for alignment_history, linear between
+// two samples and held for alignment_hold after the latest one
+class SignalHistory
+{
+private:
+    std::deque<TimedValue> samples_;
+
+public:
+    // add a sample, a late sample is inserted in order of its stamp
+    void add(double stamp, float value);
+    // value at stamp, false if stamp is out of history
+    bool at(double stamp, float& value) const;
+    // integral of the value from begin to end, false if a stamp is out of history
+    bool integral(double begin, double end, double& integral) const;
+
+    bool empty() const { return samples_.empty(); }
+    void clear() { samples_.clear(); }
+};
+
+// car speed and pose at the time of acquisition of a measurement, instead of the time
+// its message was received. Callbacks of car_speed_stamped add the speed
+class TimeAlignment
+{
+private:
+    SignalHistory speed_;
+    OdometryShm odometry_;
+
+    bool odometry_open();
+
+public:
+    void add_speed(const ros::Time& stamp, float speed) { speed_.add(stamp.toSec(), speed); }
+
+    // [m/s] car speed at stamp
+    bool speed(const ros::Time& stamp, float& speed) const { return speed_.at(stamp.toSec(), speed); }
+    // pose at stamp from the shared memory of odometry
+    bool pose(const ros::Time& stamp, OdometrySample& sample);
+    // [m] signed distance driven from begin to end: from odometry, or the integral of car speed
+    // if odometry is not running
+    bool distance(const ros::Time& begin, const ros::Time& end, double& distance);
+
+    void clear() { speed_.clear(); }
+};
+
+#endif
@@ -0,0 +1,79 @@
+/******************************************************************
+ * Filename: trajectory_cache.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-25
+ * Description: declare binary layout of the cached parking in
+ * trajectory and class for recording it and replaying it reversed
+ * 
+ ******************************************************************/
+
+#ifndef TRAJECTORY_CACHE_H_
+#define TRAJECTORY_CACHE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "autopark/path_tracking.h"
+#include "autopark/odometry.h"
+#include "autopark/side_traits.h"
+
+#define TRAJECTORY_CACHE_MAGIC      "APTRAJ"
+#define TRAJECTORY_CACHE_VERSION    1
+
+// sample of executed trajectory in car frame at the end of parking in
+struct TrajectorySample
+{
+    float x;                            // [m] pose of rear axle
+    float y;
+    float yaw;                          // [rad]
+    float speed;                        // [m/s] positive: forward
+    float steering;                     // [rad] steering angle of front wheels
+};
+
+// header at begin of file, samples follow in driven order
+struct TrajectoryCacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t type;                      // SPACE_* type of parking space
+    uint32_t count;                     // number of samples
+    uint32_t reserved;
+    double stamp;                       // [s] ROS time at end of parking in
+    double odometer;                    // [m] odometer at end of parking in
+    float range[RANGE_SENSORS];         // [m] ranges at end of parking in, 0: no message
+};
+
+
+// trajectory of parking in: recorded from odometry, saved on completion and loaded
+// by parking out to drive the reversed path
+class TrajectoryCache
+{
+private:
+    TrajectoryCacheHeader header_;
+    std::vector<OdometrySample> recorded_;      // odometry frame, while recording
+    std::vector<TrajectorySample> samples_;     // car frame at end of parking in
+
+public:
+    TrajectoryCache();
+
+    // recording: keep a sample each step [m] of driven distance and at each change of direction
+    void clear();
+    void record(const OdometrySample& sample, double step);
+    size_t recorded() const { return recorded_.size(); }
+
+    // save recorded trajectory ending at sample end, written to a temporary file and renamed
+    bool save(const char* filename, uint32_t type, const OdometrySample& end, const float range[]);
+    // load saved trajectory, return false if it is missing or invalid
+    bool load(const char* filename);
+
+    // path from end of parking in back to its start, in car frame at end of parking in
+    void exit_path(Path& path) const;
+
+    const TrajectoryCacheHeader& header() const { return header_; }
+    const std::vector<TrajectorySample>& samples() const { return samples_; }
+
+    ~TrajectoryCache();
+};
+
+#endif
@@ -0,0 +1,131 @@
+/******************************************************************
+ * Filename: ultrasonic.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-16
+ * Description: declare channels and frames of the ultrasonic
+ * sensors, the driver reading all channels from the file descriptor
+ * of a device with epoll, and a pseudo-device replaying a recording
+ * 
+ ******************************************************************/
+
+#ifndef ULTRASONIC_H_
+#define ULTRASONIC_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/atomic.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+
+#define ULTRASONIC_CHANNELS 14          // 6 apa and 8 upa
+
+// channel of an ultrasonic sensor: topic and frame id, and values of sensor_msgs::Range
+struct UltrasonicChannel
+{
+    const char* name;
+    float field_of_view;                // [rad]
+    float min_range;                    // [m]
+    float max_range;                    // [m]
+};
+
+extern const UltrasonicChannel ultrasonic_channels[ULTRASONIC_CHANNELS];
+
+// index of the channel with the name, -1 if there is none
+int ultrasonic_channel(const std::string& name);
+
+// frame of the device: one measurement of a channel
+struct UltrasonicFrame
+{
+    uint16_t channel;                   // index of ultrasonic_channels
+    uint16_t range;                     // [mm] 0 if there was no echo
+    uint32_t reserved;
+    uint64_t stamp;                     // [ns] wall time of acquisition, 0 if the device has no clock
+};
+
+// measurement of a recording, time relative to the start of the recording
+struct UltrasonicRecord
+{
+    double time;                        // [s]
+    UltrasonicFrame frame;
+};
+
+// text recording, a line per measurement: time [s], name of channel, range [m]
+bool load_recording(const std::string& filename, std::vector<UltrasonicRecord>& records);
+
+// frames read at once, all acquired before the read
+typedef boost::function<void(const std::vector<UltrasonicFrame>&)> FrameHandler;
+
+// reads frames of all channels from a device as soon as they arrive: waits with epoll on the
+// file descriptor and passes all frames available to the handler
+class UltrasonicDriver
+{
+private:
+    int fd_;
+    int epoll_fd_;
+    std::vector<char> buffer_;          // bytes of an incomplete frame
+
+    bool read_frames(std::vector<UltrasonicFrame>& frames);
+
+public:
+    // fd: non-blocking file descriptor of the device, not closed by the driver
+    explicit UltrasonicDriver(int fd);
+    ~UltrasonicDriver(void);
+
+    // wait at most timeout [s] for frames and pass them to the handler:
+    // false if the device is closed or failed
+    bool poll(double timeout, const FrameHandler& handler);
+};
+
+// open a device for the driver: -1 if it fails
+int open_device(const std::string& path);
+
+// pseudo-device: a thread of the derived class writes frames to a pipe, the driver reads
+// the other end as a device. The pipe is closed when the thread returns
+class PseudoDevice
+{
+private:
+    int fds_[2];                        // read and write end of the pipe
+    boost::thread thread_;
+
+    void thread();
+
+protected:
+    boost::atomic<bool> running_;
+
+    // start the thread, called by the constructor of the derived class
+    void start();
+    // stop the thread, called by the destructor of the derived class
+    void stop();
+
+    // frames generated by the thread
+    virtual void run() = 0;
+    // write frames acquired now to the device: false if the device failed
+    bool write_frames(std::vector<UltrasonicFrame>& frames);
+
+public:
+    PseudoDevice();
+    virtual ~PseudoDevice(void);
+
+    // non-blocking read end for the driver, -1 if the pipe could not be created
+    int fd() const;
+};
+
+// pseudo-device writing the frames of a recording at their recorded times
+class ReplayDevice : public PseudoDevice
+{
+private:
+    std::vector<UltrasonicRecord> records_;
+    double period_;                     // [s] of a loop, 0 to replay once
+
+    virtual void run();
+
+public:
+    // period [s]: repeat the recording with this period, 0 to replay it once
+    ReplayDevice(const std::vector<UltrasonicRecord>& records, double period);
+    ~ReplayDevice(void);
+};
+
+#endif
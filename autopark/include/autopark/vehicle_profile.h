@@ -0,0 +1,86 @@
+/******************************************************************
+ * Filename: vehicle_profile.h
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-02
+ * Description: declare profile types of the vehicle for the parking
+ * kernels: values of the parameter snapshot or compile-time constants
+ * 
+ ******************************************************************/
+
+#ifndef VEHICLE_PROFILE_H_
+#define VEHICLE_PROFILE_H_
+
+#include "autopark/parameters.h"
+
+
+// profile of the parameter snapshot: values can be tuned in the profile file without rebuild
+struct RuntimeProfile
+{
+    static float car_width() { return params().car_width; }
+    static float car_length() { return params().car_length; }
+    static float distance_apa() { return params().distance_apa; }
+    static float apa_width() { return params().apa_width; }
+    static float rear_overhang() { return params().rear_overhang; }
+    static float wheel_base() { return params().wheel_base; }
+    static float steering_angle_max() { return params().steering_angle_max; }
+    static float planner_margin() { return params().planner_margin; }
+    static float range_diff() { return params().range_diff; }
+    static float distance_search() { return params().distance_search; }
+    static float parallel_width() { return params().parallel_width; }
+    static float parallel_length() { return params().parallel_length; }
+    static float perpendicular_width() { return params().perpendicular_width; }
+    static float perpendicular_length() { return params().perpendicular_length; }
+    static float brake_distance_default() { return params().brake_distance_default; }
+};
+
+// profile of the default car as constant expressions: kernels instantiated with it fold the
+// values, production builds select it with AUTOPARK_PROFILE=DefaultProfile
+struct DefaultProfile
+{
+    static constexpr float car_width() { return 1.8f; }
+    static constexpr float car_length() { return 4.8f; }
+    static constexpr float distance_apa() { return 4; }
+    static constexpr float apa_width() { return 0.5f; }
+    static constexpr float rear_overhang() { return 1.0f; }
+    static constexpr float wheel_base() { return 2.7f; }
+    static constexpr float steering_angle_max() { return 0.6f; }
+    static constexpr float planner_margin() { return 0.2f; }
+    static constexpr float range_diff() { return 0.2f; }
+    static constexpr float distance_search() { return 2; }
+    static constexpr float parallel_width() { return 6; }
+    static constexpr float parallel_length() { return 2.5f; }
+    static constexpr float perpendicular_width() { return 2.5f; }
+    static constexpr float perpendicular_length() { return 5; }
+    static constexpr float brake_distance_default() { return 0.3f; }
+};
+
+// profile of the parking kernels in the nodes
+#ifdef AUTOPARK_PROFILE
+typedef AUTOPARK_PROFILE ActiveProfile;
+#else
+typedef RuntimeProfile ActiveProfile;
+#endif
+
+// check that a profile agrees with the parameters p, which the rest of the code uses
+template <class P>
+bool profile_matches(const Parameters& p)
+{
+    return P::car_width() == p.car_width && \
+    P::car_length() == p.car_length && \
+    P::distance_apa() == p.distance_apa && \
+    P::apa_width() == p.apa_width && \
+    P::rear_overhang() == p.rear_overhang && \
+    P::wheel_base() == p.wheel_base && \
+    P::steering_angle_max() == p.steering_angle_max && \
+    P::planner_margin() == p.planner_margin && \
+    P::range_diff() == p.range_diff && \
+    P::distance_search() == p.distance_search && \
+    P::parallel_width() == p.parallel_width && \
+    P::parallel_length() == p.parallel_length && \
+    P::perpendicular_width() == p.perpendicular_width && \
+    P::perpendicular_length() == p.perpendicular_length && \
+    P::brake_distance_default() == p.brake_distance_default;
+}
+
+#endif
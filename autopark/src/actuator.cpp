@@ -0,0 +1,268 @@
+/******************************************************************
+ * Filename: actuator.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-29
+ * Description: encoding of actuator command frames, SocketCAN and
+ * loopback buses, and batched non-blocking writer
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can/raw.h>
+
+#include "autopark/actuator.h"
+
+using namespace std;
+
+static const int batch_max = 16;        // maximum frames of one system call
+
+
+// encode value with scale into int16, saturate if it is out of range
+static bool encode_value(double value, double scale, uint8_t mode, uint8_t counter, canid_t id, CanFrame& frame)
+{
+    double scaled = floor(value * scale + 0.5);
+    bool valid = (scaled >= -32768 && scaled <= 32767);
+    int16_t raw = (int16_t)max(-32768.0, min(32767.0, scaled));
+
+    memset(&frame, 0, sizeof(frame));
+    frame.can_id = id;
+    frame.can_dlc = 8;
+    frame.data[0] = (uint8_t)(raw & 0xff);
+    frame.data[1] = (uint8_t)((raw >> 8) & 0xff);
+    frame.data[2] = mode;
+    frame.data[6] = counter & 0x0f;
+    for (int i = 0; i < 7; i++)
+    {
+        frame.data[7] ^= frame.data[i];
+    }
+    return valid;
+}
+
+bool encode_speed(float speed, uint8_t mode, uint8_t counter, CanFrame& frame)
+{
+    return encode_value(speed, ACTUATOR_SPEED_SCALE, mode, counter, ACTUATOR_SPEED_ID, frame);
+}
+
+bool encode_steering(float steering, uint8_t counter, CanFrame& frame)
+{
+    return encode_value(steering, ACTUATOR_STEERING_SCALE, ACTUATOR_STEER, counter, ACTUATOR_STEERING_ID, frame);
+}
+
+bool decode_command(const CanFrame& frame, float& value, uint8_t& mode, uint8_t& counter)
+{
+    if (frame.can_dlc != 8 || (frame.can_id != ACTUATOR_SPEED_ID && frame.can_id != ACTUATOR_STEERING_ID))
+    {
+        return false;
+    }
+    uint8_t checksum = 0;
+    for (int i = 0; i < 7; i++)
+    {
+        checksum ^= frame.data[i];
+    }
+    if (checksum != frame.data[7])
+    {
+        return false;
+    }
+    int16_t raw = (int16_t)(frame.data[0] | (frame.data[1] << 8));
+    double scale = (frame.can_id == ACTUATOR_SPEED_ID) ? ACTUATOR_SPEED_SCALE : ACTUATOR_STEERING_SCALE;
+    value = raw / scale;
+    mode = frame.data[2];
+    counter = frame.data[6];
+    return true;
+}
+
+
+// CONSTRUCTOR
+SocketCanBus::SocketCanBus()
+{
+    socket_ = -1;
+    name_[0] = '\0';
+}
+
+// DESTRUCTOR
+SocketCanBus::~SocketCanBus(void)
+{
+    close();
+}
+
+bool SocketCanBus::open(const char* interface)
+{
+    close();
+
+    int fd = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interface, IFNAMSIZ - 1);
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0 || (addr.can_ifindex = ifr.ifr_ifindex, \
+    bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) || fcntl(fd, F_SETFL, O_NONBLOCK) < 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    socket_ = fd;
+    snprintf(name_, sizeof(name_), "%s", interface);
+    return true;
+}
+
+void SocketCanBus::close()
+{
+    if (socket_ >= 0)
+    {
+        ::close(socket_);
+    }
+    socket_ = -1;
+}
+
+// send batch with sendmmsg, a full transmit queue (EAGAIN) leaves the rest for the next flush
+int SocketCanBus::write(const CanFrame* frames, int count)
+{
+    if (socket_ < 0)
+    {
+        return -1;
+    }
+    int written = 0;
+    while (written < count)
+    {
+        struct mmsghdr msgs[batch_max];
+        struct iovec iovs[batch_max];
+        int batch = min(count - written, batch_max);
+        memset(msgs, 0, sizeof(msgs));
+        for (int i = 0; i < batch; i++)
+        {
+            iovs[i].iov_base = (void*)&frames[written + i];
+            iovs[i].iov_len = sizeof(CanFrame);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int sent = sendmmsg(socket_, msgs, batch, MSG_DONTWAIT);
+        if (sent < 0)
+        {
+            return (errno == EAGAIN || errno == ENOBUFS) ? written : -1;
+        }
+        written += sent;
+        if (sent < batch)
+        {
+            break;
+        }
+    }
+    return written;
+}
+
+
+// CONSTRUCTOR
+LoopbackBus::LoopbackBus(size_t capacity)
+{
+    ring_.resize(capacity);
+    head_ = 0;
+    size_ = 0;
+}
+
+// DESTRUCTOR
+LoopbackBus::~LoopbackBus(void)
+{
+}
+
+int LoopbackBus::write(const CanFrame* frames, int count)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    int written = 0;
+    while (written < count && size_ < ring_.size())
+    {
+        ring_[(head_ + size_) % ring_.size()] = frames[written];
+        size_++;
+        written++;
+    }
+    return written;
+}
+
+int LoopbackBus::read(CanFrame* frames, int count)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    int read = 0;
+    while (read < count && size_ > 0)
+    {
+        frames[read] = ring_[head_];
+        head_ = (head_ + 1) % ring_.size();
+        size_--;
+        read++;
+    }
+    return read;
+}
+
+
+ActuatorBus* create_actuator_bus(const char* interface)
+{
+    if (strcmp(interface, "loopback") == 0)
+    {
+        return new LoopbackBus(256);
+    }
+    SocketCanBus* bus = new SocketCanBus();
+    if (bus->open(interface))
+    {
+        return bus;
+    }
+    delete bus;
+    return NULL;
+}
+
+
+// CONSTRUCTOR
+ActuatorWriter::ActuatorWriter(ActuatorBus* bus)
+{
+    bus_ = bus;
+    written_ = 0;
+    replaced_ = 0;
+    errors_ = 0;
+}
+
+// DESTRUCTOR
+ActuatorWriter::~ActuatorWriter(void)
+{
+}
+
+void ActuatorWriter::submit(const CanFrame& frame)
+{
+    for (size_t i = 0; i < pending_.size(); i++)
+    {
+        if (pending_[i].can_id == frame.can_id)
+        {
+            pending_[i] = frame;
+            replaced_++;
+            return;
+        }
+    }
+    pending_.push_back(frame);
+}
+
+int ActuatorWriter::flush()
+{
+    if (pending_.empty())
+    {
+        return 0;
+    }
+    int written = bus_->write(&pending_[0], pending_.size());
+    if (written < 0)
+    {
+        errors_++;
+        return 0;
+    }
+    pending_.erase(pending_.begin(), pending_.begin() + written);
+    written_ += written;
+    return written;
+}
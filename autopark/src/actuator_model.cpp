@@ -0,0 +1,125 @@
+/******************************************************************
+ * Filename: actuator_model.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-30
+ * Description: define models of steering and drive actuators and
+ * the simulated vehicle
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <algorithm>
+
+#include "autopark/autoparking.h"
+#include "autopark/actuator_model.h"
+
+using namespace std;
+
+
+ActuatorDynamics steering_dynamics()
+{
+    ActuatorDynamics dynamics = {params().steering_dead_time, params().steering_rate_max, params().steering_rate_max};
+    return dynamics;
+}
+
+ActuatorDynamics drive_dynamics()
+{
+    ActuatorDynamics dynamics = {params().drive_dead_time, params().drive_accel_max, params().drive_decel_max};
+    return dynamics;
+}
+
+ActuatorDynamics ideal_dynamics()
+{
+    ActuatorDynamics dynamics = {0, 0, 0};
+    return dynamics;
+}
+
+
+// CONSTRUCTOR
+ActuatorModel::ActuatorModel(const ActuatorDynamics& dynamics)
+{
+    dynamics_ = dynamics;
+    reset(0);
+}
+
+// DESTRUCTOR
+ActuatorModel::~ActuatorModel(void)
+{
+}
+
+void ActuatorModel::reset(double value)
+{
+    delay_.clear();
+    time_ = 0;
+    target_ = value;
+    value_ = value;
+}
+
+void ActuatorModel::command(double target)
+{
+    Command command = {time_ + dynamics_.dead_time, target};
+    delay_.push_back(command);
+}
+
+double ActuatorModel::update(double dt)
+{
+    time_ += dt;
+    // commands with passed dead time, the last one wins
+    while (!delay_.empty() && delay_.front().time <= time_ + 1e-9)
+    {
+        target_ = delay_.front().value;
+        delay_.pop_front();
+    }
+
+    double error = target_ - value_;
+    // magnitude increases if moving away from zero, a change of sign first falls to zero
+    bool rise = (value_ == 0) || ((value_ > 0) ? (error > 0) : (error < 0));
+    double rate = rise ? dynamics_.rise_max : dynamics_.fall_max;
+    if (rate <= 0 || fabs(error) <= rate * dt)
+    {
+        value_ = target_;
+    }
+    else if (!rise && fabs(value_) < rate * dt && value_ * target_ < 0)
+    {
+        // cross zero within this step: fall to zero, then rise for the rest of the step
+        double rest = dt - fabs(value_) / rate;
+        double step = (dynamics_.rise_max <= 0) ? fabs(target_) : min(fabs(target_), dynamics_.rise_max * rest);
+        value_ = (target_ > 0) ? step : -step;
+    }
+    else
+    {
+        value_ += (error > 0) ? rate * dt : -rate * dt;
+    }
+    return value_;
+}
+
+
+// CONSTRUCTOR
+VehicleSimulator::VehicleSimulator(const ActuatorDynamics& steering, const ActuatorDynamics& drive) : \
+steering_(steering), drive_(drive)
+{
+    CarPose pose = {0, 0, 0};
+    reset(pose);
+}
+
+// DESTRUCTOR
+VehicleSimulator::~VehicleSimulator(void)
+{
+}
+
+void VehicleSimulator::reset(const CarPose& pose)
+{
+    steering_.reset(0);
+    drive_.reset(0);
+    pose_ = pose;
+    odometer_ = 0;
+}
+
+void VehicleSimulator::step(double dt)
+{
+    double steering = steering_.update(dt);
+    double speed = drive_.update(dt);
+    move_car_pose(pose_, speed, steering, dt);
+    odometer_ += fabs(speed) * dt;
+}
@@ -0,0 +1,204 @@
+/******************************************************************
+ * Filename: benchmark_actuator.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-29
+ * Description: benchmark of the actuator backend: encoding, batched
+ * throughput and latency from submit to receive on the loopback bus
+ * or on a SocketCAN interface (e.g. vcan0)
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can/raw.h>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "autopark/benchmark.h"
+#include "autopark/actuator.h"
+
+using namespace std;
+
+static const int frames_throughput = 200000;    // frames of throughput benchmark
+static const int cycles_latency = 500;          // cycles of latency benchmark at 100 Hz
+
+// receiver of frames: loopback bus or second raw socket on the interface
+static LoopbackBus* loopback = NULL;
+static int receiver = -1;
+
+static boost::atomic<bool> running(true);
+static boost::atomic<long> received(0);
+static double submit_time[16];                  // time of submit by alive counter of steering frames
+static BenchmarkStats* stats_latency = NULL;
+
+
+// open raw socket which receives frames sent by other sockets on the interface
+static bool open_receiver(const char* interface)
+{
+    receiver = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, interface, IFNAMSIZ - 1);
+    struct sockaddr_can addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    if (receiver < 0 || ioctl(receiver, SIOCGIFINDEX, &ifr) < 0)
+    {
+        return false;
+    }
+    addr.can_ifindex = ifr.ifr_ifindex;
+    struct timeval timeout = {0, 10000};
+    setsockopt(receiver, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return bind(receiver, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+}
+
+// thread: drain frames, check them and measure latency of steering frames
+static void receive_frames()
+{
+    CanFrame frames[64];
+    while (running)
+    {
+        int count = 0;
+        if (loopback != NULL)
+        {
+            count = loopback->read(frames, 64);
+            if (count == 0)
+            {
+                boost::this_thread::yield();
+            }
+        }
+        else if (recv(receiver, &frames[0], sizeof(CanFrame), 0) == sizeof(CanFrame))
+        {
+            count = 1;
+        }
+        double now = benchmark_now();
+        for (int i = 0; i < count; i++)
+        {
+            float value;
+            uint8_t mode, counter;
+            if (!decode_command(frames[i], value, mode, counter))
+            {
+                printf("invalid frame 0x%x\n", frames[i].can_id);
+                continue;
+            }
+            if (stats_latency != NULL && frames[i].can_id == ACTUATOR_STEERING_ID)
+            {
+                stats_latency->add(now - submit_time[counter]);
+            }
+        }
+        received += count;
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    ActuatorBus* bus;
+    if (argc > 1)
+    {
+        SocketCanBus* socket_bus = new SocketCanBus();
+        if (!socket_bus->open(argv[1]) || !open_receiver(argv[1]))
+        {
+            printf("cannot open CAN interface %s\n", argv[1]);
+            return 1;
+        }
+        bus = socket_bus;
+    }
+    else
+    {
+        loopback = new LoopbackBus(1024);
+        bus = loopback;
+    }
+    printf("actuator bus: %s\n\n", bus->name());
+
+    // encoding and decoding
+    CanFrame frame;
+    float value;
+    uint8_t mode, counter;
+    double time_start = benchmark_now();
+    long checksum = 0;
+    for (int i = 0; i < frames_throughput; i++)
+    {
+        encode_speed((i % 200 - 100) * 0.01, ACTUATOR_FORWARD, i, frame);
+        decode_command(frame, value, mode, counter);
+        checksum += frame.data[7];
+    }
+    double duration = benchmark_now() - time_start;
+    printf("encode + decode: %.1f[ns] per frame (checksum %ld)\n\n", duration / frames_throughput * 1e9, checksum);
+
+    boost::thread thread(receive_frames);
+
+    // throughput: write batches directly to the bus, frames not accepted are retried
+    int batches[] = {1, 4, 16};
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++)
+    {
+        CanFrame frames[16];
+        for (int i = 0; i < batches[b]; i++)
+        {
+            encode_steering(i * 0.01, i, frames[i]);
+        }
+        long start = received;
+        long retries = 0;
+        time_start = benchmark_now();
+        for (int sent = 0; sent < frames_throughput; )
+        {
+            int written = bus->write(frames, min(batches[b], frames_throughput - sent));
+            if (written <= 0)
+            {
+                retries++;
+                boost::this_thread::yield();
+                continue;
+            }
+            sent += written;
+        }
+        while (received - start < frames_throughput && benchmark_now() - time_start < 10)
+        {
+            boost::this_thread::yield();
+        }
+        duration = benchmark_now() - time_start;
+        printf("throughput batch %2d: %9.0f frames/s, received %ld/%d, retries %ld\n", batches[b], \
+        (received - start) / duration, received - start, frames_throughput, retries);
+    }
+
+    // latency: speed and steering at 100 Hz through the writer, as in the controllers
+    BenchmarkStats stats("submit -> receive");
+    BenchmarkStats stats_flush("flush");
+    stats_latency = &stats;
+    ActuatorWriter writer(bus);
+    for (int i = 0; i < cycles_latency; i++)
+    {
+        double cycle = benchmark_now();
+        encode_speed(0.5, ACTUATOR_FORWARD, i, frame);
+        writer.submit(frame);
+        encode_steering(0.001 * (i % 100), i, frame);
+        submit_time[i & 0x0f] = benchmark_now();
+        writer.submit(frame);
+        double time_flush = benchmark_now();
+        writer.flush();
+        stats_flush.add(benchmark_now() - time_flush);
+        usleep(max(0.0, 0.01 - (benchmark_now() - cycle)) * 1e6);
+    }
+    usleep(20000);
+    running = false;
+    thread.join();
+    stats_latency = NULL;
+
+    printf("\n");
+    stats_flush.print();
+    stats.print();
+    printf("writer: written %lu, replaced %lu, errors %lu, pending %u\n", (unsigned long)writer.written(), \
+    (unsigned long)writer.replaced(), (unsigned long)writer.errors(), (unsigned)writer.pending());
+
+    if (receiver >= 0)
+    {
+        close(receiver);
+    }
+    delete bus;
+    return 0;
+}
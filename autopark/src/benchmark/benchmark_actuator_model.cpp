@@ -0,0 +1,162 @@
+/******************************************************************
+ * Filename: benchmark_actuator_model.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-30
+ * Description: benchmark of path tracking on planned parking paths
+ * with ideal and realistic actuator dynamics: maneuver time, errors
+ * and oscillation of the steering angle
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <cmath>
+#include <vector>
+
+#include "autopark/autoparking.h"
+#include "autopark/benchmark.h"
+#include "autopark/parking_planner.h"
+#include "autopark/path_tracking.h"
+#include "autopark/actuator_model.h"
+
+using namespace std;
+
+static const double time_max = 120;             // [s] abort of one simulation
+static const double reversal_min = 0.02;        // [rad] minimum amplitude of a steering reversal
+
+// result of tracking one path
+struct TrackingResult
+{
+    bool finished;
+    double time;                // [s] maneuver time
+    double error_max;           // [m] maximum lateral error seen by the tracker
+    double error_goal;          // [m] distance between true pose and end of path
+    double yaw_goal;            // [rad] heading error at end of path
+    double travel;              // [rad] total travel of steering angle
+    int reversals;              // changes of steering direction with amplitude > reversal_min
+};
+
+
+// track path as controller_path_tracking does: dead reckoning with measured speed and
+// steering angle of the simulated vehicle, which follows the actuator outputs
+// with constant speed of the segments, or with speed limited by tracking_speed()
+static TrackingResult track(const Path& path, const ActuatorDynamics& steering, const ActuatorDynamics& drive, \
+bool limited)
+{
+    VehicleSimulator vehicle(steering, drive);
+    CarPose start = {0, 0, 0};
+    vehicle.reset(start);
+
+    PathTracker tracker;
+    tracker.set_path(path);
+    CarPose estimate = start;
+
+    TrackingResult result = {false, 0, 0, 0, 0, 0, 0};
+    double dt = 1.0 / params().path_tracking_rate;
+    double steering_last = 0, extreme = 0;
+    int trend = 0;
+    while (result.time < time_max)
+    {
+        move_car_pose(estimate, vehicle.speed(), vehicle.steering(), dt);
+        double command = tracker.update(estimate);
+        if (tracker.finished())
+        {
+            vehicle.command_speed(0);
+            vehicle.command_steering(0);
+            result.finished = true;
+            break;
+        }
+        double speed = (tracker.direction() > 0) ? params().speed_parking_forward : params().speed_parking_backward;
+        if (limited)
+        {
+            speed = tracking_speed(speed, tracker.remaining(estimate), command - vehicle.steering());
+        }
+        vehicle.command_speed(speed);
+        vehicle.command_steering(command);
+        result.error_max = max(result.error_max, fabs(tracker.lateral_error()));
+
+        vehicle.step(dt);
+        result.time += dt;
+
+        // oscillation: count turning points of the steering angle with minimum amplitude
+        double angle = vehicle.steering();
+        result.travel += fabs(angle - steering_last);
+        steering_last = angle;
+        if (trend >= 0 && angle < extreme - reversal_min)
+        {
+            result.reversals += (trend > 0) ? 1 : 0;
+            trend = -1;
+        }
+        else if (trend <= 0 && angle > extreme + reversal_min)
+        {
+            result.reversals += (trend < 0) ? 1 : 0;
+            trend = 1;
+        }
+        if ((trend >= 0 && angle > extreme) || (trend <= 0 && angle < extreme))
+        {
+            extreme = angle;
+        }
+    }
+
+    // the car rolls out until it stands still
+    for (int i = 0; i < 1000 && (vehicle.speed() != 0 || !result.finished); i++)
+    {
+        vehicle.step(dt);
+        result.time += result.finished ? dt : 0;
+    }
+    const PathPoint& goal = path.back();
+    result.error_goal = hypot(vehicle.pose().x - goal.x, vehicle.pose().y - goal.y);
+    result.yaw_goal = fabs(normalize_angle(vehicle.pose().yaw - goal.yaw));
+    return result;
+}
+
+
+int main(int argc, char **argv)
+{
+    // actuator variants: ideal, car, slow steering rack
+    const char* names[] = {"ideal", "car", "slow rack"};
+    ActuatorDynamics slow = steering_dynamics();
+    slow.dead_time *= 2;
+    slow.rise_max /= 2;
+    slow.fall_max /= 2;
+    ActuatorDynamics steerings[] = {ideal_dynamics(), steering_dynamics(), slow};
+    ActuatorDynamics drives[] = {ideal_dynamics(), drive_dynamics(), drive_dynamics()};
+
+    // scenarios: parallel and perpendicular parking spaces (the left side is mirrored)
+    uint32_t types[] = {SPACE_RIGHT_PARALLEL, SPACE_RIGHT_PERPENDICULAR};
+    const char* type_names[] = {"parallel", "perpendicular"};
+
+    ParkingPlanner planner;
+    printf("%-14s %-10s %-8s %4s %8s %9s %9s %9s %9s %5s\n", "space", "actuator", "speed", "done", \
+    "time[s]", "err[m]", "goal[m]", "yaw[rad]", "travel", "osc");
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++)
+    {
+        bool parallel = (types[t] == SPACE_RIGHT_PARALLEL || types[t] == SPACE_LEFT_PARALLEL);
+        SpaceGeometry space;
+        space.width = parallel ? params().car_length + 1.7 : params().car_width + 0.8;
+        space.length = parallel ? params().car_width + 0.7 : params().car_length + 0.3;
+        space.distance = 0.8;
+        space.offset = -params().distance_apa_rear;
+        space.aisle = 0;
+
+        vector<PathSegment> segments;
+        if (!planner.plan(types[t], space, 0, segments))
+        {
+            printf("%-14s no path\n", type_names[t]);
+            continue;
+        }
+        Path path;
+        CarPose start = {0, 0, 0};
+        sample_path(segments, start, params().path_sample_step, path);
+
+        for (size_t a = 0; a < sizeof(names) / sizeof(names[0]); a++)
+        for (int limited = 0; limited <= 1; limited++)
+        {
+            TrackingResult result = track(path, steerings[a], drives[a], limited);
+            printf("%-14s %-10s %-8s %4s %8.2f %9.3f %9.3f %9.3f %9.3f %5d\n", type_names[t], names[a], \
+            limited ? "limited" : "constant", result.finished ? "yes" : "no", result.time, result.error_max, \
+            result.error_goal, result.yaw_goal, result.travel, result.reversals);
+        }
+    }
+    return 0;
+}
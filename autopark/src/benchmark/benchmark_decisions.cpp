@@ -0,0 +1,277 @@
+/******************************************************************
+ * Filename: benchmark_decisions.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-06
+ * Description: micro benchmarks of the decision logic of the nodes
+ * on synthetic traces: time and allocations per callback of search,
+ * surround monitor, choosing the parking space and parking in. It
+ * needs roscore, and overwrites the session store and trajectory
+ * cache: run it on a development machine, not on the car
+ * 
+ ******************************************************************/
+
+#define BENCHMARK_COUNT_ALLOCATIONS
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <ros/ros.h>
+#include <ros/master.h>
+#include <ros/console.h>
+#include <ros/callback_queue.h>
+#include "autopark/autoparking.h"
+#include "autopark/vehicle_profile.h"
+#include "autopark/benchmark.h"
+#include "autopark/search_parking_space_lf.h"
+#include "autopark/surround_monitor.h"
+#include "autopark/choose_parking_space.h"
+#include "autopark/parking_in.h"
+
+using namespace std;
+
+static const float trace_speed = 1.0;       // [m/s] car speed while searching
+static const double trace_period = 0.05;    // [s] period of apa messages
+
+
+static sensor_msgs::Range::Ptr range_msg(float range)
+{
+    sensor_msgs::Range::Ptr msg(new sensor_msgs::Range);
+    msg->range = range;
+    return msg;
+}
+
+static std_msgs::Float32::Ptr speed_msg(float speed)
+{
+    std_msgs::Float32::Ptr msg(new std_msgs::Float32);
+    msg->data = speed;
+    return msg;
+}
+
+static autopark::CarSpeed::Ptr speed_stamped_msg(float speed)
+{
+    autopark::CarSpeed::Ptr msg(new autopark::CarSpeed);
+    msg->speed = speed;
+    return msg;
+}
+
+// add apa messages of a constant range while the car drives length [m]
+static void append_ranges(vector<sensor_msgs::Range::Ptr>& trace, float range, double length)
+{
+    int samples = (int)(length / (trace_speed * trace_period));
+    for (int i = 0; i < samples; i++)
+    {
+        trace.push_back(range_msg(range));
+    }
+}
+
+
+// search: apa at left front passes a parked car, a parking gap and the next parked car
+static void benchmark_search(ros::NodeHandle& nh, double min_time)
+{
+    SearchParkingSpaceLF search(&nh);
+    autopark::CarSpeed::Ptr speed = speed_stamped_msg(trace_speed);
+
+    vector<sensor_msgs::Range::Ptr> trace;
+    append_ranges(trace, 3.0, 1.0);
+    append_ranges(trace, 0.8, ActiveProfile::car_length());
+    append_ranges(trace, 3.0, ActiveProfile::parallel_width() + 0.5);
+    append_ranges(trace, 0.8, ActiveProfile::car_length());
+    append_ranges(trace, 3.0, 1.0);
+
+    MicroBenchmark bench("search_parking_space_lf/check_parking_space", min_time);
+    bench.run([&](unsigned long i)
+    {
+        const sensor_msgs::Range::Ptr& msg = trace[i % trace.size()];
+        msg->header.stamp = ros::Time(i * trace_period);
+        // car speed is sampled with each apa message
+        speed->header.stamp = msg->header.stamp;
+        search.callback_car_speed(speed);
+        search.callback_apa_lf(msg);
+    });
+    bench.print();
+}
+
+// surround monitor: check upa ranges on each car speed message
+static void benchmark_monitor(double min_time)
+{
+    SurroundMonitor monitor;
+    sensor_msgs::Range::ConstPtr clear = range_msg(2.0);
+    sensor_msgs::Range::ConstPtr blocked = range_msg(0.2);
+    monitor.callback_upa_fl(clear);
+    monitor.callback_upa_fcl(clear);
+    monitor.callback_upa_fcr(clear);
+    monitor.callback_upa_fr(clear);
+    monitor.callback_upa_bl(clear);
+    monitor.callback_upa_bcl(clear);
+    monitor.callback_upa_bcr(clear);
+    monitor.callback_upa_br(clear);
+
+    // moving forward, nothing in the way: no command
+    std_msgs::Float32::ConstPtr forward = speed_msg(2.0);
+    MicroBenchmark bench_clear("surround_monitor/check_signals clear", min_time);
+    bench_clear.run([&](unsigned long i)
+    {
+        monitor.callback_car_speed(forward);
+    });
+    bench_clear.print();
+
+    // moving forward, object within brake distance: stop is published
+    monitor.callback_upa_fcl(blocked);
+    MicroBenchmark bench_blocked("surround_monitor/check_signals blocked", min_time);
+    bench_blocked.run([&](unsigned long i)
+    {
+        monitor.callback_car_speed(forward);
+    });
+    bench_blocked.print();
+
+    // car stops: moving forward is disabled, moving backward is enabled
+    std_msgs::Float32::ConstPtr stopped = speed_msg(0);
+    MicroBenchmark bench_stopped("surround_monitor/check_signals stopped", min_time);
+    bench_stopped.run([&](unsigned long i)
+    {
+        monitor.callback_car_speed(stopped);
+    });
+    bench_stopped.print();
+}
+
+// choose parking space: match the parking space of the apa at front with the one at back,
+// a match is published and saved to the session store
+static void benchmark_choose(ros::NodeHandle& nh, double min_time)
+{
+    ChooseParkingSpace choose(&nh);
+    autopark::CarSpeed::Ptr speed = speed_stamped_msg(trace_speed);
+
+    autopark::ParkingSpace::Ptr front(new autopark::ParkingSpace);
+    front->type = SPACE_LEFT_PERPENDICULAR;
+    front->width = 2.8;
+    front->length = 5.2;
+    front->distance = 0.8;
+    autopark::ParkingSpace::Ptr back(new autopark::ParkingSpace(*front));
+
+    // the apa at back reports the parking space too early: rejected
+    MicroBenchmark bench_reject("choose_parking_space/match rejected", min_time);
+    bench_reject.run([&](unsigned long i)
+    {
+        front->header.stamp = ros::Time(i * 10.0);
+        back->header.stamp = front->header.stamp + ros::Duration(1.0);
+        speed->header.stamp = front->header.stamp;
+        choose.callback_car_speed(speed);
+        speed->header.stamp = back->header.stamp;
+        choose.callback_car_speed(speed);
+        choose.callback_parking_space_lf(front);
+        choose.callback_parking_space_lb(back);
+    });
+    bench_reject.print();
+
+    // the apa at back reports the parking space after distance_apa: chosen, the stamps
+    // continue after the rejected ones as the history of car speed is in order of time
+    ros::Duration delay(params().distance_apa / trace_speed);
+    double stamp_start = bench_reject.operations() * 10.0;
+    MicroBenchmark bench_choose("choose_parking_space/match chosen", min_time);
+    bench_choose.run([&](unsigned long i)
+    {
+        front->header.stamp = ros::Time(stamp_start + i * 10.0);
+        back->header.stamp = front->header.stamp + delay;
+        speed->header.stamp = front->header.stamp;
+        choose.callback_car_speed(speed);
+        speed->header.stamp = back->header.stamp;
+        choose.callback_car_speed(speed);
+        choose.callback_parking_space_lf(front);
+        choose.callback_parking_space_lb(back);
+    });
+    bench_choose.print();
+}
+
+// parking in: steps of the state machine of perpendicular parking with sensors
+static void benchmark_parking_in(ros::NodeHandle& nh, double min_time)
+{
+    ParkingIn parking(&nh);
+    ros::WallTimerEvent event;
+
+    // all ranges are clear, the apas at back are in the parking space
+    sensor_msgs::Range::ConstPtr clear = range_msg(2.0);
+    sensor_msgs::Range::ConstPtr inside = range_msg(0.8);
+    parking.callback_apa_lf(clear);
+    parking.callback_apa_lb(inside);
+    parking.callback_apa_lb2(inside);
+    parking.callback_apa_rf(clear);
+    parking.callback_apa_rb(inside);
+    parking.callback_apa_rb2(inside);
+    parking.callback_upa_fl(clear);
+    parking.callback_upa_fcl(clear);
+    parking.callback_upa_fcr(clear);
+    parking.callback_upa_fr(clear);
+    parking.callback_upa_bl(clear);
+    parking.callback_upa_bcl(clear);
+    parking.callback_upa_bcr(clear);
+    parking.callback_upa_br(clear);
+    parking.callback_car_speed(speed_msg(0));
+
+    // parking space too narrow for a path: move forward before parking in with sensors
+    autopark::ParkingSpace::Ptr space(new autopark::ParkingSpace);
+    space->type = SPACE_LEFT_PERPENDICULAR;
+    space->width = ActiveProfile::car_width();
+    space->length = ActiveProfile::perpendicular_length();
+    space->distance = 0.8;
+    space->header.stamp = ros::Time::now();
+    parking.callback_parking_space(space);
+    if (parking.state() == PARKING_MOVE_BEFORE)
+    {
+        MicroBenchmark bench_move("parking_in/callback_control move before", min_time);
+        bench_move.run([&](unsigned long i)
+        {
+            parking.callback_control(event);
+        });
+        bench_move.print();
+    }
+    else
+    {
+        printf("parking_in: path found or searched into the narrow parking space, move before is skipped\n");
+    }
+
+    // align: car moves backward, the car turns a step to the parking side and back in turn
+    parking.start_perpendicular();
+    parking.callback_car_speed(speed_msg(-params().speed_parking_backward));
+    sensor_msgs::Range::ConstPtr ranges_lb2[2] = {range_msg(0.6), range_msg(1.0)};
+    MicroBenchmark bench_align("parking_in/callback_control align", min_time);
+    bench_align.run([&](unsigned long i)
+    {
+        parking.callback_apa_lb2(ranges_lb2[i % 2]);
+        parking.callback_control(event);
+    });
+    bench_align.print();
+
+    parking.cancel_parking();
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "benchmark_decisions", ros::init_options::AnonymousName);
+    // the nodes advertise and subscribe their topics
+    if (!ros::master::check())
+    {
+        printf("roscore is not running\n");
+        return 1;
+    }
+    // messages of the nodes are not printed while measuring
+    if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Error))
+    {
+        ros::console::notifyLoggerLevelsChanged();
+    }
+    double min_time = (argc > 1) ? atof(argv[1]) : 0.5;
+
+    // callbacks of the nodes are called only by the benchmarks, the queue is never spun
+    ros::CallbackQueue callback_queue;
+    ros::NodeHandle nh_c;
+    nh_c.setCallbackQueue(&callback_queue);
+
+    benchmark_search(nh_c, min_time);
+    benchmark_monitor(min_time);
+    benchmark_choose(nh_c, min_time);
+    benchmark_parking_in(nh_c, min_time);
+
+    return 0;
+}
@@ -0,0 +1,252 @@
+/******************************************************************
+ * Filename: benchmark_executor.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-10
+ * Description: benchmark of scheduling the callbacks of one node:
+ * custom callback queue with AsyncSpinner(0) against the executor
+ * with a strand. Throughput, dispatch latency at sensor rate,
+ * context switches, threads and concurrent callbacks of the object
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <sys/resource.h>
+
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <ros/callback_queue.h>
+#include "autopark/benchmark.h"
+#include "autopark/executor.h"
+
+using namespace std;
+
+static const int topics = 14;                   // subscriptions of a node: apa and upa ranges
+static const int callbacks_throughput = 200000; // callbacks of throughput benchmark
+static const double rate_latency = 100;         // [Hz] rate of each topic in latency benchmark
+static const double duration_latency = 5;       // [s] duration of latency benchmark
+static const double work_callback = 20e-6;      // [s] work of a callback in latency benchmark
+
+
+// callbacks of one object: counts calls and concurrent calls, records dispatch latency
+struct Probe
+{
+    boost::atomic<long> calls;
+    boost::atomic<int> running;
+    boost::atomic<int> running_max;
+    boost::mutex mutex;
+    BenchmarkStats* latency;
+
+    Probe() : calls(0), running(0), running_max(0), latency(NULL) {}
+};
+
+class ProbeCallback : public ros::CallbackInterface
+{
+private:
+    Probe& probe_;
+    double time_added_;
+    double work_;
+
+public:
+    ProbeCallback(Probe& probe, double work) : probe_(probe), time_added_(benchmark_now()), work_(work) {}
+
+    virtual CallResult call()
+    {
+        double time_called = benchmark_now();
+        int running = ++probe_.running;
+        int running_max = probe_.running_max;
+        while (running > running_max && !probe_.running_max.compare_exchange_weak(running_max, running))
+        {
+        }
+
+        if (probe_.latency != NULL)
+        {
+            boost::mutex::scoped_lock lock(probe_.mutex);
+            probe_.latency->add(time_called - time_added_);
+        }
+        // busy work of a callback, e.g. checking a parking space
+        while (benchmark_now() - time_called < work_)
+        {
+        }
+
+        probe_.running--;
+        probe_.calls++;
+        return Success;
+    }
+};
+
+
+// way of running the callbacks of a node: the queue callbacks are added to
+class Scheduler
+{
+public:
+    virtual ~Scheduler() {}
+    virtual ros::CallbackQueueInterface& queue() = 0;
+};
+
+// custom callback queue with AsyncSpinner(0): a thread per core calls available callbacks
+class SpinnerScheduler : public Scheduler
+{
+private:
+    ros::CallbackQueue queue_;
+    boost::thread_group threads_;
+    boost::atomic<bool> running_;
+
+    void spin()
+    {
+        while (running_)
+        {
+            queue_.callAvailable(ros::WallDuration(0.1));
+        }
+    }
+
+public:
+    SpinnerScheduler() : running_(true)
+    {
+        unsigned threads = boost::thread::hardware_concurrency();
+        for (unsigned i = 0; i < (threads ? threads : 1); i++)
+        {
+            threads_.create_thread(boost::bind(&SpinnerScheduler::spin, this));
+        }
+    }
+
+    ~SpinnerScheduler()
+    {
+        running_ = false;
+        threads_.join_all();
+    }
+
+    ros::CallbackQueueInterface& queue() { return queue_; }
+};
+
+// executor with a strand, as in the nodes
+class StrandScheduler : public Scheduler
+{
+private:
+    Executor executor_;
+    Strand strand_;
+
+public:
+    explicit StrandScheduler(unsigned threads) : executor_(threads), strand_(executor_)
+    {
+        strand_.start();
+    }
+
+    ~StrandScheduler()
+    {
+        strand_.stop();
+    }
+
+    ros::CallbackQueueInterface& queue() { return strand_; }
+};
+
+
+static long context_switches()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_nvcsw + usage.ru_nivcsw;
+}
+
+static int thread_count()
+{
+    int count = 0;
+    DIR* dir = opendir("/proc/self/task");
+    if (dir == NULL)
+    {
+        return 0;
+    }
+    while (struct dirent* entry = readdir(dir))
+    {
+        if (entry->d_name[0] != '.')
+        {
+            count++;
+        }
+    }
+    closedir(dir);
+    return count;
+}
+
+static void wait_calls(Probe& probe, long calls)
+{
+    while (probe.calls < calls)
+    {
+        boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+    }
+}
+
+// add empty callbacks of all topics as fast as possible, time per callback until all are called
+static void benchmark_throughput(const char* name, Scheduler& scheduler)
+{
+    Probe probe;
+    long switches = context_switches();
+    double time_start = benchmark_now();
+    for (int i = 0; i < callbacks_throughput; i++)
+    {
+        scheduler.queue().addCallback(ros::CallbackInterfacePtr(new ProbeCallback(probe, 0)), i % topics + 1);
+    }
+    wait_calls(probe, callbacks_throughput);
+    double duration = benchmark_now() - time_start;
+
+    printf("%-24s throughput: %8.1fns/callback %8.3f switches/callback, concurrent callbacks max %d\n", \
+    name, duration / callbacks_throughput * 1e9, (double)(context_switches() - switches) / callbacks_throughput, \
+    (int)probe.running_max);
+}
+
+// add callbacks of all topics at sensor rate, latency from adding to calling a callback
+static void benchmark_latency(const char* name, Scheduler& scheduler)
+{
+    Probe probe;
+    BenchmarkStats latency(string(name) + " latency");
+    probe.latency = &latency;
+
+    long switches = context_switches();
+    int threads = thread_count();
+    long added = 0;
+    double period = 1.0 / rate_latency;
+    double time_start = benchmark_now();
+    for (double time_next = time_start; time_next - time_start < duration_latency; time_next += period)
+    {
+        while (benchmark_now() < time_next)
+        {
+            boost::this_thread::sleep_for(boost::chrono::microseconds(100));
+        }
+        for (int topic = 0; topic < topics; topic++)
+        {
+            scheduler.queue().addCallback(ros::CallbackInterfacePtr(new ProbeCallback(probe, work_callback)), \
+            topic + 1);
+            added++;
+        }
+    }
+    wait_calls(probe, added);
+    double duration = benchmark_now() - time_start;
+
+    latency.print();
+    printf("%-24s %d threads, %8.1f switches/s, concurrent callbacks max %d\n", name, threads, \
+    (context_switches() - switches) / duration, (int)probe.running_max);
+}
+
+static void benchmark_scheduler(const char* name, Scheduler* scheduler)
+{
+    benchmark_throughput(name, *scheduler);
+    benchmark_latency(name, *scheduler);
+    delete scheduler;
+}
+
+
+int main(int argc, char **argv)
+{
+    printf("%u cores, %d topics, latency at %.0f Hz per topic with %.0fus per callback\n", \
+    boost::thread::hardware_concurrency(), topics, rate_latency, work_callback * 1e6);
+
+    benchmark_scheduler("async_spinner(0)", new SpinnerScheduler);
+    benchmark_scheduler("executor(1) strand", new StrandScheduler(1));
+    benchmark_scheduler("executor(2) strand", new StrandScheduler(2));
+
+    return 0;
+}
@@ -0,0 +1,105 @@
+/******************************************************************
+ * Filename: benchmark_firing_scheduler.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-17
+ * Description: simulation of the firing scheduler in each mode: rate
+ * and longest gap of each sensor, slots with crosstalk, compared with
+ * firing one sensor at a time and all sensors at once
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <vector>
+
+#include "autopark/benchmark.h"
+#include "autopark/firing_scheduler.h"
+
+using namespace std;
+
+static const double duration_simulation = 60;   // [s] simulated time of each mode
+
+
+// pairs of channels with crosstalk in a slot
+static int crosstalk_count(const vector<int>& channels)
+{
+    int count = 0;
+    for (size_t i = 0; i < channels.size(); i++)
+    {
+        for (size_t j = i + 1; j < channels.size(); j++)
+        {
+            count += crosstalk(channels[i], channels[j]);
+        }
+    }
+    return count;
+}
+
+// simulate the slots of a mode, print rate and longest gap of each channel
+static void simulate(FiringMode mode)
+{
+    FiringScheduler scheduler;
+    scheduler.set_mode(mode);
+
+    float rates[ULTRASONIC_CHANNELS];
+    scheduler.rates(duration_simulation, rates);
+
+    double fired_last[ULTRASONIC_CHANNELS] = {0};
+    double gap_max[ULTRASONIC_CHANNELS] = {0};
+    int fired[ULTRASONIC_CHANNELS] = {0};
+    int slots = 0, violations = 0, overruns = 0;
+    vector<int> channels;
+    double time = 0;
+    double time_start = benchmark_now();
+    while (time < duration_simulation)
+    {
+        double duration = scheduler.next_slot(channels);
+        violations += crosstalk_count(channels);
+        for (size_t i = 0; i < channels.size(); i++)
+        {
+            int channel = channels[i];
+            overruns += echo_time(channel) > duration;
+            gap_max[channel] = max(gap_max[channel], time - fired_last[channel]);
+            fired_last[channel] = time;
+            fired[channel]++;
+        }
+        time += duration;
+        slots++;
+    }
+    double time_slot = (benchmark_now() - time_start) / slots;
+
+    printf("mode %s: %d slots, %.1fns per slot, %d slots with crosstalk, %d echoes longer than slot\n", \
+    firing_mode_names[mode], slots, time_slot * 1e9, violations, overruns);
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        printf("  %-8s %6.1f Hz (expected %6.1f Hz), longest gap %6.1f ms\n", ultrasonic_channels[i].name, \
+        fired[i] / time, rates[i], gap_max[i] * 1e3);
+    }
+}
+
+
+int main()
+{
+    // one sensor at a time: each waits for the echoes of all others
+    double cycle_sequential = 0, echo_max = 0;
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        cycle_sequential += echo_time(i);
+        echo_max = max(echo_max, echo_time(i));
+    }
+    // all sensors at once: as fast as the longest echo, with crosstalk in every cycle
+    vector<int> all;
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        all.push_back(i);
+    }
+    printf("one at a time: %.1f Hz per sensor\n", 1 / cycle_sequential);
+    printf("all at once: %.1f Hz per sensor, %d pairs with crosstalk per cycle\n", 1 / echo_max, \
+    crosstalk_count(all));
+
+    for (int mode = 0; mode < FIRING_MODES; mode++)
+    {
+        simulate((FiringMode)mode);
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+/******************************************************************
+ * Filename: benchmark_hybrid_astar.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-19
+ * Description: benchmark of Hybrid A* and geometric planner on
+ * perpendicular parking spaces in narrow aisles
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <vector>
+
+#include "autopark/autoparking.h"
+#include "autopark/benchmark.h"
+#include "autopark/parking_planner.h"
+#include "autopark/hybrid_astar.h"
+
+using namespace std;
+
+
+int main(int argc, char **argv)
+{
+    const char* filename = (argc > 1) ? argv[1] : heuristic_table_file;
+
+    HybridAStar astar;
+    double time_load = benchmark_now();
+    if (!astar.load_heuristic(filename))
+    {
+        printf("cannot save heuristic table to %s\n", filename);
+    }
+    printf("heuristic table %s ready in %.3f[s]\n\n", filename, benchmark_now() - time_load);
+
+    // scenarios: width of parking space and width of aisle (from car side)
+    float widths[] = {2.4, 2.5, 2.6, 2.8, 3.0};
+    float aisles[] = {2.5, 3.0, 3.5, 4.0, 5.0};
+    uint32_t types[] = {SPACE_RIGHT_PERPENDICULAR, SPACE_LEFT_PERPENDICULAR};
+
+    ParkingPlanner planner;
+    BenchmarkStats stats_geometric("geometric planner");
+    BenchmarkStats stats_astar("hybrid a*");
+    int solved_geometric = 0, solved_astar = 0, scenarios = 0;
+    size_t expanded = 0;
+
+    printf("%-6s %-6s %-6s  %-12s %-24s\n", "type", "width", "aisle", "geometric", "hybrid a*");
+    for (size_t t = 0; t < sizeof(types) / sizeof(types[0]); t++)
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+    for (size_t a = 0; a < sizeof(aisles) / sizeof(aisles[0]); a++)
+    {
+        SpaceGeometry space;
+        space.width = widths[w];
+        space.length = params().car_length + 0.3;
+        space.distance = 0.8;
+        space.offset = -params().distance_apa_rear;
+        space.aisle = aisles[a];
+        scenarios++;
+
+        vector<PathSegment> segments;
+        double time_start = benchmark_now();
+        bool geometric = planner.plan(types[t], space, 0, segments);
+        stats_geometric.add(benchmark_now() - time_start);
+        solved_geometric += geometric;
+
+        CarPose start = {0, 0, 0}, goal;
+        planner.set_space(types[t], space, goal);
+        bool found = astar.plan(planner.obstacles(), start, goal, params().hybrid_astar_time_budget, segments);
+        stats_astar.add(astar.duration());
+        solved_astar += found;
+        expanded += astar.expanded();
+
+        printf("0x%02x   %-6.1f %-6.1f  %-12s %-3s %2d moves %6u nodes\n", types[t], space.width, space.aisle, \
+        geometric ? "ok" : "-", found ? "ok" : "-", found ? (int)segments.size() : 0, (unsigned)astar.expanded());
+    }
+
+    printf("\nsolved: geometric %d/%d, hybrid a* %d/%d, mean %u nodes expanded\n", \
+    solved_geometric, scenarios, solved_astar, scenarios, (unsigned)(expanded / scenarios));
+    stats_geometric.print();
+    stats_astar.print();
+    return 0;
+}
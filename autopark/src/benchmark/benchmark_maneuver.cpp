@@ -0,0 +1,304 @@
+/******************************************************************
+ * Filename: benchmark_maneuver.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-20
+ * Description: batch evaluation of the maneuvers of parking out:
+ * hundreds of maneuvers run concurrently on one thread, each one in a
+ * simulated parking space of random geometry with ray cast ultrasonic
+ * sensors and a kinematic car. Outcome of the maneuvers, cost of a
+ * step and memory of a maneuver
+ * usage: benchmark_maneuver [maneuvers [seed]]
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <pthread.h>
+
+#include "autopark/parameters.h"
+#include "autopark/benchmark.h"
+#include "autopark/ultrasonic.h"
+#include "autopark/parking_planner.h"
+#include "autopark/parking_out_maneuvers.h"
+
+using namespace std;
+
+static const int maneuvers_default = 400;       // maneuvers running concurrently
+static const double period_step = 0.05;         // [s] simulation step, a measurement of all sensors
+static const double time_limit = 60;            // [s] a maneuver is given up after
+static const double beam_angle = 0.26;          // [rad] half opening of the beam of a sensor (~15°)
+static const uint32_t space_types[] = {SPACE_LEFT_PERPENDICULAR, SPACE_LEFT_PARALLEL, \
+SPACE_RIGHT_PERPENDICULAR, SPACE_RIGHT_PARALLEL};
+static const char* const space_names[] = {"left perpendicular", "left parallel", \
+"right perpendicular", "right parallel"};
+
+
+// mount of a sensor in car frame (rear axle at origin)
+struct Mount
+{
+    double x;
+    double y;
+    double yaw;
+};
+
+// apas look to the side at the car corners, upas at the bumpers, in order of RangeSensor
+static void sensor_mounts(Mount mounts[RANGE_SENSORS])
+{
+    const Parameters& p = params();
+    double front = p.car_length - p.rear_overhang;
+    double back = -p.rear_overhang;
+    double side = p.car_width / 2;
+    double apa_front = min((double)(p.distance_apa_rear + p.distance_apa), front);
+    Mount table[RANGE_SENSORS] = {
+        {apa_front, side, M_PI / 2}, {p.distance_apa_rear, side, M_PI / 2}, {back, side, M_PI / 2},
+        {apa_front, -side, -M_PI / 2}, {p.distance_apa_rear, -side, -M_PI / 2}, {back, -side, -M_PI / 2},
+        {front, 0.75 * side, 0.5}, {front, 0.25 * side, 0}, {front, -0.25 * side, 0}, {front, -0.75 * side, -0.5},
+        {back, 0.75 * side, M_PI - 0.5}, {back, 0.25 * side, M_PI}, {back, -0.25 * side, M_PI}, \
+        {back, -0.75 * side, 0.5 - M_PI}
+    };
+    copy(table, table + RANGE_SENSORS, mounts);
+}
+
+// distance along a ray to a box, +inf if the ray misses it
+static double ray_box(double x, double y, double dx, double dy, const Box& box)
+{
+    double t_min = 0, t_max = numeric_limits<double>::infinity();
+    double origin[2] = {x, y}, direction[2] = {dx, dy};
+    double low[2] = {box.x_min, box.y_min}, high[2] = {box.x_max, box.y_max};
+    for (int k = 0; k < 2; k++)
+    {
+        if (fabs(direction[k]) < 1e-12)
+        {
+            if (origin[k] < low[k] || origin[k] > high[k])
+            {
+                return numeric_limits<double>::infinity();
+            }
+            continue;
+        }
+        double t1 = (low[k] - origin[k]) / direction[k];
+        double t2 = (high[k] - origin[k]) / direction[k];
+        t_min = max(t_min, min(t1, t2));
+        t_max = min(t_max, max(t1, t2));
+    }
+    return (t_min <= t_max) ? t_min : numeric_limits<double>::infinity();
+}
+
+// one maneuver in its own parking space
+struct Simulation
+{
+    int type;                           // index of space_types
+    vector<Box> obstacles;
+    CarPose pose;
+    double steering;                    // [rad]
+    float speed;                        // [m/s]
+    ManeuverInput input;
+    Maneuver* maneuver;
+    bool contact;                       // car came closer than planner_margin to an obstacle
+    bool collision;                     // car body touched an obstacle
+    double time;                        // [s] until the maneuver is over
+};
+
+static Maneuver* create_maneuver(uint32_t type)
+{
+    switch (type)
+    {
+    case SPACE_LEFT_PERPENDICULAR:
+        return new PerpendicularOut<SIDE_LEFT>();
+    case SPACE_LEFT_PARALLEL:
+        return new ParallelOut<SIDE_LEFT>();
+    case SPACE_RIGHT_PERPENDICULAR:
+        return new PerpendicularOut<SIDE_RIGHT>();
+    default:
+        return new ParallelOut<SIDE_RIGHT>();
+    }
+}
+
+static double uniform(unsigned int& seed, double low, double high)
+{
+    return low + (high - low) * rand_r(&seed) / RAND_MAX;
+}
+
+// parked car in a parking space of random geometry, the street is free or narrowed by an aisle
+static void setup(Simulation& sim, unsigned int& seed)
+{
+    const Parameters& p = params();
+    sim.type = rand_r(&seed) % 4;
+    uint32_t type = space_types[sim.type];
+    bool perpendicular = (type == SPACE_LEFT_PERPENDICULAR || type == SPACE_RIGHT_PERPENDICULAR);
+
+    SpaceGeometry space;
+    space.width = perpendicular ? p.car_width + uniform(seed, 0.6, 1.4) : p.car_length + uniform(seed, 0.8, 2.0);
+    space.length = perpendicular ? p.car_length + uniform(seed, 0.2, 0.8) : p.car_width + uniform(seed, 0.3, 0.8);
+    space.distance = uniform(seed, 0.5, 1.5);
+    space.offset = 0;
+    space.aisle = (rand_r(&seed) % 2) ? uniform(seed, 5, 8) : 0;
+
+    ParkingPlanner planner;
+    planner.set_space(type, space, sim.pose);
+    sim.obstacles = planner.obstacles();
+    sim.steering = 0;
+    sim.speed = 0;
+    sim.input.distance = 0;
+    sim.input.speed = 0;
+    sim.maneuver = create_maneuver(type);
+    sim.contact = false;
+    sim.collision = false;
+    sim.time = 0;
+}
+
+// ranges of all sensors at the pose of the car
+static void sense(Simulation& sim, const Mount mounts[RANGE_SENSORS])
+{
+    double c = cos(sim.pose.yaw), s = sin(sim.pose.yaw);
+    for (int i = 0; i < RANGE_SENSORS; i++)
+    {
+        double x = sim.pose.x + c * mounts[i].x - s * mounts[i].y;
+        double y = sim.pose.y + s * mounts[i].x + c * mounts[i].y;
+        double range = numeric_limits<double>::infinity();
+        for (int ray = -1; ray <= 1; ray++)
+        {
+            double yaw = sim.pose.yaw + mounts[i].yaw + ray * beam_angle;
+            for (size_t k = 0; k < sim.obstacles.size(); k++)
+            {
+                range = min(range, ray_box(x, y, cos(yaw), sin(yaw), sim.obstacles[k]));
+            }
+        }
+        const UltrasonicChannel& channel = ultrasonic_channels[i];
+        sim.input.range[i] = (range > channel.max_range) ? numeric_limits<float>::infinity() : \
+        max((float)range, channel.min_range);
+    }
+    sim.input.speed = sim.speed;
+}
+
+// commands as controller_turn applies them, then move the car for a step
+static void drive(Simulation& sim)
+{
+    const Parameters& p = params();
+    const ManeuverCommand& command = sim.maneuver->command();
+    if (command.move_set)
+    {
+        sim.speed = command.move;
+    }
+    if (command.turn_set)
+    {
+        switch (command.turn)
+        {
+        case 'D': sim.steering = 0; break;
+        case 'L': sim.steering = p.steering_angle_max; break;
+        case 'R': sim.steering = -p.steering_angle_max; break;
+        case 'l': sim.steering = min(sim.steering + p.steering_angle_step, (double)p.steering_angle_max); break;
+        case 'r': sim.steering = max(sim.steering - p.steering_angle_step, -(double)p.steering_angle_max); break;
+        }
+    }
+
+    double length = sim.speed * period_step;
+    move_car_arc(sim.pose, sim.steering, length);
+    sim.input.distance += length;
+    sim.time += period_step;
+    for (size_t k = 0; k < sim.obstacles.size() && length != 0; k++)
+    {
+        // collision_box keeps planner_margin around the car: the car body touches
+        // the box reduced by it
+        Box box = sim.obstacles[k];
+        box.x_min += p.planner_margin;
+        box.x_max -= p.planner_margin;
+        box.y_min += p.planner_margin;
+        box.y_max -= p.planner_margin;
+        sim.contact = sim.contact || collision_box(sim.pose, sim.obstacles[k]);
+        sim.collision = sim.collision || collision_box(sim.pose, box);
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : maneuvers_default;
+    unsigned int seed = (argc > 2) ? atoi(argv[2]) : 1;
+    if (count <= 0)
+    {
+        fprintf(stderr, "usage: benchmark_maneuver [maneuvers [seed]]\n");
+        return 1;
+    }
+
+    Mount mounts[RANGE_SENSORS];
+    sensor_mounts(mounts);
+    vector<Simulation> sims(count);
+    for (int i = 0; i < count; i++)
+    {
+        setup(sims[i], seed);
+    }
+
+    // all maneuvers on this thread: each step resumes every maneuver which is not over
+    double resume_time = 0;
+    unsigned long resumes = 0;
+    int running = count;
+    double time_start = benchmark_now();
+    for (double time = 0; running > 0 && time < time_limit; time += period_step)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            Simulation& sim = sims[i];
+            if (sim.maneuver->done())
+            {
+                continue;
+            }
+            sense(sim, mounts);
+            double resume_start = benchmark_now();
+            bool active = sim.maneuver->resume(sim.input);
+            resume_time += benchmark_now() - resume_start;
+            resumes++;
+            drive(sim);
+            if (!active)
+            {
+                running--;
+            }
+        }
+    }
+    double wall = benchmark_now() - time_start;
+
+    printf("%d maneuvers on one thread, step %.0fms, limit %.0fs\n", count, period_step * 1e3, time_limit);
+    printf("  %-20s %5s %9s %9s %8s %9s %8s\n", "space", "runs", "succeeded", "timed out", "contact", \
+    "collision", "time[s]");
+    for (int t = 0; t < 4; t++)
+    {
+        int runs = 0, succeeded = 0, timed_out = 0, contact = 0, collision = 0;
+        double time_sum = 0;
+        for (int i = 0; i < count; i++)
+        {
+            if (sims[i].type != t)
+            {
+                continue;
+            }
+            runs++;
+            succeeded += sims[i].maneuver->succeeded() ? 1 : 0;
+            timed_out += sims[i].maneuver->done() ? 0 : 1;
+            contact += sims[i].contact ? 1 : 0;
+            collision += sims[i].collision ? 1 : 0;
+            time_sum += sims[i].time;
+        }
+        printf("  %-20s %5d %9d %9d %8d %9d %8.1f\n", space_names[t], runs, succeeded, timed_out, contact, \
+        collision, runs > 0 ? time_sum / runs : 0);
+    }
+
+    // a polling loop per maneuver would need a thread with its stack
+    size_t stack = 0;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_getstacksize(&attr, &stack);
+    pthread_attr_destroy(&attr);
+    printf("steps: %lu, %.0fns per resume, %.0fs of maneuvers simulated per second\n", resumes, \
+    resumes > 0 ? resume_time / resumes * 1e9 : 0, resumes * period_step / wall);
+    printf("memory of a maneuver: perpendicular %zu bytes, parallel %zu bytes; stack of a thread %zu KiB\n", \
+    sizeof(PerpendicularOut<SIDE_LEFT>), sizeof(ParallelOut<SIDE_LEFT>), stack / 1024);
+
+    for (int i = 0; i < count; i++)
+    {
+        delete sims[i].maneuver;
+    }
+    return 0;
+}
@@ -0,0 +1,563 @@
+/******************************************************************
+ * Filename: benchmark_pipeline.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-08
+ * Description: benchmark of the launched autopark graph: publish
+ * synthetic range sensors and car speed at each rate, measure cpu
+ * time and context switches of each node, dropped messages of each
+ * subscription and the latency from a blocked upa to the stop in
+ * cmd_move, and the time of the transitions of lifecycle_manager
+ * to start and stop searching, write a json report to compare
+ * releases. It is started by benchmark_pipeline.launch instead of
+ * the sensor nodes
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <unistd.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+#include <ros/spinner.h>
+#include <std_msgs/Bool.h>
+#include <std_msgs/Float32.h>
+#include <sensor_msgs/Range.h>
+#include <rosgraph_msgs/TopicStatistics.h>
+#include "autopark/autoparking.h"
+#include "autopark/benchmark.h"
+#include "autopark/side_traits.h"
+#include "autopark/parking_kernels.h"
+#include "autopark/CarSpeed.h"
+
+using namespace std;
+
+// topics of range sensors, in the order of RangeSensor
+static const char* const range_topic[RANGE_SENSORS] = {"apa_lf", "apa_lb", "apa_lb2", "apa_rf", "apa_rb", \
+"apa_rb2", "upa_fl", "upa_fcl", "upa_fcr", "upa_fr", "upa_bl", "upa_bcl", "upa_bcr", "upa_br"};
+
+// nodes of benchmark_pipeline.launch, measured if parameter ~nodes is not set
+static const char* const node_default[] = {"controller_arbiter", "controller_move", "controller_turn", \
+"controller_path_tracking", "parking_in", "parking_out", "surround_monitor", "choose_parking_space", \
+"search_parking_space", "search_parking_space_lf", "search_parking_space_lb", "search_parking_space_rf", \
+"search_parking_space_rb", "sensor_odometry"};
+
+static const float range_clear = 3.0;       // [m] beyond distance_search and brake distance
+static const double block_time = 0.3;       // [s] upa at front center left is blocked at the begin of each cycle
+static const double settle_time = 2.0;      // [s] wait for nodes to start their spinners
+static const double statistics_wait = 5.0;  // [s] longer than statistics_window_max_size of the launch file
+
+
+// cpu time and context switches of a process, summed over its threads
+struct ProcessUsage
+{
+    bool running;
+    double cpu;                     // [s] user and system time
+    unsigned long voluntary;        // context switches: waiting for messages, locks and timers
+    unsigned long involuntary;      // context switches: preempted
+};
+
+// messages of a subscription from topic statistics
+struct TopicDrops
+{
+    unsigned long delivered;
+    unsigned long dropped;          // dropped from the subscriber queue
+    double age_sum;                 // [s] age of stamps by delivered messages
+    double age_max;                 // [s]
+};
+
+// results of one rate
+struct PipelinePhase
+{
+    double rate;                    // [Hz] messages per sensor
+    ros::Time begin;
+    double duration;                // [s]
+    unsigned long published;
+    BenchmarkStats latency;         // [s] blocked upa published to stop received
+    unsigned long missed;           // cycles without stop, or with the car not moving before
+    vector<ProcessUsage> usage;     // per measured node
+    map<pair<string, string>, TopicDrops> topics;   // by topic and subscriber node
+
+    PipelinePhase(double phase_rate) : rate(phase_rate), duration(0), published(0), latency("latency"), missed(0) {}
+};
+
+
+// pid of the node launched with __name:=name, 0 if it is not running
+static int find_node(const string& name)
+{
+    string argument = "__name:=" + name;
+    DIR* dir = opendir("/proc");
+    if (dir == NULL)
+    {
+        return 0;
+    }
+    int pid = 0;
+    struct dirent* entry;
+    while (pid == 0 && (entry = readdir(dir)) != NULL)
+    {
+        int candidate = atoi(entry->d_name);
+        if (candidate <= 0)
+        {
+            continue;
+        }
+        // arguments are separated by '\0'
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d/cmdline", candidate);
+        FILE* file = fopen(path, "r");
+        if (file == NULL)
+        {
+            continue;
+        }
+        char cmdline[4096];
+        size_t size = fread(cmdline, 1, sizeof(cmdline) - 1, file);
+        fclose(file);
+        cmdline[size] = '\0';
+        for (size_t i = 0; i < size; i += strlen(cmdline + i) + 1)
+        {
+            if (argument == cmdline + i)
+            {
+                pid = candidate;
+                break;
+            }
+        }
+    }
+    closedir(dir);
+    return pid;
+}
+
+static bool read_usage(int pid, ProcessUsage& usage)
+{
+    usage.running = false;
+    usage.cpu = 0;
+    usage.voluntary = 0;
+    usage.involuntary = 0;
+    if (pid <= 0)
+    {
+        return false;
+    }
+
+    // utime and stime of all threads are fields 14 and 15 of stat, after the command in parentheses
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* file = fopen(path, "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    char line[1024];
+    bool valid = (fgets(line, sizeof(line), file) != NULL);
+    fclose(file);
+    const char* fields = valid ? strrchr(line, ')') : NULL;
+    unsigned long utime, stime;
+    if (fields == NULL || sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", \
+    &utime, &stime) != 2)
+    {
+        return false;
+    }
+    usage.cpu = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+
+    // context switches are counted for each thread
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    DIR* dir = opendir(path);
+    if (dir == NULL)
+    {
+        return false;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (entry->d_name[0] == '.')
+        {
+            continue;
+        }
+        char status[128];
+        snprintf(status, sizeof(status), "/proc/%d/task/%s/status", pid, entry->d_name);
+        file = fopen(status, "r");
+        if (file == NULL)
+        {
+            continue;
+        }
+        unsigned long count;
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            if (sscanf(line, "voluntary_ctxt_switches: %lu", &count) == 1)
+            {
+                usage.voluntary += count;
+            }
+            else if (sscanf(line, "nonvoluntary_ctxt_switches: %lu", &count) == 1)
+            {
+                usage.involuntary += count;
+            }
+        }
+        fclose(file);
+    }
+    closedir(dir);
+    usage.running = true;
+    return true;
+}
+
+
+class PipelineBenchmark
+{
+private:
+    ros::NodeHandle nh_;
+    ros::Publisher pub_range_[RANGE_SENSORS];
+    ros::Publisher pub_car_speed_;
+    ros::Publisher pub_car_speed_stamped_;
+    ros::Publisher pub_parking_enable_;
+    ros::Subscriber sub_cmd_move_;
+    ros::Subscriber sub_statistics_;
+    ros::Subscriber sub_transition_time_;
+
+    sensor_msgs::Range msg_range_[RANGE_SENSORS];
+    std_msgs::Float32 msg_car_speed_;
+    autopark::CarSpeed msg_car_speed_stamped_;
+    float range_blocked_;           // [m] within brake distance at the car speed
+
+    // shared with the callbacks of the spinner thread
+    boost::mutex mutex_;
+    bool moving_;                   // last cmd_move is not a stop
+    bool waiting_;                  // upa is blocked, stop is not received yet
+    double block_time_;             // time of publishing the blocked range
+    vector<PipelinePhase> phases_;
+    BenchmarkStats transitions_;    // [s] until all nodes applied a stage of the pipeline
+
+public:
+    PipelineBenchmark(ros::NodeHandle* nodehandle);
+    void callback_cmd_move(const std_msgs::Float32::ConstPtr& msg);
+    void callback_statistics(const rosgraph_msgs::TopicStatistics::ConstPtr& msg);
+    void callback_transition_time(const std_msgs::Float32::ConstPtr& msg);
+    void enable(bool enabled);
+    void publish_sensors();
+    void run(double rate, double duration, const vector<string>& nodes);
+    void print();
+    void print_transitions();
+    bool save(const char* filename, const string& label, const vector<string>& nodes);
+    ~PipelineBenchmark();
+};
+
+// CONSTRUCTOR: called when this object is created to set up subscribers and publishers
+PipelineBenchmark::PipelineBenchmark(ros::NodeHandle* nodehandle):nh_(*nodehandle), \
+transitions_("stage transitions")
+{
+    // queues are long enough that no message is dropped before the nodes
+    for (int i = 0; i < RANGE_SENSORS; i++)
+    {
+        pub_range_[i] = nh_.advertise<sensor_msgs::Range>(range_topic[i], 10);
+        msg_range_[i].header.frame_id = range_topic[i];
+        msg_range_[i].radiation_type = sensor_msgs::Range::ULTRASOUND;
+        msg_range_[i].range = range_clear;
+    }
+    pub_car_speed_ = nh_.advertise<std_msgs::Float32>("car_speed", 10);
+    pub_car_speed_stamped_ = nh_.advertise<autopark::CarSpeed>("car_speed_stamped", 10);
+    pub_parking_enable_ = nh_.advertise<std_msgs::Bool>("parking_enable", 1, true);
+
+    sub_cmd_move_ = nh_.subscribe<std_msgs::Float32>("cmd_move", 10, \
+    &PipelineBenchmark::callback_cmd_move, this);
+    sub_statistics_ = nh_.subscribe<rosgraph_msgs::TopicStatistics>("/statistics", 100, \
+    &PipelineBenchmark::callback_statistics, this);
+    sub_transition_time_ = nh_.subscribe<std_msgs::Float32>("pipeline_transition_time", 10, \
+    &PipelineBenchmark::callback_transition_time, this);
+
+    // car moves with the speed of searching, surround_monitor stops it at half of the brake distance
+    msg_car_speed_.data = params().speed_search_parking;
+    range_blocked_ = brake_distance_at(msg_car_speed_.data) / 2;
+
+    moving_ = false;
+    waiting_ = false;
+    block_time_ = 0;
+}
+
+// DESTRUCTOR: called when this object is deleted to release memory
+PipelineBenchmark::~PipelineBenchmark(void)
+{
+}
+
+// callback of sub_cmd_move_: the first stop after the upa is blocked ends the measurement
+void PipelineBenchmark::callback_cmd_move(const std_msgs::Float32::ConstPtr& msg)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    if (msg->data != 0)
+    {
+        moving_ = true;
+        return;
+    }
+    moving_ = false;
+    if (waiting_ && !phases_.empty())
+    {
+        phases_.back().latency.add(benchmark_now() - block_time_);
+        waiting_ = false;
+    }
+}
+
+// callback of sub_statistics_: a window belongs to the last phase which began before it
+void PipelineBenchmark::callback_statistics(const rosgraph_msgs::TopicStatistics::ConstPtr& msg)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    for (size_t i = phases_.size(); i-- > 0;)
+    {
+        if (msg->window_start >= phases_[i].begin)
+        {
+            TopicDrops& drops = phases_[i].topics[make_pair(msg->topic, msg->node_sub)];
+            drops.delivered += msg->delivered_msgs;
+            drops.dropped += msg->dropped_msgs;
+            drops.age_sum += msg->stamp_age_mean.toSec() * msg->delivered_msgs;
+            drops.age_max = max(drops.age_max, msg->stamp_age_max.toSec());
+            break;
+        }
+    }
+}
+
+// callback of sub_transition_time_: lifecycle_manager measured a transition
+void PipelineBenchmark::callback_transition_time(const std_msgs::Float32::ConstPtr& msg)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    transitions_.add(msg->data);
+}
+
+// start or stop searching: lifecycle_manager starts or stops the stage search, search_parking_space commands the speed
+void PipelineBenchmark::enable(bool enabled)
+{
+    std_msgs::Bool msg;
+    msg.data = enabled;
+    pub_parking_enable_.publish(msg);
+}
+
+// publish one message of each sensor with the same stamp
+void PipelineBenchmark::publish_sensors()
+{
+    ros::Time stamp = ros::Time::now();
+    for (int i = 0; i < RANGE_SENSORS; i++)
+    {
+        msg_range_[i].header.stamp = stamp;
+        pub_range_[i].publish(msg_range_[i]);
+    }
+    pub_car_speed_.publish(msg_car_speed_);
+    msg_car_speed_stamped_.header.stamp = stamp;
+    msg_car_speed_stamped_.speed = msg_car_speed_.data;
+    pub_car_speed_stamped_.publish(msg_car_speed_stamped_);
+}
+
+// publish sensors at rate [Hz] for duration [s]: in each cycle the upa at front is blocked,
+// then clear until the lease of the stop has expired and the car moves again
+void PipelineBenchmark::run(double rate, double duration, const vector<string>& nodes)
+{
+    vector<ProcessUsage> usage_begin(nodes.size());
+    vector<int> pids(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        pids[i] = find_node(nodes[i]);
+        read_usage(pids[i], usage_begin[i]);
+    }
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        phases_.push_back(PipelinePhase(rate));
+        phases_.back().begin = ros::Time::now();
+        waiting_ = false;
+    }
+
+    double cycle_time = block_time + params().lease_aeb + 0.5;
+    double begin = benchmark_now();
+    double cycle_begin = begin - cycle_time;
+    unsigned long published = 0;
+    ros::WallRate loop_rate(rate);
+    while (ros::ok() && benchmark_now() - begin < duration)
+    {
+        double now = benchmark_now();
+        if (now - cycle_begin >= cycle_time)
+        {
+            // block the upa: the stop is measured only if the car moves again after the last one
+            cycle_begin = now;
+            msg_range_[UPA_FCL].range = range_blocked_;
+            boost::mutex::scoped_lock lock(mutex_);
+            if (waiting_ || !moving_)
+            {
+                phases_.back().missed++;
+            }
+            waiting_ = moving_;
+            block_time_ = now;
+        }
+        else if (now - cycle_begin >= block_time)
+        {
+            msg_range_[UPA_FCL].range = range_clear;
+        }
+
+        publish_sensors();
+        published += RANGE_SENSORS + 1;
+        loop_rate.sleep();
+    }
+    double end = benchmark_now();
+    msg_range_[UPA_FCL].range = range_clear;
+
+    boost::mutex::scoped_lock lock(mutex_);
+    PipelinePhase& phase = phases_.back();
+    if (waiting_)
+    {
+        phase.missed++;
+        waiting_ = false;
+    }
+    phase.duration = end - begin;
+    phase.published = published;
+    phase.usage.resize(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        ProcessUsage& usage = phase.usage[i];
+        if (read_usage(pids[i], usage) && usage_begin[i].running)
+        {
+            usage.cpu -= usage_begin[i].cpu;
+            usage.voluntary -= usage_begin[i].voluntary;
+            usage.involuntary -= usage_begin[i].involuntary;
+        }
+        else
+        {
+            usage.running = false;
+        }
+    }
+}
+
+// print summary of the last phase: cpu and context switches of all nodes, dropped messages of all subscriptions
+void PipelineBenchmark::print()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    const PipelinePhase& phase = phases_.back();
+    double cpu = 0;
+    unsigned long switches = 0;
+    for (size_t i = 0; i < phase.usage.size(); i++)
+    {
+        cpu += phase.usage[i].cpu;
+        switches += phase.usage[i].voluntary + phase.usage[i].involuntary;
+    }
+    unsigned long dropped = 0;
+    map<pair<string, string>, TopicDrops>::const_iterator it;
+    for (it = phase.topics.begin(); it != phase.topics.end(); ++it)
+    {
+        dropped += it->second.dropped;
+    }
+    printf("%6.1fHz published=%-8lu dropped=%-8lu cpu=%6.1f%% switches=%8.0f/s latency p50=%7.3fms " \
+    "p99=%7.3fms max=%7.3fms n=%u missed=%lu\n", phase.rate, phase.published, dropped, \
+    cpu / phase.duration * 100, switches / phase.duration, phase.latency.percentile(50) * 1e3, \
+    phase.latency.percentile(99) * 1e3, phase.latency.percentile(100) * 1e3, (unsigned)phase.latency.size(), \
+    phase.missed);
+}
+
+// print time of the transitions: starting and stopping the search
+void PipelineBenchmark::print_transitions()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    transitions_.print();
+}
+
+// write all phases to a json report
+bool PipelineBenchmark::save(const char* filename, const string& label, const vector<string>& nodes)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    boost::mutex::scoped_lock lock(mutex_);
+    fprintf(file, "{\n  \"benchmark\": \"pipeline\",\n  \"label\": %s,\n  \"stamp\": %.3f,\n", \
+    json_string(label).c_str(), ros::WallTime::now().toSec());
+    fprintf(file, "  \"transitions\": {\"samples\": %u, \"p50_ms\": %.3f, \"max_ms\": %.3f},\n", \
+    (unsigned)transitions_.size(), transitions_.percentile(50) * 1e3, transitions_.percentile(100) * 1e3);
+    fprintf(file, "  \"speed\": %.3f,\n  \"block_time\": %.3f,\n  \"phases\": [", msg_car_speed_.data, block_time);
+    for (size_t p = 0; p < phases_.size(); p++)
+    {
+        const PipelinePhase& phase = phases_[p];
+        fprintf(file, "%s\n    {\n      \"rate\": %.1f,\n      \"duration\": %.3f,\n      \"published\": %lu,\n", \
+        p ? "," : "", phase.rate, phase.duration, phase.published);
+        fprintf(file, "      \"latency\": {\"samples\": %u, \"missed\": %lu, \"mean_ms\": %.3f, \"p50_ms\": %.3f, " \
+        "\"p99_ms\": %.3f, \"max_ms\": %.3f},\n", (unsigned)phase.latency.size(), phase.missed, \
+        phase.latency.mean() * 1e3, phase.latency.percentile(50) * 1e3, phase.latency.percentile(99) * 1e3, \
+        phase.latency.percentile(100) * 1e3);
+
+        fprintf(file, "      \"nodes\": [");
+        for (size_t i = 0; i < phase.usage.size() && i < nodes.size(); i++)
+        {
+            const ProcessUsage& usage = phase.usage[i];
+            fprintf(file, "%s\n        {\"name\": %s, \"running\": %s, \"cpu_percent\": %.3f, " \
+            "\"voluntary_switches\": %lu, \"involuntary_switches\": %lu}", i ? "," : "", \
+            json_string(nodes[i]).c_str(), usage.running ? "true" : "false", \
+            usage.cpu / phase.duration * 100, usage.voluntary, usage.involuntary);
+        }
+        fprintf(file, "\n      ],\n      \"topics\": [");
+
+        map<pair<string, string>, TopicDrops>::const_iterator it;
+        for (it = phase.topics.begin(); it != phase.topics.end(); ++it)
+        {
+            const TopicDrops& drops = it->second;
+            unsigned long received = drops.delivered + drops.dropped;
+            fprintf(file, "%s\n        {\"topic\": %s, \"node\": %s, \"delivered\": %lu, \"dropped\": %lu, " \
+            "\"drop_percent\": %.3f, \"stamp_age_mean_ms\": %.3f, \"stamp_age_max_ms\": %.3f}", \
+            it == phase.topics.begin() ? "" : ",", json_string(it->first.first).c_str(), \
+            json_string(it->first.second).c_str(), drops.delivered, drops.dropped, \
+            received ? 100.0 * drops.dropped / received : 0.0, \
+            drops.delivered ? drops.age_sum / drops.delivered * 1e3 : 0.0, drops.age_max * 1e3);
+        }
+        fprintf(file, "\n      ]\n    }");
+    }
+    fprintf(file, "\n  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "benchmark_pipeline");
+    // load vehicle profile: speed of searching and lease of the stop
+    watch_parameters(parameter_file);
+
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+
+    vector<double> rates;
+    if (!nh_private.getParam("rates", rates))
+    {
+        rates.push_back(50);
+        rates.push_back(100);
+        rates.push_back(200);
+    }
+    vector<string> nodes;
+    if (!nh_private.getParam("nodes", nodes))
+    {
+        nodes.assign(node_default, node_default + sizeof(node_default) / sizeof(node_default[0]));
+    }
+    double duration = nh_private.param("duration", 20.0);
+    string report = nh_private.param<string>("report", "benchmark_pipeline.json");
+    string label = nh_private.param<string>("label", "");
+
+    PipelineBenchmark benchmark(&nh);
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+
+    benchmark.enable(true);
+    ros::WallDuration(settle_time).sleep();
+    for (size_t i = 0; i < rates.size() && ros::ok(); i++)
+    {
+        benchmark.run(rates[i], duration, nodes);
+        // the last statistics windows of the phase are closed by the next message after the pause
+        ros::WallDuration(statistics_wait).sleep();
+        benchmark.publish_sensors();
+        ros::WallDuration(settle_time).sleep();
+        benchmark.print();
+    }
+    benchmark.enable(false);
+    ros::WallDuration(settle_time).sleep();
+    benchmark.print_transitions();
+
+    if (!benchmark.save(report.c_str(), label, nodes))
+    {
+        ROS_ERROR("failed to write report %s", report.c_str());
+        return 1;
+    }
+    printf("report written to %s\n", report.c_str());
+    return 0;
+}
@@ -0,0 +1,142 @@
+/******************************************************************
+ * Filename: benchmark_startup.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-15
+ * Description: benchmark of the cold start of the autopark graph:
+ * time from launching the processes until each node applied its
+ * first stage and until lifecycle_manager reports the pipeline is
+ * ready to search, write a json report. It is started by
+ * benchmark_startup.launch, the graph is shut down when it is done
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <map>
+#include <string>
+
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+#include <ros/spinner.h>
+#include <std_msgs/Float32.h>
+#include "autopark/autoparking.h"
+#include "autopark/benchmark.h"
+#include "autopark/lifecycle.h"
+
+using namespace std;
+
+
+// first acknowledgement of a node
+struct NodeStartup
+{
+    double launch;              // [s] wall time when the process was launched
+    double ready;               // [s] wall time of the first acknowledgement
+};
+
+static boost::mutex mutex_startup;
+static map<string, NodeStartup> nodes;
+static double ready_time = -1;  // [s] from launch until ready to search, published by lifecycle_manager
+
+
+// callback of sub_ack: acknowledgements are latched, the first one of each node is kept
+static void callback_ack(const autopark::StageAck::ConstPtr& msg)
+{
+    boost::mutex::scoped_lock lock(mutex_startup);
+    if (nodes.count(msg->node) == 0)
+    {
+        NodeStartup startup = {msg->launch, msg->header.stamp.toSec()};
+        nodes[msg->node] = startup;
+    }
+}
+
+// callback of sub_ready
+static void callback_ready(const std_msgs::Float32::ConstPtr& msg)
+{
+    boost::mutex::scoped_lock lock(mutex_startup);
+    ready_time = msg->data;
+}
+
+// write startup of all nodes to a json report
+static bool save(const char* filename, const string& label, double launch_first)
+{
+    FILE* file = fopen(filename, "w");
+    if (file == NULL)
+    {
+        return false;
+    }
+    fprintf(file, "{\n  \"benchmark\": \"startup\",\n  \"label\": %s,\n  \"stamp\": %.3f,\n", \
+    json_string(label).c_str(), ros::WallTime::now().toSec());
+    fprintf(file, "  \"ready_ms\": %.3f,\n  \"nodes\": [", ready_time * 1e3);
+    map<string, NodeStartup>::const_iterator it;
+    for (it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        fprintf(file, "%s\n    {\"name\": %s, \"launch_ms\": %.3f, \"ready_ms\": %.3f}", \
+        it == nodes.begin() ? "" : ",", json_string(it->first).c_str(), \
+        (it->second.launch - launch_first) * 1e3, (it->second.ready - launch_first) * 1e3);
+    }
+    fprintf(file, "\n  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "benchmark_startup");
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+
+    double timeout = nh_private.param<double>("timeout", 10.0);
+    string report = nh_private.param<string>("report", "benchmark_startup.json");
+    string label = nh_private.param<string>("label", "");
+
+    ros::Subscriber sub_ack = nh.subscribe<autopark::StageAck>("pipeline_ack", 50, callback_ack);
+    ros::Subscriber sub_ready = nh.subscribe<std_msgs::Float32>("pipeline_ready", 1, callback_ready);
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+
+    // wait for lifecycle_manager, then for the latched acknowledgements of late connections
+    ros::WallTime start = ros::WallTime::now();
+    while (ros::ok() && (ros::WallTime::now() - start).toSec() < timeout)
+    {
+        {
+            boost::mutex::scoped_lock lock(mutex_startup);
+            if (ready_time >= 0)
+            {
+                break;
+            }
+        }
+        ros::WallDuration(0.01).sleep();
+    }
+    ros::WallDuration(0.5).sleep();
+
+    boost::mutex::scoped_lock lock(mutex_startup);
+    if (ready_time < 0)
+    {
+        printf("pipeline is not ready after %.1f s\n", timeout);
+    }
+
+    // launch of the first process is the start of the graph
+    double launch_first = 0;
+    map<string, NodeStartup>::const_iterator it;
+    for (it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        if (it->second.launch > 0 && (launch_first == 0 || it->second.launch < launch_first))
+        {
+            launch_first = it->second.launch;
+        }
+    }
+    for (it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        printf("%-32s launch=%8.1fms ready=%8.1fms\n", it->first.c_str(), \
+        (it->second.launch - launch_first) * 1e3, (it->second.ready - launch_first) * 1e3);
+    }
+    printf("ready to search %.1f ms after launch\n", ready_time * 1e3);
+
+    if (!save(report.c_str(), label, launch_first))
+    {
+        ROS_ERROR("failed to write report %s", report.c_str());
+        return 1;
+    }
+    printf("report written to %s\n", report.c_str());
+    return ready_time < 0;
+}
@@ -0,0 +1,325 @@
+/******************************************************************
+ * Filename: benchmark_time_alignment.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-19
+ * Description: accuracy of the distance driven between two range
+ * measurements on replayed measurement times: stamps at publishing
+ * and car speed at receipt, as the search nodes computed it, compared
+ * with car speed aligned to the times of acquisition. The car drives
+ * cycles of accelerating, searching, braking and standing, messages
+ * are delayed by scheduling jitter
+ * usage: benchmark_time_alignment [recording [channel]]
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "autopark/parameters.h"
+#include "autopark/benchmark.h"
+#include "autopark/ultrasonic.h"
+#include "autopark/firing_scheduler.h"
+#include "autopark/time_alignment.h"
+
+using namespace std;
+
+static const double duration_replay = 120;      // [s] of measurement times without recording
+static const double period_speed = 0.01;        // [s] of car speed samples
+static const double period_truth = 0.0005;      // [s] of integrating the true distance
+static const double latency_transport = 0.0005; // [s] minimum delay of a message
+static const double latency_jitter = 0.003;     // [s] mean exponential delay by scheduling
+static const double latency_stall = 0.04;       // [s] delay of a message preempted
+static const int stall_every = 25;              // a message of so many is preempted
+static const double spans[] = {0.5, 1.0, 2.0, 4.0};    // [s] between two measurements
+
+// drive cycle: accelerate, search, brake, stand
+static const double cycle_accelerate = 2, cycle_search = 10, cycle_brake = 2, cycle_stand = 4;
+
+
+// [m/s] true car speed at time [s]
+static double speed_true(double time)
+{
+    double speed = params().speed_search_parking;
+    double t = fmod(time, cycle_accelerate + cycle_search + cycle_brake + cycle_stand);
+    if (t < cycle_accelerate)
+    {
+        return speed * t / cycle_accelerate;
+    }
+    t -= cycle_accelerate;
+    if (t < cycle_search)
+    {
+        return speed;
+    }
+    t -= cycle_search;
+    if (t < cycle_brake)
+    {
+        return speed * (1 - t / cycle_brake);
+    }
+    return 0;
+}
+
+// [m] true driven distance at time [s], linear between the steps of integrating
+static double position_at(const vector<double>& position, double time)
+{
+    size_t step = (size_t)(time / period_truth);
+    if (step + 1 >= position.size())
+    {
+        return position.back();
+    }
+    double ratio = time / period_truth - step;
+    return position[step] + ratio * (position[step + 1] - position[step]);
+}
+
+// both times in the same phase of constant search speed
+static bool searching(double begin, double end)
+{
+    double cycle = cycle_accelerate + cycle_search + cycle_brake + cycle_stand;
+    double t = fmod(begin, cycle);
+    return floor(begin / cycle) == floor(end / cycle) && t >= cycle_accelerate && \
+    fmod(end, cycle) < cycle_accelerate + cycle_search;
+}
+
+// [s] delay of the next message
+static double latency(unsigned int& seed, int& count)
+{
+    double uniform = (rand_r(&seed) + 1.0) / (RAND_MAX + 2.0);
+    double delay = latency_transport - latency_jitter * log(uniform);
+    if (++count % stall_every == 0)
+    {
+        delay += latency_stall;
+    }
+    return delay;
+}
+
+// message in order of receipt
+struct Event
+{
+    double receipt;         // [s]
+    bool range;             // range measurement, else car speed
+    int index;              // of the measurement or speed sample
+
+    bool operator<(const Event& other) const { return receipt < other.receipt; }
+};
+
+// absolute errors [m] of all pairs of measurements of a span
+struct Errors
+{
+    vector<double> old_method;
+    vector<double> aligned;
+
+    void print(const char* label, double span) const;
+};
+
+static double percentile(vector<double> values, double ratio)
+{
+    if (values.empty())
+    {
+        return 0;
+    }
+    sort(values.begin(), values.end());
+    return values[min(values.size() - 1, (size_t)(ratio * values.size()))];
+}
+
+static double mean(const vector<double>& values)
+{
+    double sum = 0;
+    for (size_t i = 0; i < values.size(); i++)
+    {
+        sum += values[i];
+    }
+    return values.empty() ? 0 : sum / values.size();
+}
+
+void Errors::print(const char* label, double span) const
+{
+    printf("  %-7s %.1fs (%4zu pairs): old %7.1f / %7.1f / %7.1f   aligned %5.1f / %5.1f / %5.1f\n", \
+    label, span, aligned.size(), \
+    mean(old_method) * 1e3, percentile(old_method, 0.95) * 1e3, percentile(old_method, 1.0) * 1e3, \
+    mean(aligned) * 1e3, percentile(aligned, 0.95) * 1e3, percentile(aligned, 1.0) * 1e3);
+}
+
+
+int main(int argc, char **argv)
+{
+    // times of acquisition of the measurements: a recording, or the firing schedule of search
+    string name = (argc > 2) ? argv[2] : "apa_lf";
+    int channel = ultrasonic_channel(name);
+    if (channel < 0)
+    {
+        fprintf(stderr, "unknown channel %s\n", name.c_str());
+        return 1;
+    }
+    vector<double> acquired;
+    if (argc > 1)
+    {
+        vector<UltrasonicRecord> records;
+        if (!load_recording(argv[1], records))
+        {
+            fprintf(stderr, "cannot load recording %s\n", argv[1]);
+            return 1;
+        }
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            if (records[i].frame.channel == channel)
+            {
+                acquired.push_back(records[i].time - records[0].time);
+            }
+        }
+        printf("replay %s of %s: %zu measurements\n", name.c_str(), argv[1], acquired.size());
+    }
+    else
+    {
+        FiringScheduler scheduler;
+        scheduler.set_mode(FIRING_SEARCH);
+        vector<int> channels;
+        for (double time = 0; time < duration_replay; )
+        {
+            time += scheduler.next_slot(channels);
+            if (find(channels.begin(), channels.end(), channel) != channels.end())
+            {
+                acquired.push_back(time);
+            }
+        }
+        printf("replay %s of the firing schedule of search: %zu measurements\n", name.c_str(), acquired.size());
+    }
+    if (acquired.size() < 2)
+    {
+        return 1;
+    }
+
+    // true driven distance at each time step
+    double duration = acquired.back() + 1;
+    vector<double> position(1, 0);
+    for (double time = period_truth; time < duration; time += period_truth)
+    {
+        position.push_back(position.back() + \
+        0.5 * (speed_true(time - period_truth) + speed_true(time)) * period_truth);
+    }
+
+    // messages: the old sensor nodes stamped a measurement when they published it
+    unsigned int seed = 1;
+    int count = 0;
+    vector<Event> events;
+    vector<double> stamp_published(acquired.size());
+    for (size_t i = 0; i < acquired.size(); i++)
+    {
+        stamp_published[i] = acquired[i] + latency(seed, count);
+        Event event = {stamp_published[i] + latency(seed, count), true, (int)i};
+        events.push_back(event);
+    }
+    vector<double> speed_acquired;
+    for (double time = 0; time < duration; time += period_speed)
+    {
+        Event event = {time + latency(seed, count), false, (int)speed_acquired.size()};
+        speed_acquired.push_back(time);
+        events.push_back(event);
+    }
+    stable_sort(events.begin(), events.end());
+
+    // earlier measurement of each measurement for each span
+    const int span_count = sizeof(spans) / sizeof(spans[0]);
+    vector<vector<int> > earlier(span_count, vector<int>(acquired.size(), -1));
+    for (int s = 0; s < span_count; s++)
+    {
+        size_t j = 0;
+        for (size_t i = 0; i < acquired.size(); i++)
+        {
+            while (j + 1 < i && acquired[j + 1] <= acquired[i] - spans[s])
+            {
+                j++;
+            }
+            if (acquired[j] <= acquired[i] - spans[s])
+            {
+                earlier[s][i] = j;
+            }
+        }
+    }
+
+    // replay in order of receipt
+    float speed_received = 0;           // old: latest car speed
+    double stop_begin = 0, stop_total = 0;
+    bool stopped = false;
+    vector<float> speed_at(acquired.size());
+    vector<double> stop_at(acquired.size());
+    SignalHistory history;
+    vector<Errors> errors(span_count);
+    vector<Errors> errors_search(span_count);   // constant speed: the error of the stamps only
+    vector<double> lookup_time;
+    for (size_t e = 0; e < events.size(); e++)
+    {
+        const Event& event = events[e];
+        if (!event.range)
+        {
+            double time = speed_acquired[event.index];
+            float speed = speed_true(time);
+            history.add(time, speed);
+
+            // old: stops measured between the receipt of zero and non-zero speed
+            speed_received = speed;
+            if (speed == 0 && !stopped)
+            {
+                stop_begin = event.receipt;
+                stopped = true;
+            }
+            if (speed != 0 && stopped)
+            {
+                stop_total += event.receipt - stop_begin;
+                stopped = false;
+            }
+            continue;
+        }
+
+        int i = event.index;
+        speed_at[i] = speed_received;
+        stop_at[i] = stop_total;
+        for (int s = 0; s < span_count; s++)
+        {
+            int j = earlier[s][i];
+            if (j < 0)
+            {
+                continue;
+            }
+            double truth = position_at(position, acquired[i]) - position_at(position, acquired[j]);
+
+            // old: latest speed times the time between the stamps without stops
+            double distance_old = speed_at[i] * \
+            (stamp_published[i] - stamp_published[j] - (stop_at[i] - stop_at[j]));
+
+            // aligned: car speed integrated between the times of acquisition
+            double distance_aligned;
+            double time_start = benchmark_now();
+            bool valid = history.integral(acquired[j], acquired[i], distance_aligned);
+            lookup_time.push_back(benchmark_now() - time_start);
+            if (!valid)
+            {
+                distance_aligned = 0;
+            }
+
+            errors[s].old_method.push_back(fabs(distance_old - truth));
+            errors[s].aligned.push_back(fabs(distance_aligned - truth));
+            if (searching(acquired[j], acquired[i]))
+            {
+                errors_search[s].old_method.push_back(fabs(distance_old - truth));
+                errors_search[s].aligned.push_back(fabs(distance_aligned - truth));
+            }
+        }
+    }
+
+    printf("error of driven distance [mm]: mean / p95 / max\n");
+    for (int s = 0; s < span_count; s++)
+    {
+        errors[s].print("all", spans[s]);
+    }
+    for (int s = 0; s < span_count; s++)
+    {
+        errors_search[s].print("search", spans[s]);
+    }
+    printf("integral of car speed: %.0fns mean\n", mean(lookup_time) * 1e9);
+
+    return 0;
+}
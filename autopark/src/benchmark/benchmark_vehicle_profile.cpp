@@ -0,0 +1,129 @@
+/******************************************************************
+ * Filename: benchmark_vehicle_profile.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-02
+ * Description: benchmark of the parking kernels instantiated with
+ * the compile-time profile against the runtime parameter snapshot
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "autopark/benchmark.h"
+#include "autopark/parking_kernels.h"
+
+using namespace std;
+
+static const int samples = 4096;        // inputs of each kernel
+static const int repeats = 200;         // runs over all inputs
+
+
+// search: classify apa ranges and measured lengths
+template <class P>
+long run_search(const vector<float>& ranges, const vector<double>& lengths)
+{
+    long result = 0;
+    for (int i = 1; i < samples; i++)
+    {
+        result += range_trend<P>(ranges[i - 1], ranges[i]);
+        result += object_kind<P>(lengths[i]);
+        if (space_valid<P>(lengths[i], lengths[i - 1]))
+        {
+            result += 3 + space_kind<P>(lengths[i], lengths[i - 1]);
+        }
+    }
+    return result;
+}
+
+// monitor: check groups of 4 upa ranges
+template <class P>
+long run_monitor(const vector<float>& ranges)
+{
+    long result = 0;
+    for (int i = 0; i + 4 <= samples; i++)
+    {
+        result += ranges_clear<P>(&ranges[i], 4) ? 1 : 0;
+        result += ranges_blocked(&ranges[i], 4, brake_distance_at(ranges[i])) ? 2 : 0;
+    }
+    return result;
+}
+
+// maneuver: move along arcs and check collision against boxes
+template <class P>
+long run_maneuver(const vector<CarPose>& poses, const vector<Box>& boxes)
+{
+    long result = 0;
+    for (int i = 0; i < samples; i++)
+    {
+        CarPose pose = poses[i];
+        car_move_arc<P>(pose, (i % 7 - 3) * 0.2, 0.05);
+        for (size_t k = 0; k < boxes.size(); k++)
+        {
+            result += car_collision_box<P>(pose, boxes[k]) ? 1 : 0;
+        }
+    }
+    return result;
+}
+
+// run kernel repeats times, print duration per input for both profiles
+template <class Runtime, class Static>
+void compare(const char* name, Runtime runtime, Static fixed)
+{
+    BenchmarkStats stats_runtime(string(name) + " runtime");
+    BenchmarkStats stats_static(string(name) + " static");
+    long result_runtime = 0, result_static = 0;
+    for (int r = 0; r < repeats; r++)
+    {
+        double time_start = benchmark_now();
+        result_runtime = runtime();
+        stats_runtime.add((benchmark_now() - time_start) / samples);
+        time_start = benchmark_now();
+        result_static = fixed();
+        stats_static.add((benchmark_now() - time_start) / samples);
+    }
+    printf("%-10s runtime %7.2f[ns] static %7.2f[ns] speedup %.2f results %s\n", name, \
+    stats_runtime.percentile(50) * 1e9, stats_static.percentile(50) * 1e9, \
+    stats_runtime.percentile(50) / stats_static.percentile(50), \
+    result_runtime == result_static ? "equal" : "DIFFERENT");
+}
+
+
+int main(int argc, char **argv)
+{
+    if (!profile_matches<DefaultProfile>(params()))
+    {
+        printf("DefaultProfile differs from the default parameters\n");
+        return 1;
+    }
+
+    // random inputs around the thresholds
+    srand(1);
+    vector<float> ranges(samples);
+    vector<double> lengths(samples);
+    vector<CarPose> poses(samples);
+    for (int i = 0; i < samples; i++)
+    {
+        ranges[i] = 3.0 * rand() / RAND_MAX;
+        lengths[i] = 8.0 * rand() / RAND_MAX;
+        poses[i].x = 10.0 * rand() / RAND_MAX - 5;
+        poses[i].y = 10.0 * rand() / RAND_MAX - 5;
+        poses[i].yaw = 2 * M_PI * rand() / RAND_MAX - M_PI;
+    }
+    vector<Box> boxes;
+    Box box_front = {3, 8, -4, -1}, box_back = {-8, -3, -4, -1}, box_curb = {-8, 8, -6, -5};
+    boxes.push_back(box_front);
+    boxes.push_back(box_back);
+    boxes.push_back(box_curb);
+
+    printf("duration per input, median of %d runs over %d inputs\n", repeats, samples);
+    compare("search", [&]() { return run_search<RuntimeProfile>(ranges, lengths); }, \
+    [&]() { return run_search<DefaultProfile>(ranges, lengths); });
+    compare("monitor", [&]() { return run_monitor<RuntimeProfile>(ranges); }, \
+    [&]() { return run_monitor<DefaultProfile>(ranges); });
+    compare("maneuver", [&]() { return run_maneuver<RuntimeProfile>(poses, boxes); }, \
+    [&]() { return run_maneuver<DefaultProfile>(poses, boxes); });
+    return 0;
+}
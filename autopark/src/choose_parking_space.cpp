@@ -9,60 +9,45 @@
  ******************************************************************/
 
 #include "autopark/autoparking.h"
+#include "autopark/executor.h"
+#include "autopark/lifecycle.h"
 #include "autopark/choose_parking_space.h"
 
 using namespace std;
 
-static bool parking_enable = false;     // flag of parking enable
-static bool search_done = false;        // flag of searching parking space done
-static bool trigger_spinner = false;    // flag of spinners enable
-
-boost::shared_ptr<ros::AsyncSpinner> sp_spinner;   // create a shared_ptr for AsyncSpinner object
-
-// define struct of Times for stop situation during check and choose parking space
-struct Times
-{
-    ros::Time begin;
-    ros::Time end;
-    double duration;
-    bool trigger;
-} time_left, time_right;    // define two objects for left and right side
-
-
-// callback from global callback queue
-// callback of sub_parking_enable
-void callback_parking_enable(const std_msgs::Bool::ConstPtr& msg)
-{
-    ROS_INFO("call callback of parking_enable: %d", msg->data);
-    parking_enable = msg->data;
-}
-
 
 // CONSTRUCTOR: called when this object is created to set up subscribers and publishers
 ChooseParkingSpace::ChooseParkingSpace(ros::NodeHandle* nodehandle):nh_(*nodehandle)
 {
     ROS_INFO("call constructor in choose_parking_space");
 
-    sub_car_speed_ = nh_.subscribe<std_msgs::Float32>("car_speed", 1, \
+    // history of car speed: no message is dropped
+    sub_car_speed_ = nh_.subscribe<autopark::CarSpeed>("car_speed_stamped", 10, \
     &ChooseParkingSpace::callback_car_speed, this);
 
-    sub_parking_space_lf_ = nh_.subscribe<std_msgs::Header>("parking_space_lf", 1, \
+    sub_parking_space_lf_ = nh_.subscribe<autopark::ParkingSpace>("parking_space_lf", 1, \
     &ChooseParkingSpace::callback_parking_space_lf, this);
 
-    sub_parking_space_lb_ = nh_.subscribe<std_msgs::Header>("parking_space_lb", 1, \
+    sub_parking_space_lb_ = nh_.subscribe<autopark::ParkingSpace>("parking_space_lb", 1, \
     &ChooseParkingSpace::callback_parking_space_lb, this);
 
-    sub_parking_space_rf_ = nh_.subscribe<std_msgs::Header>("parking_space_rf", 1, \
+    sub_parking_space_rf_ = nh_.subscribe<autopark::ParkingSpace>("parking_space_rf", 1, \
     &ChooseParkingSpace::callback_parking_space_rf, this);
 
-    sub_parking_space_rb_ = nh_.subscribe<std_msgs::Header>("parking_space_rb", 1, \
+    sub_parking_space_rb_ = nh_.subscribe<autopark::ParkingSpace>("parking_space_rb", 1, \
     &ChooseParkingSpace::callback_parking_space_rb, this);
 
-    pub_parking_space_ = nh_.advertise<std_msgs::Header>("parking_space", 1);
+    pub_parking_space_ = nh_.advertise<autopark::ParkingSpace>("parking_space", 1);
     pub_search_done_ = nh_.advertise<std_msgs::Bool>("search_done", 1);
 
     // initialize:
     msg_search_done_.data = true;           // to stop searching parking space
+
+    // chosen parking space is shared with the other processes
+    if (!session_.open(session_store_file))
+    {
+        ROS_WARN("session store %s cannot be opened", session_store_file);
+    }
 }
 
 // DESTRUCTOR: called when this object is deleted to release memory 
@@ -72,74 +57,47 @@ ChooseParkingSpace::~ChooseParkingSpace(void)
 }
 
 // callbacks from custom callback queue
-// callback of sub_car_speed_
-void ChooseParkingSpace::callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
+// callback of sub_car_speed_: speed at its time of acquisition
+void ChooseParkingSpace::callback_car_speed(const autopark::CarSpeed::ConstPtr& msg)
 {
-    ROS_INFO("call callback of car_speed: speed=%f", msg->data);
-    msg_car_speed_.data = msg->data;
-
-    if (!que_parking_space_lf_.empty())
-    {
-        if (msg_car_speed_.data == 0 && !time_left.trigger)
-        {
-            time_left.begin = ros::Time::now();
-            time_left.trigger = true;
-        }
-        if (msg_car_speed_.data != 0 && time_left.trigger)
-        {
-            time_left.end = ros::Time::now();
-            time_left.trigger = false;
-
-            time_left.duration += (time_left.end - time_left.begin).toSec();
-        }
-    }
-    if (!que_parking_space_rf_.empty())
-    {
-        if (msg_car_speed_.data == 0 && !time_right.trigger)
-        {
-            time_right.begin = ros::Time::now();
-            time_right.trigger = true;
-        }
-        if (msg_car_speed_.data != 0 && time_right.trigger)
-        {
-            time_right.end = ros::Time::now();
-            time_right.trigger = false;
-
-            time_right.duration += (time_right.end - time_right.begin).toSec();
-        }
-    }
+    ROS_INFO("call callback of car_speed: speed=%f", msg->speed);
+    alignment_.add_speed(msg->header.stamp, msg->speed);
 }
 
 // callback of sub_parking_space_lf_
-void ChooseParkingSpace::callback_parking_space_lf(const std_msgs::Header::ConstPtr& msg)
+void ChooseParkingSpace::callback_parking_space_lf(const autopark::ParkingSpace::ConstPtr& msg)
 {
-    ROS_INFO("call callback_parking_space_lf: %d", msg->seq);
+    ROS_INFO("call callback_parking_space_lf: %d", msg->type);
 
-    msg_parking_space_lf_.seq = msg->seq;
-    msg_parking_space_lf_.stamp = msg->stamp;
+    msg_parking_space_lf_ = *msg;
     que_parking_space_lf_.push(msg_parking_space_lf_);
 }
 
 // callback of sub_parking_space_lb_
-void ChooseParkingSpace::callback_parking_space_lb(const std_msgs::Header::ConstPtr& msg)
+void ChooseParkingSpace::callback_parking_space_lb(const autopark::ParkingSpace::ConstPtr& msg)
 {
-    ROS_INFO("call callback_parking_space_lb: %d", msg->seq);
+    ROS_INFO("call callback_parking_space_lb: %d", msg->type);
 
-    msg_parking_space_lb_.seq = msg->seq;
-    msg_parking_space_lb_.stamp = msg->stamp;
+    msg_parking_space_lb_ = *msg;
     if (!que_parking_space_lf_.empty())
     {
-        // time duration messages from parking_space_lf and parking_space_lb
-        double time_diff = (msg_parking_space_lb_.stamp - que_parking_space_lf_.front().stamp).toSec();
-        // car moved distance
-        double distance_fb = msg_car_speed_.data * (time_diff - time_left.duration);
-        // reset time duration for stop
-        time_left.duration = 0;
+        // car moved distance between the measurements which found the parking space
+        double distance_fb;
+        if (!alignment_.distance(que_parking_space_lf_.front().header.stamp, msg_parking_space_lb_.header.stamp, \
+        distance_fb))
+        {
+            ROS_WARN("no car speed between the parking spaces of apa_lf and apa_lb");
+            distance_fb = 0;
+        }
 
         // check parking space
-        if (fabs(distance_fb - distance_apa) < apa_width)
+        if (fabs(distance_fb - params().distance_apa) < params().apa_width)
         {
-            msg_parking_space_.seq = que_parking_space_lf_.front().seq & msg_parking_space_lb_.seq;
+            // geometry is measured by the apa at front, type is confirmed by both apas
+            msg_parking_space_ = que_parking_space_lf_.front();
+            msg_parking_space_.type = que_parking_space_lf_.front().type & msg_parking_space_lb_.type;
+            // the front end of the parking space is at the apas at back
+            msg_parking_space_.header.stamp = msg_parking_space_lb_.header.stamp;
 
             // choose parking space
             choose_parking_space();
@@ -150,35 +108,39 @@ void ChooseParkingSpace::callback_parking_space_lb(const std_msgs::Header::Const
 }
 
 // callback of sub_parking_space_rf_
-void ChooseParkingSpace::callback_parking_space_rf(const std_msgs::Header::ConstPtr& msg)
+void ChooseParkingSpace::callback_parking_space_rf(const autopark::ParkingSpace::ConstPtr& msg)
 {
-    ROS_INFO("call callback_parking_space_rf: %d", msg->seq);
+    ROS_INFO("call callback_parking_space_rf: %d", msg->type);
 
-    msg_parking_space_rf_.seq = msg->seq;
-    msg_parking_space_rf_.stamp = msg->stamp;
+    msg_parking_space_rf_ = *msg;
     que_parking_space_rf_.push(msg_parking_space_rf_);
 }
 
 // callback of sub_parking_space_rb_
-void ChooseParkingSpace::callback_parking_space_rb(const std_msgs::Header::ConstPtr& msg)
+void ChooseParkingSpace::callback_parking_space_rb(const autopark::ParkingSpace::ConstPtr& msg)
 {
-    ROS_INFO("call callback_parking_space_rb: %d", msg->seq);
+    ROS_INFO("call callback_parking_space_rb: %d", msg->type);
 
-    msg_parking_space_rb_.seq = msg->seq;
-    msg_parking_space_rb_.stamp = msg->stamp;
+    msg_parking_space_rb_ = *msg;
     if (!que_parking_space_rf_.empty())
     {
-        // time duration messages from parking_space_lf and parking_space_lb
-        double time_diff = (msg_parking_space_rb_.stamp - que_parking_space_rf_.front().stamp).toSec();
-        // car moved distance
-        double distance_fb = msg_car_speed_.data * (time_diff - time_right.duration);
-        // reset time duration for stop
-        time_right.duration = 0;
+        // car moved distance between the measurements which found the parking space
+        double distance_fb;
+        if (!alignment_.distance(que_parking_space_rf_.front().header.stamp, msg_parking_space_rb_.header.stamp, \
+        distance_fb))
+        {
+            ROS_WARN("no car speed between the parking spaces of apa_rf and apa_rb");
+            distance_fb = 0;
+        }
 
         // check parking space
-        if (fabs(distance_fb - distance_apa) < apa_width)
+        if (fabs(distance_fb - params().distance_apa) < params().apa_width)
         {
-            msg_parking_space_.seq = que_parking_space_rf_.front().seq & msg_parking_space_rb_.seq;
+            // geometry is measured by the apa at front, type is confirmed by both apas
+            msg_parking_space_ = que_parking_space_rf_.front();
+            msg_parking_space_.type = que_parking_space_rf_.front().type & msg_parking_space_rb_.type;
+            // the front end of the parking space is at the apas at back
+            msg_parking_space_.header.stamp = msg_parking_space_rb_.header.stamp;
 
             // choose parking
             choose_parking_space();
@@ -194,56 +156,44 @@ void ChooseParkingSpace::choose_parking_space()
     ROS_INFO("call choose parking space function");
 
     // parallel parking space on the right side
-    if (msg_parking_space_.seq & SPACE_RIGHT_PARALLEL == SPACE_RIGHT_PARALLEL)
+    if ((msg_parking_space_.type & SPACE_RIGHT_PARALLEL) == SPACE_RIGHT_PARALLEL)
     {
-        msg_parking_space_.seq = SPACE_RIGHT_PARALLEL;
-        msg_parking_space_.stamp = ros::Time::now();
+        msg_parking_space_.type = SPACE_RIGHT_PARALLEL;
         pub_parking_space_.publish(msg_parking_space_);
         pub_search_done_.publish(msg_search_done_);
 
-        // save parking space info via global variable parking_space
-        parking_space = SPACE_RIGHT_PARALLEL;
-
-        search_done = true;     // to stop choosing parking space
+        // save parking space to session store
+        save_session();
     }
     // perpendicular parking space on the right side 
-    else if (msg_parking_space_.seq & SPACE_RIGHT_PERPENDICULAR == SPACE_RIGHT_PERPENDICULAR)
+    else if ((msg_parking_space_.type & SPACE_RIGHT_PERPENDICULAR) == SPACE_RIGHT_PERPENDICULAR)
     {
-        msg_parking_space_.seq = SPACE_RIGHT_PERPENDICULAR;
-        msg_parking_space_.stamp = ros::Time::now();
+        msg_parking_space_.type = SPACE_RIGHT_PERPENDICULAR;
         pub_parking_space_.publish(msg_parking_space_);
         pub_search_done_.publish(msg_search_done_);
 
-        // save parking space info via global variable parking_space
-        parking_space = SPACE_RIGHT_PERPENDICULAR;
-
-        search_done = true;
+        // save parking space to session store
+        save_session();
     }
     // parallel parking space on the left side
-    else if (msg_parking_space_.seq & SPACE_LEFT_PARALLEL == SPACE_LEFT_PARALLEL)
+    else if ((msg_parking_space_.type & SPACE_LEFT_PARALLEL) == SPACE_LEFT_PARALLEL)
     {
-        msg_parking_space_.seq = SPACE_LEFT_PARALLEL;
-        msg_parking_space_.stamp = ros::Time::now();
+        msg_parking_space_.type = SPACE_LEFT_PARALLEL;
         pub_parking_space_.publish(msg_parking_space_);
         pub_search_done_.publish(msg_search_done_);
 
-        // save parking space info via global variable parking_space
-        parking_space = SPACE_LEFT_PARALLEL;
-
-        search_done = true;
+        // save parking space to session store
+        save_session();
     }
     // perpendicular parking space on the left side
-    else if (msg_parking_space_.seq & SPACE_LEFT_PERPENDICULAR == SPACE_LEFT_PERPENDICULAR)
+    else if ((msg_parking_space_.type & SPACE_LEFT_PERPENDICULAR) == SPACE_LEFT_PERPENDICULAR)
     {
-        msg_parking_space_.seq = SPACE_LEFT_PERPENDICULAR;
-        msg_parking_space_.stamp = ros::Time::now();
+        msg_parking_space_.type = SPACE_LEFT_PERPENDICULAR;
         pub_parking_space_.publish(msg_parking_space_);
         pub_search_done_.publish(msg_search_done_);
 
-        // save parking space info via global variable parking_space
-        parking_space = SPACE_LEFT_PERPENDICULAR;
-
-        search_done = true;
+        // save parking space to session store
+        save_session();
     }
     else
     {
@@ -251,100 +201,66 @@ void ChooseParkingSpace::choose_parking_space()
     }
 }
 
+// save chosen parking space to session store
+void ChooseParkingSpace::save_session()
+{
+    ParkingSession session;
+    memset(&session, 0, sizeof(session));
+    session.state = SESSION_CHOSEN;
+    session.type = msg_parking_space_.type;
+    session.width = msg_parking_space_.width;
+    session.length = msg_parking_space_.length;
+    session.distance = msg_parking_space_.distance;
+    session.stamp = msg_parking_space_.header.stamp.toSec();
+    if (!session_.store(session))
+    {
+        ROS_WARN("failed to save parking session to %s", session_store_file);
+    }
+}
+
 
+// benchmark_decisions links this node without main
+#ifndef AUTOPARK_NO_MAIN
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "choose_parking_space");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
 
-    // create a node handle, use global callback queue
-    ros::NodeHandle nh;
     //create a node handle for class, use custom callback queue
     ros::NodeHandle nh_c;
-    // create custom callback queue
-    ros::CallbackQueue callback_queue;
-    // set custom callback queue
-    nh_c.setCallbackQueue(&callback_queue);
-
-    ros::Subscriber sub_parking_enable = nh.subscribe<std_msgs::Bool>("parking_enable", 1, \
-    callback_parking_enable);
+    // run callbacks of the class one at a time on a fixed number of threads
+    Executor executor(params().executor_threads);
+    Strand strand(executor);
+    // set strand as callback queue
+    nh_c.setCallbackQueue(&strand);
 
     // instantiating an object of class ChooseParkingSpace
     ChooseParkingSpace ChooseParkingSpace_obj(&nh_c);  // pass nh_c to class constructor
 
-    // create AsyncSpinner, run it on all available cores to process custom callback queue
-    sp_spinner.reset(new ros::AsyncSpinner(0, &callback_queue));
-
-    // initialize Times: 
-    time_left.duration = 0;
-    time_left.trigger = false;
-
-    time_right.duration = 0;
-    time_right.trigger = false;
-
-    // set loop rate
-    ros::Rate loop_rate(10);
-    while (ros::ok())
+    // choose in stage search: search_done of the chosen parking space ends the stage
+    LifecycleNode lifecycle(STAGE_BIT(STAGE_SEARCH), [&](bool active)
     {
-        ROS_INFO_STREAM_ONCE("node choose_parking_space is running");
-        if (parking_enable)
+        if (active)
         {
-            if (!trigger_spinner)
-            {
-                ROS_INFO("choose parking space enabled");
-
-                // clear old callbacks in custom callback queue
-                callback_queue.clear();
-                // start spinners for custom callback queue
-                sp_spinner->start();
-                ROS_INFO("spinners start");
-
-                trigger_spinner = true;
-            }
-            else
-            {
-                if (search_done)
-                {
-                    ROS_INFO("choose parking space finished");
-
-                    // stop spinners for custom callback queue
-                    sp_spinner->stop();
-                    ROS_INFO("spinners stop");
-
-                    // reset
-                    parking_enable = false;
-                    search_done = false;
-                    trigger_spinner = false;
-                }
-            }
+            ROS_INFO("choose parking space enabled");
+            // clear old callbacks of the class
+            strand.clear();
+            // start running callbacks of the class
+            strand.start();
         }
         else
         {
-            if (trigger_spinner)
-            {
-                ROS_INFO("choose parking space disabled");
-
-                // stop spinners for custom callback queue
-                sp_spinner->stop();
-                ROS_INFO("spinners stop");
-
-                // reset
-                parking_enable = false;
-                search_done = false;
-                trigger_spinner = false;
-            }
+            ROS_INFO("choose parking space disabled");
+            // stop running callbacks of the class
+            strand.stop();
         }
+    });
 
-        // process message in global callback queue: "parking_enable"
-        ros::spinOnce();
-
-        loop_rate.sleep();
-    }
-
-    // release AsyncSpinner object
-    sp_spinner.reset();
-
-    // wait for ROS threads to terminate
-    ros::waitForShutdown();
+    ROS_INFO("node choose_parking_space is running");
+    // process stage transitions in global callback queue when they arrive
+    ros::spin();
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,87 @@
+/******************************************************************
+ * Filename: command_arbiter.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-27
+ * Description: arbitration of commands by fixed priority levels, a
+ * command holds until its lease expires or a higher level commands
+ * 
+ ******************************************************************/
+
+#include "autopark/command_arbiter.h"
+
+using namespace std;
+
+
+// CONSTRUCTOR
+CommandArbiter::CommandArbiter()
+{
+    for (int i = 0; i < PRIORITY_LEVELS; i++)
+    {
+        duration_[i] = 0;
+    }
+    default_value_ = 0;
+    reset();
+}
+
+// DESTRUCTOR
+CommandArbiter::~CommandArbiter(void)
+{
+}
+
+void CommandArbiter::reset()
+{
+    for (int i = 0; i < PRIORITY_LEVELS; i++)
+    {
+        lease_[i].value = default_value_;
+        lease_[i].expire = 0;
+        lease_[i].valid = false;
+    }
+    output_ = default_value_;
+    active_ = -1;
+}
+
+// highest level with a valid lease at time now, -1 if none
+int CommandArbiter::highest(double now) const
+{
+    for (int i = PRIORITY_LEVELS - 1; i >= 0; i--)
+    {
+        if (lease_[i].valid && now < lease_[i].expire)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool CommandArbiter::command(int priority, float value, double now)
+{
+    if (priority < 0 || priority >= PRIORITY_LEVELS)
+    {
+        return false;
+    }
+    lease_[priority].value = value;
+    lease_[priority].expire = now + duration_[priority];
+    lease_[priority].valid = true;
+
+    // a higher level holds its lease: the command is kept until that lease expires
+    if (highest(now) > priority)
+    {
+        return false;
+    }
+    output_ = value;
+    active_ = priority;
+    return true;
+}
+
+bool CommandArbiter::update(double now)
+{
+    int level = highest(now);
+    if (level == active_)
+    {
+        return false;
+    }
+    output_ = (level < 0) ? default_value_ : lease_[level].value;
+    active_ = level;
+    return true;
+}
@@ -0,0 +1,207 @@
+/******************************************************************
+ * Filename: controller_arbiter.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-27
+ * Description: subscribe move and steering commands of all sources
+ * by priority level (AEB > maneuver > search), arbitrate them with
+ * lease timeouts and publish the result to cmd_move, cmd_turn and
+ * cmd_steer for controller_move and controller_turn. Latency is
+ * measured in the arbiter for each level, and for AEB stops from the
+ * range measurement to the output
+ * 
+ ******************************************************************/
+
+#include <boost/thread/mutex.hpp>
+#include <ros/ros.h>
+#include <ros/spinner.h>
+#include <ros/callback_queue.h>
+#include <std_msgs/Char.h>
+#include <std_msgs/Float32.h>
+#include "autopark/MoveCommand.h"
+#include "autopark/autoparking.h"
+#include "autopark/command_arbiter.h"
+#include "autopark/benchmark.h"
+
+using namespace std;
+
+
+// global variables for arbitration: used by the thread of AEB commands and the main thread
+static boost::mutex mutex_arbiter;
+static CommandArbiter arbiter_move;     // speed: stop if no source holds a lease
+static CommandArbiter arbiter_steer;    // steering: commands are passed, not repeated
+
+static ros::Publisher pub_move;
+static ros::Publisher pub_turn;
+static ros::Publisher pub_steer;
+
+// latency from receiving a command to publishing the output, of each level
+static const char* const level_name[PRIORITY_LEVELS] = {"search", "maneuver", "aeb"};
+static BenchmarkStats latency[PRIORITY_LEVELS] = \
+{BenchmarkStats(level_name[0]), BenchmarkStats(level_name[1]), BenchmarkStats(level_name[2])};
+// latency from the acquisition of the measurement a command reacts to, to publishing the output
+static BenchmarkStats latency_input("input");
+static double report_last = 0;
+
+
+// publish output of move arbiter
+void publish_move()
+{
+    std_msgs::Float32 msg;
+    msg.data = arbiter_move.output();
+    pub_move.publish(msg);
+}
+
+// apply move command of a source, input: time of the measurement it reacts to, or zero
+void command_move(int priority, float speed, const ros::Time& input = ros::Time())
+{
+    double start = benchmark_now();
+    boost::mutex::scoped_lock lock(mutex_arbiter);
+    if (arbiter_move.command(priority, speed, start))
+    {
+        publish_move();
+        if (!input.isZero())
+        {
+            latency_input.add((ros::Time::now() - input).toSec());
+        }
+    }
+    latency[priority].add(benchmark_now() - start);
+}
+
+// apply legacy turn command of a source
+void command_turn(int priority, char turn)
+{
+    double start = benchmark_now();
+    boost::mutex::scoped_lock lock(mutex_arbiter);
+    if (arbiter_steer.command(priority, 0, start))
+    {
+        std_msgs::Char msg;
+        msg.data = turn;
+        pub_turn.publish(msg);
+    }
+    latency[priority].add(benchmark_now() - start);
+}
+
+// apply continuous steering command of a source
+void command_steer(int priority, float steering)
+{
+    double start = benchmark_now();
+    boost::mutex::scoped_lock lock(mutex_arbiter);
+    if (arbiter_steer.command(priority, steering, start))
+    {
+        std_msgs::Float32 msg;
+        msg.data = steering;
+        pub_steer.publish(msg);
+    }
+    latency[priority].add(benchmark_now() - start);
+}
+
+
+// callbacks of commands of each level
+void callback_move_aeb(const autopark::MoveCommand::ConstPtr& msg)
+{
+    command_move(PRIORITY_AEB, msg->speed, msg->header.stamp);
+}
+
+void callback_move_maneuver(const std_msgs::Float32::ConstPtr& msg)
+{
+    command_move(PRIORITY_MANEUVER, msg->data);
+}
+
+void callback_move_search(const std_msgs::Float32::ConstPtr& msg)
+{
+    command_move(PRIORITY_SEARCH, msg->data);
+}
+
+void callback_turn_maneuver(const std_msgs::Char::ConstPtr& msg)
+{
+    command_turn(PRIORITY_MANEUVER, msg->data);
+}
+
+void callback_steer_maneuver(const std_msgs::Float32::ConstPtr& msg)
+{
+    command_steer(PRIORITY_MANEUVER, msg->data);
+}
+
+
+// callback of timer: expire leases and report latency
+void callback_timer(const ros::WallTimerEvent& event)
+{
+    boost::mutex::scoped_lock lock(mutex_arbiter);
+    double now = benchmark_now();
+
+    // lease of the active level is expired: command of a lower level or stop
+    if (arbiter_move.update(now))
+    {
+        ROS_INFO("move command of level %d, speed=%f", arbiter_move.active(), arbiter_move.output());
+        publish_move();
+    }
+    arbiter_steer.update(now);
+
+    if (now - report_last < params().arbiter_report_period)
+    {
+        return;
+    }
+    for (int i = 0; i < PRIORITY_LEVELS; i++)
+    {
+        if (latency[i].size() > 0)
+        {
+            ROS_INFO("latency of %s commands: n=%u p50=%.3fms p99=%.3fms max=%.3fms", level_name[i], \
+            (unsigned)latency[i].size(), latency[i].percentile(50) * 1e3, latency[i].percentile(99) * 1e3, \
+            latency[i].percentile(100) * 1e3);
+            latency[i] = BenchmarkStats(level_name[i]);
+        }
+    }
+    if (latency_input.size() > 0)
+    {
+        ROS_INFO("latency of aeb stops from range measurement to cmd_move: n=%u p50=%.3fms p99=%.3fms max=%.3fms", \
+        (unsigned)latency_input.size(), latency_input.percentile(50) * 1e3, latency_input.percentile(99) * 1e3, \
+        latency_input.percentile(100) * 1e3);
+        latency_input = BenchmarkStats("input");
+    }
+    report_last = now;
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "controller_arbiter");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
+    ros::NodeHandle nh;
+    // AEB commands have their own callback queue and thread, they never wait behind other callbacks
+    ros::NodeHandle nh_aeb;
+    ros::CallbackQueue callback_queue_aeb;
+    nh_aeb.setCallbackQueue(&callback_queue_aeb);
+
+    arbiter_move.set_lease(PRIORITY_AEB, params().lease_aeb);
+    arbiter_move.set_lease(PRIORITY_MANEUVER, params().lease_maneuver);
+    arbiter_move.set_lease(PRIORITY_SEARCH, params().lease_search);
+    arbiter_steer.set_lease(PRIORITY_AEB, params().lease_aeb);
+    arbiter_steer.set_lease(PRIORITY_MANEUVER, params().lease_maneuver);
+    arbiter_steer.set_lease(PRIORITY_SEARCH, params().lease_search);
+    report_last = benchmark_now();
+
+    // define publishers for topics "cmd_move", "cmd_turn", "cmd_steer"
+    pub_move = nh.advertise<std_msgs::Float32>("cmd_move", 1);
+    pub_turn = nh.advertise<std_msgs::Char>("cmd_turn", 1);
+    pub_steer = nh.advertise<std_msgs::Float32>("cmd_steer", 1);
+
+    // define subscribers for commands of each level
+    ros::Subscriber sub_move_aeb = nh_aeb.subscribe<autopark::MoveCommand>("cmd_move_aeb", 1, callback_move_aeb);
+    ros::Subscriber sub_move_maneuver = nh.subscribe<std_msgs::Float32>("cmd_move_maneuver", 1, callback_move_maneuver);
+    ros::Subscriber sub_move_search = nh.subscribe<std_msgs::Float32>("cmd_move_search", 1, callback_move_search);
+    ros::Subscriber sub_turn_maneuver = nh.subscribe<std_msgs::Char>("cmd_turn_maneuver", 1, callback_turn_maneuver);
+    ros::Subscriber sub_steer_maneuver = nh.subscribe<std_msgs::Float32>("cmd_steer_maneuver", 1, callback_steer_maneuver);
+
+    // expire leases with a fixed rate
+    ros::WallTimer timer = nh.createWallTimer(ros::WallDuration(1.0 / params().arbiter_rate), callback_timer);
+
+    ros::AsyncSpinner spinner_aeb(1, &callback_queue_aeb);
+    spinner_aeb.start();
+
+    // process callbacks in loop
+    ros::spin();
+
+    return 0;
+}
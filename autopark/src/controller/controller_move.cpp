@@ -3,13 +3,17 @@
  * Version: v1.0
  * Author: Meng Peng
  * Date: 2020-05-16
- * Description: subscribe message from topic cmd_move, then move
+ * Description: subscribe message from topic cmd_move, then move by
+ * sending speed command frames to the actuator bus
  * 
  ******************************************************************/
 
+#include <string>
 #include <ros/ros.h>
 #include <std_msgs/Bool.h>
 #include <std_msgs/Float32.h>
+#include "autopark/autoparking.h"
+#include "autopark/actuator.h"
 
 using namespace std;
 
@@ -19,6 +23,27 @@ static float move_speed;                // move speed
 static bool forward_state = true;       // forward state: default enabled
 static bool backward_state = true;      // backward state: default enabled
 
+// global actuator backend: frame of current command is sent cyclically
+static ActuatorWriter* actuator_writer;
+static float command_speed = 0;         // speed of current command
+static uint8_t command_mode = ACTUATOR_STOP;
+static uint8_t alive_counter = 0;
+
+
+// encode speed command, submit and flush it without blocking
+void send_speed(float speed, uint8_t mode)
+{
+    CanFrame frame;
+    if (!encode_speed(speed, mode, alive_counter++, frame))
+    {
+        ROS_WARN("speed %f out of range of command frame", speed);
+    }
+    command_speed = speed;
+    command_mode = mode;
+    actuator_writer->submit(frame);
+    actuator_writer->flush();
+}
+
 
 // control motor with messages from "cmd_move", "forward_enable", "backward_enable" 
 void do_move()
@@ -37,17 +62,17 @@ void do_move()
     if (forward_state && move_speed > 0)
     {
         ROS_INFO("move forward");
-        // do move forward
+        send_speed(move_speed, ACTUATOR_FORWARD);
     }
     else if (backward_state && move_speed < 0)
     {
         ROS_INFO("move backward");
-        // do move backward
+        send_speed(move_speed, ACTUATOR_BACKWARD);
     }
     else
     {
         ROS_INFO("stop");
-        // do stop
+        send_speed(0, ACTUATOR_STOP);
     }
 }
 
@@ -66,6 +91,8 @@ void callback_forward_enable(const std_msgs::Bool::ConstPtr& msg)
 {
     ROS_INFO("forward_enable: %d", msg->data);
     forward_state = msg->data;
+    // apply new gates at once, e.g. stop when the current direction is disabled
+    do_move();
 }
 
 // callback for "backward_enable"
@@ -73,21 +100,50 @@ void callback_backward_enable(const std_msgs::Bool::ConstPtr& msg)
 {
     ROS_INFO("backward_enable: %d", msg->data);
     backward_state = msg->data;
+    // apply new gates at once, e.g. stop when the current direction is disabled
+    do_move();
+}
+
+// callback of timer: resend current command, the actuator stops if frames are missing
+void callback_actuator(const ros::TimerEvent&)
+{
+    send_speed(command_speed, command_mode);
 }
 
 
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "controller_move");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
     ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+    // CAN interface of the actuators, "loopback" without a car, e.g. in benchmarks
+    string interface = nh_private.param<string>("interface", actuator_bus);
 
     // define subscriber for topics "cmd_move", "forward_enable", "backward_enable"
     ros::Subscriber sub1 = nh.subscribe<std_msgs::Float32>("cmd_move", 1, callback_cmd_move);
     ros::Subscriber sub2 = nh.subscribe<std_msgs::Bool>("forward_enable", 1, callback_forward_enable);
     ros::Subscriber sub3 = nh.subscribe<std_msgs::Bool>("backward_enable", 1, callback_backward_enable);
 
+    // open actuator bus and send stop until the first command
+    ActuatorBus* bus = create_actuator_bus(interface.c_str());
+    if (bus == NULL)
+    {
+        ROS_FATAL("cannot open CAN interface %s, the car cannot move", interface.c_str());
+        return 1;
+    }
+    actuator_writer = new ActuatorWriter(bus);
+    ros::Timer timer = nh.createTimer(ros::Duration(1.0 / params().actuator_rate), callback_actuator);
+
     // process callbacks in loop
     ros::spin();
 
+    send_speed(0, ACTUATOR_STOP);
+    ROS_INFO("actuator frames written: %lu, replaced: %lu, errors: %lu", (unsigned long)actuator_writer->written(), \
+    (unsigned long)actuator_writer->replaced(), (unsigned long)actuator_writer->errors());
+    delete actuator_writer;
+    delete bus;
+
     return 0;
 }
\ No newline at end of file
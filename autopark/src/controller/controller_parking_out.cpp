@@ -3,48 +3,68 @@
  * Version: v1.0
  * Author: Meng Peng
  * Date: 2020-06-01
- * Description: publish message of topic parking_out_enable to 
- * enable parking out function
+ * Description: publish message to the topic parking_out_enable to
+ * enable parking out as soon as all nodes are ready, close when
+ * lifecycle_manager started stage park out
  * 
  ******************************************************************/
 
 #include <ros/ros.h>
 #include <std_msgs/Bool.h>
+#include <std_msgs/Float32.h>
 #include "autopark/autoparking.h"
+#include "autopark/lifecycle.h"
 
-int main(int argc, char **argv)
-{
-    ros::init(argc, argv, "controller_parking_out");
-    ros::NodeHandle nh;
-    ros::Publisher pub_enable = nh.advertise<std_msgs::Bool>("parking_out_enable", 1);
+static ros::Publisher pub_enable;
+static bool enabled = false;            // parking_out_enable is published
+static int stage = -1;                  // latest stage of the pipeline
 
-    ros::Duration(1).sleep();   // wait for initialization of publisher
 
-    // define message
-    std_msgs::Bool msg_parking_out_enable;
-    // set message
-    msg_parking_out_enable.data = true;    // to enable parking out
+// callback of sub_ready: all nodes are ready, enable parking out at once
+static void callback_ready(const std_msgs::Float32::ConstPtr& msg)
+{
+    if (enabled)
+    {
+        return;
+    }
+    ROS_INFO("autopark ready %.1f ms after launch", msg->data * 1e3);
 
-    // set loop rate: 10 Hz
-    ros::Rate loop_rate(10);
+    // publish message to all subscribers of topic "parking_out_enable"
+    std_msgs::Bool msg_enable;
+    msg_enable.data = true;             // to enable parking out
+    pub_enable.publish(msg_enable);
+    enabled = true;
 
-    while (ros::ok())
+    if (stage == STAGE_PARK_OUT)
     {
-        if (pub_enable.getNumSubscribers() > 0)
-        {
-            // publish message to all subscribers of topic "parking_out"
-            pub_enable.publish(msg_parking_out_enable);
+        ROS_INFO("parking out enabled");
+        ros::shutdown();
+    }
+}
 
-            ROS_INFO("parking out enabled");
+// callback of sub_stage: close this node when lifecycle_manager started the stage
+static void callback_stage(const autopark::PipelineStage::ConstPtr& msg)
+{
+    stage = msg->stage;
+    if (enabled && stage == STAGE_PARK_OUT)
+    {
+        ROS_INFO("parking out enabled");
+        ros::shutdown();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "controller_parking_out");
+    ros::NodeHandle nh;
 
-            // close this node
-            ros::shutdown();
-        }
+    // latched: lifecycle_manager receives the message when it is connected, no waiting for publishers
+    pub_enable = nh.advertise<std_msgs::Bool>("parking_out_enable", 1, true);
 
-        ros::spinOnce();
+    ros::Subscriber sub_ready = nh.subscribe<std_msgs::Float32>("pipeline_ready", 1, callback_ready);
+    ros::Subscriber sub_stage = nh.subscribe<autopark::PipelineStage>("pipeline_stage", 1, callback_stage);
 
-        loop_rate.sleep();
-    }
+    ros::spin();
 
     return 0;
-}
\ No newline at end of file
+}
@@ -4,47 +4,44 @@
  * Author: Meng Peng
  * Date: 2020-04-15
  * Description: publish message to the topic parking_enable to 
- * stop autoparking
+ * stop autoparking, close when lifecycle_manager stopped it
  * 
  ******************************************************************/
 
 #include <ros/ros.h>
 #include <std_msgs/Bool.h>
 #include "autopark/autoparking.h"
+#include "autopark/lifecycle.h"
+
+
+// callback of sub_stage: close this node when no stage of parking in runs
+static void callback_stage(const autopark::PipelineStage::ConstPtr& msg)
+{
+    if (msg->stage == STAGE_IDLE || msg->stage == STAGE_PARK_OUT)
+    {
+        ROS_INFO("autoparking disabled");
+        ros::shutdown();
+    }
+}
 
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "controller_parking_stop");
     ros::NodeHandle nh;
-    ros::Publisher pub_enable = nh.advertise<std_msgs::Bool>("parking_enable", 1);
 
-    ros::Duration(1).sleep();   // wait initialization of publishers
+    // latched: lifecycle_manager receives the message when it is connected, no waiting for publishers
+    ros::Publisher pub_enable = nh.advertise<std_msgs::Bool>("parking_enable", 1, true);
 
     // define message
     std_msgs::Bool msg_parking_enable;
     // set message
     msg_parking_enable.data = false;    // to stop autoparking
+    // publish message to all subscribers of topic "parking_enable"
+    pub_enable.publish(msg_parking_enable);
 
-    // set loop rate: 10 Hz
-    ros::Rate loop_rate(10);
+    ros::Subscriber sub_stage = nh.subscribe<autopark::PipelineStage>("pipeline_stage", 1, callback_stage);
 
-    while (ros::ok())
-    {
-        if (pub_enable.getNumSubscribers() > 0)
-        {
-            // publish message to all subscribers of topic "parking_enable"
-            pub_enable.publish(msg_parking_enable);
-
-            ROS_INFO("autoparking disabled");
-
-            // close this node
-            ros::shutdown();
-        }
-
-        ros::spinOnce();
-
-        loop_rate.sleep();
-    }
+    ros::spin();
 
     return 0;
-}
\ No newline at end of file
+}
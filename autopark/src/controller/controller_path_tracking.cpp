@@ -0,0 +1,166 @@
+/******************************************************************
+ * Filename: controller_path_tracking.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-08
+ * Description: subscribe planned path from topic parking_path, then
+ * follow it with continuous steering angle (topic cmd_steer_maneuver) and
+ * report the tracking error
+ * 
+ ******************************************************************/
+
+#include <ros/ros.h>
+#include <std_msgs/Bool.h>
+#include <std_msgs/Float32.h>
+#include <nav_msgs/Path.h>
+#include "autopark/autoparking.h"
+#include "autopark/path_tracking.h"
+
+using namespace std;
+
+
+// global variables for path tracking
+static PathTracker tracker;             // pure pursuit controller
+static CarPose car_pose;                // car pose in frame of path (car frame at planning time)
+static float car_speed = 0;             // current car speed
+static float steering_angle = 0;        // current steering angle, follows the command with delay
+static bool tracking = false;           // flag of path tracking active
+static ros::Time time_last;             // time of last control step
+
+// statistics of tracking error
+static double error_max = 0;
+static double error_sum = 0;
+static uint32_t error_count = 0;
+
+static ros::Publisher pub_move;
+static ros::Publisher pub_steer;
+static ros::Publisher pub_error;
+static ros::Publisher pub_done;
+
+
+// publish move and steering commands
+void publish_commands(float speed, float steering)
+{
+    std_msgs::Float32 msg_move, msg_steer;
+    msg_move.data = speed;
+    msg_steer.data = steering;
+    pub_move.publish(msg_move);
+    pub_steer.publish(msg_steer);
+}
+
+// callback of "parking_path": path starts at current pose of the car
+void callback_parking_path(const nav_msgs::Path::ConstPtr& msg)
+{
+    ROS_INFO("call callback of parking_path: %d points", (int)msg->poses.size());
+
+    Path path;
+    path_from_msg(*msg, path);
+    tracker.set_path(path);
+
+    // path is planned in car frame
+    car_pose.x = 0;
+    car_pose.y = 0;
+    car_pose.yaw = 0;
+    time_last = ros::Time::now();
+
+    error_max = 0;
+    error_sum = 0;
+    error_count = 0;
+
+    tracking = !tracker.empty();
+    if (!tracking)
+    {
+        // empty path: cancel tracking and stop
+        ROS_INFO("path tracking canceled");
+        publish_commands(0, 0);
+    }
+}
+
+// callback of "car_speed"
+void callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
+{
+    car_speed = msg->data;
+}
+
+// callback of "steering_angle"
+void callback_steering_angle(const std_msgs::Float32::ConstPtr& msg)
+{
+    steering_angle = msg->data;
+}
+
+// control step with rate path_tracking_rate
+void callback_timer(const ros::TimerEvent& event)
+{
+    if (!tracking)
+    {
+        return;
+    }
+
+    // dead reckoning with measured speed and steering angle: the steering rack needs
+    // time to reach the command, so the last command is not the actual angle
+    double dt = (event.current_real - time_last).toSec();
+    time_last = event.current_real;
+    move_car_pose(car_pose, car_speed, steering_angle, dt);
+
+    double steering = tracker.update(car_pose);
+
+    if (tracker.finished())
+    {
+        // stop and turn straight
+        publish_commands(0, 0);
+
+        std_msgs::Bool msg_done;
+        msg_done.data = true;
+        pub_done.publish(msg_done);
+
+        ROS_INFO("path tracking finished: max error=%f[m], mean error=%f[m]", \
+        error_max, error_count > 0 ? error_sum / error_count : 0.0);
+
+        tracking = false;
+        return;
+    }
+
+    // move with speed according to direction of current segment, slow down before its end
+    // and while the steering angle lags behind the command
+    float speed = (tracker.direction() > 0) ? params().speed_parking_forward : params().speed_parking_backward;
+    speed = tracking_speed(speed, tracker.remaining(car_pose), steering - steering_angle);
+    publish_commands(speed, steering);
+
+    // report tracking error
+    double error = fabs(tracker.lateral_error());
+    error_max = max(error_max, error);
+    error_sum += error;
+    error_count++;
+
+    std_msgs::Float32 msg_error;
+    msg_error.data = tracker.lateral_error();
+    pub_error.publish(msg_error);
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "controller_path_tracking");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
+    ros::NodeHandle nh;
+
+    // define subscribers for topics "parking_path", "car_speed", "steering_angle"
+    ros::Subscriber sub_path = nh.subscribe<nav_msgs::Path>("parking_path", 1, callback_parking_path);
+    ros::Subscriber sub_speed = nh.subscribe<std_msgs::Float32>("car_speed", 1, callback_car_speed);
+    ros::Subscriber sub_steering = nh.subscribe<std_msgs::Float32>("steering_angle", 1, callback_steering_angle);
+
+    // define publishers for commands and tracking state
+    pub_move = nh.advertise<std_msgs::Float32>("cmd_move_maneuver", 1);
+    pub_steer = nh.advertise<std_msgs::Float32>("cmd_steer_maneuver", 1);
+    pub_error = nh.advertise<std_msgs::Float32>("tracking_error", 1);
+    pub_done = nh.advertise<std_msgs::Bool>("path_done", 1);
+
+    // control loop with a fixed rate
+    ros::Timer timer = nh.createTimer(ros::Duration(1.0 / params().path_tracking_rate), callback_timer);
+
+    // process callbacks in loop
+    ros::spin();
+
+    return 0;
+}
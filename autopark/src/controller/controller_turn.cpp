@@ -3,19 +3,66 @@
  * Version: v1.0
  * Author: Meng Peng
  * Date: 2020-04-16
- * Description: subscribe message from topic cmd_turn, then turn
+ * Description: subscribe messages from topics cmd_steer and cmd_turn,
+ * then turn by sending steering command frames to the actuator bus
+ * and publish the steering angle to topic steering_angle
  * 
  ******************************************************************/
 
+#include <string>
 #include <ros/ros.h>
 #include <std_msgs/Char.h>
+#include <std_msgs/Float32.h>
+#include "autopark/autoparking.h"
+#include "autopark/actuator.h"
+#include "autopark/actuator_model.h"
 
 using namespace std;
 
 // global variable to update message from topic cmd_turn
 static char turn_angle;
+// global variable of steering angle: [rad], positive to the left
+static float steering_angle = 0;
+// global publisher of the steering angle for odometry
+static ros::Publisher pub_steering;
+// global actuator backend: frame of current steering angle is sent cyclically
+static ActuatorWriter* actuator_writer;
+static uint8_t alive_counter = 0;
+// global model of steering rack, selected by ~simulate_steering without a car: the published
+// steering angle follows the command with dead time and rate limit, as measured on the real car
+static ActuatorModel* steering_model = NULL;
 
 
+// encode steering command, submit and flush it without blocking
+void send_steering()
+{
+    CanFrame frame;
+    encode_steering(steering_angle, alive_counter++, frame);
+    actuator_writer->submit(frame);
+    actuator_writer->flush();
+}
+
+
+// function to set the steering angle of front wheels
+void do_steer()
+{
+    // limit steering angle
+    steering_angle = max(-params().steering_angle_max, min(params().steering_angle_max, steering_angle));
+
+    ROS_INFO("steering angle: %f", steering_angle);
+    send_steering();
+
+    if (steering_model != NULL)
+    {
+        // simulated steering angle is published by callback_actuator
+        steering_model->command(steering_angle);
+        return;
+    }
+    std_msgs::Float32 msg;
+    msg.data = steering_angle;
+    pub_steering.publish(msg);
+}
+
 // function to check subscribed message from topic cmd_turn and do turn
 void do_turn()
 {
@@ -23,27 +70,31 @@ void do_turn()
     {
     case 'l':
         ROS_INFO("turn left once");     // turn wheel 1° to the left (steering rotate maybe 18°)
-        /* code for real controller */
+        steering_angle += params().steering_angle_step;
         break;
     case 'r':
         ROS_INFO("turn right once");    // turn wheel 1° to the right
-        /* code */
+        steering_angle -= params().steering_angle_step;
         break;
     case 'L':
         ROS_INFO("turn full left");     // turn wheel to the full left position
-        /* code */
+        steering_angle = params().steering_angle_max;
         break;
     case 'R':
         ROS_INFO("turn full right");    // turn wheel to the full right position
-        /* code */
+        steering_angle = -params().steering_angle_max;
         break;
     case 'D':
         ROS_INFO("turn direct");        // keep wheel direct (default-position)
-        /* code */
+        steering_angle = 0;
         break;
+    case TURN_HOLD:                     // keep wheel: the lease of the source is renewed by the arbiter
+        return;
     default:
-        break;
+        return;
     }
+
+    do_steer();
 }
 
 // callback of "cmd_turn"
@@ -55,15 +106,69 @@ void callback_cmd_turn(const std_msgs::Char::ConstPtr& msg)
     do_turn();
 }
 
+// callback of "cmd_steer"
+void callback_cmd_steer(const std_msgs::Float32::ConstPtr& msg)
+{
+    ROS_INFO("cmd_steer: %f", msg->data);
+    steering_angle = msg->data;
+
+    do_steer();
+}
+
+// callback of timer: resend current steering angle, the actuator holds it only while frames arrive
+void callback_actuator(const ros::TimerEvent&)
+{
+    send_steering();
+
+    if (steering_model != NULL && !steering_model->settled())
+    {
+        std_msgs::Float32 msg;
+        msg.data = steering_model->update(1.0 / params().actuator_rate);
+        pub_steering.publish(msg);
+    }
+}
+
 
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "controller_turn");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
     ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+    // CAN interface of the actuators, "loopback" without a car, e.g. in benchmarks
+    string interface = nh_private.param<string>("interface", actuator_bus);
+    bool simulate_steering = nh_private.param<bool>("simulate_steering", false);
+
+    // define subscribers for topics "cmd_turn" (legacy) and "cmd_steer" (continuous)
     ros::Subscriber sub = nh.subscribe<std_msgs::Char>("cmd_turn", 1, callback_cmd_turn);
+    ros::Subscriber sub_steer = nh.subscribe<std_msgs::Float32>("cmd_steer", 1, callback_cmd_steer);
+    // define publisher for topic "steering_angle"
+    pub_steering = nh.advertise<std_msgs::Float32>("steering_angle", 1, true);
+
+    // open actuator bus and send direct steering until the first command
+    ActuatorBus* bus = create_actuator_bus(interface.c_str());
+    if (bus == NULL)
+    {
+        ROS_FATAL("cannot open CAN interface %s, the car cannot steer", interface.c_str());
+        return 1;
+    }
+    if (simulate_steering)
+    {
+        ROS_INFO("steering angle is simulated, CAN interface %s", interface.c_str());
+        steering_model = new ActuatorModel(steering_dynamics());
+    }
+    actuator_writer = new ActuatorWriter(bus);
+    ros::Timer timer = nh.createTimer(ros::Duration(1.0 / params().actuator_rate), callback_actuator);
 
     // process callbacks in loop
     ros::spin();
 
+    ROS_INFO("actuator frames written: %lu, replaced: %lu, errors: %lu", (unsigned long)actuator_writer->written(), \
+    (unsigned long)actuator_writer->replaced(), (unsigned long)actuator_writer->errors());
+    delete steering_model;
+    delete actuator_writer;
+    delete bus;
+
     return 0;
-}
\ No newline at end of file
+}
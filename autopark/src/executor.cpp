@@ -0,0 +1,309 @@
+/******************************************************************
+ * Filename: executor.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-10
+ * Description: work-stealing thread pool and strands running the
+ * callbacks of a node one at a time
+ * 
+ ******************************************************************/
+
+#include "autopark/executor.h"
+
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <ros/assert.h>
+
+using namespace std;
+
+static const int strand_batch = 16;     // callbacks of a strand per run, then other strands may run
+
+// executor and queue of the current thread, if it belongs to a pool
+static thread_local const Executor* current_executor = NULL;
+static thread_local size_t current_index = 0;
+
+
+// CONSTRUCTOR: start threads, at least one
+Executor::Executor(unsigned threads)
+{
+    pending_ = 0;
+    next_ = 0;
+    stopping_ = false;
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+    for (unsigned i = 0; i < threads; i++)
+    {
+        workers_.push_back(new Worker);
+    }
+    for (unsigned i = 0; i < threads; i++)
+    {
+        threads_.create_thread(boost::bind(&Executor::work, this, i));
+    }
+}
+
+// DESTRUCTOR: stop and join threads
+Executor::~Executor(void)
+{
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        stopping_ = true;
+    }
+    wakeup_.notify_all();
+    threads_.join_all();
+
+    // the run of a strand may be among the dropped tasks: it would wait for it forever
+    // in stop(). Strands are destroyed before the executor, a strand left is stopped
+    boost::mutex::scoped_lock lock(mutex_);
+    ROS_ASSERT_MSG(strands_.empty(), "executor destroyed before %zu strands", strands_.size());
+    for (size_t i = 0; i < strands_.size(); i++)
+    {
+        strands_[i]->abandon();
+    }
+    strands_.clear();
+    lock.unlock();
+
+    for (size_t i = 0; i < workers_.size(); i++)
+    {
+        delete workers_[i];
+    }
+}
+
+void Executor::attach(Strand* strand)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    strands_.push_back(strand);
+}
+
+void Executor::detach(Strand* strand)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    strands_.erase(remove(strands_.begin(), strands_.end(), strand), strands_.end());
+}
+
+void Executor::post(const ExecutorTask& task)
+{
+    // a thread of the pool keeps its tasks, other threads spread them
+    size_t index;
+    if (current_executor == this)
+    {
+        index = current_index;
+    }
+    else
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        index = next_;
+        next_ = (next_ + 1) % workers_.size();
+    }
+    pending_.fetch_add(1, boost::memory_order_release);
+    {
+        boost::mutex::scoped_lock lock(workers_[index]->mutex);
+        workers_[index]->tasks.push_back(task);
+    }
+
+    // an idle thread checks pending_ with mutex_ locked: no wakeup is lost
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+    }
+    wakeup_.notify_one();
+}
+
+// take the oldest task of the own queue, or steal the newest task of another queue
+bool Executor::take(size_t index, ExecutorTask& task)
+{
+    for (size_t k = 0; k < workers_.size(); k++)
+    {
+        Worker& worker = *workers_[(index + k) % workers_.size()];
+        boost::mutex::scoped_lock lock(worker.mutex);
+        if (worker.tasks.empty())
+        {
+            continue;
+        }
+        if (k == 0)
+        {
+            task.swap(worker.tasks.front());
+            worker.tasks.pop_front();
+        }
+        else
+        {
+            task.swap(worker.tasks.back());
+            worker.tasks.pop_back();
+        }
+        pending_.fetch_sub(1, boost::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+// loop of thread index: run tasks, sleep while there is none
+void Executor::work(size_t index)
+{
+    current_executor = this;
+    current_index = index;
+
+    ExecutorTask task;
+    while (true)
+    {
+        if (take(index, task))
+        {
+            task();
+            task.clear();
+            continue;
+        }
+
+        boost::mutex::scoped_lock lock(mutex_);
+        while (!stopping_ && pending_.load(boost::memory_order_acquire) == 0)
+        {
+            wakeup_.wait(lock);
+        }
+        if (stopping_)
+        {
+            return;
+        }
+    }
+}
+
+
+// CONSTRUCTOR: callbacks are queued, they are run after start()
+Strand::Strand(Executor& executor):executor_(executor)
+{
+    enabled_ = false;
+    scheduled_ = false;
+    calling_ = false;
+    calling_owner_ = 0;
+    detached_ = false;
+    executor_.attach(this);
+}
+
+// DESTRUCTOR: wait for the running callback, drop the others
+Strand::~Strand(void)
+{
+    stop();
+    bool detached;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        detached = detached_;
+    }
+    if (!detached)
+    {
+        executor_.detach(this);
+    }
+}
+
+void Strand::abandon()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    enabled_ = false;
+    scheduled_ = false;
+    detached_ = true;
+    idle_.notify_all();
+}
+
+// a new callback may make the callbacks not ready before ready: they are tried again first
+void Strand::addCallback(const ros::CallbackInterfacePtr& callback, uint64_t owner_id)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    queue_.insert(queue_.end(), retry_.begin(), retry_.end());
+    retry_.clear();
+    Entry entry = {callback, owner_id};
+    queue_.push_back(entry);
+    schedule();
+}
+
+// remove callbacks of a subscription or timer which is shut down, and wait if one of them
+// is running on another thread
+void Strand::remove_owner(deque<Entry>& entries, uint64_t owner_id)
+{
+    for (deque<Entry>::iterator it = entries.begin(); it != entries.end();)
+    {
+        if (it->owner == owner_id)
+        {
+            it = entries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void Strand::removeByID(uint64_t owner_id)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    remove_owner(queue_, owner_id);
+    remove_owner(retry_, owner_id);
+    while (calling_ && calling_owner_ == owner_id && calling_thread_ != boost::this_thread::get_id())
+    {
+        idle_.wait(lock);
+    }
+}
+
+void Strand::start()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    enabled_ = !detached_;
+    schedule();
+}
+
+void Strand::stop()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    enabled_ = false;
+    while (scheduled_)
+    {
+        idle_.wait(lock);
+    }
+}
+
+void Strand::clear()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    queue_.clear();
+    retry_.clear();
+}
+
+// post a run to the executor if callbacks are waiting, called with mutex_ locked
+void Strand::schedule()
+{
+    if (enabled_ && !detached_ && !scheduled_ && !queue_.empty())
+    {
+        scheduled_ = true;
+        executor_.post(boost::bind(&Strand::run, this));
+    }
+}
+
+// run a batch of callbacks in order, then post the next run to let other strands run
+void Strand::run()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    for (int i = 0; i < strand_batch && enabled_ && !queue_.empty(); i++)
+    {
+        Entry entry = queue_.front();
+        queue_.pop_front();
+        calling_ = true;
+        calling_owner_ = entry.owner;
+        calling_thread_ = boost::this_thread::get_id();
+        lock.unlock();
+
+        ros::CallbackInterface::CallResult result = ros::CallbackInterface::TryAgain;
+        if (entry.callback->ready())
+        {
+            result = entry.callback->call();
+        }
+
+        lock.lock();
+        calling_ = false;
+        idle_.notify_all();
+        if (result == ros::CallbackInterface::TryAgain)
+        {
+            // not ready: posting the run again at once would spin a thread, it is tried
+            // again with the next callback added
+            retry_.push_back(entry);
+        }
+    }
+
+    scheduled_ = false;
+    schedule();
+    idle_.notify_all();
+}
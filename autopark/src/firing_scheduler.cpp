@@ -0,0 +1,211 @@
+/******************************************************************
+ * Filename: firing_scheduler.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-17
+ * Description: define scheduler of firing the ultrasonic sensors and
+ * the pseudo-device measuring the channels it fires
+ * 
+ ******************************************************************/
+
+#include "autopark/firing_scheduler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include <ros/ros.h>
+#include "autopark/parameters.h"
+
+using namespace std;
+
+const char* const firing_mode_names[FIRING_MODES] = {"idle", "search", "forward", "backward"};
+
+// weights of the channels in each mode, in order of ultrasonic_channels:
+// apa_lf, apa_lb, apa_lb2, apa_rf, apa_rb, apa_rb2, upa_fl, fcl, fcr, fr, upa_bl, bcl, bcr, br
+static const float firing_weights[FIRING_MODES][ULTRASONIC_CHANNELS] = {
+    {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1},
+    {4, 4, 1, 4, 4, 1, 1, 1, 1, 1, 0.5, 0.5, 0.5, 0.5},
+    {2, 1, 1, 2, 1, 1, 4, 4, 4, 4, 0.5, 0.5, 0.5, 0.5},
+    {1, 2, 2, 1, 2, 2, 0.5, 0.5, 0.5, 0.5, 4, 4, 4, 4}
+};
+
+// pairs of channels hearing the echo of each other: apas on the same side, apas and upas
+// at the same corner, and upas of the same bumper up to the next but one
+static const int crosstalk_pairs[][2] = {
+    {0, 1}, {0, 2}, {1, 2}, {3, 4}, {3, 5}, {4, 5},
+    {0, 6}, {3, 9}, {1, 10}, {2, 10}, {4, 13}, {5, 13},
+    {6, 7}, {6, 8}, {7, 8}, {7, 9}, {8, 9},
+    {10, 11}, {10, 12}, {11, 12}, {11, 13}, {12, 13}
+};
+
+
+bool crosstalk(int channel_a, int channel_b)
+{
+    for (size_t i = 0; i < sizeof(crosstalk_pairs) / sizeof(crosstalk_pairs[0]); i++)
+    {
+        if ((crosstalk_pairs[i][0] == channel_a && crosstalk_pairs[i][1] == channel_b) || \
+        (crosstalk_pairs[i][0] == channel_b && crosstalk_pairs[i][1] == channel_a))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+double echo_time(int channel)
+{
+    return 2 * ultrasonic_channels[channel].max_range / params().speed_of_sound + params().firing_guard_time;
+}
+
+// channels of the next slot by the passes of a mode, return duration [s] of the slot.
+// A firing costs the echo time of the channel: the weights share the time of the sensors
+static double schedule_slot(FiringMode mode, double pass[ULTRASONIC_CHANNELS], vector<int>& channels)
+{
+    // channels by pass: the first one leads the slot, channels without weight never fire
+    vector<pair<double, int> > order;
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        if (firing_weights[mode][i] > 0)
+        {
+            order.push_back(make_pair(pass[i], i));
+        }
+    }
+    sort(order.begin(), order.end());
+
+    channels.clear();
+    if (order.empty())
+    {
+        return 0;
+    }
+    double duration = echo_time(order[0].second);
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        int channel = order[i].second;
+        bool free = echo_time(channel) <= duration;
+        for (size_t j = 0; j < channels.size() && free; j++)
+        {
+            free = !crosstalk(channel, channels[j]);
+        }
+        if (free)
+        {
+            channels.push_back(channel);
+            pass[channel] += echo_time(channel) / firing_weights[mode][channel];
+        }
+    }
+    return duration;
+}
+
+
+// CONSTRUCTOR
+FiringScheduler::FiringScheduler()
+{
+    mode_ = FIRING_IDLE;
+    memset(pass_, 0, sizeof(pass_));
+}
+
+// a new mode starts with equal passes: the weights take effect at once
+void FiringScheduler::set_mode(FiringMode mode)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    if (mode != mode_)
+    {
+        mode_ = mode;
+        memset(pass_, 0, sizeof(pass_));
+    }
+}
+
+FiringMode FiringScheduler::mode()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return mode_;
+}
+
+double FiringScheduler::next_slot(vector<int>& channels)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return schedule_slot(mode_, pass_, channels);
+}
+
+void FiringScheduler::rates(double duration, float rates[ULTRASONIC_CHANNELS])
+{
+    FiringMode mode;
+    double pass[ULTRASONIC_CHANNELS];
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        mode = mode_;
+        memcpy(pass, pass_, sizeof(pass));
+    }
+
+    int fired[ULTRASONIC_CHANNELS] = {0};
+    vector<int> channels;
+    double time = 0;
+    while (time < duration)
+    {
+        double slot = schedule_slot(mode, pass, channels);
+        if (slot <= 0)
+        {
+            break;
+        }
+        for (size_t i = 0; i < channels.size(); i++)
+        {
+            fired[channels[i]]++;
+        }
+        time += slot;
+    }
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        rates[i] = (time > 0) ? fired[i] / time : 0;
+    }
+}
+
+
+// CONSTRUCTOR: start firing
+FiringDevice::FiringDevice(FiringScheduler& scheduler, const float ranges[ULTRASONIC_CHANNELS], float noise):\
+scheduler_(scheduler), ranges_(ranges, ranges + ULTRASONIC_CHANNELS), noise_(noise)
+{
+    start();
+}
+
+// DESTRUCTOR: stop firing before the ranges are destroyed
+FiringDevice::~FiringDevice(void)
+{
+    stop();
+}
+
+// the echoes of a slot are received until its end
+void FiringDevice::run()
+{
+    vector<int> channels;
+    vector<UltrasonicFrame> frames;
+    unsigned int seed = 1;
+    double time = ros::WallTime::now().toSec();
+    while (running_)
+    {
+        double duration = scheduler_.next_slot(channels);
+        if (duration <= 0)
+        {
+            break;
+        }
+        time += duration;
+        double wait = time - ros::WallTime::now().toSec();
+        if (wait > 0)
+        {
+            boost::this_thread::sleep_for(boost::chrono::microseconds((long)(wait * 1e6)));
+        }
+
+        frames.resize(channels.size());
+        for (size_t i = 0; i < channels.size(); i++)
+        {
+            memset(&frames[i], 0, sizeof(UltrasonicFrame));
+            frames[i].channel = channels[i];
+            float noise = noise_ * (2.0f * rand_r(&seed) / RAND_MAX - 1);
+            frames[i].range = (uint16_t)((ranges_[channels[i]] + noise) * 1000 + 0.5f);
+        }
+        if (!write_frames(frames))
+        {
+            break;
+        }
+    }
+}
@@ -0,0 +1,149 @@
+/******************************************************************
+ * Filename: generate_maneuver_table.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-15
+ * Description: offline program to plan maneuvers for a grid of
+ * parking space geometry and starting heading, then save them as
+ * binary table for parking_in
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "autopark/autoparking.h"
+#include "autopark/parking_planner.h"
+#include "autopark/maneuver_table.h"
+
+using namespace std;
+
+
+// set axis of table
+static TableAxis make_axis(float min, float max, float step)
+{
+    TableAxis axis;
+    axis.min = min;
+    axis.step = step;
+    axis.count = (uint32_t)((max - min) / step + 1.5);
+    return axis;
+}
+
+// set block of one SPACE_* type: sweep width, length, distance and heading
+static ManeuverBlock make_block(uint32_t type)
+{
+    ManeuverBlock block;
+    block.type = type;
+    if (type == SPACE_LEFT_PARALLEL || type == SPACE_RIGHT_PARALLEL)
+    {
+        block.axis[0] = make_axis(params().car_length + 2 * params().planner_margin, params().car_length + 4.4, 0.25);
+        block.axis[1] = make_axis(params().car_width + 2 * params().planner_margin, params().car_width + 1.9, 0.25);
+    }
+    else
+    {
+        block.axis[0] = make_axis(params().car_width + 2 * params().planner_margin, params().car_width + 2.2, 0.2);
+        block.axis[1] = make_axis(params().car_length / 2, params().car_length + 1.2, 0.25);
+    }
+    block.axis[2] = make_axis(0.3, params().distance_search, 0.25);
+    block.axis[3] = make_axis(-0.15, 0.15, 0.05);
+    block.cells = 0;
+    return block;
+}
+
+
+int main(int argc, char **argv)
+{
+    const char* filename = (argc > 1) ? argv[1] : maneuver_table_file;
+    // the table is only valid for the geometry of the vehicle profile used by the nodes
+    if (access(parameter_file, R_OK) == 0 && !load_parameters(parameter_file))
+    {
+        printf("invalid vehicle profile %s\n", parameter_file);
+        return 1;
+    }
+    uint32_t types[MANEUVER_TYPES] = {SPACE_RIGHT_PARALLEL, SPACE_RIGHT_PERPENDICULAR, \
+    SPACE_LEFT_PARALLEL, SPACE_LEFT_PERPENDICULAR};
+
+    ManeuverTableHeader header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, MANEUVER_TABLE_MAGIC, sizeof(header.magic));
+    header.version = MANEUVER_TABLE_VERSION;
+    header.segments_max = MANEUVER_SEGMENTS_MAX;
+    header.offset = -params().distance_apa_rear;     // parking space is chosen when passing the apas at back
+    header.car_length = params().car_length;
+    header.car_width = params().car_width;
+    header.wheel_base = params().wheel_base;
+    header.steering_angle_max = params().steering_angle_max;
+
+    ParkingPlanner planner;
+    vector<ManeuverCell> cells;
+    vector<PathSegment> segments;
+    for (int i = 0; i < MANEUVER_TYPES; i++)
+    {
+        ManeuverBlock& block = header.block[i];
+        block = make_block(types[i]);
+        block.cells = sizeof(header) + cells.size() * sizeof(ManeuverCell);
+
+        uint32_t found = 0, total = 0;
+        const TableAxis* axis = block.axis;
+        for (uint32_t w = 0; w < axis[0].count; w++)
+        for (uint32_t l = 0; l < axis[1].count; l++)
+        for (uint32_t d = 0; d < axis[2].count; d++)
+        for (uint32_t h = 0; h < axis[3].count; h++)
+        {
+            SpaceGeometry space;
+            space.width = axis[0].min + w * axis[0].step;
+            space.length = axis[1].min + l * axis[1].step;
+            space.distance = axis[2].min + d * axis[2].step;
+            space.offset = header.offset;
+            space.aisle = 0;                    // table is planned without obstacles on the other side
+            double heading = axis[3].min + h * axis[3].step;
+
+            ManeuverCell cell;
+            memset(&cell, 0, sizeof(cell));
+            if (planner.plan(types[i], space, heading, segments) && segments.size() <= MANEUVER_SEGMENTS_MAX)
+            {
+                cell.count = segments.size();
+                copy(segments.begin(), segments.end(), cell.segment);
+                found++;
+            }
+            cells.push_back(cell);
+            total++;
+        }
+        printf("type 0x%02x: %u of %u cells with maneuver\n", types[i], found, total);
+    }
+
+    // running nodes map the table: write a new file next to it and replace the table at once,
+    // truncating the mapped file would crash them
+    string temporary = string(filename) + ".XXXXXX";
+    int fd = mkstemp(&temporary[0]);
+    FILE* file = (fd < 0) ? NULL : fdopen(fd, "wb");
+    if (file == NULL)
+    {
+        printf("cannot create %s\n", temporary.c_str());
+        if (fd >= 0)
+        {
+            close(fd);
+            unlink(temporary.c_str());
+        }
+        return 1;
+    }
+    bool written = (fwrite(&header, sizeof(header), 1, file) == 1 && \
+    fwrite(&cells[0], sizeof(ManeuverCell), cells.size(), file) == cells.size() && \
+    fflush(file) == 0 && fsync(fileno(file)) == 0 && fchmod(fileno(file), 0644) == 0);
+    written = (fclose(file) == 0) && written;
+    if (!written || rename(temporary.c_str(), filename) != 0)
+    {
+        printf("cannot write %s\n", filename);
+        unlink(temporary.c_str());
+        return 1;
+    }
+
+    printf("maneuver table saved to %s: %u bytes\n", filename, \
+    (unsigned)(sizeof(header) + cells.size() * sizeof(ManeuverCell)));
+    return 0;
+}
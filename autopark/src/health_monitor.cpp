@@ -0,0 +1,134 @@
+/******************************************************************
+ * Filename: health_monitor.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-18
+ * Description: keep statistics of each ultrasonic sensor (rate,
+ * jitter, noise, stuck range while car moves, ranges outside
+ * min_range ... max_range)
+ * and publish the health of all sensors latched to topic
+ * sensor_health: periodically and at once when a sensor is degraded
+ * or recovers
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <string>
+
+#include <boost/bind.hpp>
+#include <ros/ros.h>
+#include <sensor_msgs/Range.h>
+#include <std_msgs/Float32.h>
+#include "autopark/autoparking.h"
+#include "autopark/parameters.h"
+#include "autopark/sensor_health.h"
+#include "autopark/ultrasonic.h"
+
+using namespace std;
+
+static ros::Publisher pub_health;
+static ChannelHealth health[ULTRASONIC_CHANNELS];
+static uint32_t degraded_published = 0;
+static float car_speed = 0;                 // [m/s] latest car speed, the car stands until it is known
+
+
+// status bits as text, for logging
+static string status_text(uint8_t status)
+{
+    static const char* const names[] = {"stale", "rate", "jitter", "noise", "stuck", "range"};
+    string text;
+    for (int i = 0; i < 6; i++)
+    {
+        if (status & (1 << i))
+        {
+            text += text.empty() ? names[i] : string(" ") + names[i];
+        }
+    }
+    return text;
+}
+
+static void publish_health(double time)
+{
+    autopark::SensorHealth msg_health;
+    msg_health.header.stamp = ros::Time::now();
+    msg_health.degraded = 0;
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        uint8_t status = health[i].status(time);
+        if (status & HEALTH_DEGRADED)
+        {
+            msg_health.degraded |= 1u << i;
+        }
+        msg_health.status.push_back(status);
+        msg_health.rate.push_back(health[i].rate());
+        msg_health.jitter.push_back(health[i].jitter());
+        msg_health.noise.push_back(health[i].noise());
+        msg_health.out_of_range.push_back(health[i].out_of_range());
+
+        bool degraded = (msg_health.degraded >> i) & 1;
+        if (degraded != (bool)((degraded_published >> i) & 1))
+        {
+            if (degraded)
+            {
+                ROS_WARN("%s degraded: %s", ultrasonic_channels[i].name, status_text(status).c_str());
+            }
+            else
+            {
+                ROS_INFO("%s recovered", ultrasonic_channels[i].name);
+            }
+        }
+    }
+    degraded_published = msg_health.degraded;
+    pub_health.publish(msg_health);
+}
+
+// callback of the range of each sensor: a change of degraded is published at once
+static void callback_range(const sensor_msgs::Range::ConstPtr& msg, int channel)
+{
+    double time = msg->header.stamp.toSec();
+    bool moving = fabs(car_speed) > params().health_moving_speed;
+    health[channel].update(time, msg->range, msg->min_range, msg->max_range, moving);
+
+    bool degraded = health[channel].status(time) & HEALTH_DEGRADED;
+    if (degraded != (bool)((degraded_published >> channel) & 1))
+    {
+        publish_health(time);
+    }
+}
+
+// callback of car speed: ranges of a standing car are not stuck
+static void callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
+{
+    car_speed = msg->data;
+}
+
+// callback of timer: stale sensors and the statistics of all
+static void callback_timer(const ros::WallTimerEvent& event)
+{
+    publish_health(ros::Time::now().toSec());
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "health_monitor");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
+    ros::NodeHandle nh;
+
+    pub_health = nh.advertise<autopark::SensorHealth>("sensor_health", 1, true);
+
+    // queue of measurements: all of them are counted in the statistics
+    ros::Subscriber sub_range[ULTRASONIC_CHANNELS];
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        sub_range[i] = nh.subscribe<sensor_msgs::Range>(ultrasonic_channels[i].name, 10, \
+        boost::bind(callback_range, _1, i));
+    }
+    ros::Subscriber sub_car_speed = nh.subscribe<std_msgs::Float32>("car_speed", 1, callback_car_speed);
+    ros::WallTimer timer = nh.createWallTimer(ros::WallDuration(1.0 / params().health_rate), callback_timer);
+
+    ros::spin();
+
+    return 0;
+}
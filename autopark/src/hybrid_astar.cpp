@@ -0,0 +1,611 @@
+/******************************************************************
+ * Filename: hybrid_astar.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-19
+ * Description: Hybrid A* path planning over a local occupancy grid
+ * with cached non-holonomic heuristic table and node arena
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <ctime>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <functional>
+
+#include "autopark/autoparking.h"
+#include "autopark/hybrid_astar.h"
+#include "autopark/parking_kernels.h"
+
+using namespace std;
+
+static const double grid_resolution = 0.1;      // [m] cell size of occupancy grid
+static const double grid_border = 6;            // [m] border of local grid around start and goal
+static const double state_resolution = 0.25;    // [m] cell size of discrete states
+static const int yaw_bins = 72;                 // number of discrete headings (5°)
+static const double move_length = 0.4;          // [m] length of one move
+static const int steer_half = 2;                // steering angles: full right ... straight ... full left
+static const double reverse_penalty = 1.2;      // factor of cost for moving backward
+static const double switch_penalty = 1.0;       // [m] cost of changing the move direction
+static const double steer_penalty = 0.1;        // [m] cost of changing the steering angle from full left to full right
+static const double heuristic_weight = 1.5;     // weight of heuristic: faster search, a bit longer path
+static const double goal_tolerance = 0.1;       // [m] lateral tolerance to reach the goal
+static const double goal_tolerance_yaw = 0.05;  // [rad] heading tolerance to reach the goal
+static const double heuristic_range = 12;       // [m] range of non-holonomic heuristic table
+static const size_t arena_block = 4096;         // number of nodes in one block of arena
+
+static const float cost_max = numeric_limits<float>::max();
+static const uint32_t state_invalid = numeric_limits<uint32_t>::max();
+
+#define HEURISTIC_TABLE_MAGIC       "APHEUR"
+#define HEURISTIC_TABLE_VERSION     1
+
+// header of heuristic table file: the table is only valid for the same car and moves
+struct HeuristicHeader
+{
+    char magic[8];
+    uint32_t version;
+    float resolution;
+    float range;
+    uint32_t yaw_bins;
+    float move_length;
+    uint32_t steer_half;
+    float wheel_base;
+    float steering_angle_max;
+};
+
+// size of heuristic table: x in [-range, range], y in [0, range]
+static const int heuristic_x = (int)(2 * heuristic_range / state_resolution + 0.5) + 1;
+static const int heuristic_y = (int)(heuristic_range / state_resolution + 0.5) + 1;
+
+
+// current time in seconds
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// discrete heading
+static int yaw_index(double yaw)
+{
+    int index = (int)floor((normalize_angle(yaw) + M_PI) / (2 * M_PI) * yaw_bins + 0.5);
+    return index % yaw_bins;
+}
+
+
+// CONSTRUCTOR
+NodeArena::NodeArena()
+{
+    used_ = 0;
+}
+
+// DESTRUCTOR
+NodeArena::~NodeArena(void)
+{
+    for (size_t i = 0; i < blocks_.size(); i++)
+    {
+        delete[] blocks_[i];
+    }
+}
+
+// get next free node, allocate a new block only if all blocks are used
+SearchNode* NodeArena::allocate()
+{
+    size_t block = used_ / arena_block;
+    if (block >= blocks_.size())
+    {
+        blocks_.push_back(new SearchNode[arena_block]);
+    }
+    return &blocks_[block][used_++ % arena_block];
+}
+
+
+// CONSTRUCTOR
+OccupancyGrid::OccupancyGrid()
+{
+    x_min_ = 0;
+    y_min_ = 0;
+    resolution_ = grid_resolution;
+    width_ = 0;
+    height_ = 0;
+}
+
+// DESTRUCTOR
+OccupancyGrid::~OccupancyGrid(void)
+{
+}
+
+// rasterize boxes, then compute distance with two passes (chamfer distance)
+void OccupancyGrid::set(const vector<Box>& obstacles, double x_min, double x_max, \
+double y_min, double y_max, double resolution)
+{
+    x_min_ = x_min;
+    y_min_ = y_min;
+    resolution_ = resolution;
+    width_ = (int)ceil((x_max - x_min) / resolution);
+    height_ = (int)ceil((y_max - y_min) / resolution);
+    distance_.assign(width_ * height_, cost_max);
+
+    for (size_t i = 0; i < obstacles.size(); i++)
+    {
+        const Box& box = obstacles[i];
+        int i_min = max(0, (int)ceil((box.x_min - x_min_) / resolution_ - 0.5));
+        int i_max = min(width_ - 1, (int)floor((box.x_max - x_min_) / resolution_ - 0.5));
+        int j_min = max(0, (int)ceil((box.y_min - y_min_) / resolution_ - 0.5));
+        int j_max = min(height_ - 1, (int)floor((box.y_max - y_min_) / resolution_ - 0.5));
+        for (int j = j_min; j <= j_max; j++)
+        {
+            fill(distance_.begin() + j * width_ + i_min, distance_.begin() + j * width_ + i_max + 1, 0.0f);
+        }
+    }
+
+    const float straight = resolution_;
+    const float diagonal = resolution_ * M_SQRT2;
+    // forward pass
+    for (int j = 0; j < height_; j++)
+    {
+        for (int i = 0; i < width_; i++)
+        {
+            float& d = distance_[j * width_ + i];
+            if (i > 0) d = min(d, distance_[j * width_ + i - 1] + straight);
+            if (j > 0) d = min(d, distance_[(j - 1) * width_ + i] + straight);
+            if (i > 0 && j > 0) d = min(d, distance_[(j - 1) * width_ + i - 1] + diagonal);
+            if (i + 1 < width_ && j > 0) d = min(d, distance_[(j - 1) * width_ + i + 1] + diagonal);
+        }
+    }
+    // backward pass
+    for (int j = height_ - 1; j >= 0; j--)
+    {
+        for (int i = width_ - 1; i >= 0; i--)
+        {
+            float& d = distance_[j * width_ + i];
+            if (i + 1 < width_) d = min(d, distance_[j * width_ + i + 1] + straight);
+            if (j + 1 < height_) d = min(d, distance_[(j + 1) * width_ + i] + straight);
+            if (i + 1 < width_ && j + 1 < height_) d = min(d, distance_[(j + 1) * width_ + i + 1] + diagonal);
+            if (i > 0 && j + 1 < height_) d = min(d, distance_[(j + 1) * width_ + i - 1] + diagonal);
+        }
+    }
+}
+
+// distance to the nearest obstacle, outside of grid is occupied
+float OccupancyGrid::distance(double x, double y) const
+{
+    int i = (int)floor((x - x_min_) / resolution_);
+    int j = (int)floor((y - y_min_) / resolution_);
+    if (i < 0 || j < 0 || i >= width_ || j >= height_)
+    {
+        return 0;
+    }
+    return distance_[j * width_ + i];
+}
+
+
+// CONSTRUCTOR
+HybridAStar::HybridAStar()
+{
+    search_ = 0;
+    cells_x_ = 0;
+    cells_y_ = 0;
+    expanded_ = 0;
+    duration_ = 0;
+}
+
+// DESTRUCTOR
+HybridAStar::~HybridAStar(void)
+{
+}
+
+// check collision of car (with safety margin): poses far from obstacles are found
+// in the occupancy grid, close to obstacles the check of the geometric planner is used
+bool HybridAStar::free(const CarPose& pose) const
+{
+    typedef ActiveProfile P;
+    double center = P::car_length() / 2 - P::rear_overhang();
+    double radius = hypot(P::car_length() / 2 + P::planner_margin(), P::car_width() / 2 + P::planner_margin());
+    if (grid_.distance(pose.x + cos(pose.yaw) * center, pose.y + sin(pose.yaw) * center) > \
+    radius + grid_resolution * M_SQRT2)
+    {
+        return true;
+    }
+
+    for (size_t i = 0; i < obstacles_.size(); i++)
+    {
+        if (car_collision_box<P>(pose, obstacles_[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// move along an arc and check collision on the way
+bool HybridAStar::move(CarPose& pose, double steering, double length) const
+{
+    int steps = max(1, (int)ceil(fabs(length) / params().planner_step));
+    for (int k = 0; k < steps; k++)
+    {
+        car_move_arc<ActiveProfile>(pose, steering, length / steps);
+        if (!free(pose))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// index of discrete state: cell of the coarse grid and discrete heading
+uint32_t HybridAStar::state_index(const CarPose& pose) const
+{
+    int i = (int)floor((pose.x - grid_.x_min()) / state_resolution);
+    int j = (int)floor((pose.y - grid_.y_min()) / state_resolution);
+    if (i < 0 || j < 0 || i >= cells_x_ || j >= cells_y_)
+    {
+        return state_invalid;
+    }
+    return (j * cells_x_ + i) * yaw_bins + yaw_index(pose.yaw);
+}
+
+// heuristic: maximum of non-holonomic cost without obstacles and holonomic cost with obstacles
+float HybridAStar::heuristic(const CarPose& pose, const CarPose& goal) const
+{
+    // pose in goal frame, mirrored to y >= 0
+    double dx = pose.x - goal.x;
+    double dy = pose.y - goal.y;
+    double x = cos(goal.yaw) * dx + sin(goal.yaw) * dy;
+    double y = -sin(goal.yaw) * dx + cos(goal.yaw) * dy;
+    double yaw = normalize_angle(pose.yaw - goal.yaw);
+    if (y < 0)
+    {
+        y = -y;
+        yaw = -yaw;
+    }
+
+    float cost = hypot(dx, dy);
+    int i = (int)floor((x + heuristic_range) / state_resolution + 0.5);
+    int j = (int)floor(y / state_resolution + 0.5);
+    if (!heuristic_.empty() && i >= 0 && i < heuristic_x && j < heuristic_y)
+    {
+        float table = heuristic_[(j * heuristic_x + i) * yaw_bins + yaw_index(yaw)];
+        if (table < cost_max)
+        {
+            cost = max(cost, table);
+        }
+    }
+
+    int ci = (int)floor((pose.x - grid_.x_min()) / state_resolution);
+    int cj = (int)floor((pose.y - grid_.y_min()) / state_resolution);
+    if (ci >= 0 && cj >= 0 && ci < cells_x_ && cj < cells_y_ && holonomic_[cj * cells_x_ + ci] < cost_max)
+    {
+        cost = max(cost, holonomic_[cj * cells_x_ + ci]);
+    }
+    return cost;
+}
+
+// holonomic cost to goal with obstacles: Dijkstra on coarse grid, cells closer to
+// obstacles than half the car width are blocked
+void HybridAStar::compute_holonomic(const CarPose& goal)
+{
+    holonomic_.assign(cells_x_ * cells_y_, cost_max);
+    int gi = (int)floor((goal.x - grid_.x_min()) / state_resolution);
+    int gj = (int)floor((goal.y - grid_.y_min()) / state_resolution);
+    if (gi < 0 || gj < 0 || gi >= cells_x_ || gj >= cells_y_)
+    {
+        return;
+    }
+
+    typedef pair<float, int> Item;
+    priority_queue<Item, vector<Item>, greater<Item> > open;
+    holonomic_[gj * cells_x_ + gi] = 0;
+    open.push(Item(0, gj * cells_x_ + gi));
+    while (!open.empty())
+    {
+        Item item = open.top();
+        open.pop();
+        if (item.first > holonomic_[item.second])
+        {
+            continue;
+        }
+        int i = item.second % cells_x_;
+        int j = item.second / cells_x_;
+        for (int dj = -1; dj <= 1; dj++)
+        {
+            for (int di = -1; di <= 1; di++)
+            {
+                int ni = i + di, nj = j + dj;
+                if ((di == 0 && dj == 0) || ni < 0 || nj < 0 || ni >= cells_x_ || nj >= cells_y_)
+                {
+                    continue;
+                }
+                double x = grid_.x_min() + (ni + 0.5) * state_resolution;
+                double y = grid_.y_min() + (nj + 0.5) * state_resolution;
+                if (grid_.distance(x, y) < params().car_width / 2)
+                {
+                    continue;
+                }
+                float cost = item.first + ((di != 0 && dj != 0) ? M_SQRT2 : 1) * state_resolution;
+                if (cost < holonomic_[nj * cells_x_ + ni])
+                {
+                    holonomic_[nj * cells_x_ + ni] = cost;
+                    open.push(Item(cost, nj * cells_x_ + ni));
+                }
+            }
+        }
+    }
+}
+
+// non-holonomic cost without obstacles from origin to every discrete pose: Dijkstra
+// with the moves of the search, the cost back to origin is the same (moves are reversible)
+void HybridAStar::compute_heuristic()
+{
+    const int size_y = 2 * heuristic_y - 1;     // y in [-range, range] during computation
+    vector<float> cost(heuristic_x * size_y * yaw_bins, cost_max);
+
+    typedef pair<float, uint32_t> Item;
+    priority_queue<Item, vector<Item>, greater<Item> > open;
+    uint32_t origin = ((heuristic_y - 1) * heuristic_x + (heuristic_x - 1) / 2) * yaw_bins + yaw_index(0);
+    cost[origin] = 0;
+    open.push(Item(0, origin));
+    while (!open.empty())
+    {
+        Item item = open.top();
+        open.pop();
+        if (item.first > cost[item.second])
+        {
+            continue;
+        }
+        int cell = item.second / yaw_bins;
+        CarPose pose;
+        pose.x = (cell % heuristic_x) * state_resolution - heuristic_range;
+        pose.y = (cell / heuristic_x - (heuristic_y - 1)) * state_resolution;
+        pose.yaw = (item.second % yaw_bins) * 2 * M_PI / yaw_bins - M_PI;
+
+        for (int direction = -1; direction <= 1; direction += 2)
+        {
+            for (int steer = -steer_half; steer <= steer_half; steer++)
+            {
+                CarPose next = pose;
+                car_move_arc<ActiveProfile>(next, ActiveProfile::steering_angle_max() * steer / steer_half, \
+                direction * move_length);
+                int i = (int)floor((next.x + heuristic_range) / state_resolution + 0.5);
+                int j = (int)floor(next.y / state_resolution + 0.5) + heuristic_y - 1;
+                if (i < 0 || j < 0 || i >= heuristic_x || j >= size_y)
+                {
+                    continue;
+                }
+                uint32_t index = (j * heuristic_x + i) * yaw_bins + yaw_index(next.yaw);
+                float next_cost = item.first + move_length;
+                if (next_cost < cost[index])
+                {
+                    cost[index] = next_cost;
+                    open.push(Item(next_cost, index));
+                }
+            }
+        }
+    }
+
+    // keep y >= 0
+    heuristic_.assign(cost.begin() + (heuristic_y - 1) * heuristic_x * yaw_bins, cost.end());
+}
+
+// load heuristic table, or compute and save it
+bool HybridAStar::load_heuristic(const char* filename)
+{
+    HeuristicHeader header;
+    memset(&header, 0, sizeof(header));
+    strncpy(header.magic, HEURISTIC_TABLE_MAGIC, sizeof(header.magic));
+    header.version = HEURISTIC_TABLE_VERSION;
+    header.resolution = state_resolution;
+    header.range = heuristic_range;
+    header.yaw_bins = yaw_bins;
+    header.move_length = move_length;
+    header.steer_half = steer_half;
+    header.wheel_base = params().wheel_base;
+    header.steering_angle_max = params().steering_angle_max;
+
+    size_t size = (size_t)heuristic_x * heuristic_y * yaw_bins;
+
+    // load cached table if it is computed with the same parameters
+    FILE* file = fopen(filename, "rb");
+    if (file != NULL)
+    {
+        HeuristicHeader cached;
+        heuristic_.resize(size);
+        bool loaded = (fread(&cached, sizeof(cached), 1, file) == 1 && memcmp(&cached, &header, sizeof(header)) == 0 && \
+        fread(&heuristic_[0], sizeof(float), size, file) == size);
+        fclose(file);
+        if (loaded)
+        {
+            return true;
+        }
+    }
+
+    compute_heuristic();
+
+    file = fopen(filename, "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool saved = (fwrite(&header, sizeof(header), 1, file) == 1 && \
+    fwrite(&heuristic_[0], sizeof(float), size, file) == size);
+    fclose(file);
+    return saved;
+}
+
+bool HybridAStar::heuristic_valid() const
+{
+    return heuristic_.size() == (size_t)heuristic_x * heuristic_y * yaw_bins;
+}
+
+// search path from start to goal
+bool HybridAStar::plan(const vector<Box>& obstacles, const CarPose& start, const CarPose& goal, \
+double time_budget, vector<PathSegment>& segments)
+{
+    double time_start = now();
+    segments.clear();
+    expanded_ = 0;
+
+    // local grid around start and goal
+    obstacles_ = obstacles;
+    grid_.set(obstacles, min(start.x, goal.x) - grid_border, max(start.x, goal.x) + grid_border, \
+    min(start.y, goal.y) - grid_border, max(start.y, goal.y) + grid_border, grid_resolution);
+    cells_x_ = (int)ceil(grid_.width() * grid_resolution / state_resolution);
+    cells_y_ = (int)ceil(grid_.height() * grid_resolution / state_resolution);
+
+    // reset states by a new stamp instead of clearing the arrays
+    size_t states = (size_t)cells_x_ * cells_y_ * yaw_bins;
+    if (state_cost_.size() < states)
+    {
+        state_cost_.resize(states);
+        state_stamp_.resize(states, 0);
+    }
+    if (++search_ == 0)
+    {
+        fill(state_stamp_.begin(), state_stamp_.end(), 0);
+        search_ = 1;
+    }
+
+    compute_holonomic(goal);
+    arena_.reset();
+
+    typedef pair<float, SearchNode*> Item;
+    priority_queue<Item, vector<Item>, greater<Item> > open;
+
+    SearchNode* root = arena_.allocate();
+    root->pose = start;
+    root->cost = 0;
+    root->total = heuristic(start, goal);
+    root->parent = NULL;
+    root->index = state_index(start);
+    root->direction = 0;
+    root->steer = 0;
+    if (root->index != state_invalid)
+    {
+        state_stamp_[root->index] = search_;
+        state_cost_[root->index] = 0;
+    }
+    open.push(Item(root->total, root));
+
+    SearchNode* end = NULL;
+    double shot = 0;        // length of last straight move to goal
+    while (!open.empty())
+    {
+        // hard time budget
+        if ((expanded_ & 63) == 0 && now() - time_start > time_budget)
+        {
+            break;
+        }
+
+        SearchNode* node = open.top().second;
+        open.pop();
+        if (node->index != state_invalid && state_stamp_[node->index] == search_ && \
+        node->cost > state_cost_[node->index])
+        {
+            continue;   // a better node reached this state
+        }
+        expanded_++;
+
+        // goal reached, or straight move to goal: heading and lateral position match
+        double dx = goal.x - node->pose.x;
+        double dy = goal.y - node->pose.y;
+        double along = cos(node->pose.yaw) * dx + sin(node->pose.yaw) * dy;
+        double across = -sin(node->pose.yaw) * dx + cos(node->pose.yaw) * dy;
+        if (fabs(across) < goal_tolerance && fabs(normalize_angle(goal.yaw - node->pose.yaw)) < goal_tolerance_yaw)
+        {
+            CarPose pose = node->pose;
+            if (fabs(along) < goal_tolerance || move(pose, 0, along))
+            {
+                end = node;
+                shot = (fabs(along) < goal_tolerance) ? 0 : along;
+                break;
+            }
+        }
+
+        for (int direction = -1; direction <= 1; direction += 2)
+        {
+            for (int steer = -steer_half; steer <= steer_half; steer++)
+            {
+                CarPose pose = node->pose;
+                if (!move(pose, params().steering_angle_max * steer / steer_half, direction * move_length))
+                {
+                    continue;
+                }
+                uint32_t index = state_index(pose);
+                if (index == state_invalid)
+                {
+                    continue;
+                }
+
+                float cost = node->cost + move_length * (direction < 0 ? reverse_penalty : 1) + \
+                steer_penalty * abs(steer - node->steer) / (2 * steer_half);
+                if (node->direction != 0 && node->direction != direction)
+                {
+                    cost += switch_penalty;
+                }
+                if (state_stamp_[index] == search_ && cost >= state_cost_[index])
+                {
+                    continue;
+                }
+                state_stamp_[index] = search_;
+                state_cost_[index] = cost;
+
+                SearchNode* child = arena_.allocate();
+                child->pose = pose;
+                child->cost = cost;
+                child->total = cost + heuristic_weight * heuristic(pose, goal);
+                child->parent = node;
+                child->index = index;
+                child->direction = direction;
+                child->steer = steer;
+                open.push(Item(child->total, child));
+            }
+        }
+    }
+
+    if (end != NULL)
+    {
+        // moves from start to end, consecutive equal moves are merged
+        vector<SearchNode*> nodes;
+        for (SearchNode* node = end; node->parent != NULL; node = node->parent)
+        {
+            nodes.push_back(node);
+        }
+        for (size_t i = nodes.size(); i > 0; i--)
+        {
+            PathSegment segment;
+            segment.steering = params().steering_angle_max * nodes[i - 1]->steer / steer_half;
+            segment.length = nodes[i - 1]->direction * move_length;
+            if (!segments.empty() && segments.back().steering == segment.steering && \
+            (segments.back().length > 0) == (segment.length > 0))
+            {
+                segments.back().length += segment.length;
+            }
+            else
+            {
+                segments.push_back(segment);
+            }
+        }
+        if (shot != 0)
+        {
+            PathSegment segment = {0, (float)shot};
+            if (!segments.empty() && segments.back().steering == 0 && (segments.back().length > 0) == (shot > 0))
+            {
+                segments.back().length += shot;
+            }
+            else
+            {
+                segments.push_back(segment);
+            }
+        }
+    }
+
+    duration_ = now() - time_start;
+    return end != NULL;
+}
@@ -0,0 +1,128 @@
+/******************************************************************
+ * Filename: lifecycle.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-13
+ * Description: define class for nodes following the stage of the
+ * parking pipeline published by lifecycle_manager
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "autopark/lifecycle.h"
+
+using namespace std;
+
+const char* const stage_names[] = {"idle", "search", "park_in", "done", "park_out"};
+
+const char* stage_name(uint8_t stage)
+{
+    return (stage < STAGE_COUNT) ? stage_names[stage] : "unknown";
+}
+
+
+// wall time [s] when this process was launched, 0 if /proc is not readable
+double process_launch_time()
+{
+    // uptime of the system and start time of the process since boot, in clock ticks
+    double uptime = 0;
+    FILE* file = fopen("/proc/uptime", "r");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    bool read_uptime = (fscanf(file, "%lf", &uptime) == 1);
+    fclose(file);
+
+    char line[1024];
+    file = fopen("/proc/self/stat", "r");
+    if (file == NULL)
+    {
+        return 0;
+    }
+    bool read_stat = (fgets(line, sizeof(line), file) != NULL);
+    fclose(file);
+
+    // fields after the command in parentheses: state is field 3, start time field 22
+    char* fields = read_stat ? strrchr(line, ')') : NULL;
+    unsigned long long start_ticks = 0;
+    if (!read_uptime || fields == NULL || sscanf(fields + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u " \
+    "%*u %*u %*d %*d %*d %*d %*d %*d %llu", &start_ticks) != 1)
+    {
+        return 0;
+    }
+    double age = uptime - (double)start_ticks / sysconf(_SC_CLK_TCK);
+    return ros::WallTime::now().toSec() - age;
+}
+
+
+// CONSTRUCTOR: subscribe the stage, the latched stage is received on the first spin
+LifecycleNode::LifecycleNode(uint32_t stages, const StageHandler& handler):stages_(stages), handler_(handler)
+{
+    active_ = false;
+    session_ = 0;
+    launch_ = process_launch_time();
+
+    // latched: the last acknowledgement of each node is received by late subscribers
+    pub_ack_ = nh_.advertise<autopark::StageAck>("pipeline_ack", 10, true);
+    // transitions are small and rare: send them at once
+    sub_stage_ = nh_.subscribe<autopark::PipelineStage>("pipeline_stage", 10, \
+    &LifecycleNode::callback_stage, this, ros::TransportHints().tcpNoDelay());
+}
+
+void LifecycleNode::callback_stage(const autopark::PipelineStage::ConstPtr& msg)
+{
+    bool active = (msg->stage <= STAGE_PARK_OUT) && (stages_ & STAGE_BIT(msg->stage));
+    bool changed;
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        changed = (active != active_);
+        session_ = msg->session;
+    }
+
+    if (changed)
+    {
+        ROS_INFO("stage %s of session %u: %s", stage_name(msg->stage), msg->session, \
+        active ? "active" : "inactive");
+        handler_(active);
+
+        boost::mutex::scoped_lock lock(mutex_);
+        active_ = active;
+        changed_.notify_all();
+    }
+
+    // lifecycle_manager measures the transition when all nodes acknowledged it
+    autopark::StageAck msg_ack;
+    msg_ack.header.stamp = ros::Time::now();
+    msg_ack.node = ros::this_node::getName();
+    msg_ack.session = msg->session;
+    msg_ack.stage = msg->stage;
+    msg_ack.active = active;
+    msg_ack.launch = launch_;
+    pub_ack_.publish(msg_ack);
+}
+
+bool LifecycleNode::active()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return active_;
+}
+
+uint32_t LifecycleNode::session()
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    return session_;
+}
+
+bool LifecycleNode::wait_until(bool active, double timeout)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+    if (active_ != active)
+    {
+        changed_.timed_wait(lock, boost::posix_time::microseconds((long)(timeout * 1e6)));
+    }
+    return active_ == active;
+}
@@ -0,0 +1,279 @@
+/******************************************************************
+ * Filename: lifecycle_manager.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-13
+ * Description: drive the stages of the parking pipeline (search ->
+ * park in -> done, park out -> done) from the enable and done topics,
+ * a failed parking in or out goes back to idle,
+ * publish each transition latched on pipeline_stage and measure the
+ * time until all nodes acknowledged it. At startup the time from launch
+ * until all nodes of ~nodes are ready to search is published latched
+ * on pipeline_ready
+ * 
+ ******************************************************************/
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <std_msgs/Bool.h>
+#include <std_msgs/Float32.h>
+#include "autopark/autoparking.h"
+#include "autopark/lifecycle.h"
+
+using namespace std;
+
+static ros::Publisher pub_stage;
+static ros::Publisher pub_transition_time;
+static ros::Publisher pub_ready;
+static ros::WallTimer timer_ack;
+
+static autopark::PipelineStage msg_stage;      // current stage
+static double transition_time = 0;              // [s] latest acknowledgement of current stage
+
+// nodes of ~nodes which acknowledge stages: a transition is done when all of them did
+static set<string> nodes_lifecycle;
+static set<string> acks_waiting;                // nodes which did not acknowledge current stage
+
+// startup: nodes which did not acknowledge a stage yet
+static set<string> nodes_waiting;
+static double launch_first = 0;                 // [s] wall time of the first launched process
+static double ready_last = 0;                   // [s] wall time of the last acknowledgement
+
+
+// publish a transition, a new session starts with searching or parking out
+static void set_stage(uint8_t stage)
+{
+    if (stage == msg_stage.stage)
+    {
+        return;
+    }
+    if (stage == STAGE_SEARCH || stage == STAGE_PARK_OUT)
+    {
+        msg_stage.session++;
+    }
+    ROS_INFO("session %u: stage %s -> %s", msg_stage.session, stage_name(msg_stage.stage), \
+    stage_name(stage));
+
+    msg_stage.stage = stage;
+    msg_stage.header.stamp = ros::Time::now();
+    acks_waiting = nodes_lifecycle;
+    transition_time = 0;
+    pub_stage.publish(msg_stage);
+
+    // nodes which did not acknowledge the stage in time are reported
+    timer_ack.stop();
+    if (!acks_waiting.empty())
+    {
+        timer_ack.start();
+    }
+}
+
+// callbacks of enable and done topics: transitions of the pipeline
+static void callback_parking_enable(const std_msgs::Bool::ConstPtr& msg)
+{
+    ROS_INFO("call callback of parking_enable: %d", msg->data);
+    if (msg->data)
+    {
+        if (msg_stage.stage == STAGE_IDLE || msg_stage.stage == STAGE_DONE)
+        {
+            set_stage(STAGE_SEARCH);
+        }
+    }
+    else if (msg_stage.stage != STAGE_PARK_OUT)
+    {
+        set_stage(STAGE_IDLE);
+    }
+}
+
+static void callback_parking_out_enable(const std_msgs::Bool::ConstPtr& msg)
+{
+    ROS_INFO("call callback of parking_out_enable: %d", msg->data);
+    if (msg->data)
+    {
+        if (msg_stage.stage == STAGE_IDLE || msg_stage.stage == STAGE_DONE)
+        {
+            set_stage(STAGE_PARK_OUT);
+        }
+    }
+    else if (msg_stage.stage == STAGE_PARK_OUT)
+    {
+        set_stage(STAGE_IDLE);
+    }
+}
+
+static void callback_search_done(const std_msgs::Bool::ConstPtr& msg)
+{
+    if (msg->data && msg_stage.stage == STAGE_SEARCH)
+    {
+        set_stage(STAGE_PARK_IN);
+    }
+}
+
+static void callback_parking_in_done(const std_msgs::Bool::ConstPtr& msg)
+{
+    // parking in may be aborted before lifecycle_manager received search_done
+    if (msg_stage.stage != STAGE_SEARCH && msg_stage.stage != STAGE_PARK_IN)
+    {
+        return;
+    }
+    if (!msg->data)
+    {
+        ROS_WARN("session %u: parking in failed", msg_stage.session);
+    }
+    set_stage(msg->data ? STAGE_DONE : STAGE_IDLE);
+}
+
+static void callback_parking_out_done(const std_msgs::Bool::ConstPtr& msg)
+{
+    if (msg_stage.stage != STAGE_PARK_OUT)
+    {
+        return;
+    }
+    if (!msg->data)
+    {
+        ROS_WARN("session %u: parking out failed", msg_stage.session);
+    }
+    set_stage(msg->data ? STAGE_DONE : STAGE_IDLE);
+}
+
+// startup: a node is ready when it applied its first stage, the pipeline is ready to search
+// when all nodes are ready
+static void check_ready(const autopark::StageAck& msg)
+{
+    if (nodes_waiting.erase(msg.node) == 0)
+    {
+        return;
+    }
+    if (msg.launch > 0)
+    {
+        launch_first = (launch_first > 0) ? min(launch_first, msg.launch) : msg.launch;
+    }
+    ready_last = max(ready_last, msg.header.stamp.toSec());
+    if (!nodes_waiting.empty())
+    {
+        return;
+    }
+
+    std_msgs::Float32 msg_ready;
+    msg_ready.data = ready_last - launch_first;
+    pub_ready.publish(msg_ready);
+
+    ROS_INFO("ready to search %.1f ms after launch", msg_ready.data * 1e3);
+    if (msg_ready.data > params().startup_ready_max)
+    {
+        ROS_WARN("startup took %.1f ms, more than %.1f ms", msg_ready.data * 1e3, \
+        params().startup_ready_max * 1e3);
+    }
+}
+
+// acknowledgements of nodes: the transition is done when all nodes applied it
+static void callback_ack(const autopark::StageAck::ConstPtr& msg)
+{
+    check_ready(*msg);
+
+    // nodes out of ~nodes and repeated acknowledgements are not counted
+    if (msg->session != msg_stage.session || msg->stage != msg_stage.stage || \
+    acks_waiting.erase(msg->node) == 0)
+    {
+        return;
+    }
+    transition_time = max(transition_time, (msg->header.stamp - msg_stage.header.stamp).toSec());
+    if (!acks_waiting.empty())
+    {
+        return;
+    }
+    timer_ack.stop();
+
+    ROS_INFO("session %u: stage %s applied by %lu nodes in %.2f ms", msg_stage.session, \
+    stage_name(msg_stage.stage), (unsigned long)nodes_lifecycle.size(), transition_time * 1e3);
+    if (transition_time > params().lifecycle_transition_max)
+    {
+        ROS_WARN("transition to stage %s took %.2f ms, more than %.2f ms", stage_name(msg_stage.stage), \
+        transition_time * 1e3, params().lifecycle_transition_max * 1e3);
+    }
+
+    std_msgs::Float32 msg_time;
+    msg_time.data = transition_time;
+    pub_transition_time.publish(msg_time);
+}
+
+static void callback_timer_ack(const ros::WallTimerEvent& event)
+{
+    ROS_WARN("session %u: stage %s acknowledged by %lu of %lu nodes", msg_stage.session, \
+    stage_name(msg_stage.stage), (unsigned long)(nodes_lifecycle.size() - acks_waiting.size()), \
+    (unsigned long)nodes_lifecycle.size());
+    for (set<string>::const_iterator it = acks_waiting.begin(); it != acks_waiting.end(); ++it)
+    {
+        ROS_WARN("node %s did not acknowledge the stage", it->c_str());
+    }
+    for (set<string>::const_iterator it = nodes_waiting.begin(); it != nodes_waiting.end(); ++it)
+    {
+        ROS_WARN("node %s is not ready", it->c_str());
+    }
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "lifecycle_manager");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+
+    // nodes which acknowledge stages: the pipeline is ready to search when all of them did
+    vector<string> nodes;
+    nh_private.getParam("nodes", nodes);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        nodes_lifecycle.insert(nodes[i][0] == '/' ? nodes[i] : "/" + nodes[i]);
+    }
+    nodes_waiting = nodes_lifecycle;
+    if (nodes_lifecycle.empty())
+    {
+        ROS_WARN("no ~nodes: transitions of stages are not measured");
+    }
+    launch_first = process_launch_time();
+
+    // the stage is latched: nodes started later apply the current stage
+    pub_stage = nh.advertise<autopark::PipelineStage>("pipeline_stage", 1, true);
+    pub_transition_time = nh.advertise<std_msgs::Float32>("pipeline_transition_time", 10);
+    pub_ready = nh.advertise<std_msgs::Float32>("pipeline_ready", 1, true);
+
+    ros::TransportHints hints = ros::TransportHints().tcpNoDelay();
+    ros::Subscriber sub_parking_enable = nh.subscribe<std_msgs::Bool>("parking_enable", 1, \
+    callback_parking_enable, hints);
+    ros::Subscriber sub_parking_out_enable = nh.subscribe<std_msgs::Bool>("parking_out_enable", 1, \
+    callback_parking_out_enable, hints);
+    ros::Subscriber sub_search_done = nh.subscribe<std_msgs::Bool>("search_done", 1, \
+    callback_search_done, hints);
+    ros::Subscriber sub_parking_in_done = nh.subscribe<std_msgs::Bool>("parking_in_done", 1, \
+    callback_parking_in_done, hints);
+    ros::Subscriber sub_parking_out_done = nh.subscribe<std_msgs::Bool>("parking_out_done", 1, \
+    callback_parking_out_done, hints);
+    ros::Subscriber sub_ack = nh.subscribe<autopark::StageAck>("pipeline_ack", 50, callback_ack, hints);
+
+    // one-shot timer, started on each transition and for startup
+    timer_ack = nh.createWallTimer(ros::WallDuration(1.0), callback_timer_ack, true, !nodes_waiting.empty());
+
+    msg_stage.session = 0;
+    msg_stage.stage = STAGE_IDLE;
+    msg_stage.header.stamp = ros::Time::now();
+    pub_stage.publish(msg_stage);
+
+    // without ~nodes the pipeline is ready when lifecycle_manager is
+    if (nodes_waiting.empty())
+    {
+        std_msgs::Float32 msg_ready;
+        msg_ready.data = ros::WallTime::now().toSec() - launch_first;
+        pub_ready.publish(msg_ready);
+    }
+
+    // all callbacks are events on one thread: no polling loop
+    ros::spin();
+
+    return 0;
+}
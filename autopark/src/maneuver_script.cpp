@@ -0,0 +1,56 @@
+/******************************************************************
+ * Filename: maneuver_script.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-20
+ * Description: define the base of maneuvers written as a script,
+ * resumed with each new measurement
+ * 
+ ******************************************************************/
+
+#include "autopark/maneuver_script.h"
+
+#include <cstddef>
+
+
+// CONSTRUCTOR
+Maneuver::Maneuver()
+{
+    input_ = NULL;
+    command_.move = 0;
+    command_.turn = 'D';
+    command_.move_set = false;
+    command_.turn_set = false;
+    succeeded_ = false;
+    steps_ = 0;
+    travel_start_ = 0;
+}
+
+void Maneuver::move(float speed)
+{
+    command_.move = speed;
+    command_.move_set = true;
+}
+
+void Maneuver::turn(char turn)
+{
+    command_.turn = turn;
+    command_.turn_set = true;
+}
+
+bool Maneuver::resume(const ManeuverInput& input)
+{
+    command_.move_set = false;
+    command_.turn_set = false;
+    if (done())
+    {
+        return false;
+    }
+
+    // the input is valid until the next wait
+    input_ = &input;
+    step();
+    input_ = NULL;
+    steps_++;
+    return !done();
+}
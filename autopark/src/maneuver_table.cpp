@@ -0,0 +1,223 @@
+/******************************************************************
+ * Filename: maneuver_table.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-15
+ * Description: look up maneuvers in the precomputed table, the file
+ * is memory-mapped without parsing
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "autopark/autoparking.h"
+#include "autopark/maneuver_table.h"
+
+using namespace std;
+
+// check if two segments can be interpolated: same direction and no opposite full steering
+static bool similar(const PathSegment& a, const PathSegment& b)
+{
+    return ((a.length > 0) == (b.length > 0)) && fabs(a.steering - b.steering) < params().steering_angle_max;
+}
+
+
+// CONSTRUCTOR
+ManeuverTable::ManeuverTable()
+{
+    data_ = NULL;
+    size_ = 0;
+}
+
+// DESTRUCTOR
+ManeuverTable::~ManeuverTable(void)
+{
+    close();
+}
+
+// map table file into memory and check header
+bool ManeuverTable::open(const char* filename)
+{
+    close();
+
+    int fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(ManeuverTableHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    data_ = (const uint8_t*)data;
+    size_ = st.st_size;
+
+    // table must be generated for this car
+    const ManeuverTableHeader* h = header();
+    bool valid = (strncmp(h->magic, MANEUVER_TABLE_MAGIC, sizeof(h->magic)) == 0 && \
+    h->version == MANEUVER_TABLE_VERSION && h->segments_max == MANEUVER_SEGMENTS_MAX && \
+    h->car_length == params().car_length && h->car_width == params().car_width && \
+    h->wheel_base == params().wheel_base && h->steering_angle_max == params().steering_angle_max);
+
+    for (int i = 0; valid && i < MANEUVER_TYPES; i++)
+    {
+        size_t cells = 1;
+        for (int k = 0; k < MANEUVER_AXES; k++)
+        {
+            cells *= h->block[i].axis[k].count;
+        }
+        valid = (h->block[i].cells + cells * sizeof(ManeuverCell) <= size_);
+    }
+
+    if (!valid)
+    {
+        close();
+    }
+    return valid;
+}
+
+// unmap table
+void ManeuverTable::close()
+{
+    if (data_ != NULL)
+    {
+        munmap((void*)data_, size_);
+        data_ = NULL;
+        size_ = 0;
+    }
+}
+
+// cell at index of all axes
+const ManeuverCell* ManeuverTable::cell(const ManeuverBlock& block, const uint32_t index[]) const
+{
+    size_t offset = 0;
+    for (int k = 0; k < MANEUVER_AXES; k++)
+    {
+        offset = offset * block.axis[k].count + index[k];
+    }
+    return (const ManeuverCell*)(data_ + block.cells) + offset;
+}
+
+// look up maneuver: the lengths and steering angles are interpolated between the
+// neighbor cells if they have the same moves, otherwise the cell of the smaller
+// parking space is used
+bool ManeuverTable::lookup(uint32_t type, const SpaceGeometry& space, double heading, \
+vector<PathSegment>& segments) const
+{
+    segments.clear();
+    if (data_ == NULL)
+    {
+        return false;
+    }
+
+    const ManeuverBlock* block = NULL;
+    for (int i = 0; i < MANEUVER_TYPES; i++)
+    {
+        if (header()->block[i].type == type)
+        {
+            block = &header()->block[i];
+        }
+    }
+    if (block == NULL)
+    {
+        return false;
+    }
+
+    // lower neighbor and interpolation weight on every axis
+    double value[MANEUVER_AXES] = {space.width, space.length, space.distance, heading};
+    uint32_t lower[MANEUVER_AXES];
+    double weight[MANEUVER_AXES];
+    for (int k = 0; k < MANEUVER_AXES; k++)
+    {
+        const TableAxis& axis = block->axis[k];
+        double position = (value[k] - axis.min) / axis.step;
+        if (position < -1e-6 || position > axis.count - 1 + 1e-6)
+        {
+            return false;   // out of table
+        }
+        position = max(0.0, min((double)(axis.count - 1), position));
+        lower[k] = min((uint32_t)position, axis.count > 1 ? axis.count - 2 : 0);
+        weight[k] = (axis.count > 1) ? position - lower[k] : 0;
+    }
+
+    const ManeuverCell* base = cell(*block, lower);
+    if (base->count == 0)
+    {
+        return false;   // no maneuver for the smaller parking space
+    }
+    segments.assign(base->segment, base->segment + base->count);
+
+    // interpolate over the 2^4 neighbor cells
+    vector<PathSegment> interpolated(base->count);
+    for (int corner = 0; corner < (1 << MANEUVER_AXES); corner++)
+    {
+        uint32_t index[MANEUVER_AXES];
+        double factor = 1;
+        for (int k = 0; k < MANEUVER_AXES; k++)
+        {
+            bool upper = (corner >> k) & 1;
+            index[k] = lower[k] + (upper && block->axis[k].count > 1 ? 1 : 0);
+            factor *= upper ? weight[k] : 1 - weight[k];
+        }
+        if (factor == 0)
+        {
+            continue;
+        }
+
+        // neighbor with other moves: keep the maneuver of the smaller parking space
+        const ManeuverCell* neighbor = cell(*block, index);
+        if (neighbor->count != base->count)
+        {
+            interpolated.clear();
+            break;
+        }
+        for (size_t i = 0; i < base->count; i++)
+        {
+            if (!similar(neighbor->segment[i], base->segment[i]))
+            {
+                interpolated.clear();
+                break;
+            }
+            interpolated[i].steering += factor * neighbor->segment[i].steering;
+            interpolated[i].length += factor * neighbor->segment[i].length;
+        }
+        if (interpolated.empty())
+        {
+            break;
+        }
+    }
+    if (!interpolated.empty())
+    {
+        segments = interpolated;
+    }
+
+    // parking space is at another position than at planning: move straight first
+    float shift = space.offset - header()->offset;
+    if (fabs(shift) > 1e-3)
+    {
+        if (segments[0].steering == 0)
+        {
+            segments[0].length += shift;
+        }
+        else
+        {
+            PathSegment straight = {0, shift};
+            segments.insert(segments.begin(), straight);
+        }
+    }
+    return true;
+}
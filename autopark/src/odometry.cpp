@@ -0,0 +1,338 @@
+/******************************************************************
+ * Filename: odometry.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-22
+ * Description: integration of car pose and shared memory with the
+ * history of poses
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "autopark/autoparking.h"
+#include "autopark/parking_planner.h"
+#include "autopark/odometry.h"
+
+using namespace std;
+
+static const int read_retries = 8;      // retries of a slot which is overwritten while it is read
+
+
+// CONSTRUCTOR
+Odometry::Odometry()
+{
+    reset();
+}
+
+// DESTRUCTOR
+Odometry::~Odometry(void)
+{
+}
+
+void Odometry::reset()
+{
+    memset(&state_, 0, sizeof(state_));
+    started_ = false;
+}
+
+// move along the arc of current speed and steering angle until time stamp
+void Odometry::update(double stamp)
+{
+    if (!started_)
+    {
+        state_.stamp = stamp;
+        started_ = true;
+        return;
+    }
+
+    double dt = stamp - state_.stamp;
+    if (dt <= 0)
+    {
+        return;     // older stamp: keep state
+    }
+
+    double length = state_.speed * dt;
+    CarPose pose = {state_.x, state_.y, state_.yaw};
+    move_car_arc(pose, state_.steering, length);
+    state_.x = pose.x;
+    state_.y = pose.y;
+    state_.yaw = pose.yaw;
+    state_.distance += length;
+    state_.odometer += fabs(length);
+    state_.stamp = stamp;
+}
+
+void Odometry::set_speed(double stamp, float speed)
+{
+    update(stamp);
+    state_.speed = speed;
+}
+
+void Odometry::set_steering(double stamp, float steering)
+{
+    update(stamp);
+    state_.steering = steering;
+}
+
+
+// CONSTRUCTOR
+OdometryShm::OdometryShm()
+{
+    shared_ = NULL;
+    size_ = 0;
+    writer_ = false;
+}
+
+// DESTRUCTOR
+OdometryShm::~OdometryShm(void)
+{
+    close();
+}
+
+bool OdometryShm::create(const char* name, uint32_t capacity)
+{
+    close();
+
+    size_t size = sizeof(OdometryShared) + (capacity - 1) * sizeof(OdometrySlot);
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    if (ftruncate(fd, size) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // readers check the header, so it is written last
+    shared_ = (OdometryShared*)data;
+    size_ = size;
+    writer_ = true;
+    memset(shared_->magic, 0, sizeof(shared_->magic));
+    __sync_synchronize();
+    shared_->version = ODOMETRY_SHM_VERSION;
+    shared_->capacity = capacity;
+    shared_->count = 0;
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        shared_->slots[i].sequence = 0;
+    }
+    __sync_synchronize();
+    strncpy(shared_->magic, ODOMETRY_SHM_MAGIC, sizeof(shared_->magic));
+    return true;
+}
+
+bool OdometryShm::open(const char* name)
+{
+    close();
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(OdometryShared))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const OdometryShared* shared = (const OdometryShared*)data;
+    if (strncmp(shared->magic, ODOMETRY_SHM_MAGIC, sizeof(shared->magic)) != 0 || \
+    shared->version != ODOMETRY_SHM_VERSION || \
+    sizeof(OdometryShared) + (shared->capacity - 1) * sizeof(OdometrySlot) > (size_t)st.st_size)
+    {
+        munmap(data, st.st_size);
+        return false;
+    }
+
+    shared_ = (OdometryShared*)data;
+    size_ = st.st_size;
+    writer_ = false;
+    return true;
+}
+
+void OdometryShm::close()
+{
+    if (shared_ != NULL)
+    {
+        munmap((void*)shared_, size_);
+    }
+    shared_ = NULL;
+    size_ = 0;
+    writer_ = false;
+}
+
+// write next slot: invalidate it, write sample, then publish its sequence and the count
+void OdometryShm::write(const OdometrySample& sample)
+{
+    if (shared_ == NULL || !writer_)
+    {
+        return;
+    }
+    uint64_t index = shared_->count;
+    OdometrySlot& slot = shared_->slots[index % shared_->capacity];
+    slot.sequence = 0;
+    __sync_synchronize();
+    slot.sample = sample;
+    __sync_synchronize();
+    slot.sequence = index + 1;
+    shared_->count = index + 1;
+}
+
+// copy sample of index, false if the slot holds another sample before or after copying
+bool OdometryShm::read_slot(uint64_t index, OdometrySample& sample) const
+{
+    const OdometrySlot& slot = shared_->slots[index % shared_->capacity];
+    for (int i = 0; i < read_retries; i++)
+    {
+        uint64_t sequence = slot.sequence;
+        __sync_synchronize();
+        sample = *(const OdometrySample*)&slot.sample;
+        __sync_synchronize();
+        if (sequence == index + 1 && slot.sequence == sequence)
+        {
+            return true;
+        }
+        if (sequence > index + 1)
+        {
+            return false;   // overwritten by a newer sample
+        }
+    }
+    return false;
+}
+
+bool OdometryShm::latest(OdometrySample& sample) const
+{
+    if (shared_ == NULL)
+    {
+        return false;
+    }
+    for (int i = 0; i < read_retries; i++)
+    {
+        uint64_t count = shared_->count;
+        if (count == 0)
+        {
+            return false;
+        }
+        if (read_slot(count - 1, sample))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// binary search in the history, then interpolate between the two samples around stamp;
+// after the latest sample the pose is extrapolated along its arc up to odometry_timeout,
+// later the odometry is stale and the caller falls back
+bool OdometryShm::at(double stamp, OdometrySample& sample) const
+{
+    if (shared_ == NULL)
+    {
+        return false;
+    }
+    uint64_t count = shared_->count;
+    if (count == 0)
+    {
+        return false;
+    }
+    uint64_t last = count - 1;
+    uint64_t first = (count > shared_->capacity) ? count - shared_->capacity + 1 : 0;
+
+    OdometrySample newer;
+    if (!read_slot(last, newer))
+    {
+        return false;
+    }
+    if (stamp >= newer.stamp)
+    {
+        if (stamp - newer.stamp > params().odometry_timeout)
+        {
+            return false;
+        }
+        sample = newer;
+        CarPose pose = {sample.x, sample.y, sample.yaw};
+        double length = sample.speed * (stamp - sample.stamp);
+        move_car_arc(pose, sample.steering, length);
+        sample.x = pose.x;
+        sample.y = pose.y;
+        sample.yaw = pose.yaw;
+        sample.distance += length;
+        sample.odometer += fabs(length);
+        sample.stamp = stamp;
+        return true;
+    }
+
+    // last sample with stamp <= time stamp
+    OdometrySample older;
+    uint64_t low = first, high = last;
+    if (!read_slot(low, older) || older.stamp > stamp)
+    {
+        return false;   // out of history
+    }
+    while (high - low > 1)
+    {
+        uint64_t middle = low + (high - low) / 2;
+        OdometrySample probe;
+        if (!read_slot(middle, probe))
+        {
+            return false;
+        }
+        if (probe.stamp <= stamp)
+        {
+            low = middle;
+            older = probe;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    if (!read_slot(high, newer) || !read_slot(low, older))
+    {
+        return false;
+    }
+
+    double ratio = (newer.stamp > older.stamp) ? (stamp - older.stamp) / (newer.stamp - older.stamp) : 0;
+    sample = older;
+    sample.stamp = stamp;
+    sample.x += ratio * (newer.x - older.x);
+    sample.y += ratio * (newer.y - older.y);
+    sample.yaw = normalize_angle(older.yaw + ratio * normalize_angle(newer.yaw - older.yaw));
+    sample.distance += ratio * (newer.distance - older.distance);
+    sample.odometer += ratio * (newer.odometer - older.odometer);
+    return true;
+}
+
+bool OdometryShm::distance(double begin, double end, double& distance) const
+{
+    OdometrySample sample_begin, sample_end;
+    if (!at(begin, sample_begin) || !at(end, sample_end))
+    {
+        return false;
+    }
+    distance = sample_end.distance - sample_begin.distance;
+    return true;
+}
@@ -0,0 +1,377 @@
+/******************************************************************
+ * Filename: parameters.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-01
+ * Description: define default vehicle profile, loading of profile
+ * files and publishing of parameter snapshots
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <sys/stat.h>
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <ros/console.h>
+#include <ros/package.h>
+#include <ros/param.h>
+
+#include "autopark/parameters.h"
+#include "autopark/vehicle_profile.h"
+
+using namespace std;
+
+static const float parameter_poll_period = 1;   // [s] period of checking the profile file for changes
+static bool parameters_started = false;         // startup of watch_parameters() is done: geometry is fixed
+
+// name of each parameter in profile files
+struct ParameterEntry
+{
+    const char* name;
+    float Parameters::* member;
+    bool reloadable;            // false: only loaded at startup (geometry and rates)
+};
+
+static const ParameterEntry parameter_entries[] =
+{
+    {"range_diff", &Parameters::range_diff, true},
+    {"distance_search", &Parameters::distance_search, true},
+    {"parallel_width", &Parameters::parallel_width, true},
+    {"parallel_length", &Parameters::parallel_length, true},
+    {"perpendicular_width", &Parameters::perpendicular_width, true},
+    {"perpendicular_length", &Parameters::perpendicular_length, true},
+    {"car_width", &Parameters::car_width, false},
+    {"car_length", &Parameters::car_length, false},
+    {"distance_apa", &Parameters::distance_apa, false},
+    {"apa_width", &Parameters::apa_width, false},
+    {"apa_tolerance", &Parameters::apa_tolerance, true},
+    {"distance_apa_rear", &Parameters::distance_apa_rear, false},
+    {"rear_overhang", &Parameters::rear_overhang, false},
+    {"wheel_base", &Parameters::wheel_base, false},
+    {"steering_angle_max", &Parameters::steering_angle_max, false},
+    {"steering_angle_step", &Parameters::steering_angle_step, true},
+    {"brake_distance_default", &Parameters::brake_distance_default, true},
+    {"move_distance_perpendicular", &Parameters::move_distance_perpendicular, true},
+    {"parking_distance_min", &Parameters::parking_distance_min, true},
+    {"parking_distance_max", &Parameters::parking_distance_max, true},
+    {"distance_perpendicular_out", &Parameters::distance_perpendicular_out, true},
+    {"distance_parallel_out", &Parameters::distance_parallel_out, true},
+    {"speed_search_parking", &Parameters::speed_search_parking, true},
+    {"speed_parking_forward", &Parameters::speed_parking_forward, true},
+    {"speed_parking_backward", &Parameters::speed_parking_backward, true},
+    {"planner_margin", &Parameters::planner_margin, true},
+    {"planner_step", &Parameters::planner_step, true},
+    {"path_sample_step", &Parameters::path_sample_step, true},
+    {"lookahead_distance", &Parameters::lookahead_distance, true},
+    {"path_goal_tolerance", &Parameters::path_goal_tolerance, true},
+    {"path_tracking_rate", &Parameters::path_tracking_rate, false},
+    {"tracking_decel", &Parameters::tracking_decel, true},
+    {"tracking_speed_min", &Parameters::tracking_speed_min, true},
+    {"steering_lag_max", &Parameters::steering_lag_max, true},
+    {"hybrid_astar_time_budget", &Parameters::hybrid_astar_time_budget, true},
+    {"aisle_range_max", &Parameters::aisle_range_max, true},
+    {"odometry_rate", &Parameters::odometry_rate, false},
+    {"odometry_timeout", &Parameters::odometry_timeout, true},
+    {"trajectory_tolerance", &Parameters::trajectory_tolerance, true},
+    {"parking_time", &Parameters::parking_time, true},
+    {"parking_control_rate", &Parameters::parking_control_rate, false},
+    {"executor_threads", &Parameters::executor_threads, false},
+    {"lifecycle_transition_max", &Parameters::lifecycle_transition_max, true},
+    {"startup_ready_max", &Parameters::startup_ready_max, true},
+    {"arbiter_rate", &Parameters::arbiter_rate, false},
+    {"arbiter_report_period", &Parameters::arbiter_report_period, true},
+    {"lease_aeb", &Parameters::lease_aeb, true},
+    {"lease_maneuver", &Parameters::lease_maneuver, true},
+    {"lease_search", &Parameters::lease_search, true},
+    {"command_heartbeat", &Parameters::command_heartbeat, true},
+    {"actuator_rate", &Parameters::actuator_rate, false},
+    {"steering_dead_time", &Parameters::steering_dead_time, true},
+    {"steering_rate_max", &Parameters::steering_rate_max, true},
+    {"drive_dead_time", &Parameters::drive_dead_time, true},
+    {"drive_accel_max", &Parameters::drive_accel_max, true},
+    {"drive_decel_max", &Parameters::drive_decel_max, true},
+    {"speed_of_sound", &Parameters::speed_of_sound, true},
+    {"firing_guard_time", &Parameters::firing_guard_time, true},
+    {"health_rate", &Parameters::health_rate, false},
+    {"health_smoothing", &Parameters::health_smoothing, true},
+    {"health_timeout", &Parameters::health_timeout, true},
+    {"health_rate_min", &Parameters::health_rate_min, true},
+    {"health_jitter_max", &Parameters::health_jitter_max, true},
+    {"health_noise_max", &Parameters::health_noise_max, true},
+    {"health_stuck_samples", &Parameters::health_stuck_samples, true},
+    {"health_moving_speed", &Parameters::health_moving_speed, true},
+    {"health_out_of_range_max", &Parameters::health_out_of_range_max, true},
+    {"alignment_history", &Parameters::alignment_history, true},
+    {"alignment_hold", &Parameters::alignment_hold, true},
+    {"alignment_delay", &Parameters::alignment_delay, true}
+};
+static const size_t parameter_count = sizeof(parameter_entries) / sizeof(parameter_entries[0]);
+
+static const Parameters parameters_default;
+boost::atomic<const Parameters*> parameters_snapshot(&parameters_default);
+
+static boost::mutex parameters_mutex;           // serialize loading
+static vector<const Parameters*> parameters_retired;  // replaced snapshots, readers may still use them
+static unsigned parameters_loaded = 0;
+
+
+// CONSTRUCTOR: default profile
+Parameters::Parameters()
+{
+    range_diff = 0.2;                           // [m] range difference to distinguish turn point
+    distance_search = 2;                        // [m] maximum distance between car and parking space
+    parallel_width = 6;                         // [m] minimum width of parallel parking space
+    parallel_length = 2.5;                      // [m] minimum length of parallel parking space
+    perpendicular_width = 2.5;                  // [m] minimum width of perpendicular parking space
+    perpendicular_length = 5;                   // [m] minimum length of perpendicular parking space
+    car_width = 1.8;                            // [m] minimum width of car
+    car_length = 4.8;                           // [m] minimum length of car
+    distance_apa = 4;                           // [m] distance between two apas at front and back of car
+    apa_width = 0.5;                            // [m] lateral range of apa
+    apa_tolerance = 0.02;                       // [m] measuring tolerance of apa
+    distance_apa_rear = 0.5;                    // [m] distance between rear axle and apas at back
+    rear_overhang = 1.0;                        // [m] distance between rear axle and rear of car
+    wheel_base = 2.7;                           // [m] distance between front and rear axle
+    steering_angle_max = 0.6;                   // [rad] maximum steering angle of front wheels (~34°)
+    steering_angle_step = 0.0175;               // [rad] steering angle of a little turn (~1°)
+
+    brake_distance_default = 0.3;               // [m] default brake distance
+    move_distance_perpendicular = 1.5;          // [m] move distance before perpendicular parking in
+    parking_distance_min = 0.4;                 // [m] minimum distance between car and parkwall (car)
+    parking_distance_max = 1.2;                 // [m] maximum distance between car and parkwall (car)
+    distance_perpendicular_out = 3;             // [m] move distance for perpendicular parking out
+    distance_parallel_out = 1;                  // [m] safe distance for parallel parking out
+
+    speed_search_parking = 5;                   // [m/s] car speed when search parking space
+    speed_parking_forward = 2;                  // [m/s] car speed when move forward for parking
+    speed_parking_backward = -2;                // [m/s] car speed when move backward for parking
+
+    planner_margin = 0.2;                       // [m] safety margin around car for path planning
+    planner_step = 0.05;                        // [m] step length to check collision of planned path
+    path_sample_step = 0.1;                     // [m] distance between points of published path
+    lookahead_distance = 1.0;                   // [m] lookahead distance of path tracking
+    path_goal_tolerance = 0.1;                  // [m] tolerance to reach the end of a path segment
+    path_tracking_rate = 100;                   // [Hz] loop rate of path tracking controller
+    tracking_decel = 1.0;                       // [m/s^2] deceleration of path tracking before cusps
+    tracking_speed_min = 0.1;                   // [m/s] creep speed of path tracking to reach cusps
+    steering_lag_max = 0.1;                     // [rad] steering lag of path tracking where the car stops
+    hybrid_astar_time_budget = 0.2;             // [s] maximum search time of Hybrid A*
+    aisle_range_max = 6;                        // [m] maximum apa range to obstacles on the other side of aisle
+    odometry_rate = 100;                        // [Hz] rate of integrating and publishing odometry
+    odometry_timeout = 0.1;                     // [s] maximum extrapolation of odometry after its latest sample
+    trajectory_tolerance = 0.2;                 // [m] tolerance of replaying cached trajectory for parking out
+
+    parking_time = 60;                          // [s] total time for parking
+    parking_control_rate = 20;                  // [Hz] rate of steps of parking in
+    executor_threads = 1;                       // number of threads running the callbacks of a node
+    lifecycle_transition_max = 0.005;           // [s] maximum time until all nodes applied a stage of the pipeline
+    startup_ready_max = 0.2;                    // [s] maximum time from launch until all nodes are ready to search
+
+    arbiter_rate = 100;                         // [Hz] rate of expiring leases of commands
+    arbiter_report_period = 10;                 // [s] period of reporting latency of arbitration
+    lease_aeb = 0.5;                            // [s] lease of commands of surround_monitor
+    lease_maneuver = 0.2;                       // [s] lease of commands of parking in and out
+    lease_search = 0.2;                         // [s] lease of commands of searching parking space
+    command_heartbeat = 0.1;                    // [s] period of repeating unchanged commands
+    actuator_rate = 100;                        // [Hz] rate of sending command frames to actuators
+    steering_dead_time = 0.1;                   // [s] dead time of steering actuator
+    steering_rate_max = 0.5;                    // [rad/s] maximum rate of steering angle
+    drive_dead_time = 0.2;                      // [s] dead time of drive actuator
+    drive_accel_max = 1.0;                      // [m/s^2] maximum acceleration of drive
+    drive_decel_max = 2.0;                      // [m/s^2] maximum deceleration of drive
+
+    speed_of_sound = 343;                       // [m/s] speed of sound for echo time of ultrasonic sensors
+    firing_guard_time = 0.002;                  // [s] ring-down of ultrasonic sensors added to a firing slot
+    health_rate = 2;                            // [Hz] rate of publishing the health of the sensors
+    health_smoothing = 0.05;                    // weight of a measurement in the statistics of sensor health
+    health_timeout = 1.0;                       // [s] time without measurement until a sensor is stale
+    health_rate_min = 1.0;                      // [Hz] minimum rate of a healthy sensor
+    health_jitter_max = 0.5;                    // maximum jitter of a healthy sensor relative to its interval
+    health_noise_max = 0.3;                     // [m] maximum difference of successive ranges of a healthy sensor
+    health_stuck_samples = 50;                  // successive unchanged ranges until a sensor is stuck
+    health_moving_speed = 0.05;                 // [m/s] car speed above which unchanged ranges count as stuck
+    health_out_of_range_max = 0.2;              // maximum ratio of ranges of a healthy sensor outside its range
+    alignment_history = 60;                     // [s] history of car speed to align measurements with
+    alignment_hold = 0.1;                       // [s] car speed is held after its latest sample
+    alignment_delay = 0.05;                     // [s] odometry waits for late samples of car speed
+}
+
+// parse profile file into parameters, return false on any unknown name or invalid value
+static bool read_parameters(const char* filename, Parameters& parameters, bool startup)
+{
+    FILE* file = fopen(filename, "r");
+    if (file == NULL)
+    {
+        ROS_WARN("cannot open parameter file %s", filename);
+        return false;
+    }
+
+    bool valid = true;
+    char line[256];
+    for (int number = 1; fgets(line, sizeof(line), file) != NULL; number++)
+    {
+        char* comment = strchr(line, '#');
+        if (comment != NULL)
+        {
+            *comment = '\0';
+        }
+        char name[64];
+        char value[64];
+        int fields = sscanf(line, " %63[a-z_0-9] : %63s", name, value);
+        if (fields <= 0)
+        {
+            continue;
+        }
+
+        char* end = NULL;
+        float number_value = (fields == 2) ? strtof(value, &end) : 0;
+        size_t i = 0;
+        while (i < parameter_count && strcmp(parameter_entries[i].name, name) != 0)
+        {
+            i++;
+        }
+        if (fields != 2 || *end != '\0' || !std::isfinite(number_value) || i == parameter_count)
+        {
+            ROS_WARN("invalid line %d in parameter file %s", number, filename);
+            valid = false;
+            continue;
+        }
+        if (!startup && !parameter_entries[i].reloadable)
+        {
+            if (parameters.*parameter_entries[i].member != number_value)
+            {
+                ROS_WARN("parameter %s is only loaded at startup, restart to change it", name);
+            }
+            continue;
+        }
+        parameters.*parameter_entries[i].member = number_value;
+    }
+    fclose(file);
+    return valid;
+}
+
+bool load_parameters(const char* filename)
+{
+    boost::mutex::scoped_lock lock(parameters_mutex);
+
+    const Parameters* current = parameters_snapshot.load(boost::memory_order_acquire);
+    Parameters* next = new Parameters(*current);
+    if (!read_parameters(filename, *next, !parameters_started))
+    {
+        delete next;
+        return false;
+    }
+
+    // readers hold references to a snapshot without any registration, so replaced
+    // snapshots are kept: a reload costs only the size of one snapshot
+    parameters_snapshot.store(next, boost::memory_order_release);
+    if (current != &parameters_default)
+    {
+        parameters_retired.push_back(current);
+    }
+    parameters_loaded++;
+    ROS_INFO("parameters loaded from %s (version %u)", filename, parameters_loaded);
+    if (!profile_matches<ActiveProfile>(*next))
+    {
+        ROS_WARN("%s differs from the vehicle profile of this build, the parking kernels keep it", filename);
+    }
+    return true;
+}
+
+unsigned parameters_version()
+{
+    boost::mutex::scoped_lock lock(parameters_mutex);
+    return parameters_loaded;
+}
+
+// modification of a file: an edit within the same second changes its nanoseconds or size
+struct FileVersion
+{
+    bool exists;
+    struct timespec modified;
+    off_t size;
+};
+
+static FileVersion file_version(const char* filename)
+{
+    FileVersion version = {false, {0, 0}, 0};
+    struct stat status;
+    if (stat(filename, &status) == 0)
+    {
+        version.exists = true;
+        version.modified = status.st_mtim;
+        version.size = status.st_size;
+    }
+    return version;
+}
+
+static bool same_version(const FileVersion& a, const FileVersion& b)
+{
+    return a.exists == b.exists && a.modified.tv_sec == b.modified.tv_sec && \
+    a.modified.tv_nsec == b.modified.tv_nsec && a.size == b.size;
+}
+
+// thread: reload profile file when its modification time or size changes
+static void poll_parameters(string filename, FileVersion loaded)
+{
+    while (true)
+    {
+        boost::this_thread::sleep_for(boost::chrono::milliseconds((int)(parameter_poll_period * 1000)));
+        FileVersion version = file_version(filename.c_str());
+        if (same_version(version, loaded))
+        {
+            continue;
+        }
+        loaded = version;
+        if (version.exists)
+        {
+            load_parameters(filename.c_str());
+        }
+        else
+        {
+            ROS_WARN("parameter file %s is removed, the loaded parameters are kept", filename.c_str());
+        }
+    }
+}
+
+// path of the profile: ~profile, else a relative filename is in the package directory,
+// the working directory of nodes under roslaunch is ~/.ros
+static string profile_path(const char* filename)
+{
+    string path;
+    if (ros::param::get("~profile", path) && !path.empty())
+    {
+        return path;
+    }
+    if (filename[0] == '/')
+    {
+        return filename;
+    }
+    string package = ros::package::getPath("autopark");
+    return package.empty() ? string(filename) : package + "/" + filename;
+}
+
+void watch_parameters(const char* filename)
+{
+    string path = profile_path(filename);
+    FileVersion version = file_version(path.c_str());
+    if (!version.exists)
+    {
+        ROS_ERROR("parameter file %s does not exist, the compiled vehicle profile is used", path.c_str());
+    }
+    else if (!load_parameters(path.c_str()))
+    {
+        ROS_ERROR("parameter file %s is invalid, the compiled vehicle profile is used", path.c_str());
+    }
+    {
+        boost::mutex::scoped_lock lock(parameters_mutex);
+        parameters_started = true;
+    }
+    boost::thread thread(poll_parameters, path, version);
+    thread.detach();
+}
@@ -8,40 +8,32 @@
  * 
  ******************************************************************/
 
+#include <boost/bind.hpp>
+
 #include "autopark/autoparking.h"
+#include "autopark/executor.h"
+#include "autopark/lifecycle.h"
 #include "autopark/parking_in.h"
 
 using namespace std;
 
-static bool parking_enable = false;         // flag of parking enable
 static bool trigger_check = false;          // flag to enable check function 
-static bool trigger_spinner = false;        // flag to enable spinners
-
-static bool parking_finished = false;       // flag of parking finished
-
-boost::shared_ptr<ros::AsyncSpinner> sp_spinner;   // create a shared_ptr for AsyncSpinner object
-
-
-// callback from global callback queue
-// callback of sub_parking_enable
-void callback_parking_enable(const std_msgs::Bool::ConstPtr& msg)
-{
-    ROS_INFO("call callback of parking_enable: %d", msg->data);
-    parking_enable = msg->data;
-}
 
 
 // CONSTRUCTOR: called when this object is created to set up subscribers and publishers
-ParkingIn::ParkingIn(ros::NodeHandle* nodehandle):nh_(*nodehandle)
+ParkingIn::ParkingIn(ros::NodeHandle* nodehandle):nh_(*nodehandle), searcher_(1), health_(nh_, msg_range_, &mutex_)
 {
     ROS_INFO("call constructor of ParkingIn");
 
-    sub_parking_space_ = nh_.subscribe<std_msgs::Header>("parking_space", 1, \
+    sub_parking_space_ = nh_.subscribe<autopark::ParkingSpace>("parking_space", 1, \
     &ParkingIn::callback_parking_space, this);
 
     sub_car_speed_ = nh_.subscribe<std_msgs::Float32>("car_speed", 1, \
     &ParkingIn::callback_car_speed, this);
 
+    sub_path_done_ = nh_.subscribe<std_msgs::Bool>("path_done", 1, \
+    &ParkingIn::callback_path_done, this);
+
     sub_apa_lf_ = nh_.subscribe<sensor_msgs::Range>("apa_lf", 1, \
     &ParkingIn::callback_apa_lf, this);
 
@@ -84,101 +76,317 @@ ParkingIn::ParkingIn(ros::NodeHandle* nodehandle):nh_(*nodehandle)
     sub_upa_br_ = nh_.subscribe<sensor_msgs::Range>("upa_br", 1, \
     &ParkingIn::callback_upa_br, this);
 
-    timer_ = nh_.createWallTimer(ros::WallDuration(parking_time), \
-    &ParkingIn::callback_timer, this);
+    // one shot timer of total parking time, started with parking in
+    timer_ = nh_.createWallTimer(ros::WallDuration(params().parking_time), \
+    &ParkingIn::callback_timer, this, true, false);
+
+    // timer to step the state machine of parking in
+    timer_control_ = nh_.createWallTimer(ros::WallDuration(1.0 / params().parking_control_rate), \
+    &ParkingIn::callback_control, this, false, false);
+
+    channel_move_.advertise(nh_, "cmd_move_maneuver", params().command_heartbeat);
+
+    channel_turn_.advertise(nh_, "cmd_turn_maneuver", params().command_heartbeat);
+    std_msgs::Char msg_turn_hold;
+    msg_turn_hold.data = TURN_HOLD;
+    channel_turn_.set_hold(msg_turn_hold);
 
-    pub_move_ = nh_.advertise<std_msgs::Float32>("cmd_move", 1);
+    pub_path_ = nh_.advertise<nav_msgs::Path>("parking_path", 1);
 
-    pub_turn_ = nh_.advertise<std_msgs::Char>("cmd_turn", 1);
+    pub_parking_in_done_ = nh_.advertise<std_msgs::Bool>("parking_in_done", 1);
+
+    // initialize:
+    path_done_ = false;
+    state_ = PARKING_IDLE;
+    moved_distance_ = 0;
+
+    // maneuvers are looked up in the precomputed table, or planned if it is missing
+    if (table_.open(maneuver_table_file))
+    {
+        ROS_INFO("maneuver table %s loaded", maneuver_table_file);
+    }
+    else
+    {
+        ROS_WARN("maneuver table %s not found, maneuvers are planned on line", maneuver_table_file);
+    }
+
+    // parking session is shared with parking out
+    if (!session_.open(session_store_file))
+    {
+        ROS_WARN("session store %s cannot be opened", session_store_file);
+    }
+
+    // Hybrid A* is needed only after searching: the node is ready before its heuristic
+    heuristic_ready_ = false;
+    search_running_ = false;
+    search_posted_ = 0;
+    search_finished_ = 0;
+    search_found_ = false;
+    heuristic_loader_ = boost::thread(&ParkingIn::load_heuristic, this);
 }
 
 // DESTRUCTOR: called when this object is deleted to release memory 
 ParkingIn::~ParkingIn(void)
 {
     ROS_INFO("call destructor of ParkingIn");
+    if (heuristic_loader_.joinable())
+    {
+        heuristic_loader_.join();
+    }
+    // a search running on searcher_ uses astar_
+    boost::mutex::scoped_lock lock(search_mutex_);
+    while (search_running_)
+    {
+        search_idle_.wait(lock);
+    }
 }
 
 // callbacks from custom callback queue
 // callback of sub_parking_space_
-void ParkingIn::callback_parking_space(const std_msgs::Header::ConstPtr& msg)
+void ParkingIn::callback_parking_space(const autopark::ParkingSpace::ConstPtr& msg)
+{
+    ROS_INFO("call callback of parking_space: %d", msg->type);
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_parking_space_ = *msg;
+
+    // start parking in, or re-plan with the new parking space during parking in
+    start_parking();
+}
+
+// callback of sub_car_speed_
+void ParkingIn::callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
+{
+    ROS_INFO("call callback of car_speed: speed=%f", msg->data);
+    msg_car_speed_.data = msg->data;
+}
+
+// callback of sub_path_done_
+void ParkingIn::callback_path_done(const std_msgs::Bool::ConstPtr& msg)
+{
+    ROS_INFO("call callback of path_done: %d", msg->data);
+    path_done_ = msg->data;
+}
+
+// callback of timer: parking should be finished in a certain time
+void ParkingIn::callback_timer(const ros::WallTimerEvent& event)
+{
+    ROS_INFO("timer of %f[s] is triggered", params().parking_time);
+    boost::mutex::scoped_lock lock(mutex_);
+
+    // here can ask the driver if continue parking, otherwise stop:
+    // the car stays in place and the driver takes over
+    if (parking_active())
+    {
+        ROS_WARN("parking in timed out");
+        stop_parking(PARKING_ABORTED);
+    }
+}
+
+// callback of control timer: one step of the state machine, no callback of the
+// custom callback queue is blocked by a maneuver
+void ParkingIn::callback_control(const ros::WallTimerEvent& event)
+{
+    boost::mutex::scoped_lock lock(mutex_);
+
+    record_trajectory();
+
+    switch (state_)
+    {
+    case PARKING_MOVE_BEFORE:
+        // move forward before perpendicular parking in
+        if (move_before_parking(params().move_distance_perpendicular))
+        {
+            start_perpendicular();
+        }
+        break;
+
+    case PARKING_TURN_IN:
+    case PARKING_ALIGN:
+        if (msg_parking_space_.type == SPACE_LEFT_PERPENDICULAR)
+        {
+            parking_perpendicular<SIDE_LEFT>();
+        }
+        else
+        {
+            parking_perpendicular<SIDE_RIGHT>();
+        }
+        break;
+
+    case PARKING_SEARCH_PATH:
+    {
+        // search of Hybrid A* is finished: follow the path, or move forward and park in with sensors
+        std::vector<PathSegment> segments;
+        bool found;
+        {
+            boost::mutex::scoped_lock lock_search(search_mutex_);
+            if (search_finished_ != search_posted_)
+            {
+                break;
+            }
+            found = search_found_;
+            segments.swap(search_segments_);
+        }
+        if (found)
+        {
+            follow_path(segments);
+        }
+        else
+        {
+            ROS_WARN("no path found into parking space");
+            start_move_before();
+        }
+        break;
+    }
+
+    case PARKING_FOLLOW_PATH:
+        // end of path is reached
+        if (path_done_)
+        {
+            stop_parking(PARKING_FINISHED);
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    // publish changed commands, repeat them while the car is moved with sensors
+    flush_commands(parking_active() && state_ != PARKING_FOLLOW_PATH);
+}
+
+
+// *****************************************************
+// functions of the state machine
+// *****************************************************
+// start parking into msg_parking_space_: follow a planned path, or park in with sensors
+void ParkingIn::start_parking()
 {
-    ROS_INFO("call callback of parking_space: %d", msg->seq);
-    msg_parking_space_.seq = msg->seq;
+    // the total time of parking is counted from the first parking space
+    if (!parking_active())
+    {
+        timer_.stop();
+        timer_.start();
 
-    // check parking space and park in
-    switch (msg_parking_space_.seq)
+        channel_move_.reset();
+        channel_turn_.reset();
+
+        // the trajectory is recorded from the first parking space, an old one is invalid
+        trajectory_.clear();
+        remove(trajectory_cache_file);
+        record_trajectory();
+    }
+
+    switch (msg_parking_space_.type)
     {
     case SPACE_LEFT_PERPENDICULAR:
         ROS_INFO("parking_left_perpendicular start");
-        // move forward before perpendicular parking in
-        move_before_parking(move_distance_perpendicular);
-        // perpendicular parking on the left side
-        parking_left_perpendicular();
+        // follow planned path, or move forward and park in with sensors
+        if (!parking_planned())
+        {
+            start_move_before();
+        }
         break;
 
     case SPACE_LEFT_PARALLEL:
         ROS_INFO("parking_left_parallel start");
         // parallel parking on the left side
-        parking_left_parallel();
+        if (!parking_planned())
+        {
+            // no path: stop and wait for the next parking space
+            stop_parking(PARKING_IDLE);
+            return;
+        }
         break;
 
     case SPACE_RIGHT_PERPENDICULAR:
         ROS_INFO("parking_right_perpendicular start");
-        // move forward before perpendicular parking in
-        move_before_parking(move_distance_perpendicular);
-        // perpendicular parking on the right side
-        parking_right_perpendicular();
+        // follow planned path, or move forward and park in with sensors
+        if (!parking_planned())
+        {
+            start_move_before();
+        }
         break;
 
     case SPACE_RIGHT_PARALLEL:
         ROS_INFO("parking_right_parallel start");
         // parallel parking on the right side
-        parking_right_parallel();
+        if (!parking_planned())
+        {
+            // no path: stop and wait for the next parking space
+            stop_parking(PARKING_IDLE);
+            return;
+        }
         break;
 
     default:
-        break;
+        return;
     }
 
-    if (parking_finished)
-    {
-        ROS_INFO("parking in finished");
-
-        // save the parking space for parking out
-        parking_space = msg_parking_space_.seq;
-
-        // reset
-        parking_enable = false;
-        trigger_spinner = false;
-        parking_finished = false;
+    timer_control_.start();
+}
 
-        // stop spinners for custom callback queue
-        sp_spinner->stop();
-        ROS_INFO("spinners stop");
-    }
+// move forward before perpendicular parking in with sensors
+void ParkingIn::start_move_before()
+{
+    moved_distance_ = 0;
+    move_begin_ = ros::Time::now();
+    move_last_ = move_begin_;
+    state_ = PARKING_MOVE_BEFORE;
 }
 
-// callback of sub_car_speed_
-void ParkingIn::callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
+// cancel parking in, e.g. when parking is disabled: stop at once
+void ParkingIn::cancel_parking()
 {
-    ROS_INFO("call callback of car_speed: speed=%f", msg->data);
-    msg_car_speed_.data = msg->data;
+    boost::mutex::scoped_lock lock(mutex_);
+    if (parking_active())
+    {
+        ROS_WARN("parking in canceled");
+        stop_parking(PARKING_ABORTED);
+    }
+    state_ = PARKING_IDLE;
 }
 
-// callback of timer: parking should be finished in a certain time
-void ParkingIn::callback_timer(const ros::WallTimerEvent& event)
+// stop car and timers, leave the state machine in state PARKING_IDLE, PARKING_FINISHED or PARKING_ABORTED
+void ParkingIn::stop_parking(ParkingInState state)
 {
-    ROS_INFO("timer of %f[s] is triggered", parking_time);
+    // stop
+    msg_cmd_move_.data = 0;
+    command_move();
+    flush_commands(false);
+    ROS_INFO("commands published: move %lu, turn %lu; suppressed: move %lu, turn %lu", \
+    (unsigned long)channel_move_.published(), (unsigned long)channel_turn_.published(), \
+    (unsigned long)channel_move_.suppressed(), (unsigned long)channel_turn_.suppressed());
+
+    // an empty path cancels path tracking
+    if (state_ == PARKING_FOLLOW_PATH && state != PARKING_FINISHED)
+    {
+        nav_msgs::Path msg_path;
+        msg_path.header.stamp = ros::Time::now();
+        msg_path.header.frame_id = "base_link";
+        pub_path_.publish(msg_path);
+    }
 
-    // here can ask the driver if quit parking:
-    /*
-    // do move back to the street and go on searching parking space
-    // stop spinners for custom callback queue
-    // sp_spinner->stop();
-    */
+    timer_.stop();
+    timer_control_.stop();
+    state_ = state;
 
-    // or continue parking:
-    /* do continue */
+    if (state == PARKING_FINISHED)
+    {
+        ROS_INFO("parking in finished");
+
+        // save the parking space for parking out
+        save_session();
+        save_trajectory();
+    }
+
+    // parking in is over: lifecycle_manager ends the stage park in, done if it is finished
+    // and failed if it is aborted
+    if (state != PARKING_IDLE)
+    {
+        std_msgs::Bool msg_done;
+        msg_done.data = (state == PARKING_FINISHED);
+        pub_parking_in_done_.publish(msg_done);
+    }
 }
 
 
@@ -186,1003 +394,662 @@ void ParkingIn::callback_timer(const ros::WallTimerEvent& event)
 void ParkingIn::callback_apa_lf(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_lf: range=%f", msg->range);
-    msg_apa_lf_.header.stamp = msg->header.stamp;
-    msg_apa_lf_.header.frame_id = msg->header.frame_id;
-    msg_apa_lf_.range = msg->range;
+    msg_range_[APA_LF].header.stamp = msg->header.stamp;
+    msg_range_[APA_LF].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_LF].range = health_.range(APA_LF, msg->range);
 }
 
 // callback of sub_apa_lb_
 void ParkingIn::callback_apa_lb(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_lb: range=%f", msg->range);
-    msg_apa_lb_.header.stamp = msg->header.stamp;
-    msg_apa_lb_.header.frame_id = msg->header.frame_id;
-    msg_apa_lb_.range = msg->range;
+    msg_range_[APA_LB].header.stamp = msg->header.stamp;
+    msg_range_[APA_LB].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_LB].range = health_.range(APA_LB, msg->range);
 }
 
 // callback of sub_apa_lb2_
 void ParkingIn::callback_apa_lb2(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_lb2: range=%f", msg->range);
-    msg_apa_lb2_.header.stamp = msg->header.stamp;
-    msg_apa_lb2_.header.frame_id = msg->header.frame_id;
-    msg_apa_lb2_.range = msg->range;
+    msg_range_[APA_LB2].header.stamp = msg->header.stamp;
+    msg_range_[APA_LB2].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_LB2].range = health_.range(APA_LB2, msg->range);
 }
 
 // callback of sub_apa_rf_
 void ParkingIn::callback_apa_rf(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_rf: range=%f", msg->range);
-    msg_apa_rf_.header.stamp = msg->header.stamp;
-    msg_apa_rf_.header.frame_id = msg->header.frame_id;
-    msg_apa_rf_.range = msg->range;
+    msg_range_[APA_RF].header.stamp = msg->header.stamp;
+    msg_range_[APA_RF].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_RF].range = health_.range(APA_RF, msg->range);
 }
 
 // callback of sub_apa_rb_
 void ParkingIn::callback_apa_rb(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_rb: range=%f", msg->range);
-    msg_apa_rb_.header.stamp = msg->header.stamp;
-    msg_apa_rb_.header.frame_id = msg->header.frame_id;
-    msg_apa_rb_.range = msg->range;
+    msg_range_[APA_RB].header.stamp = msg->header.stamp;
+    msg_range_[APA_RB].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_RB].range = health_.range(APA_RB, msg->range);
 }
 
 // callback of sub_apa_rb2_
 void ParkingIn::callback_apa_rb2(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_rb2: range=%f", msg->range);
-    msg_apa_rb2_.header.stamp = msg->header.stamp;
-    msg_apa_rb2_.header.frame_id = msg->header.frame_id;
-    msg_apa_rb2_.range = msg->range;
+    msg_range_[APA_RB2].header.stamp = msg->header.stamp;
+    msg_range_[APA_RB2].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_RB2].range = health_.range(APA_RB2, msg->range);
 }
 
 // callback of sub_upa_fl_
 void ParkingIn::callback_upa_fl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fl: range=%f", msg->range);
-    msg_upa_fl_.header.stamp = msg->header.stamp;
-    msg_upa_fl_.header.frame_id = msg->header.frame_id;
-    msg_upa_fl_.range = msg->range;
+    msg_range_[UPA_FL].header.stamp = msg->header.stamp;
+    msg_range_[UPA_FL].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_FL].range = health_.range(UPA_FL, msg->range);
 }
 
 // callback of sub_upa_fcl_
 void ParkingIn::callback_upa_fcl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fcl: range=%f", msg->range);
-    msg_upa_fcl_.header.stamp = msg->header.stamp;
-    msg_upa_fcl_.header.frame_id = msg->header.frame_id;
-    msg_upa_fcl_.range = msg->range;
+    msg_range_[UPA_FCL].header.stamp = msg->header.stamp;
+    msg_range_[UPA_FCL].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_FCL].range = health_.range(UPA_FCL, msg->range);
 }
 
 // callback of sub_upa_fcr_
 void ParkingIn::callback_upa_fcr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fcr: range=%f", msg->range);
-    msg_upa_fcr_.header.stamp = msg->header.stamp;
-    msg_upa_fcr_.header.frame_id = msg->header.frame_id;
-    msg_upa_fcr_.range = msg->range;
+    msg_range_[UPA_FCR].header.stamp = msg->header.stamp;
+    msg_range_[UPA_FCR].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_FCR].range = health_.range(UPA_FCR, msg->range);
 }
 
 // callback of sub_upa_fr_
 void ParkingIn::callback_upa_fr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fr: range=%f", msg->range);
-    msg_upa_fr_.header.stamp = msg->header.stamp;
-    msg_upa_fr_.header.frame_id = msg->header.frame_id;
-    msg_upa_fr_.range = msg->range;
+    msg_range_[UPA_FR].header.stamp = msg->header.stamp;
+    msg_range_[UPA_FR].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_FR].range = health_.range(UPA_FR, msg->range);
 }
 
 // callback of sub_upa_bl_
 void ParkingIn::callback_upa_bl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bl: range=%f", msg->range);
-    msg_upa_bl_.header.stamp = msg->header.stamp;
-    msg_upa_bl_.header.frame_id = msg->header.frame_id;
-    msg_upa_bl_.range = msg->range;
+    msg_range_[UPA_BL].header.stamp = msg->header.stamp;
+    msg_range_[UPA_BL].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_BL].range = health_.range(UPA_BL, msg->range);
 }
 
 // callback of sub_upa_bcl_
 void ParkingIn::callback_upa_bcl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bcl: range=%f", msg->range);
-    msg_upa_bcl_.header.stamp = msg->header.stamp;
-    msg_upa_bcl_.header.frame_id = msg->header.frame_id;
-    msg_upa_bcl_.range = msg->range;
+    msg_range_[UPA_BCL].header.stamp = msg->header.stamp;
+    msg_range_[UPA_BCL].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_BCL].range = health_.range(UPA_BCL, msg->range);
 }
 
 // callback of sub_upa_bcr_
 void ParkingIn::callback_upa_bcr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bcr: range=%f", msg->range);
-    msg_upa_bcr_.header.stamp = msg->header.stamp;
-    msg_upa_bcr_.header.frame_id = msg->header.frame_id;
-    msg_upa_bcr_.range = msg->range;
+    msg_range_[UPA_BCR].header.stamp = msg->header.stamp;
+    msg_range_[UPA_BCR].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_BCR].range = health_.range(UPA_BCR, msg->range);
 }
 
 // callback of sub_upa_br_
 void ParkingIn::callback_upa_br(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_br: range=%f", msg->range);
-    msg_upa_br_.header.stamp = msg->header.stamp;
-    msg_upa_br_.header.frame_id = msg->header.frame_id;
-    msg_upa_br_.range = msg->range;
+    msg_range_[UPA_BR].header.stamp = msg->header.stamp;
+    msg_range_[UPA_BR].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_BR].range = health_.range(UPA_BR, msg->range);
+}
+
+
+// functions of commands: set during a step, published by flush_commands only if changed
+void ParkingIn::command_move()
+{
+    channel_move_.set(msg_cmd_move_);
+}
+
+void ParkingIn::command_turn()
+{
+    // a little left or right is a step of steering angle, it is published each time
+    channel_turn_.set(msg_cmd_turn_, msg_cmd_turn_.data == 'l' || msg_cmd_turn_.data == 'r');
+}
+
+// heartbeat: repeat unchanged commands to keep their lease in controller_arbiter
+void ParkingIn::flush_commands(bool heartbeat)
+{
+    channel_move_.flush(heartbeat);
+    channel_turn_.flush(heartbeat);
 }
 
+// function of recording the executed trajectory from odometry
+void ParkingIn::record_trajectory()
+{
+    // odometry may start after this node
+    if (!odometry_.is_open() && !odometry_.open(odometry_shm_name))
+    {
+        return;
+    }
+    OdometrySample sample;
+    if (odometry_.latest(sample))
+    {
+        trajectory_.record(sample, params().path_sample_step);
+    }
+}
 
-// function of moving a given distance
-void ParkingIn::move_before_parking(float move_distance)
+// function of saving the executed trajectory and the ranges at the end for parking out
+void ParkingIn::save_trajectory()
 {
-    static double moved_distance = 0;
-    static ros::Time move_start, move_end;
-    static double move_duration;
-    move_start = ros::Time::now();
-    msg_cmd_move_.data = speed_parking_forward;
+    OdometrySample end;
+    if (trajectory_.recorded() == 0 || !odometry_.latest(end))
+    {
+        ROS_WARN("no trajectory of parking in is recorded");
+        return;
+    }
+
+    float range[RANGE_SENSORS];
+    for (int i = 0; i < RANGE_SENSORS; ++i)
+    {
+        range[i] = msg_range_[i].range;
+    }
+    if (!trajectory_.save(trajectory_cache_file, msg_parking_space_.type, end, range))
+    {
+        ROS_WARN("failed to save trajectory of parking in to %s", trajectory_cache_file);
+    }
+}
+
+// function of saving the parking space and the final pose to the session store
+void ParkingIn::save_session()
+{
+    ParkingSession session;
+    memset(&session, 0, sizeof(session));
+    session.state = SESSION_PARKED;
+    session.type = msg_parking_space_.type;
+    session.width = msg_parking_space_.width;
+    session.length = msg_parking_space_.length;
+    session.distance = msg_parking_space_.distance;
+    session.stamp = ros::Time::now().toSec();
+
+    OdometrySample end;
+    if (odometry_.is_open() && odometry_.latest(end))
+    {
+        session.x = end.x;
+        session.y = end.y;
+        session.yaw = end.yaw;
+        session.odometer = end.odometer;
+    }
+    if (!session_.store(session))
+    {
+        ROS_WARN("failed to save parking session to %s", session_store_file);
+    }
+}
+
+// function of driven distance between two time stamps from shared memory of odometry
+bool ParkingIn::driven_distance(const ros::Time& begin, const ros::Time& end, double& distance)
+{
+    // odometry may start after this node
+    if (!odometry_.is_open() && !odometry_.open(odometry_shm_name))
+    {
+        return false;
+    }
+    return odometry_.distance(begin.toSec(), end.toSec(), distance);
+}
+
+// function of the pose of the car at end in the car frame at begin, from shared memory of odometry
+bool ParkingIn::moved_pose(const ros::Time& begin, const ros::Time& end, CarPose& pose)
+{
+    OdometrySample from, to;
+    if ((!odometry_.is_open() && !odometry_.open(odometry_shm_name)) || \
+    !odometry_.at(begin.toSec(), from) || !odometry_.at(end.toSec(), to))
+    {
+        return false;
+    }
+    double dx = to.x - from.x, dy = to.y - from.y;
+    pose.x = cos(from.yaw) * dx + sin(from.yaw) * dy;
+    pose.y = -sin(from.yaw) * dx + cos(from.yaw) * dy;
+    pose.yaw = normalize_angle(to.yaw - from.yaw);
+    return true;
+}
+
+// function of moving a given distance: one step, return true when the distance is reached
+bool ParkingIn::move_before_parking(float move_distance)
+{
+    // moved distance from odometry, or integrated car speed if odometry is not running
+    ros::Time move_now = ros::Time::now();
+    if (!driven_distance(move_begin_, move_now, moved_distance_))
+    {
+        moved_distance_ += msg_car_speed_.data * (move_now - move_last_).toSec();
+    }
+    move_last_ = move_now;
+
     // move forward with speed_parking_forward until move_distance is reached
-    while (moved_distance < move_distance)
+    if (moved_distance_ < move_distance)
     {
-        pub_move_.publish(msg_cmd_move_);
-        ros::Duration(0.01).sleep();
-        move_end = ros::Time::now();
-        move_duration = (move_end - move_start).toSec();
-        moved_distance += msg_car_speed_.data * move_duration;
-        move_start = move_end;
+        msg_cmd_move_.data = params().speed_parking_forward;
+        command_move();
+        return false;
     }
 
     // stop
     msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
+    command_move();
+    return true;
 }
 
-
-// *****************************************************
-// function of perpendicular parking on the left side
-// *****************************************************
-void ParkingIn::parking_left_perpendicular()
+// function of starting perpendicular parking: turn full to the parking space and move backward
+void ParkingIn::start_perpendicular()
 {
     // stop
     msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
-    // turn full right
-    msg_cmd_turn_.data = 'L';
-    pub_turn_.publish(msg_cmd_turn_);
+    command_move();
+    // turn full left or right
+    msg_cmd_turn_.data = (msg_parking_space_.type == SPACE_LEFT_PERPENDICULAR) ? 'L' : 'R';
+    command_turn();
     // move backward with speed_parking_backward
-    msg_cmd_move_.data = speed_parking_backward;
-    pub_move_.publish(msg_cmd_move_);
+    msg_cmd_move_.data = params().speed_parking_backward;
+    command_move();
 
-    ros::Rate looprate(20);
+    state_ = PARKING_TURN_IN;
+}
 
-    // check and change car posture with a rate 20Hz until car rear is in parking space
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
 
+// *****************************************************
+// function of perpendicular parking, mirrored for the left and right side by SideTraits
+// *****************************************************
+template <ParkingSide side>
+void ParkingIn::parking_perpendicular()
+{
+    typedef SideTraits<side> Side;
+
+    // hold move and turn commands, they are published at the end of the step if changed
+    command_move();
+    command_turn();
+
+    // check and change car posture in each step until car rear is in parking space
+    if (state_ == PARKING_TURN_IN)
+    {
         // car rear is already in parking space
-        if (msg_apa_lb_.range < parking_distance_max && msg_apa_rb_.range < parking_distance_max)
+        if (msg_range_[Side::apa_back].range < params().parking_distance_max && \
+        msg_range_[Side::apa_back_other].range < params().parking_distance_max)
         {
-            break;      // break this loop
+            // align car in next steps
+            state_ = PARKING_ALIGN;
         }
         // car rear is still out of parking space
         else
         {
-            // car is too close to the parkwall (car) on the left side
-            if (msg_apa_lb_.range < parking_distance_min || msg_upa_bl_.range < parking_distance_min)
+            // car is too close to the parkwall (car) on the parking side
+            if (msg_range_[Side::apa_back].range < params().parking_distance_min || \
+            msg_range_[Side::upa_back].range < params().parking_distance_min)
             {
                 // turn straight
                 msg_cmd_turn_.data = 'D';
-                pub_turn_.publish(msg_cmd_turn_);
+                command_turn();
             }
             else
             {
-                // keep turnning full left
-                msg_cmd_turn_.data = 'L';
-                pub_turn_.publish(msg_cmd_turn_);
+                // keep turnning full to the parking side
+                msg_cmd_turn_.data = Side::turn_full;
+                command_turn();
             }
         }
-
-        looprate.sleep();
+        return;
     }
 
-    // check and change car posture with a rate 20Hz until parking is finished
-    while (ros::ok())
+    // check and change car posture in each step until parking is finished
+    // car is parallel to the parkwall (car)
+    if (fabs(msg_range_[Side::apa_back].range - msg_range_[Side::apa_back2].range) <= params().apa_tolerance)
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car is parallel to the left parkwall (car)
-        if (fabs(msg_apa_lb_.range - msg_apa_lb2_.range) <= apa_tolerance)
+        // turn straight
+        msg_cmd_turn_.data = 'D';
+        command_turn();
+        // keep moving backward with speed_parking_backward
+        msg_cmd_move_.data = params().speed_parking_backward;
+        command_move();
+
+        // car rear is close to the back parkwall, parking finish
+        if (min(msg_range_[Side::upa_back_center].range, msg_range_[Side::upa_back_center_other].range) < \
+        params().parking_distance_min)
         {
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-            // keep moving backward with speed_parking_backward
-            msg_cmd_move_.data = speed_parking_backward;
-            pub_move_.publish(msg_cmd_move_);
-
-            // car rear is close to the back parkwall, parking finish
-            if (min(msg_upa_bcl_.range, msg_upa_bcr_.range) < parking_distance_min)
-            {
-                // stop
-                msg_cmd_move_.data = 0;
-                pub_move_.publish(msg_cmd_move_);
-
-                parking_finished = true;     // parking finished!
-                break;      // break this loop
-            }
+            // stop, parking finished!
+            stop_parking(PARKING_FINISHED);
+            return;
         }
-        // car is not parallel to the right parkwall (car)
-        else
+    }
+    // car is not parallel to the parkwall (car)
+    else
+    {
+        // car moves forward
+        if (msg_car_speed_.data > 0)
         {
-            // car moves forward
-            if (msg_car_speed_.data > 0)
+            // car head is closer to the parkwall on the parking side (car) than car rear
+            if ((msg_range_[Side::apa_back].range - msg_range_[Side::apa_back2].range) > params().apa_tolerance)
             {
-                // car head is closer to the left parkwall (car) than car rear
-                if ((msg_apa_lb_.range - msg_apa_lb2_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'R')
-                    {
-                        // turn a little right
-                        msg_cmd_turn_.data = 'r';
-                    }
-                }
-                // car rear is closer to the left parkwall (car) than car head
-                else if ((msg_apa_lb2_.range - msg_apa_lb_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'L')
-                    {
-                        // turn a little left
-                        msg_cmd_turn_.data = 'l';
-                    }
-                }
-                else
-                {
-                    // do nothing
-                }
-
-                // car head is too close to the left parkwall (car)
-                if (msg_apa_lf_.range < parking_distance_min)
+                if (msg_cmd_turn_.data != Side::turn_full_other)
                 {
-                    // keep the steering full right
-                    msg_cmd_turn_.data = 'R';
-                    pub_turn_.publish(msg_cmd_turn_);
-                }
-                // car head is too close to the right parkwall (car)
-                if (msg_apa_rf_.range < parking_distance_min)
-                {
-                    // keep the steering full left
-                    msg_cmd_turn_.data = 'L';
-                    pub_turn_.publish(msg_cmd_turn_);
-                }
-
-                // car is getting out of parking space
-                if ((msg_cmd_turn_.data == 'R' && msg_apa_lb_.range > parking_distance_max) \
-                || (msg_cmd_turn_.data == 'L' && msg_apa_rb_.range > parking_distance_max))
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn straight
-                    msg_cmd_turn_.data = 'D';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move backward
-                    msg_cmd_move_.data = speed_parking_backward;
-                    pub_move_.publish(msg_cmd_move_);
+                    // turn a little to the other side
+                    msg_cmd_turn_.data = Side::turn_step_other;
                 }
             }
-            // car moves backward
-            if (msg_car_speed_.data < 0)
+            // car rear is closer to the parkwall on the parking side (car) than car head
+            else if ((msg_range_[Side::apa_back2].range - msg_range_[Side::apa_back].range) > params().apa_tolerance)
             {
-                // car head is closer to the left parkwall (car) than car rear
-                if ((msg_apa_lb_.range - msg_apa_lb2_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'L')
-                    {
-                        // turn a little left
-                        msg_cmd_turn_.data = 'l';
-                    }
-                }
-                // car rear is closer to the left parkwall (car) than car head
-                else if ((msg_apa_lb2_.range - msg_apa_lb_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'R')
-                    {
-                        // turn a little right
-                        msg_cmd_turn_.data = 'r';
-                    }
-                }
-                else
+                if (msg_cmd_turn_.data != Side::turn_full)
                 {
-                    // do nothing
-                }
-
-                // car rear is too close to the left parkwall (car)
-                if (msg_apa_lb_.range < parking_distance_min)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn full left
-                    msg_cmd_turn_.data = 'L';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move forward
-                    msg_cmd_move_.data = speed_parking_forward;
-                    pub_move_.publish(msg_cmd_move_);
-                }
-                // car rear is too close to the right parkwall (car)
-                if (msg_apa_rf_.range < parking_distance_min)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // keep the steering full right
-                    msg_cmd_turn_.data = 'R';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move forward
-                    msg_cmd_move_.data = speed_parking_forward;
-                    pub_move_.publish(msg_cmd_move_);
+                    // turn a little to the parking side
+                    msg_cmd_turn_.data = Side::turn_step;
                 }
             }
-            // car stops
             else
             {
                 // do nothing
             }
-        }
-
-        looprate.sleep();
-    }
-} 
 
-
-// *****************************************************
-// function of perpendicular parking on the right side
-// *****************************************************
-void ParkingIn::parking_right_perpendicular()
-{
-    // stop
-    msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
-    // turn full right
-    msg_cmd_turn_.data = 'R';
-    pub_turn_.publish(msg_cmd_turn_);
-    // move backward with speed_parking_backward
-    msg_cmd_move_.data = speed_parking_backward;
-    pub_move_.publish(msg_cmd_move_);
-
-    ros::Rate looprate(20);
-
-    // check and change car posture with a rate 20Hz until car rear is in parking space
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car rear is already in parking space
-        if (msg_apa_lb_.range < parking_distance_max && msg_apa_rb_.range < parking_distance_max)
-        {
-            break;      // break this loop
-        }
-        // car rear is still out of parking space
-        else
-        {
-            // car is too close to the parkwall (car) on the right side
-            if (msg_apa_rb_.range < parking_distance_min || msg_upa_br_.range < parking_distance_min)
+            // car head is too close to the parkwall on the parking side (car)
+            if (msg_range_[Side::apa_front].range < params().parking_distance_min)
             {
-                // turn straight
-                msg_cmd_turn_.data = 'D';
-                pub_turn_.publish(msg_cmd_turn_);
+                // keep the steering full to the other side
+                msg_cmd_turn_.data = Side::turn_full_other;
+                command_turn();
             }
-            else
+            // car head is too close to the parkwall on the other side (car)
+            if (msg_range_[Side::apa_front_other].range < params().parking_distance_min)
             {
-                // keep turnning full right
-                msg_cmd_turn_.data = 'R';
-                pub_turn_.publish(msg_cmd_turn_);
+                // keep the steering full to the parking side
+                msg_cmd_turn_.data = Side::turn_full;
+                command_turn();
             }
-        }
-
-        looprate.sleep();
-    }
-
-    // check and change car posture with a rate 20Hz until parking is finished
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
 
-        // car is parallel to the right parkwall (car)
-        if (fabs(msg_apa_rb_.range - msg_apa_rb2_.range) <= apa_tolerance)
-        {
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-            // keep moving backward with speed_parking_backward
-            msg_cmd_move_.data = speed_parking_backward;
-            pub_move_.publish(msg_cmd_move_);
-
-            // car rear is close to the back parkwall, parking finish
-            if (min(msg_upa_bcl_.range, msg_upa_bcr_.range) < parking_distance_min)
+            // car is getting out of parking space
+            if ((msg_cmd_turn_.data == Side::turn_full_other && \
+            msg_range_[Side::apa_back].range > params().parking_distance_max) || \
+            (msg_cmd_turn_.data == Side::turn_full && msg_range_[Side::apa_back_other].range > params().parking_distance_max))
             {
                 // stop
                 msg_cmd_move_.data = 0;
-                pub_move_.publish(msg_cmd_move_);
-
-                parking_finished = true;     // parking finished!
-                break;      // break this loop
+                command_move();
+                // turn straight
+                msg_cmd_turn_.data = 'D';
+                command_turn();
+                // move backward
+                msg_cmd_move_.data = params().speed_parking_backward;
+                command_move();
             }
         }
-        // car is not parallel to the right parkwall (car)
-        else
+        // car moves backward
+        if (msg_car_speed_.data < 0)
         {
-            // car moves forward
-            if (msg_car_speed_.data > 0)
+            // car head is closer to the parkwall on the parking side (car) than car rear
+            if ((msg_range_[Side::apa_back].range - msg_range_[Side::apa_back2].range) > params().apa_tolerance)
             {
-                // car head is closer to the right parkwall (car) than car rear
-                if ((msg_apa_rb_.range - msg_apa_rb2_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'L')
-                    {
-                        // turn a little left
-                        msg_cmd_turn_.data = 'l';
-                    }
-                }
-                // car rear is closer to the right parkwall (car) than car head
-                else if ((msg_apa_rb2_.range - msg_apa_rb_.range) > apa_tolerance)
+                if (msg_cmd_turn_.data != Side::turn_full)
                 {
-                    if (msg_cmd_turn_.data != 'R')
-                    {
-                        // turn a little right
-                        msg_cmd_turn_.data = 'r';
-                    }
-                }
-                else
-                {
-                    // do nothing
-                }
-
-                // car head is too close to the right parkwall (car)
-                if (msg_apa_rf_.range < parking_distance_min)
-                {
-                    // keep the steering full left
-                    msg_cmd_turn_.data = 'L';
-                    pub_turn_.publish(msg_cmd_turn_);
-                }
-                // car head is too close to the left parkwall (car)
-                if (msg_apa_lf_.range < parking_distance_min)
-                {
-                    // keep the steering full right
-                    msg_cmd_turn_.data = 'R';
-                    pub_turn_.publish(msg_cmd_turn_);
-                }
-
-                // car is getting out of parking space
-                if ((msg_cmd_turn_.data == 'R' && msg_apa_lb_.range > parking_distance_max) \
-                || (msg_cmd_turn_.data == 'L' && msg_apa_rb_.range > parking_distance_max))
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn straight
-                    msg_cmd_turn_.data = 'D';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move backward
-                    msg_cmd_move_.data = speed_parking_backward;
-                    pub_move_.publish(msg_cmd_move_);
+                    // turn a little to the parking side
+                    msg_cmd_turn_.data = Side::turn_step;
                 }
             }
-            // car moves backward
-            if (msg_car_speed_.data < 0)
+            // car rear is closer to the parkwall on the parking side (car) than car head
+            else if ((msg_range_[Side::apa_back2].range - msg_range_[Side::apa_back].range) > params().apa_tolerance)
             {
-                // car head is closer to the right parkwall (car) than car rear
-                if ((msg_apa_rb_.range - msg_apa_rb2_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'R')
-                    {
-                        // turn a little right
-                        msg_cmd_turn_.data = 'r';
-                    }
-                }
-                // car rear is closer to the right parkwall (car) than car head
-                else if ((msg_apa_rb2_.range - msg_apa_rb_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'L')
-                    {
-                        // turn a little left
-                        msg_cmd_turn_.data = 'l';
-                    }
-                }
-                else
-                {
-                    // do nothing
-                }
-
-                // car rear is too close to the right parkwall (car)
-                if (msg_apa_rb_.range < parking_distance_min)
+                if (msg_cmd_turn_.data != Side::turn_full_other)
                 {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn full right
-                    msg_cmd_turn_.data = 'R';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move forward
-                    msg_cmd_move_.data = speed_parking_forward;
-                    pub_move_.publish(msg_cmd_move_);
-                }
-                // car rear is too close to the left parkwall (car)
-                if (msg_apa_lf_.range < parking_distance_min)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // keep the steering full left
-                    msg_cmd_turn_.data = 'L';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move forward
-                    msg_cmd_move_.data = speed_parking_forward;
-                    pub_move_.publish(msg_cmd_move_);
+                    // turn a little to the other side
+                    msg_cmd_turn_.data = Side::turn_step_other;
                 }
             }
-            // car stops
             else
             {
                 // do nothing
             }
-        }
-
-        looprate.sleep();
-    }
-}
-
-
-// *****************************************************
-// function of parallel parking on the left side
-// *****************************************************
-void ParkingIn::parking_left_parallel()
-{
-    // stop
-    msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
-    // turn full left
-    msg_cmd_turn_.data = 'L';
-    pub_turn_.publish(msg_cmd_turn_);
-    // move backward with speed_parking_backward
-    msg_cmd_move_.data = speed_parking_backward;
-    pub_move_.publish(msg_cmd_move_);
-
-    ros::Rate looprate(20);
-
-    // check and change car posture with a rate of 20Hz until car rear is in parking space
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car rear is already in parking space
-        // (sensor upa_bcl is in the middle of the parking space)
-        if (msg_upa_bcl_.range < parallel_length/2)
-        {
-            // turn full right
-            msg_cmd_turn_.data = 'R';
-            pub_turn_.publish(msg_cmd_turn_);
-
-            break;      // break this loop
-        }
-        // car rear is reaching parking space
-        // (the actuall angle between car and parking space depends on the starting distance)
-        else if (msg_upa_bcr_.range < parallel_length)
-        {
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-        }
-        else
-        {
-            // do nothing
-        }
-
-        looprate.sleep();
-    }
 
-    // check and change car posture with a rate of 20Hz until parking is finished
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car is parallel to the parkwall on the left side
-        if (fabs(msg_apa_lb_.range - msg_apa_lb2_.range) <= apa_tolerance)
-        {
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-            // keep moving forward with speed_parking_forward
-            msg_cmd_move_.data = speed_parking_forward;
-            pub_move_.publish(msg_cmd_move_);
-
-            // car is close to parkwall (car) at front
-            if (min(msg_upa_fcl_.range, msg_upa_fcr_.range) < parking_distance_min)
+            // car rear is too close to the parkwall on the parking side (car)
+            if (msg_range_[Side::apa_back].range < params().parking_distance_min)
             {
                 // stop
                 msg_cmd_move_.data = 0;
-                pub_move_.publish(msg_cmd_move_);
-
-                parking_finished = true;     // parking finished!
-                break;      // break this loop
+                command_move();
+                // turn full to the parking side
+                msg_cmd_turn_.data = Side::turn_full;
+                command_turn();
+                // move forward
+                msg_cmd_move_.data = params().speed_parking_forward;
+                command_move();
+            }
+            // car rear is too close to the parkwall on the other side (car)
+            if (msg_range_[Side::apa_front_other].range < params().parking_distance_min)
+            {
+                // stop
+                msg_cmd_move_.data = 0;
+                command_move();
+                // keep the steering full to the other side
+                msg_cmd_turn_.data = Side::turn_full_other;
+                command_turn();
+                // move forward
+                msg_cmd_move_.data = params().speed_parking_forward;
+                command_move();
             }
         }
-        // car is not parallel to the parkwall on the left side
+        // car stops
         else
         {
-            // car moves forard
-            if (msg_car_speed_.data > 0)
-            {
-                // car head is closer to the left parkwall (car) than car rear
-                if ((msg_apa_lb_.range - msg_apa_lb2_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'R')
-                    {
-                        // turn a little right
-                        msg_cmd_turn_.data = 'r';
-                    }
-                }
-                // car rear is closer to the left parkwall (car) than car head
-                else if ((msg_apa_lb2_.range - msg_apa_lb_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'L')
-                    {
-                        // turn a little left
-                        msg_cmd_turn_.data = 'l';
-                    }
-                }
-                else
-                {
-                    // do nothing
-                }
-
-                // car head is too close to parkwall (car)
-                if (min(msg_apa_lf_.range, msg_upa_fl_.range) < parking_distance_min)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn full right
-                    msg_cmd_turn_.data = 'R';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move backward with speed_parking_backward
-                    msg_cmd_move_.data = speed_parking_backward;
-                    pub_move_.publish(msg_cmd_move_);
-                }
-            }
-            // car moves backward
-            else if (msg_car_speed_.data < 0)
-            {
-                // car head is closer to the left parkwall (car) than car rear
-                if ((msg_apa_lb_.range - msg_apa_lb2_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'L')
-                    {
-                        // turn a little left
-                        msg_cmd_turn_.data = 'l';
-                    }
-                }
-                // car rear is closer to the left parkwall (car) than car head
-                else if ((msg_apa_lb2_.range - msg_apa_lb_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'R')
-                    {
-                        // turn a little right
-                        msg_cmd_turn_.data = 'r';
-                    }
-                }
-                else
-                {
-                    // do nothing
-                }
-
-                // car head is too close to parkwall (car)
-                if (min(msg_apa_lf_.range, msg_upa_fl_.range) < parking_distance_min)
-                {
-                    // turn straight
-                    msg_cmd_turn_.data = 'D';
-                    pub_turn_.publish(msg_cmd_turn_);
-                }
-                else
-                {
-                    // turn full right
-                    msg_cmd_turn_.data = 'R';
-                    pub_turn_.publish(msg_cmd_turn_);
-                }
-
-                // car rear is too close to parkwall (car)
-                if (min(msg_apa_lb_.range, msg_upa_bl_.range) < parking_distance_min)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn full left
-                    msg_cmd_turn_.data = 'L';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move forward
-                    msg_cmd_move_.data = speed_parking_forward;
-                    pub_move_.publish(msg_cmd_move_);
-                }
-            }
-            // car stops
-            else
-            {
-                // do nothing
-            }
+            // do nothing
         }
-
-        looprate.sleep();
     }
-}
+} 
+
 
 
 // *****************************************************
-// function of parallel parking on the right side
+// function of parking along a path: look up or plan once, then follow the path
 // *****************************************************
-void ParkingIn::parking_right_parallel()
+// heuristic of Hybrid A* is computed once and cached in a file, loaded by heuristic_loader_
+void ParkingIn::load_heuristic()
 {
-    // stop
-    msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
-    // turn full right
-    msg_cmd_turn_.data = 'R';
-    pub_turn_.publish(msg_cmd_turn_);
-    // move backward with speed_parking_backward
-    msg_cmd_move_.data = speed_parking_backward;
-    pub_move_.publish(msg_cmd_move_);
-
-    ros::Rate looprate(20);
-
-    // check and change car posture with a rate of 20Hz until car rear is in parking space
-    while (ros::ok())
+    ros::WallTime load_start = ros::WallTime::now();
+    bool saved = astar_.load_heuristic(heuristic_table_file);
+    if (!astar_.heuristic_valid())
+    {
+        ROS_ERROR("heuristic table %s cannot be loaded or computed, no search with hybrid a*", heuristic_table_file);
+        return;
+    }
+    if (!saved)
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
+        ROS_WARN("heuristic table %s cannot be saved, it is computed again at the next start", heuristic_table_file);
+    }
+    ROS_INFO("heuristic table ready in %f[s]", (ros::WallTime::now() - load_start).toSec());
+    heuristic_ready_ = true;
+}
 
-        // car rear is already in parking space
-        // (sensor upa_bcr is in the middle of the parking space)
-        if (msg_upa_bcr_.range < parallel_length/2)
-        {
-            // turn full left
-            msg_cmd_turn_.data = 'L';
-            pub_turn_.publish(msg_cmd_turn_);
+bool ParkingIn::parking_planned()
+{
+    // stop before planning
+    msg_cmd_move_.data = 0;
+    command_move();
+    flush_commands(false);
 
-            break;      // break this loop
-        }
-        // car rear is reaching parking space
-        // (the actuall angle between car and parking space depends on the starting distance)
-        else if (msg_upa_bcr_.range < parallel_length)
+    // car moved since the parking space was found: from odometry, or straight from car speed
+    CarPose moved = {0, 0, 0};
+    ros::Time now = ros::Time::now();
+    if (!moved_pose(msg_parking_space_.header.stamp, now, moved))
+    {
+        moved.x = msg_car_speed_.data * (now - msg_parking_space_.header.stamp).toSec();
+    }
+    uint32_t type = msg_parking_space_.type;
+    bool right = (type == SPACE_RIGHT_PARALLEL || type == SPACE_RIGHT_PERPENDICULAR);
+    int8_t side = right ? SIDE_RIGHT : SIDE_LEFT;
+
+    // parking space along the parked cars, origin at the car: its front end was at the apas
+    // at back when it was found, the car was parallel to the parked cars while searching
+    SpaceGeometry space;
+    space.width = msg_parking_space_.width;
+    space.length = msg_parking_space_.length;
+    space.distance = msg_parking_space_.distance - side * moved.y;
+    space.offset = -params().distance_apa_rear - moved.x;
+    double heading = moved.yaw;
+
+    // obstacles on the other side of the aisle, measured by the apa at front of the other side:
+    // a degraded apa reads as blocked, the aisle is unknown and no path is planned
+    int apa_aisle = right ? APA_LF : APA_RF;
+    if (health_.degraded(apa_aisle))
+    {
+        ROS_WARN("apa at front of the other side is degraded, no path is planned");
+        return false;
+    }
+    float range = msg_range_[apa_aisle].range;
+    space.aisle = (range < params().aisle_range_max) ? range : 0;
+
+    // look up maneuver in the table and check it against the measured obstacles,
+    // plan it if the parking space is out of table, search it in narrow aisles
+    std::vector<PathSegment> segments;
+    CarPose goal;
+    ros::WallTime plan_start = ros::WallTime::now();
+    bool planned = table_.lookup(type, space, heading, segments) && \
+    planner_.set_space(type, space, goal) && planner_.check(segments, heading);
+    const char* method = "looked up";
+    if (!planned)
+    {
+        planned = planner_.plan(type, space, heading, segments);
+        method = "planned";
+    }
+    bool searching = false;
+    if (!planned && (type == SPACE_LEFT_PERPENDICULAR || type == SPACE_RIGHT_PERPENDICULAR) && \
+    planner_.set_space(type, space, goal))
+    {
+        // Hybrid A* runs on the thread of searcher_ and the strand goes on, callback_control
+        // picks up its path. No search before its heuristic is loaded or while one is running
+        boost::mutex::scoped_lock lock_search(search_mutex_);
+        if (!heuristic_ready_ || search_running_)
         {
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
+            ROS_WARN("hybrid a* is not ready, no search");
         }
         else
         {
-            // do nothing
+            CarPose start = {0, 0, heading};
+            search_running_ = true;
+            search_posted_++;
+            searcher_.post(boost::bind(&ParkingIn::search_path, this, planner_.obstacles(), start, goal, \
+            search_posted_));
+            searching = true;
+            method = "searching";
         }
-
-        looprate.sleep();
     }
+    double plan_duration = (ros::WallTime::now() - plan_start).toSec();
+    ROS_INFO("maneuver %s in %f[ms]: width=%f[m], length=%f[m], aisle=%f[m], heading=%f[rad], %d segments", \
+    method, plan_duration * 1000, space.width, space.length, space.aisle, heading, (int)segments.size());
 
-    // check and change car posture with a rate of 20Hz until parking is finished
-    while (ros::ok())
+    if (searching)
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
+        // car stays stopped until the search is finished
+        state_ = PARKING_SEARCH_PATH;
+        return true;
+    }
+    if (!planned)
+    {
+        // no path into the parking space: stay on the street
+        ROS_WARN("no path found into parking space");
+        return false;
+    }
 
-        // car is parallel to the parkwall on the right side
-        if (fabs(msg_apa_rb_.range - msg_apa_rb2_.range) <= apa_tolerance)
-        {
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-            // keep moving forward with speed_parking_forward
-            msg_cmd_move_.data = speed_parking_forward;
-            pub_move_.publish(msg_cmd_move_);
-
-            // car is close to parkwall (car) at front
-            if (min(msg_upa_fcl_.range, msg_upa_fcr_.range) < parking_distance_min)
-            {
-                // stop
-                msg_cmd_move_.data = 0;
-                pub_move_.publish(msg_cmd_move_);
+    follow_path(segments);
+    return true;
+}
 
-                parking_finished = true;     // parking finished!
-                break;      // break this loop
-            }
-        }
-        // car is not parallel to the parkwall on the right side
-        else
-        {
-            // car moves forard
-            if (msg_car_speed_.data > 0)
-            {
-                // car head is closer to the right parkwall (car) than car rear
-                if ((msg_apa_rb_.range - msg_apa_rb2_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'L')
-                    {
-                        // turn a little left
-                        msg_cmd_turn_.data = 'l';
-                    }
-                }
-                // car rear is closer to the right parkwall (car) than car head
-                else if ((msg_apa_rb2_.range - msg_apa_rb_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'R')
-                    {
-                        // turn a little right
-                        msg_cmd_turn_.data = 'r';
-                    }
-                }
-                else
-                {
-                    // do nothing
-                }
+// search of Hybrid A* on the thread of searcher_, without mutex_
+void ParkingIn::search_path(const std::vector<Box>& obstacles, const CarPose& start, const CarPose& goal, \
+unsigned search)
+{
+    std::vector<PathSegment> segments;
+    bool found = astar_.plan(obstacles, start, goal, params().hybrid_astar_time_budget, segments);
+    ROS_INFO("hybrid a*: %d nodes expanded in %f[ms], %d segments", (int)astar_.expanded(), \
+    astar_.duration() * 1000, (int)segments.size());
+
+    boost::mutex::scoped_lock lock(search_mutex_);
+    search_found_ = found;
+    search_segments_.swap(segments);
+    search_finished_ = search;
+    search_running_ = false;
+    search_idle_.notify_all();
+}
 
-                // car head is too close to parkwall (car)
-                if (min(msg_apa_rf_.range, msg_upa_fr_.range) < parking_distance_min)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn full left
-                    msg_cmd_turn_.data = 'L';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move backward with speed_parking_backward
-                    msg_cmd_move_.data = speed_parking_backward;
-                    pub_move_.publish(msg_cmd_move_);
-                }
-            }
-            // car moves backward
-            else if (msg_car_speed_.data < 0)
-            {
-                // car head is closer to the right parkwall (car) than car rear
-                if ((msg_apa_rb_.range - msg_apa_rb2_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'R')
-                    {
-                        // turn a little right
-                        msg_cmd_turn_.data = 'r';
-                    }
-                }
-                // car rear is closer to the right parkwall (car) than car head
-                else if ((msg_apa_rb2_.range - msg_apa_rb_.range) > apa_tolerance)
-                {
-                    if (msg_cmd_turn_.data != 'L')
-                    {
-                        // turn a little left
-                        msg_cmd_turn_.data = 'l';
-                    }
-                }
-                else
-                {
-                    // do nothing
-                }
+// function of following the planned path with controller_path_tracking: publish the path,
+// the control timer checks the end of path
+void ParkingIn::follow_path(const std::vector<PathSegment>& segments)
+{
+    // sample the path in car frame at planning time
+    Path path;
+    CarPose start = {0, 0, 0};
+    sample_path(segments, start, params().path_sample_step, path);
 
-                // car head is too close to parkwall (car)
-                if (min(msg_apa_rf_.range, msg_upa_fr_.range) < parking_distance_min)
-                {
-                    // turn straight
-                    msg_cmd_turn_.data = 'D';
-                    pub_turn_.publish(msg_cmd_turn_);
-                }
-                else
-                {
-                    // turn full left
-                    msg_cmd_turn_.data = 'L';
-                    pub_turn_.publish(msg_cmd_turn_);
-                }
+    nav_msgs::Path msg_path;
+    path_to_msg(path, msg_path);
+    msg_path.header.stamp = ros::Time::now();
+    msg_path.header.frame_id = "base_link";
 
-                // car rear is too close to parkwall (car)
-                if (min(msg_apa_rb_.range, msg_upa_br_.range) < parking_distance_min)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn full right
-                    msg_cmd_turn_.data = 'R';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move forward
-                    msg_cmd_move_.data = speed_parking_forward;
-                    pub_move_.publish(msg_cmd_move_);
-                }
-            }
-            // car stops
-            else
-            {
-                // do nothing
-            }
-        }
+    path_done_ = false;
+    pub_path_.publish(msg_path);
 
-        looprate.sleep();
-    }
+    state_ = PARKING_FOLLOW_PATH;
 }
 
 
+// benchmark_decisions links this node without main
+#ifndef AUTOPARK_NO_MAIN
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "parking_in");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
 
-    // create a node handle, use global callback queue
-    ros::NodeHandle nh;
     //create a node handle for class, use custom callback queue
     ros::NodeHandle nh_c;
-    // create custom callback queue
-    ros::CallbackQueue callback_queue;
-    // set custom callback queue
-    nh_c.setCallbackQueue(&callback_queue);
-
-    // create and initialize subscribers
-    ros::Subscriber sub_parking_enable = nh.subscribe<std_msgs::Bool>("parking_enable", 1, \
-    callback_parking_enable);
+    // run callbacks of the class one at a time on a fixed number of threads
+    Executor executor(params().executor_threads);
+    Strand strand(executor);
+    // set strand as callback queue
+    nh_c.setCallbackQueue(&strand);
 
     // instantiating class object
     ParkingIn ParkingIn_obj(&nh_c);  // pass nh_c to class constructor
 
-    // create AsyncSpinner, run it on all available cores to process custom callback queue
-    sp_spinner.reset(new ros::AsyncSpinner(0, &callback_queue));
-
-    // set loop rate
-    ros::Rate loop_rate(10);
-    while (ros::ok())
+    // parking in waits for the chosen parking space in stage search and runs in stage park in
+    LifecycleNode lifecycle(STAGE_BIT(STAGE_SEARCH) | STAGE_BIT(STAGE_PARK_IN), [&](bool active)
     {
-        ROS_INFO_STREAM_ONCE("node parking_in is running");
-        if (parking_enable)
+        if (active)
         {
-            if (!trigger_spinner)
-            {
-                ROS_INFO("parking in enabled");
-
-                // clear old callbacks in custom callback queue
-                callback_queue.clear();
-                // start spinners for custom callback queue
-                sp_spinner->start();
-                ROS_INFO("spinners start");
-
-                trigger_spinner = true;
-            }
+            ROS_INFO("parking in enabled");
+            // clear old callbacks of the class
+            strand.clear();
+            // start running callbacks of the class
+            strand.start();
         }
         else
         {
-            if (trigger_spinner)
-            {
-                ROS_INFO("parking in disabled");
-
-                // stop spinners for custom callback queue
-                sp_spinner->stop();
-                ROS_INFO("spinners stop");
-
-                // reset
-                parking_enable = false;
-                trigger_spinner = false;
-                parking_finished = false;
-            }
+            ROS_INFO("parking in disabled");
+            // stop the car if parking in is not finished
+            ParkingIn_obj.cancel_parking();
+            // stop running callbacks of the class
+            strand.stop();
         }
+    });
 
-        // process message in global callback queue
-        ros::spinOnce();
-
-        loop_rate.sleep();
-    }
-
-    // release AsyncSpinner object
-    sp_spinner.reset();
-
-    // wait for ROS threads to terminate
-    ros::waitForShutdown();
+    ROS_INFO("node parking_in is running");
+    // process stage transitions in global callback queue when they arrive
+    ros::spin();
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
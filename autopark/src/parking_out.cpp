@@ -9,37 +9,29 @@
  ******************************************************************/
 
 #include "autopark/autoparking.h"
+#include "autopark/executor.h"
+#include "autopark/lifecycle.h"
 #include "autopark/parking_out.h"
 
 using namespace std;
 
-static bool parking_out_enable = false;         // flag of parking out enable
 static bool parking_out_finished = false;       // flag of parking finished
-static bool trigger_spinner = false;            // flag of spinners enable
 
 static double moved_distance = 0;
 static ros::Time time_begin, time_end;
 
-boost::shared_ptr<ros::AsyncSpinner> sp_spinner;   // create a shared_ptr for AsyncSpinner object
-
-
-// callback from global callback queue
-// callback of sub_parking_out_enable
-void callback_parking_out_enable(const std_msgs::Bool::ConstPtr& msg)
-{
-    ROS_INFO("call callback of parking_out_enable: %d", msg->data);
-    parking_out_enable = msg->data;
-}
-
 
 // CONSTRUCTOR: called when this object is created to set up subscribers and publishers
-ParkingOut::ParkingOut(ros::NodeHandle* nodehandle):nh_(*nodehandle)
+ParkingOut::ParkingOut(ros::NodeHandle* nodehandle):nh_(*nodehandle), health_(nh_, msg_range_, &mutex_)
 {
     ROS_INFO("call constructor in parking_out");
 
     sub_car_speed_ = nh_.subscribe<std_msgs::Float32>("car_speed", 1, \
     &ParkingOut::callback_car_speed, this);
 
+    sub_path_done_ = nh_.subscribe<std_msgs::Bool>("path_done", 1, \
+    &ParkingOut::callback_path_done, this);
+
     sub_apa_lf_ = nh_.subscribe<sensor_msgs::Range>("apa_lf", 1, \
     &ParkingOut::callback_apa_lf, this);
 
@@ -76,9 +68,24 @@ ParkingOut::ParkingOut(ros::NodeHandle* nodehandle):nh_(*nodehandle)
     sub_upa_br_ = nh_.subscribe<sensor_msgs::Range>("upa_br", 1, \
     &ParkingOut::callback_upa_br, this);
 
-    pub_move_ = nh_.advertise<std_msgs::Float32>("cmd_move", 1);
+    channel_move_.advertise(nh_, "cmd_move_maneuver", params().command_heartbeat);
+
+    channel_turn_.advertise(nh_, "cmd_turn_maneuver", params().command_heartbeat);
+    std_msgs::Char msg_turn_hold;
+    msg_turn_hold.data = TURN_HOLD;
+    channel_turn_.set_hold(msg_turn_hold);
+
+    pub_path_ = nh_.advertise<nav_msgs::Path>("parking_path", 1);
 
-    pub_turn_ = nh_.advertise<std_msgs::Char>("cmd_turn", 1);
+    path_done_ = false;
+    cancelled_ = false;
+    maneuver_ = NULL;
+
+    // parking space is saved by parking in, it is read when parking out is enabled
+    if (!session_.open(session_store_file))
+    {
+        ROS_WARN("session store %s cannot be opened", session_store_file);
+    }
 }
 
 // DESTRUCTOR: called when this object is deleted to release memory 
@@ -92,781 +99,544 @@ ParkingOut::~ParkingOut(void)
 void ParkingOut::callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
 {
     ROS_INFO("call callback of car_speed: speed=%f", msg->data);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_car_speed_.data = msg->data;
 
     time_end = ros::Time::now();
 
-    // calculate the moved distance
-    moved_distance += msg_car_speed_.data * (time_end - time_begin).toSec();
+    // calculate the moved distance: from odometry, or from car speed if odometry is not running
+    double driven;
+    if (!driven_distance(time_begin, time_end, driven))
+    {
+        driven = msg_car_speed_.data * (time_end - time_begin).toSec();
+    }
+    moved_distance += driven;
 
-    time_begin = ros::Time::now();
+    time_begin = time_end;
+    resume_maneuver();
+}
+
+// callback of sub_path_done_
+void ParkingOut::callback_path_done(const std_msgs::Bool::ConstPtr& msg)
+{
+    ROS_INFO("call callback of path_done: %d", msg->data);
+    path_done_ = msg->data;
+}
+
+// function of driven distance between two time stamps from shared memory of odometry
+bool ParkingOut::driven_distance(const ros::Time& begin, const ros::Time& end, double& distance)
+{
+    // odometry may start after this node
+    if (!odometry_.is_open() && !odometry_.open(odometry_shm_name))
+    {
+        return false;
+    }
+    return odometry_.distance(begin.toSec(), end.toSec(), distance);
 }
 
 // callback of sub_apa_lf_
 void ParkingOut::callback_apa_lf(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_lf: range=%f", msg->range);
-    msg_apa_lf_.header.stamp = msg->header.stamp;
-    msg_apa_lf_.header.frame_id = msg->header.frame_id;
-    msg_apa_lf_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[APA_LF].header.stamp = msg->header.stamp;
+    msg_range_[APA_LF].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_LF].range = health_.range(APA_LF, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_apa_lb_
 void ParkingOut::callback_apa_lb(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_lb: range=%f", msg->range);
-    msg_apa_lb_.header.stamp = msg->header.stamp;
-    msg_apa_lb_.header.frame_id = msg->header.frame_id;
-    msg_apa_lb_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[APA_LB].header.stamp = msg->header.stamp;
+    msg_range_[APA_LB].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_LB].range = health_.range(APA_LB, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_apa_rf_
 void ParkingOut::callback_apa_rf(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_rf: range=%f", msg->range);
-    msg_apa_rf_.header.stamp = msg->header.stamp;
-    msg_apa_rf_.header.frame_id = msg->header.frame_id;
-    msg_apa_rf_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[APA_RF].header.stamp = msg->header.stamp;
+    msg_range_[APA_RF].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_RF].range = health_.range(APA_RF, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_apa_rb_
 void ParkingOut::callback_apa_rb(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of apa_rb: range=%f", msg->range);
-    msg_apa_rb_.header.stamp = msg->header.stamp;
-    msg_apa_rb_.header.frame_id = msg->header.frame_id;
-    msg_apa_rb_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[APA_RB].header.stamp = msg->header.stamp;
+    msg_range_[APA_RB].header.frame_id = msg->header.frame_id;
+    msg_range_[APA_RB].range = health_.range(APA_RB, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_upa_fl_
 void ParkingOut::callback_upa_fl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fl: range=%f", msg->range);
-    msg_upa_fl_.header.stamp = msg->header.stamp;
-    msg_upa_fl_.header.frame_id = msg->header.frame_id;
-    msg_upa_fl_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[UPA_FL].header.stamp = msg->header.stamp;
+    msg_range_[UPA_FL].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_FL].range = health_.range(UPA_FL, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_upa_fcl_
 void ParkingOut::callback_upa_fcl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fcl: range=%f", msg->range);
-    msg_upa_fcl_.header.stamp = msg->header.stamp;
-    msg_upa_fcl_.header.frame_id = msg->header.frame_id;
-    msg_upa_fcl_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[UPA_FCL].header.stamp = msg->header.stamp;
+    msg_range_[UPA_FCL].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_FCL].range = health_.range(UPA_FCL, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_upa_fcr_
 void ParkingOut::callback_upa_fcr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fcr: range=%f", msg->range);
-    msg_upa_fcr_.header.stamp = msg->header.stamp;
-    msg_upa_fcr_.header.frame_id = msg->header.frame_id;
-    msg_upa_fcr_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[UPA_FCR].header.stamp = msg->header.stamp;
+    msg_range_[UPA_FCR].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_FCR].range = health_.range(UPA_FCR, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_upa_fr_
 void ParkingOut::callback_upa_fr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fr: range=%f", msg->range);
-    msg_upa_fr_.header.stamp = msg->header.stamp;
-    msg_upa_fr_.header.frame_id = msg->header.frame_id;
-    msg_upa_fr_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[UPA_FR].header.stamp = msg->header.stamp;
+    msg_range_[UPA_FR].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_FR].range = health_.range(UPA_FR, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_upa_bl_
 void ParkingOut::callback_upa_bl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bl: range=%f", msg->range);
-    msg_upa_bl_.header.stamp = msg->header.stamp;
-    msg_upa_bl_.header.frame_id = msg->header.frame_id;
-    msg_upa_bl_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[UPA_BL].header.stamp = msg->header.stamp;
+    msg_range_[UPA_BL].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_BL].range = health_.range(UPA_BL, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_upa_bcl_
 void ParkingOut::callback_upa_bcl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bcl: range=%f", msg->range);
-    msg_upa_bcl_.header.stamp = msg->header.stamp;
-    msg_upa_bcl_.header.frame_id = msg->header.frame_id;
-    msg_upa_bcl_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[UPA_BCL].header.stamp = msg->header.stamp;
+    msg_range_[UPA_BCL].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_BCL].range = health_.range(UPA_BCL, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_upa_bcr_
 void ParkingOut::callback_upa_bcr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bcr: range=%f", msg->range);
-    msg_upa_bcr_.header.stamp = msg->header.stamp;
-    msg_upa_bcr_.header.frame_id = msg->header.frame_id;
-    msg_upa_bcr_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[UPA_BCR].header.stamp = msg->header.stamp;
+    msg_range_[UPA_BCR].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_BCR].range = health_.range(UPA_BCR, msg->range);
+    resume_maneuver();
 }
 
 // callback of sub_upa_br_
 void ParkingOut::callback_upa_br(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_br: range=%f", msg->range);
-    msg_upa_br_.header.stamp = msg->header.stamp;
-    msg_upa_br_.header.frame_id = msg->header.frame_id;
-    msg_upa_br_.range = msg->range;
+    boost::mutex::scoped_lock lock(mutex_);
+    msg_range_[UPA_BR].header.stamp = msg->header.stamp;
+    msg_range_[UPA_BR].header.frame_id = msg->header.frame_id;
+    msg_range_[UPA_BR].range = health_.range(UPA_BR, msg->range);
+    resume_maneuver();
 }
 
 
-// ************************************************************************
-// function of getting out of perpendicular parking space on the left side
-// ************************************************************************
-void ParkingOut::parking_out_left_perpendicular()
+// function of parking space type from the session store, 0 if car is not parked by autopark
+uint32_t ParkingOut::parked_space() const
 {
-    // turn straight
-    msg_cmd_turn_.data = 'D';
-    pub_turn_.publish(msg_cmd_turn_);
-    // move forward with speed_parking_forward
-    msg_cmd_move_.data = speed_parking_forward;
-    pub_move_.publish(msg_cmd_move_);
-
-    ros::Rate looprate(20);
-    // move forward until car is out of parking space
-    while (ros::ok())
+    ParkingSession session;
+    if (!session_.load(session) || session.state != SESSION_PARKED)
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // a half of car is out of parking space
-        if (moved_distance > distance_perpendicular_out)
-        {
-            // turn full left
-            msg_cmd_turn_.data = 'L';
-            pub_turn_.publish(msg_cmd_turn_);
-
-            break;
-        }
-
-        looprate.sleep();
+        return 0;
     }
+    return session.type;
+}
 
-    /***** PLAN A *****/
-    // now parking out is finished, driver can get into car easily,
-    // but car is not parallel to the street
-    /*
-    // stop
-    msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
-
-    parking_out_finished = true;
-    */
+// function of ending the parking session after parking out
+void ParkingOut::finish_session()
+{
+    ROS_INFO("commands published: move %lu, turn %lu; suppressed: move %lu, turn %lu", \
+    (unsigned long)channel_move_.published(), (unsigned long)channel_turn_.published(), \
+    (unsigned long)channel_move_.suppressed(), (unsigned long)channel_turn_.suppressed());
 
-    /***** PLAN B *****/
-    // keep moving forward until car is complete out of parking space
-    while (ros::ok())
+    ParkingSession session;
+    if (!session_.load(session))
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // right of car rear is out of parking space
-        if (msg_apa_rb_.range > distance_search)
-        {
-            break;
-        }
-
-        looprate.sleep();
+        memset(&session, 0, sizeof(session));
     }
-    while (ros::ok())
+    session.state = SESSION_NONE;
+    session.stamp = ros::Time::now().toSec();
+    if (!session_.store(session))
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car head is close to object (car) on the left side of street or 
-        // car rear is complete out of parking space
-        if (msg_apa_lf_.range < distance_search || \
-        (msg_upa_bcl_.range > perpendicular_width && msg_upa_bcr_.range > perpendicular_width))
-        {
-            // stop
-            msg_cmd_move_.data = 0;
-            pub_move_.publish(msg_cmd_move_);
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-
-            parking_out_finished = true;
-
-            break;
-        }
-        else
-        {
-            // car is too close to parkwall (car) on the left side
-            if (msg_apa_lb_.range < brake_distance_default)
-            {
-                // turn straight
-                msg_cmd_turn_.data = 'D';
-            }
-            else
-            {
-                // keep turnning full left
-                msg_cmd_turn_.data = 'L';
-            }
-        }
-
-        looprate.sleep();
+        ROS_WARN("failed to save parking session to %s", session_store_file);
     }
 }
 
 
 // ************************************************************************
-// function of getting out of perpendicular parking space on the right side
+// function of getting out of parking space along the reversed trajectory of parking in
 // ************************************************************************
-void ParkingOut::parking_out_right_perpendicular()
+bool ParkingOut::parking_out_replay()
 {
-    // turn straight
-    msg_cmd_turn_.data = 'D';
-    pub_turn_.publish(msg_cmd_turn_);
-    // move forward with speed_parking_forward
-    msg_cmd_move_.data = speed_parking_forward;
-    pub_move_.publish(msg_cmd_move_);
+    // parking out starts: the first commands are published, counters start from 0
+    channel_move_.reset();
+    channel_turn_.reset();
 
-    ros::Rate looprate(20);
-    // move forward until a half of car is out of parking space
-    while (ros::ok())
+    if (!trajectory_.load(trajectory_cache_file))
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // a half of car is out of parking space
-        if (moved_distance > distance_perpendicular_out)
-        {
-            // turn full right
-            msg_cmd_turn_.data = 'R';
-            pub_turn_.publish(msg_cmd_turn_);
-
-            break;
-        }
-
-        looprate.sleep();
+        ROS_INFO("no cached trajectory of parking in");
+        return false;
     }
+    const TrajectoryCacheHeader& header = trajectory_.header();
 
-    /***** PLAN A *****/
-    // now parking out is finished, driver can get into car easily,
-    // but car is not parallel to the street
-    /*
-    // stop
-    msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
-
-    parking_out_finished = true;
-    */
-
-    /***** PLAN B *****/
-    // keep moving forward until car is complete out of parking space
-    while (ros::ok())
+    // trajectory of the parking space in the session store
+    if (header.type != parked_space())
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // left of car rear is out of parking space
-        if (msg_apa_lb_.range > distance_search)
-        {
-            break;
-        }
+        ROS_INFO("cached trajectory is not of the parked space");
+        return false;
+    }
 
-        looprate.sleep();
+    // car is not moved since parking in (odometer is smaller if odometry is restarted)
+    OdometrySample sample;
+    if ((odometry_.is_open() || odometry_.open(odometry_shm_name)) && odometry_.latest(sample) && \
+    sample.odometer - header.odometer > params().trajectory_tolerance)
+    {
+        ROS_INFO("car is moved since parking in, cached trajectory is invalid");
+        return false;
     }
-    while (ros::ok())
+
+    // no object is closer to the car than at the end of parking in
+    boost::mutex::scoped_lock lock(mutex_);
+    for (int i = 0; i < RANGE_SENSORS; ++i)
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car head is close to object (car) on the right side of street or 
-        // car rear is complete out of parking space
-        if (msg_apa_rf_.range < distance_search || \
-        (msg_upa_bcl_.range > perpendicular_width && msg_upa_bcr_.range > perpendicular_width))
+        if (header.range[i] <= 0 || msg_range_[i].header.stamp.isZero())
         {
-            // stop
-            msg_cmd_move_.data = 0;
-            pub_move_.publish(msg_cmd_move_);
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-
-            parking_out_finished = true;
-
-            break;
+            continue;
         }
-        else
+        if (min(msg_range_[i].range, params().distance_search) < \
+        min(header.range[i], params().distance_search) - params().trajectory_tolerance)
         {
-            // car is too close to parkwall (car) on the right side
-            if (msg_apa_rb_.range < brake_distance_default)
-            {
-                // turn straight
-                msg_cmd_turn_.data = 'D';
-            }
-            else
-            {
-                // keep turnning full right
-                msg_cmd_turn_.data = 'R';
-            }
+            ROS_INFO("object is closer than at parking in (sensor %d), cached trajectory is invalid", i);
+            return false;
         }
-
-        looprate.sleep();
     }
-}
+    lock.unlock();
 
+    // follow reversed trajectory with controller_path_tracking, car frame is unchanged since parking in
+    Path path;
+    trajectory_.exit_path(path);
+    nav_msgs::Path msg_path;
+    path_to_msg(path, msg_path);
+    msg_path.header.stamp = ros::Time::now();
+    msg_path.header.frame_id = "base_link";
 
-// ************************************************************************
-// function of getting out of parallel parking space on the left side
-// ************************************************************************
-void ParkingOut::parking_out_left_parallel()
-{
-    // turn straight
-    msg_cmd_turn_.data = 'D';
-    pub_turn_.publish(msg_cmd_turn_);
-    // move backward with speed_parking_backward
-    msg_cmd_move_.data = speed_parking_backward;
-    pub_move_.publish(msg_cmd_move_);
+    path_done_ = false;
+    pub_path_.publish(msg_path);
+    ROS_INFO("replay reversed trajectory of parking in: %u samples", header.count);
 
+    ros::Time time_start = ros::Time::now();
     ros::Rate looprate(20);
-    // move until car is ready to turn right and move forward to get out of parking space
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // distance between car and parkwall (car) at front is larger than safe distance
-        // or car rear is too close to parkwall (car) at back
-        if (msg_upa_fcr_.range > distance_parallel_out || \
-        (msg_upa_bl_.range < brake_distance_default || \
-        msg_upa_bcl_.range < brake_distance_default || \
-        msg_upa_bcr_.range < brake_distance_default || \
-        msg_upa_br_.range < brake_distance_default))
-        {
-            // stop
-            msg_cmd_move_.data = 0;
-            pub_move_.publish(msg_cmd_move_);
-            // turn full right
-            msg_cmd_turn_.data = 'R';
-            pub_turn_.publish(msg_cmd_turn_);
-            // move forward
-            msg_cmd_move_.data = speed_parking_forward;
-            pub_move_.publish(msg_cmd_move_);
-
-            break;
-        }
-
-        looprate.sleep();
-    }
-
-    // move forward until car head is out of parking space
-    while (ros::ok())
+    while (!path_done_)
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car head is out of parking space
-        if (msg_apa_lf_.range > distance_search && \
-            msg_upa_fl_.range > distance_search)
-        {
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-            // move forward
-            msg_cmd_move_.data = speed_parking_forward;
-            pub_move_.publish(msg_cmd_move_);
-
-            break;
-        }
-        else
+        // parking out is disabled or the node shuts down
+        if (!ros::ok() || cancelled_)
         {
-            // car head is too close to parkwall (car)
-            if (msg_upa_fl_.range < brake_distance_default)
-            {
-                // stop
-                msg_cmd_move_.data = 0;
-                pub_move_.publish(msg_cmd_move_);
-                // turn full left
-                msg_cmd_turn_.data = 'L';
-                pub_turn_.publish(msg_cmd_turn_);
-                // move backward
-                msg_cmd_move_.data = speed_parking_backward;
-                pub_move_.publish(msg_cmd_move_);
-
-                // car rear is too close to parkwall (car)
-                if (msg_upa_bl_.range < brake_distance_default)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn full right
-                    msg_cmd_turn_.data = 'R';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move forward
-                    msg_cmd_move_.data = speed_parking_forward;
-                    pub_move_.publish(msg_cmd_move_);
-                }
-            }
+            stop_path(msg_path);
+            ROS_WARN("replay of trajectory is cancelled");
+            return false;
         }
 
-        looprate.sleep();
-    }
-
-    // move forward until half of car rear is out of parking space
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // half of car rear is out of parking space
-        if (msg_upa_bcl_.range > parallel_length/2)
+        // object is too close in moving direction or replay times out
+        lock.lock();
+        bool blocked = path_blocked();
+        lock.unlock();
+        if (blocked || (ros::Time::now() - time_start).toSec() > params().parking_time)
         {
-            // turn full left
-            msg_cmd_turn_.data = 'L';
-            pub_turn_.publish(msg_cmd_turn_);
-            // move forward
-            msg_cmd_move_.data = speed_parking_forward;
-            pub_move_.publish(msg_cmd_move_);
-
-            break;
+            stop_path(msg_path);
+            ROS_WARN("replay of trajectory is stopped, get out with sensors");
+            return false;
         }
 
         looprate.sleep();
     }
 
-    /***** PLAN A *****/
-    // now parking out is finished, driver can get into car easily,
-    // but car is not parallel to the street
-    /*
     // stop
     msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
+    command_move();
+    // turn straight
+    msg_cmd_turn_.data = 'D';
+    command_turn();
+    flush_commands();
 
+    // the trajectory is driven back, it is invalid for the next parking out
+    remove(trajectory_cache_file);
     parking_out_finished = true;
-    */
 
-    /***** PLAN B *****/
-    // keep moving forward until car is complete out of parking space
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
+    return true;
+}
 
-        // car is complete out of parking space
-        if (msg_upa_bl_.range > parallel_length)
-        {
-            // stop
-            msg_cmd_move_.data = 0;
-            pub_move_.publish(msg_cmd_move_);
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
+// function of stopping the car following a path: stop, an empty path cancels path tracking
+void ParkingOut::stop_path(nav_msgs::Path& msg_path)
+{
+    msg_cmd_move_.data = 0;
+    command_move();
+    flush_commands();
+    msg_path.poses.clear();
+    msg_path.header.stamp = ros::Time::now();
+    pub_path_.publish(msg_path);
+}
 
-            parking_out_finished = true;
+// functions of commands: set during a loop step, published by flush_commands only if changed
+void ParkingOut::command_move()
+{
+    channel_move_.set(msg_cmd_move_);
+}
 
-            break;
-        }
-        else
+void ParkingOut::command_turn()
+{
+    channel_turn_.set(msg_cmd_turn_, msg_cmd_turn_.data == 'l' || msg_cmd_turn_.data == 'r');
+}
+
+// heartbeat: repeat unchanged commands to keep their lease in controller_arbiter
+void ParkingOut::flush_commands()
+{
+    channel_move_.flush();
+    channel_turn_.flush();
+}
+
+// function of checking the upas in moving direction (front or back, in order of RangeSensor),
+// mutex_ is locked
+bool ParkingOut::path_blocked() const
+{
+    int first = (msg_car_speed_.data < 0) ? UPA_BL : UPA_FL;
+    for (int i = first; i < first + 4; ++i)
+    {
+        if (!msg_range_[i].header.stamp.isZero() && msg_range_[i].range < params().brake_distance_default)
         {
-            // car head is too close to object (car) at side of street
-            if (msg_upa_fl_.range < parking_distance_min)
-            {
-                // turn straight
-                msg_cmd_turn_.data = 'D';
-            }
+            return true;
         }
     }
-
-    looprate.sleep();
+    return false;
 }
 
 
-
 // ************************************************************************
-// function of getting out of parallel parking space on the right side
+// function of getting out of parking space with sensors: the maneuver is resumed
+// by the callbacks with each new measurement, the main thread waits until it is over
 // ************************************************************************
-void ParkingOut::parking_out_right_parallel()
+bool ParkingOut::run_maneuver(Maneuver& maneuver)
 {
-    // turn straight
-    msg_cmd_turn_.data = 'D';
-    pub_turn_.publish(msg_cmd_turn_);
-    // move backward with speed_parking_backward
-    msg_cmd_move_.data = speed_parking_backward;
-    pub_move_.publish(msg_cmd_move_);
-
-    ros::Rate looprate(20);
-    // move until car is ready to turn right and move forward to get out of parking space
-    while (ros::ok())
+    boost::mutex::scoped_lock lock(mutex_);
+    maneuver_ = &maneuver;
+    ros::Time time_start = ros::Time::now();
+    while (!maneuver.done())
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // distance between car and parkwall (car) at front is larger than safe distance
-        // or car rear is too close to parkwall (car) at back
-        if (msg_upa_fcl_.range > distance_parallel_out || \
-        (msg_upa_bl_.range < brake_distance_default || \
-        msg_upa_bcl_.range < brake_distance_default || \
-        msg_upa_bcr_.range < brake_distance_default || \
-        msg_upa_br_.range < brake_distance_default))
+        // parking out is disabled (callbacks are stopped), the node shuts down or the
+        // maneuver times out: stop the car
+        if (!ros::ok() || cancelled_ || (ros::Time::now() - time_start).toSec() > params().parking_time)
         {
-            // stop
+            maneuver_ = NULL;
             msg_cmd_move_.data = 0;
-            pub_move_.publish(msg_cmd_move_);
-            // turn full left
-            msg_cmd_turn_.data = 'L';
-            pub_turn_.publish(msg_cmd_turn_);
-            // move forward
-            msg_cmd_move_.data = speed_parking_forward;
-            pub_move_.publish(msg_cmd_move_);
-
-            break;
+            command_move();
+            flush_commands();
+            ROS_WARN("maneuver is stopped after %u steps", maneuver.steps());
+            return false;
         }
-
-        looprate.sleep();
+        maneuver_over_.timed_wait(lock, boost::posix_time::milliseconds(100));
     }
+    maneuver_ = NULL;
 
-    // move forward until car head is out of parking space
-    while (ros::ok())
-    {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car head is out of parking space
-        if (msg_apa_rf_.range > distance_search && \
-            msg_upa_fr_.range > distance_search)
-        {
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-            // move forward
-            msg_cmd_move_.data = speed_parking_forward;
-            pub_move_.publish(msg_cmd_move_);
-
-            break;
-        }
-        else
-        {
-            // car head is too close to parkwall (car)
-            if (msg_upa_fr_.range < brake_distance_default)
-            {
-                // stop
-                msg_cmd_move_.data = 0;
-                pub_move_.publish(msg_cmd_move_);
-                // turn full right
-                msg_cmd_turn_.data = 'R';
-                pub_turn_.publish(msg_cmd_turn_);
-                // move backward
-                msg_cmd_move_.data = speed_parking_backward;
-                pub_move_.publish(msg_cmd_move_);
-
-                // car rear is too close to parkwall (car)
-                if (msg_upa_br_.range < brake_distance_default)
-                {
-                    // stop
-                    msg_cmd_move_.data = 0;
-                    pub_move_.publish(msg_cmd_move_);
-                    // turn full left
-                    msg_cmd_turn_.data = 'L';
-                    pub_turn_.publish(msg_cmd_turn_);
-                    // move forward
-                    msg_cmd_move_.data = speed_parking_forward;
-                    pub_move_.publish(msg_cmd_move_);
-                }
-            }
-        }
+    ROS_INFO("maneuver is over after %u steps", maneuver.steps());
+    return maneuver.succeeded();
+}
 
-        looprate.sleep();
+// function of a step of the running maneuver with the latest measurements, mutex_ is locked
+void ParkingOut::resume_maneuver()
+{
+    if (maneuver_ == NULL)
+    {
+        return;
     }
 
-    // move forward until half of car rear is out of parking space
-    while (ros::ok())
+    ManeuverInput input;
+    input.distance = moved_distance;
+    input.speed = msg_car_speed_.data;
+    for (int i = 0; i < RANGE_SENSORS; ++i)
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // half of car rear is out of parking space
-        if (msg_upa_bcr_.range > parallel_length/2)
-        {
-            // turn full right
-            msg_cmd_turn_.data = 'R';
-            pub_turn_.publish(msg_cmd_turn_);
-            // move forward
-            msg_cmd_move_.data = speed_parking_forward;
-            pub_move_.publish(msg_cmd_move_);
-
-            break;
-        }
-
-        looprate.sleep();
+        input.range[i] = msg_range_[i].range;
     }
-
-    /***** PLAN A *****/
-    // now parking out is finished, driver can get into car easily,
-    // but car is not parallel to the street
-    /*
-    // stop
-    msg_cmd_move_.data = 0;
-    pub_move_.publish(msg_cmd_move_);
-
-    parking_out_finished = true;
-    */
-
-    /***** PLAN B *****/
-    // keep moving forward until car is complete out of parking space
-    while (ros::ok())
+    if (!maneuver_->resume(input))
     {
-        // publish move and turn commands
-        pub_move_.publish(msg_cmd_move_);
-        pub_turn_.publish(msg_cmd_turn_);
-
-        // car is complete out of parking space
-        if (msg_upa_br_.range > parallel_length)
-        {
-            // stop
-            msg_cmd_move_.data = 0;
-            pub_move_.publish(msg_cmd_move_);
-            // turn straight
-            msg_cmd_turn_.data = 'D';
-            pub_turn_.publish(msg_cmd_turn_);
-
-            parking_out_finished = true;
-
-            break;
-        }
-        else
-        {
-            // car head is too close to object (car) at side of street
-            if (msg_apa_rf_.range < parking_distance_min)
-            {
-                // turn straight
-                msg_cmd_turn_.data = 'D';
-            }
-        }
+        maneuver_over_.notify_all();
     }
 
-    looprate.sleep();
+    const ManeuverCommand& command = maneuver_->command();
+    if (command.turn_set)
+    {
+        msg_cmd_turn_.data = command.turn;
+        command_turn();
+    }
+    if (command.move_set)
+    {
+        msg_cmd_move_.data = command.move;
+        command_move();
+    }
+    // publish changed commands, repeat unchanged ones with heartbeat
+    flush_commands();
 }
 
 
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "parking_out");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
 
     // create a node handle, use global callback queue
     ros::NodeHandle nh;
     //create a node handle for class, use custom callback queue
     ros::NodeHandle nh_c;
-    // create custom callback queue
-    ros::CallbackQueue callback_queue;
-    // set custom callback queue
-    nh_c.setCallbackQueue(&callback_queue);
+    // run callbacks of the class one at a time on a fixed number of threads
+    Executor executor(params().executor_threads);
+    Strand strand(executor);
+    // set strand as callback queue
+    nh_c.setCallbackQueue(&strand);
 
-    // create and initialize subscribers
-    ros::Subscriber sub_parking_out_enable = nh.subscribe<std_msgs::Bool>("parking_out_enable", 1, \
-    callback_parking_out_enable);
+    // create and initialize publishers
+    ros::Publisher pub_parking_out_done = nh.advertise<std_msgs::Bool>("parking_out_done", 1);
+    std_msgs::Bool msg_parking_out_done;
 
     // instantiating class object
     ParkingOut ParkingOut_obj(&nh_c);  // pass nh_c to class constructor
 
-    // create AsyncSpinner, run it on all available cores to process custom callback queue
-    sp_spinner.reset(new ros::AsyncSpinner(0, &callback_queue));
+    // parking out runs in stage park out
+    LifecycleNode lifecycle(STAGE_BIT(STAGE_PARK_OUT), [&](bool active)
+    {
+        if (active)
+        {
+            ROS_INFO("parking out enabled");
+            ParkingOut_obj.cancel(false);
+            time_begin = ros::Time::now();  // initialize time_begin
+            moved_distance = 0;
+            // clear old callbacks of the class
+            strand.clear();
+            // start running callbacks of the class
+            strand.start();
+        }
+        else
+        {
+            ROS_INFO("parking out disabled");
+            // a running parking out stops the car and returns
+            ParkingOut_obj.cancel(true);
+            // stop running callbacks of the class
+            strand.stop();
+        }
+    });
 
-    // set loop rate
-    ros::Rate loop_rate(10);
+    // stage transitions are processed when they arrive, parking out runs in the main thread
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+
+    ROS_INFO("node parking_out is running");
     while (ros::ok())
     {
-        ROS_INFO_STREAM_ONCE("node parking_out is running");
-        if (parking_out_enable)
+        // wait for stage park out
+        if (!lifecycle.wait_until(true, 0.1))
         {
-            if (!trigger_spinner)
-            {
-                ROS_INFO("parking out enabled");
+            continue;
+        }
 
-                time_begin = ros::Time::now();  // initialize time_begin
+        // replay reversed trajectory of parking in, or get out of the parking space with sensors
+        if (!ParkingOut_obj.parking_out_replay() && !ParkingOut_obj.cancelled())
+        {
+            // check parking space (saved in session store by parking in) and get out of it
+            switch (ParkingOut_obj.parked_space())
+            {
+            case SPACE_LEFT_PERPENDICULAR:
+            {
+                ROS_INFO("parking out of left perpendicular parking space");
+                PerpendicularOut<SIDE_LEFT> maneuver;
+                parking_out_finished = ParkingOut_obj.run_maneuver(maneuver);
+                break;
+            }
 
-                // clear old callbacks in custom callback queue
-                callback_queue.clear();
-                // start spinners for custom callback queue
-                sp_spinner->start();
-                ROS_INFO("spinners start");
+            case SPACE_LEFT_PARALLEL:
+            {
+                ROS_INFO("parking out of left parallel parking space");
+                ParallelOut<SIDE_LEFT> maneuver;
+                parking_out_finished = ParkingOut_obj.run_maneuver(maneuver);
+                break;
+            }
 
-                trigger_spinner = true;
+            case SPACE_RIGHT_PERPENDICULAR:
+            {
+                ROS_INFO("parking out of right perpendicular parking space");
+                PerpendicularOut<SIDE_RIGHT> maneuver;
+                parking_out_finished = ParkingOut_obj.run_maneuver(maneuver);
+                break;
             }
-            else
+
+            case SPACE_RIGHT_PARALLEL:
             {
-                // check parking_space (saved in autoparking.h) and get out of the parking space
-                switch (parking_space)
-                {
-                case SPACE_LEFT_PERPENDICULAR:
-                    ROS_INFO("parking out of left perpendicular parking space");
-                    ParkingOut_obj.parking_out_left_perpendicular();
-                    break;
-
-                case SPACE_LEFT_PARALLEL:
-                    ROS_INFO("parking out of left parallel parking space");
-                    ParkingOut_obj.parking_out_left_parallel();
-                    break;
-
-                case SPACE_RIGHT_PERPENDICULAR:
-                    ROS_INFO("parking out of right perpendicular parking space");
-                    ParkingOut_obj.parking_out_right_perpendicular();
-                    break;
-
-                case SPACE_RIGHT_PARALLEL:
-                    ROS_INFO("parking out of right parallel parking space");
-                    ParkingOut_obj.parking_out_right_parallel();
-                    break;
-
-                default:
-                    ROS_INFO("parking space is unknown");
-                    if (trigger_spinner)
-                    {
-                        // stop spinners for custom callback queue
-                        sp_spinner->stop();
-                        ROS_INFO("spinners stop");
-
-                        // reset
-                        parking_out_enable = false;
-                        trigger_spinner = false;
-                        parking_out_finished = false;
-                        moved_distance = 0;
-                    }
-                }
-
-                if (parking_out_finished)
-                {
-                    ROS_INFO("parking out finished");
-
-                    // stop spinners for custom callback queue
-                    sp_spinner->stop();
-                    ROS_INFO("spinners stop");
-
-                    // reset
-                    parking_out_enable = false;
-                    trigger_spinner = false;
-                    parking_out_finished = false;
-                    moved_distance = 0;
-                }
+                ROS_INFO("parking out of right parallel parking space");
+                ParallelOut<SIDE_RIGHT> maneuver;
+                parking_out_finished = ParkingOut_obj.run_maneuver(maneuver);
+                break;
+            }
+
+            default:
+                ROS_INFO("parking space is unknown");
             }
         }
 
-        // process message in global callback queue
-        ros::spinOnce();
+        if (parking_out_finished)
+        {
+            ROS_INFO("parking out finished");
+            ParkingOut_obj.finish_session();
+        }
+        else if (!ParkingOut_obj.cancelled())
+        {
+            ROS_WARN("parking out failed, the car stays in the parking space");
+        }
 
-        loop_rate.sleep();
+        // parking out is over: lifecycle_manager ends the stage park out, unless it is
+        // already ended. Done if the car got out, failed if the maneuver gave up
+        if (!ParkingOut_obj.cancelled())
+        {
+            msg_parking_out_done.data = parking_out_finished;
+            pub_parking_out_done.publish(msg_parking_out_done);
+        }
+        parking_out_finished = false;
+        while (ros::ok() && !lifecycle.wait_until(false, 0.1))
+        {
+        }
     }
 
-    // release AsyncSpinner object
-    sp_spinner.reset();
-
-    // wait for ROS threads to terminate
-    ros::waitForShutdown();
-
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,470 @@
+/******************************************************************
+ * Filename: parking_planner.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-12
+ * Description: geometric planner for parallel parking, the path is
+ * planned once when the parking space is chosen
+ * 
+ ******************************************************************/
+
+#include <algorithm>
+
+#include "autopark/autoparking.h"
+#include "autopark/parking_planner.h"
+#include "autopark/parking_kernels.h"
+
+using namespace std;
+
+static const double move_length_min = 0.1;      // [m] shortest forward or backward move
+static const double move_length_max = 3;        // [m] longest move in parking space
+static const int moves_max = 8;                 // maximum number of moves in parking space
+static const double shift_max = 1.5;            // [m] maximum lateral shift away from the parking space
+static const double shift_step = 0.25;          // [m] step of lateral shift
+static const double turn_length = 1;            // [m] length of turning parallel to the parked cars
+
+
+// move car pose exactly along an arc with constant steering angle
+void move_car_arc(CarPose& pose, double steering, double length)
+{
+    car_move_arc<ActiveProfile>(pose, steering, length);
+}
+
+// sample a path from maneuver segments
+void sample_path(const vector<PathSegment>& segments, const CarPose& start, double step, Path& path)
+{
+    path.clear();
+    CarPose pose = start;
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        int8_t direction = (segments[i].length >= 0) ? 1 : -1;
+        if (path.empty())
+        {
+            PathPoint point = {pose.x, pose.y, pose.yaw, direction};
+            path.push_back(point);
+        }
+        else
+        {
+            // cusp: the last point leads into the new segment
+            path.back().direction = direction;
+        }
+
+        int steps = max(1, (int)ceil(fabs(segments[i].length) / step));
+        double length = segments[i].length / steps;
+        for (int k = 0; k < steps; k++)
+        {
+            move_car_arc(pose, segments[i].steering, length);
+            PathPoint point = {pose.x, pose.y, pose.yaw, direction};
+            path.push_back(point);
+        }
+    }
+}
+
+
+// check collision between car (with safety margin) and box: separating axis test
+bool collision_box(const CarPose& pose, const Box& box)
+{
+    return car_collision_box<ActiveProfile>(pose, box);
+}
+
+// CONSTRUCTOR
+ParkingPlanner::ParkingPlanner()
+{
+    radius_min_ = params().wheel_base / tan(params().steering_angle_max);
+}
+
+// DESTRUCTOR
+ParkingPlanner::~ParkingPlanner(void)
+{
+}
+
+// check collision between car (with safety margin) and obstacles
+bool ParkingPlanner::collision(const CarPose& pose) const
+{
+    for (size_t i = 0; i < obstacles_.size(); i++)
+    {
+        if (collision_box(pose, obstacles_[i]))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// drive with constant steering until length is reached or next step collides,
+// return the driven length
+double ParkingPlanner::drive(CarPose& pose, double steering, double length, \
+vector<PathSegment>& segments) const
+{
+    int steps = (int)ceil(fabs(length) / params().planner_step);
+    double step = (steps > 0) ? length / steps : 0;
+    double driven = 0;
+
+    for (int k = 0; k < steps; k++)
+    {
+        CarPose next = pose;
+        move_car_arc(next, steering, step);
+        if (collision(next))
+        {
+            break;
+        }
+        pose = next;
+        driven += step;
+    }
+
+    if (fabs(driven) > 1e-3)
+    {
+        PathSegment segment = {(float)steering, (float)driven};
+        segments.push_back(segment);
+    }
+    return driven;
+}
+
+// exit from pose to the street (y = 0, yaw = 0) with a forward S-curve: arc to the left
+// with minimal radius, then arc to the right back to yaw 0
+bool ParkingPlanner::exit_parallel(const CarPose& start, vector<PathSegment>& segments) const
+{
+    CarPose pose = start;
+    double offset = -start.y;       // lateral distance to the street
+
+    // yaw phi at the end of the left arc: R(cos(yaw) - cos(phi)) + R(1 - cos(phi)) = offset
+    double cos_phi = (1 + cos(start.yaw) - offset / radius_min_) / 2;
+    if (cos_phi < 0)
+    {
+        return false;   // street is too far away
+    }
+    double phi = acos(min(cos_phi, 1.0));
+    double radius = radius_min_;
+    if (phi < start.yaw)
+    {
+        // car is already turned enough: only turn back with a larger radius
+        phi = start.yaw;
+        radius = offset / (1 - cos(phi));
+    }
+
+    size_t size = segments.size();
+    double length_left = radius_min_ * (phi - start.yaw);
+    double length_right = radius * phi;
+    double steering_right = -atan(params().wheel_base / radius);
+    if (fabs(drive(pose, params().steering_angle_max, length_left, segments) - length_left) > 1e-3 || \
+    fabs(drive(pose, steering_right, length_right, segments) - length_right) > 1e-3)
+    {
+        segments.resize(size);
+        return false;
+    }
+    return true;
+}
+
+// exit from pose to the street (y >= 0, yaw = 0) after perpendicular parking: move
+// straight forward, then arc to the right with minimal radius back to yaw 0, the street
+// is shifted away from the parking space if the arc is too close to the parked cars
+bool ParkingPlanner::exit_perpendicular(const CarPose& start, vector<PathSegment>& segments) const
+{
+    if (sin(start.yaw) < 0.1)
+    {
+        return false;   // car is not heading to the street
+    }
+
+    size_t size = segments.size();
+    double length_right = radius_min_ * start.yaw;
+    for (double shift = 0; shift <= shift_max; shift += shift_step)
+    {
+        // straight length d: y + d * sin(yaw) + R * (1 - cos(yaw)) = shift
+        double length_straight = (shift - start.y - radius_min_ * (1 - cos(start.yaw))) / sin(start.yaw);
+        if (length_straight < 0)
+        {
+            continue;   // street is too close for minimal radius
+        }
+
+        CarPose pose = start;
+        if (fabs(drive(pose, 0, length_straight, segments) - length_straight) < 1e-3 && \
+        fabs(drive(pose, -params().steering_angle_max, length_right, segments) - length_right) < 1e-3)
+        {
+            return true;
+        }
+        segments.resize(size);
+    }
+    return false;
+}
+
+// plan getting out of the parking space from the goal, the parking in path is the reversed one
+bool ParkingPlanner::plan_out(const CarPose& goal, bool perpendicular, bool back_first, \
+vector<PathSegment>& segments) const
+{
+    segments.clear();
+    CarPose pose = goal;
+
+    // move backward to get more space at front
+    if (back_first)
+    {
+        drive(pose, 0, -move_length_max, segments);
+    }
+
+    // parallel: forward with full steering to the left and backward with full steering to the right
+    // until the car can get out with one S-curve
+    // perpendicular: forward with full steering to the right and backward with full steering to
+    // the left until the car can turn to the street
+    double steering = perpendicular ? -params().steering_angle_max : params().steering_angle_max;
+    for (int move = 0; perpendicular ? !exit_perpendicular(pose, segments) : !exit_parallel(pose, segments); move++)
+    {
+        if (move >= moves_max)
+        {
+            return false;
+        }
+        bool forward = (move % 2 == 0);
+        double driven = forward ? drive(pose, steering, move_length_max, segments) : \
+        drive(pose, -steering, -move_length_max, segments);
+        if (fabs(driven) < move_length_min)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// set parked cars beside the parking space and the curb at its end
+void ParkingPlanner::set_obstacles(const SpaceGeometry& space, double neighbor_length)
+{
+    double y_line = -(params().car_width / 2 + space.distance);
+    double y_curb = y_line - space.length;
+    double x_front = space.offset;
+    double x_rear = space.offset - space.width;
+
+    obstacles_.clear();
+    Box box_front = {x_front, x_front + neighbor_length, y_curb, y_line};
+    Box box_rear = {x_rear - neighbor_length, x_rear, y_curb, y_line};
+    // curb is lower than the car body: no safety margin
+    Box box_curb = {x_rear - neighbor_length, x_front + neighbor_length, y_curb - 1, y_curb - params().planner_margin};
+    obstacles_.push_back(box_front);
+    obstacles_.push_back(box_rear);
+    obstacles_.push_back(box_curb);
+
+    // obstacles on the other side of the aisle
+    if (space.aisle > 0)
+    {
+        double y_aisle = params().car_width / 2 + space.aisle;
+        Box box_aisle = {x_rear - 2 * params().car_length, x_front + 2 * params().car_length, y_aisle, y_aisle + 1};
+        obstacles_.push_back(box_aisle);
+    }
+}
+
+// goal of parallel parking: car in the middle between parked cars, close to the line
+// of parked cars to keep space for turning the car rear to the curb
+CarPose ParkingPlanner::goal_parallel(const SpaceGeometry& space) const
+{
+    double y_line = -(params().car_width / 2 + space.distance);
+    double y_curb = y_line - space.length;
+    CarPose goal;
+    goal.x = space.offset - space.width / 2 - (params().car_length / 2 - params().rear_overhang);
+    goal.y = max(y_line - params().car_width / 2 - 2 * params().planner_margin, (y_line + y_curb) / 2);
+    goal.yaw = 0;
+    return goal;
+}
+
+// goal of perpendicular parking: car in the middle between parked cars, car rear close to the curb
+CarPose ParkingPlanner::goal_perpendicular(const SpaceGeometry& space) const
+{
+    double y_curb = -(params().car_width / 2 + space.distance) - space.length;
+    CarPose goal;
+    goal.x = space.offset - space.width / 2;
+    goal.y = y_curb + params().planner_margin + params().rear_overhang;
+    goal.yaw = M_PI / 2;
+    return goal;
+}
+
+// plan from the goal with the fewest moves, parking in is the reversed way out
+bool ParkingPlanner::plan_in(const CarPose& goal, bool perpendicular, int8_t side, vector<PathSegment>& segments) const
+{
+    // keep the maneuver with fewest moves: direct or after moving backward in the space
+    vector<PathSegment> out, candidate;
+    for (int back_first = 0; back_first <= 1; back_first++)
+    {
+        if (plan_out(goal, perpendicular, back_first, candidate) && (out.empty() || candidate.size() < out.size()))
+        {
+            out = candidate;
+        }
+    }
+    if (out.empty())
+    {
+        return false;
+    }
+
+    // end of getting out
+    CarPose exit = goal;
+    for (size_t i = 0; i < out.size(); i++)
+    {
+        move_car_arc(exit, out[i].steering, out[i].length);
+    }
+
+    // parking in: shift away from the parking space with an S-curve if needed,
+    // move straight to the end of getting out, then the reversed maneuver
+    CarPose pose = {0, 0, 0};
+    if (exit.y > 1e-3)
+    {
+        // S-curve with minimal radius: 2R * (1 - cos(phi)) = shift
+        double length = radius_min_ * acos(1 - exit.y / (2 * radius_min_));
+        if (fabs(drive(pose, params().steering_angle_max, length, segments) - length) > 1e-3 || \
+        fabs(drive(pose, -params().steering_angle_max, length, segments) - length) > 1e-3)
+        {
+            segments.clear();
+            return false;
+        }
+    }
+    double length_straight = exit.x - pose.x;
+    if (fabs(drive(pose, 0, length_straight, segments) - length_straight) > 1e-3)
+    {
+        segments.clear();
+        return false;
+    }
+    for (size_t i = out.size(); i > 0; i--)
+    {
+        PathSegment segment = {out[i - 1].steering, -out[i - 1].length};
+        segments.push_back(segment);
+    }
+
+    // mirror steering for the left side
+    if (side == SIDE_LEFT)
+    {
+        for (size_t i = 0; i < segments.size(); i++)
+        {
+            segments[i].steering = -segments[i].steering;
+        }
+    }
+    return true;
+}
+
+// mirror obstacles for the left side
+void ParkingPlanner::mirror_obstacles(int8_t side)
+{
+    if (side != SIDE_LEFT)
+    {
+        return;
+    }
+    for (size_t i = 0; i < obstacles_.size(); i++)
+    {
+        double y_min = obstacles_[i].y_min;
+        obstacles_[i].y_min = -obstacles_[i].y_max;
+        obstacles_[i].y_max = -y_min;
+    }
+}
+
+// plan parallel parking, planned for the right side and mirrored for the left side
+bool ParkingPlanner::plan_parallel(const SpaceGeometry& space, int8_t side, vector<PathSegment>& segments)
+{
+    segments.clear();
+
+    // parking space is too small for the car
+    if (space.width < params().car_length + 2 * params().planner_margin || \
+    space.length < params().car_width + 2 * params().planner_margin)
+    {
+        return false;
+    }
+    set_obstacles(space, params().car_length);
+
+    bool planned = plan_in(goal_parallel(space), false, side, segments);
+    mirror_obstacles(side);
+    return planned;
+}
+
+// plan perpendicular parking backward into the space, planned for the right side and
+// mirrored for the left side
+bool ParkingPlanner::plan_perpendicular(const SpaceGeometry& space, int8_t side, vector<PathSegment>& segments)
+{
+    segments.clear();
+
+    // parking space is too small for the car
+    if (space.width < params().car_width + 2 * params().planner_margin || space.length < params().car_length / 2)
+    {
+        return false;
+    }
+    set_obstacles(space, params().car_width);
+
+    bool planned = plan_in(goal_perpendicular(space), true, side, segments);
+    mirror_obstacles(side);
+    return planned;
+}
+
+// plan parking into a parking space of type SPACE_*, heading: [rad] yaw of the car to the
+// parked cars, positive to the left
+bool ParkingPlanner::plan(uint32_t type, const SpaceGeometry& space, double heading, \
+vector<PathSegment>& segments)
+{
+    segments.clear();
+    int8_t side = (type == SPACE_LEFT_PARALLEL || type == SPACE_LEFT_PERPENDICULAR) ? SIDE_LEFT : SIDE_RIGHT;
+    bool perpendicular = (type == SPACE_LEFT_PERPENDICULAR || type == SPACE_RIGHT_PERPENDICULAR);
+    if (type != SPACE_LEFT_PARALLEL && type != SPACE_RIGHT_PARALLEL && !perpendicular)
+    {
+        return false;
+    }
+
+    // turn parallel to the parked cars first, then plan from there: the turn always has
+    // the same length, so that its steering angle changes continuously with heading
+    CarPose pose = {0, 0, heading};
+    PathSegment turn;
+    turn.length = max(turn_length, radius_min_ * fabs(heading));
+    turn.steering = atan(-heading * params().wheel_base / turn.length);
+    move_car_arc(pose, turn.steering, turn.length);
+
+    SpaceGeometry shifted = space;
+    shifted.offset -= pose.x;
+    shifted.distance -= side * pose.y;
+    if (shifted.distance <= 0)
+    {
+        return false;
+    }
+
+    vector<PathSegment> maneuver;
+    bool planned = perpendicular ? plan_perpendicular(shifted, side, maneuver) : \
+    plan_parallel(shifted, side, maneuver);
+    if (!planned)
+    {
+        return false;
+    }
+
+    segments.push_back(turn);
+    segments.insert(segments.end(), maneuver.begin(), maneuver.end());
+    return true;
+}
+
+// set obstacles and goal of a parking space of type SPACE_* in car frame
+bool ParkingPlanner::set_space(uint32_t type, const SpaceGeometry& space, CarPose& goal)
+{
+    int8_t side = (type == SPACE_LEFT_PARALLEL || type == SPACE_LEFT_PERPENDICULAR) ? SIDE_LEFT : SIDE_RIGHT;
+    if (type == SPACE_LEFT_PARALLEL || type == SPACE_RIGHT_PARALLEL)
+    {
+        set_obstacles(space, params().car_length);
+        goal = goal_parallel(space);
+    }
+    else if (type == SPACE_LEFT_PERPENDICULAR || type == SPACE_RIGHT_PERPENDICULAR)
+    {
+        set_obstacles(space, params().car_width);
+        goal = goal_perpendicular(space);
+    }
+    else
+    {
+        return false;
+    }
+
+    mirror_obstacles(side);
+    if (side == SIDE_LEFT)
+    {
+        goal.y = -goal.y;
+        goal.yaw = -goal.yaw;
+    }
+    return true;
+}
+
+// check collision along a path starting at the car (origin of car frame)
+bool ParkingPlanner::check(const vector<PathSegment>& segments, double heading) const
+{
+    CarPose pose = {0, 0, heading};
+    vector<PathSegment> driven;
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        if (fabs(drive(pose, segments[i].steering, segments[i].length, driven) - segments[i].length) > 1e-3)
+        {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,253 @@
+/******************************************************************
+ * Filename: path_tracking.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-08
+ * Description: define functions for car pose and path, and class
+ * for tracking a path with pure pursuit
+ * 
+ ******************************************************************/
+
+#include <algorithm>
+
+#include "autopark/autoparking.h"
+#include "autopark/path_tracking.h"
+
+using namespace std;
+
+
+// normalize angle to [-pi, pi)
+double normalize_angle(double angle)
+{
+    angle = fmod(angle + M_PI, 2 * M_PI);
+    if (angle < 0)
+    {
+        angle += 2 * M_PI;
+    }
+    return angle - M_PI;
+}
+
+// move car pose with kinematic bicycle model
+void move_car_pose(CarPose& pose, double speed, double steering, double dt)
+{
+    pose.x += speed * cos(pose.yaw) * dt;
+    pose.y += speed * sin(pose.yaw) * dt;
+    pose.yaw = normalize_angle(pose.yaw + speed / params().wheel_base * tan(steering) * dt);
+}
+
+// speed of path tracking limited by the actuators
+double tracking_speed(double speed, double remaining, double steering_lag)
+{
+    double speed_max = fabs(speed);
+    // stop at the end of segment after the dead time of drive, then creep to reach it
+    double braking = max(0.0, remaining - speed_max * params().drive_dead_time);
+    speed_max = min(speed_max, sqrt(2 * params().tracking_decel * braking) + params().tracking_speed_min);
+    // the planned curvature is reached only with the commanded steering angle
+    speed_max *= max(0.0, 1 - fabs(steering_lag) / params().steering_lag_max);
+    return (speed < 0) ? -speed_max : speed_max;
+}
+
+// convert path to ROS message
+void path_to_msg(const Path& path, nav_msgs::Path& msg)
+{
+    msg.poses.resize(path.size());
+    for (size_t i = 0; i < path.size(); i++)
+    {
+        msg.poses[i].header.seq = i;
+        msg.poses[i].pose.position.x = path[i].x;
+        msg.poses[i].pose.position.y = path[i].y;
+        msg.poses[i].pose.position.z = 0;
+        // rotation around z axis only
+        msg.poses[i].pose.orientation.x = 0;
+        msg.poses[i].pose.orientation.y = 0;
+        msg.poses[i].pose.orientation.z = sin(path[i].yaw / 2);
+        msg.poses[i].pose.orientation.w = cos(path[i].yaw / 2);
+    }
+}
+
+// convert ROS message to path
+void path_from_msg(const nav_msgs::Path& msg, Path& path)
+{
+    path.resize(msg.poses.size());
+    for (size_t i = 0; i < msg.poses.size(); i++)
+    {
+        const geometry_msgs::Pose& pose = msg.poses[i].pose;
+        path[i].x = pose.position.x;
+        path[i].y = pose.position.y;
+        path[i].yaw = atan2(2 * (pose.orientation.w * pose.orientation.z + pose.orientation.x * pose.orientation.y), \
+        1 - 2 * (pose.orientation.y * pose.orientation.y + pose.orientation.z * pose.orientation.z));
+    }
+
+    // direction: next point is in front of or behind the car
+    for (size_t i = 0; i + 1 < path.size(); i++)
+    {
+        double dx = path[i + 1].x - path[i].x;
+        double dy = path[i + 1].y - path[i].y;
+        path[i].direction = (dx * cos(path[i].yaw) + dy * sin(path[i].yaw) >= 0) ? 1 : -1;
+    }
+    if (!path.empty())
+    {
+        // last point keeps direction of the point before
+        path.back().direction = (path.size() > 1) ? path[path.size() - 2].direction : 1;
+    }
+}
+
+
+// CONSTRUCTOR: create an empty tracker
+PathTracker::PathTracker()
+{
+    reset();
+}
+
+// DESTRUCTOR
+PathTracker::~PathTracker(void)
+{
+}
+
+// set a new path and start tracking from its first point
+void PathTracker::set_path(const Path& path)
+{
+    path_ = path;
+    index_ = 0;
+    segment_begin_ = 0;
+    lateral_error_ = 0;
+    heading_error_ = 0;
+    steering_angle_ = 0;
+    finished_ = path_.empty();
+
+    find_segment_end();
+}
+
+// clear path
+void PathTracker::reset()
+{
+    set_path(Path());
+}
+
+// find the last point of current segment: direction changes or path ends
+void PathTracker::find_segment_end()
+{
+    segment_end_ = segment_begin_;
+    if (path_.empty())
+    {
+        return;
+    }
+    while (segment_end_ + 1 < path_.size() && \
+    path_[segment_end_].direction == path_[segment_begin_].direction)
+    {
+        segment_end_++;
+    }
+}
+
+// check if the car reached (or already passed) the end of current segment
+bool PathTracker::segment_reached(const CarPose& pose) const
+{
+    const PathPoint& end = path_[segment_end_];
+    double dx = end.x - pose.x;
+    double dy = end.y - pose.y;
+    double distance = hypot(dx, dy);
+
+    if (distance < params().path_goal_tolerance)
+    {
+        return true;
+    }
+
+    // end point is behind the car in moving direction
+    double projection = (dx * cos(end.yaw) + dy * sin(end.yaw)) * direction();
+    return (projection < 0 && distance < params().lookahead_distance);
+}
+
+// moving direction of current segment
+int8_t PathTracker::direction() const
+{
+    if (path_.empty())
+    {
+        return 0;
+    }
+    return path_[segment_begin_].direction;
+}
+
+// distance to the end of current segment
+double PathTracker::remaining(const CarPose& pose) const
+{
+    if (path_.empty())
+    {
+        return 0;
+    }
+    return hypot(path_[segment_end_].x - pose.x, path_[segment_end_].y - pose.y);
+}
+
+// compute steering angle for current pose with pure pursuit
+double PathTracker::update(const CarPose& pose)
+{
+    if (path_.empty() || finished_)
+    {
+        steering_angle_ = 0;
+        return steering_angle_;
+    }
+
+    // switch to next segment (change move direction at cusp)
+    while (segment_reached(pose))
+    {
+        if (segment_end_ + 1 >= path_.size())
+        {
+            finished_ = true;
+            steering_angle_ = 0;
+            return steering_angle_;
+        }
+        segment_begin_ = segment_end_;
+        index_ = segment_end_;
+        find_segment_end();
+    }
+
+    // nearest point: only search forward inside of current segment
+    double distance_min = hypot(path_[index_].x - pose.x, path_[index_].y - pose.y);
+    while (index_ < segment_end_)
+    {
+        double distance = hypot(path_[index_ + 1].x - pose.x, path_[index_ + 1].y - pose.y);
+        if (distance > distance_min)
+        {
+            break;
+        }
+        distance_min = distance;
+        index_++;
+    }
+
+    // tracking errors against the nearest point
+    const PathPoint& nearest = path_[index_];
+    lateral_error_ = -sin(nearest.yaw) * (pose.x - nearest.x) + cos(nearest.yaw) * (pose.y - nearest.y);
+    heading_error_ = normalize_angle(pose.yaw - nearest.yaw);
+
+    // lookahead point: first point outside of lookahead distance
+    size_t target = index_;
+    while (target < segment_end_ && \
+    hypot(path_[target].x - pose.x, path_[target].y - pose.y) < params().lookahead_distance)
+    {
+        target++;
+    }
+    double target_x = path_[target].x;
+    double target_y = path_[target].y;
+
+    // near the segment end: extend the segment along its heading
+    double rest = params().lookahead_distance - hypot(target_x - pose.x, target_y - pose.y);
+    if (target == segment_end_ && rest > 0)
+    {
+        target_x += direction() * rest * cos(path_[target].yaw);
+        target_y += direction() * rest * sin(path_[target].yaw);
+    }
+
+    // lookahead point in car frame
+    double dx = target_x - pose.x;
+    double dy = target_y - pose.y;
+    double local_x = cos(pose.yaw) * dx + sin(pose.yaw) * dy;
+    double local_y = -sin(pose.yaw) * dx + cos(pose.yaw) * dy;
+
+    // pure pursuit: the same formula for backward with mirrored x axis
+    double alpha = atan2(local_y, direction() * local_x);
+    double distance = max(hypot(local_x, local_y), 1e-3);
+    steering_angle_ = atan2(2 * params().wheel_base * sin(alpha), distance);
+    double steering_max = params().steering_angle_max;
+    steering_angle_ = max(-steering_max, min(steering_max, steering_angle_));
+
+    return steering_angle_;
+}
@@ -8,43 +8,15 @@
  ******************************************************************/
 
 #include "autopark/autoparking.h"
+#include "autopark/executor.h"
+#include "autopark/lifecycle.h"
 #include "autopark/search_parking_space_lf.h"
+#include "autopark/parking_kernels.h"
 
 using namespace std;
 
-static bool parking_enable = false;     // flag of parking enable
-static bool search_done = false;        // flag of searching parking space done
-static bool trigger_spinner = false;    // flag of spinners enable
-
 static float distance_min;              // minimum distance between car and object
 
-boost::shared_ptr<ros::AsyncSpinner> sp_spinner;   // create a shared_ptr for AsyncSpinner object
-
-// define struct of Times for stop situation during check parking space
-struct Times
-{
-    ros::Time begin;
-    ros::Time end;
-    double duration;
-    bool trigger;
-} time_2, time_5;    // define two objects for case 2 and case 5
-
-
-// callback from global callback queue
-// callback of sub_parking_enable
-void callback_parking_enable(const std_msgs::Bool::ConstPtr& msg)
-{
-    ROS_INFO("call callback of parking_enable: %d", msg->data);
-    parking_enable = msg->data;
-}
-
-// callback of sub_search_done
-void callback_search_done(const std_msgs::Bool::ConstPtr& msg)
-{
-    ROS_INFO("call callback of search_done: %d", msg->data);
-    search_done = msg->data;
-}
-
 
 // CONSTRUCTOR: called when this object is created to set up subscribers and publishers
 SearchParkingSpaceLF::SearchParkingSpaceLF(ros::NodeHandle* nodehandle):nh_(*nodehandle)
@@ -54,10 +26,11 @@ SearchParkingSpaceLF::SearchParkingSpaceLF(ros::NodeHandle* nodehandle):nh_(*nod
     sub_apa_lf_ = nh_.subscribe<sensor_msgs::Range>("apa_lf", 1, \
     &SearchParkingSpaceLF::callback_apa_lf, this);
 
-    sub_car_speed_ = nh_.subscribe<std_msgs::Float32>("car_speed", 1, \
+    // history of car speed: no message is dropped
+    sub_car_speed_ = nh_.subscribe<autopark::CarSpeed>("car_speed_stamped", 10, \
     &SearchParkingSpaceLF::callback_car_speed, this);
 
-    pub_parking_space_ = nh_.advertise<std_msgs::Header>("parking_space_lf", 1);
+    pub_parking_space_ = nh_.advertise<autopark::ParkingSpace>("parking_space_lf", 1);
 }
 
 // DESTRUCTOR: called when this object is deleted to release memory 
@@ -67,42 +40,11 @@ SearchParkingSpaceLF::~SearchParkingSpaceLF(void)
 }
 
 // callbacks from custom callback queue
-// callback of sub_car_speed_
-void SearchParkingSpaceLF::callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
+// callback of sub_car_speed_: speed at its time of acquisition
+void SearchParkingSpaceLF::callback_car_speed(const autopark::CarSpeed::ConstPtr& msg)
 {
-    ROS_INFO("call callback of car_speed: speed=%f", msg->data);
-    msg_car_speed_.data = msg->data;
-
-    if (vec_turnpoint_.size() == 1)
-    {
-        if (msg_car_speed_.data == 0 && !time_2.trigger)
-        {
-            time_2.begin = ros::Time::now();
-            time_2.trigger = true;
-        }
-        if (msg_car_speed_.data != 0 && time_2.trigger)
-        {
-            time_2.end = ros::Time::now();
-            time_2.trigger = false;
-
-            time_2.duration += (time_2.end - time_2.begin).toSec();
-        }
-    }
-    if (vec_turnpoint_.size() == 3)
-    {
-        if (msg_car_speed_.data == 0 && !time_5.trigger)
-        {
-            time_5.begin = ros::Time::now();
-            time_5.trigger = true;
-        }
-        if (msg_car_speed_.data != 0 && time_5.trigger)
-        {
-            time_5.end = ros::Time::now();
-            time_5.trigger = false;
-
-            time_5.duration += (time_5.end - time_5.begin).toSec();
-        }
-    }
+    ROS_INFO("call callback of car_speed: speed=%f", msg->speed);
+    alignment_.add_speed(msg->header.stamp, msg->speed);
 }
 
 // callback of sub_apa_lf_
@@ -117,6 +59,18 @@ void SearchParkingSpaceLF::callback_apa_lf(const sensor_msgs::Range::ConstPtr& m
     check_parking_space();
 }
 
+// function of driven distance between the times of acquisition of two measurements
+bool SearchParkingSpaceLF::driven_distance(const ros::Time& begin, const ros::Time& end, double& distance)
+{
+    if (!alignment_.distance(begin, end, distance))
+    {
+        ROS_WARN("no car speed between %f and %f", begin.toSec(), end.toSec());
+        distance = 0;
+        return false;
+    }
+    return true;
+}
+
 // check function to find parking space
 void SearchParkingSpaceLF::check_parking_space()
 {
@@ -124,7 +78,7 @@ void SearchParkingSpaceLF::check_parking_space()
     if (que_apa_lf_.empty())
     {
         //detected object in the range of distance_search
-        if (msg_apa_lf_.range < distance_search)
+        if (msg_apa_lf_.range < ActiveProfile::distance_search())
         {
             // add first valid range message to que_apa_lf_
             que_apa_lf_.push(msg_apa_lf_);
@@ -135,18 +89,21 @@ void SearchParkingSpaceLF::check_parking_space()
         // add new message to que_apa_lf_
         que_apa_lf_.push(msg_apa_lf_);
 
+        // trend of range between the first and new message
+        int trend = range_trend<ActiveProfile>(que_apa_lf_.front().range, que_apa_lf_.back().range);
+
         // number of turn points in vec_turnpoint_
-        static uint16_t size_vec_turnpoint = vec_turnpoint_.size();
+        uint16_t size_vec_turnpoint = vec_turnpoint_.size();
         switch (size_vec_turnpoint)
         {
         case 0:     // no turn point in vec_turnpoint_
             // range increase: close to parking space (parking gap)
-            if ((que_apa_lf_.back().range - que_apa_lf_.front().range) > range_diff)
+            if (trend == RANGE_INCREASE)
             {
                 // do nothing
             }
             // range decrease: away from parking space (parking gap)
-            else if ((que_apa_lf_.front().range - que_apa_lf_.back().range) > range_diff)
+            else if (trend == RANGE_DECREASE)
             {
                 vec_turnpoint_.push_back(que_apa_lf_.back());  // first turn point
                 distance_min = que_apa_lf_.back().range;
@@ -161,12 +118,12 @@ void SearchParkingSpaceLF::check_parking_space()
 
         case 1:     // one turn point in vec_turnpoint_
             // range increase: close to parking space (parking gap)
-            if ((que_apa_lf_.back().range - que_apa_lf_.front().range) > range_diff)
+            if (trend == RANGE_INCREASE)
             {
                 vec_turnpoint_.push_back(que_apa_lf_.front());    // second turn point
             }
             // range decrease: away from parking space (parking gap)
-            else if ((que_apa_lf_.front().range - que_apa_lf_.back().range) > range_diff)
+            else if (trend == RANGE_DECREASE)
             {
                 vec_turnpoint_.pop_back();      // delete the added first turn point
                 vec_turnpoint_.push_back(que_apa_lf_.back());  // add the new first turn point
@@ -184,25 +141,23 @@ void SearchParkingSpaceLF::check_parking_space()
             break;
 
         case 2:     // two turn points in vec_turnpoint_
-            double obj_diff, obj_length;
-            // time duration between the first and second turn point
-            obj_diff = (vec_turnpoint_[1].header.stamp - vec_turnpoint_[0].header.stamp).toSec();
-            // parallel length of object
-            obj_length = msg_car_speed_.data * (obj_diff - time_2.duration);
-            // reset time duration for stop
-            time_2.duration = 0;
-            
-            if (obj_length < perpendicular_width && obj_length > car_width)
+            double obj_length;
+            int obj_kind;
+            // parallel length of object: driven distance between the first and second turn point
+            driven_distance(vec_turnpoint_[0].header.stamp, vec_turnpoint_[1].header.stamp, obj_length);
+
+            obj_kind = object_kind<ActiveProfile>(obj_length);
+            if (obj_kind == KIND_PERPENDICULAR)
             {
                 // perpendicular parking: 0 0 0 1  0 0 0 0
-                setbit(msg_parking_space_.seq, 4);
-                clrbit(msg_parking_space_.seq, 5);
+                setbit(msg_parking_space_.type, 4);
+                clrbit(msg_parking_space_.type, 5);
             }
-            else if (obj_length < parallel_width && obj_length > car_length)
+            else if (obj_kind == KIND_PARALLEL)
             {
                 // parallel parking: 0 0 1 0  0 0 0 0
-                setbit(msg_parking_space_.seq, 5);
-                clrbit(msg_parking_space_.seq, 4);
+                setbit(msg_parking_space_.type, 5);
+                clrbit(msg_parking_space_.type, 4);
             }
             else
             {
@@ -210,12 +165,12 @@ void SearchParkingSpaceLF::check_parking_space()
             }
 
             // range increase: close to parking space (parking gap)
-            if ((que_apa_lf_.back().range - que_apa_lf_.front().range) > range_diff)
+            if (trend == RANGE_INCREASE)
             {
                 // do nothing
             }
             // range decrease: away from parking space (parking gap)
-            else if ((que_apa_lf_.front().range - que_apa_lf_.back().range) > range_diff)
+            else if (trend == RANGE_DECREASE)
             {
                 vec_turnpoint_.push_back(que_apa_lf_.front());    // third key point
                 vec_turnpoint_.push_back(que_apa_lf_.front());    // fourth key point
@@ -229,7 +184,7 @@ void SearchParkingSpaceLF::check_parking_space()
 
         case 3:     // three turn points in vec_turnpoint_
             // range decrease: away from parking space (parking gap)
-            if ((que_apa_lf_.front().range - que_apa_lf_.back().range) > range_diff)
+            if (trend == RANGE_DECREASE)
             {
                 vec_turnpoint_.push_back(que_apa_lf_.front());     // fourth turn point
             }
@@ -242,12 +197,12 @@ void SearchParkingSpaceLF::check_parking_space()
 
         case 4:     // four turn points in vec_turnpoint_
             // range increase: close to parking space (parking gap)
-            if ((que_apa_lf_.back().range - que_apa_lf_.front().range) > range_diff)
+            if (trend == RANGE_INCREASE)
             {
                 // do nothing
             }
             // range decrease: away from parking space (parking gap)
-            else if ((que_apa_lf_.front().range - que_apa_lf_.back().range) > range_diff)
+            else if (trend == RANGE_DECREASE)
             {
                 // do nothing
             }
@@ -260,49 +215,51 @@ void SearchParkingSpaceLF::check_parking_space()
             break;
 
         case 5:     // five turn points in vec_turnpoint_
-            double space_diff, space_width, space_length;
-            // time duration between the third and fourth turn point
-            space_diff = (vec_turnpoint_[4].header.stamp - vec_turnpoint_[3].header.stamp).toSec();
-            // width of space
-            space_width = msg_car_speed_.data * (space_diff - time_5.duration);
-            // reset time duration for stop
-            time_5.duration = 0;
+            double space_width, space_length;
+            int space_kind_walls;
+            // width of space: driven distance between the third and fourth turn point
+            driven_distance(vec_turnpoint_[3].header.stamp, vec_turnpoint_[4].header.stamp, space_width);
 
             // length of space
             space_length = min(vec_turnpoint_[3].range, vec_turnpoint_[4].range) - \
             min(distance_min, vec_turnpoint_[5].range);
 
-            if ((space_width > perpendicular_width && space_length > perpendicular_length) || \
-            (space_width > parallel_width && space_length > parallel_length))
+            if (space_valid<ActiveProfile>(space_width, space_length))
             {
                 // parking space on the left side
-                setbit(msg_parking_space_.seq, 6);     // 0 1 x x  0 0 0 0
+                setbit(msg_parking_space_.type, 6);    // 0 1 x x  0 0 0 0
                 // 0 1 0 1  0 0 0 0: perpendicular parking on the left side
                 // 0 1 1 0  0 0 0 0: parallel parking space on the left side
                 // else: not a valid parking space
 
                 // in case of specific parking space with 3 walls
+                space_kind_walls = space_kind<ActiveProfile>(space_width, space_length);
                 // perpendicular parking space
-                if (space_width < parallel_width)
+                if (space_kind_walls == KIND_PERPENDICULAR)
                 {
                     // perpendicular parking: 0 0 0 1  0 0 0 0
-                    setbit(msg_parking_space_.seq, 4);
-                    clrbit(msg_parking_space_.seq, 5);
+                    setbit(msg_parking_space_.type, 4);
+                    clrbit(msg_parking_space_.type, 5);
                 }
                 // parallel parking space
-                if (space_length < perpendicular_length)
+                else if (space_kind_walls == KIND_PARALLEL)
                 {
                     // parallel parking: 0 0 1 0  0 0 0 0
-                    setbit(msg_parking_space_.seq, 5);
-                    clrbit(msg_parking_space_.seq, 4);
+                    setbit(msg_parking_space_.type, 5);
+                    clrbit(msg_parking_space_.type, 4);
                 }
 
-                // set time stamp
-                msg_parking_space_.stamp = ros::Time::now();
+                // set measured geometry of parking space for path planning
+                msg_parking_space_.width = space_width;
+                msg_parking_space_.length = space_length;
+                msg_parking_space_.distance = distance_min;
+
+                // stamp of acquisition of the measurement which found the parking space
+                msg_parking_space_.header.stamp = msg_apa_lf_.header.stamp;
                 // publish parking space
                 pub_parking_space_.publish(msg_parking_space_);
                 // reset parking space state
-                clrbit(msg_parking_space_.seq, 6);     // 0 0 x x  0 0 0 0
+                clrbit(msg_parking_space_.type, 6);    // 0 0 x x  0 0 0 0
             }
 
             // delete fist message in que_apa_lf_
@@ -321,98 +278,48 @@ void SearchParkingSpaceLF::check_parking_space()
 }
 
 
+// benchmark_decisions links this node without main
+#ifndef AUTOPARK_NO_MAIN
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "search_parking_space_lf");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
 
-    // create a node handle, use global callback queue
-    ros::NodeHandle nh;
     //create a node handle for class, use custom callback queue
     ros::NodeHandle nh_c;
-    // create custom callback queue
-    ros::CallbackQueue callback_queue;
-    // set custom callback queue
-    nh_c.setCallbackQueue(&callback_queue);
-
-    ros::Subscriber sub_parking_enable = nh.subscribe<std_msgs::Bool>("parking_enable", 1, \
-    callback_parking_enable);
-
-    ros::Subscriber sub_search_done = nh.subscribe<std_msgs::Bool>("search_done", 1, \
-    callback_search_done);
+    // run callbacks of the class one at a time on a fixed number of threads
+    Executor executor(params().executor_threads);
+    Strand strand(executor);
+    // set strand as callback queue
+    nh_c.setCallbackQueue(&strand);
 
     // instantiating an object of class SearchParkingSpaceLF
     SearchParkingSpaceLF SearchParkingSpaceLF_lf(&nh_c);  // pass nh_c to class constructor
 
-    // create AsyncSpinner, run it on all available cores to process custom callback queue
-    sp_spinner.reset(new ros::AsyncSpinner(0, &callback_queue));
-
-    // initialize Times: 
-    time_2.duration = 0;
-    time_2.trigger = false;
-
-    time_5.duration = 0;
-    time_5.trigger = false;
-
-    // set loop rate
-    ros::Rate loop_rate(10);
-    while (ros::ok())
+    // search in stage search, it ends when the parking space is chosen
+    LifecycleNode lifecycle(STAGE_BIT(STAGE_SEARCH), [&](bool active)
     {
-        ROS_INFO_STREAM_ONCE("node search_parking_space_lf is running");
-        if (parking_enable)
+        if (active)
         {
-            if (!trigger_spinner)
-            {
-                ROS_INFO("search parking space with apa_lf enabled");
-                // clear old callbacks in custom callback queue
-                callback_queue.clear();
-                // start spinners for custom callback queue
-                sp_spinner->start();
-                ROS_INFO("spinners start");
-
-                trigger_spinner = true;
-            }
-            else
-            {
-                if (search_done)
-                {
-                    ROS_INFO("search parking space finished");
-                    // stop spinners for custom callback queue
-                    sp_spinner->stop();
-                    ROS_INFO("spinners stop");
-
-                    // reset
-                    parking_enable = false;
-                    search_done = false;
-                    trigger_spinner = false;
-                }
-            }
+            ROS_INFO("search parking space with apa_lf enabled");
+            // clear old callbacks of the class
+            strand.clear();
+            // start running callbacks of the class
+            strand.start();
         }
         else
         {
-            if (trigger_spinner)
-            {
-                ROS_INFO("search parking space with apa_lf disabled");
-                // stop spinners for custom callback queue
-                sp_spinner->stop();
-                ROS_INFO("spinners stop");
-
-                // reset
-                parking_enable = false;
-                search_done = false;
-                trigger_spinner = false;
-            }
+            ROS_INFO("search parking space with apa_lf disabled");
+            // stop running callbacks of the class
+            strand.stop();
         }
+    });
 
-        ros::spinOnce();
-
-        loop_rate.sleep();
-    }
-
-    // release AsyncSpinner object
-    sp_spinner.reset();
-
-    // wait for ROS threads to terminate
-    ros::waitForShutdown();
+    ROS_INFO("node search_parking_space_lf is running");
+    // process stage transitions in global callback queue when they arrive
+    ros::spin();
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
@@ -3,21 +3,26 @@
  * Version: v1.0
  * Author: Meng Peng
  * Date: 2020-04-17
- * Description: publish car speed to topic car_speed
+ * Description: publish car speed to topic car_speed, and with its
+ * time of acquisition to topic car_speed_stamped
  * 
  ******************************************************************/
 
 #include <ros/ros.h>
 #include <std_msgs/Float32.h>
+#include "autopark/CarSpeed.h"
 
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "encoder");
     ros::NodeHandle nh;
     ros::Publisher pub = nh.advertise<std_msgs::Float32>("car_speed", 1);
+    // consumers aligning measurements keep a history of car speed: no message is dropped
+    ros::Publisher pub_stamped = nh.advertise<autopark::CarSpeed>("car_speed_stamped", 10);
 
     // define message
     std_msgs::Float32 flt_msg;
+    autopark::CarSpeed msg_stamped;
     //set message data
     flt_msg.data = 5;   // 5 m/s = 18 km/h
 
@@ -25,11 +30,16 @@ int main(int argc, char **argv)
     ros::Rate loop_rate(100);
     while (ros::ok())
     {
+        // stamp at the measurement, before logging and publishing delay it
+        msg_stamped.header.stamp = ros::Time::now();
+        msg_stamped.speed = flt_msg.data;
+
         // output the published message
         ROS_INFO("car speed: %f m/s", flt_msg.data);
 
         // publish message 
         pub.publish(flt_msg);
+        pub_stamped.publish(msg_stamped);
 
         ros::spinOnce();
         loop_rate.sleep();
@@ -0,0 +1,114 @@
+/******************************************************************
+ * Filename: sensor_odometry.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-22
+ * Description: integrate car pose and driven distance from topics
+ * car_speed_stamped and steering_angle, publish it to topic odom and
+ * write it to shared memory for other nodes
+ * 
+ ******************************************************************/
+
+#include <map>
+
+#include <ros/ros.h>
+#include <std_msgs/Float32.h>
+#include <nav_msgs/Odometry.h>
+#include "autopark/autoparking.h"
+#include "autopark/odometry.h"
+#include "autopark/parameters.h"
+#include "autopark/CarSpeed.h"
+
+using namespace std;
+
+// change of speed or steering angle
+struct OdometryChange
+{
+    bool speed;         // speed, else steering angle
+    float value;
+};
+
+// global object to integrate car pose
+static Odometry odometry;
+// changes by stamp: they are integrated alignment_delay after their stamp, so a sample
+// of car speed arriving late is still applied at its time of acquisition
+static multimap<double, OdometryChange> changes;
+
+
+// callback of "car_speed_stamped": speed is changed at the time of acquisition
+void callback_car_speed(const autopark::CarSpeed::ConstPtr& msg)
+{
+    OdometryChange change = {true, msg->speed};
+    changes.insert(make_pair(msg->header.stamp.toSec(), change));
+}
+
+// callback of "steering_angle": steering angle is changed at the time of receipt
+void callback_steering_angle(const std_msgs::Float32::ConstPtr& msg)
+{
+    OdometryChange change = {false, msg->data};
+    changes.insert(make_pair(ros::Time::now().toSec(), change));
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "odometry");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
+    ros::NodeHandle nh;
+
+    ros::Subscriber sub_speed = nh.subscribe<autopark::CarSpeed>("car_speed_stamped", 10, callback_car_speed);
+    ros::Subscriber sub_steering = nh.subscribe<std_msgs::Float32>("steering_angle", 1, callback_steering_angle);
+    ros::Publisher pub = nh.advertise<nav_msgs::Odometry>("odom", 1);
+
+    // other nodes read the latest pose or the pose at a time stamp without subscribing
+    OdometryShm shm;
+    if (!shm.create(odometry_shm_name, odometry_history))
+    {
+        ROS_ERROR("cannot create shared memory %s", odometry_shm_name);
+    }
+
+    nav_msgs::Odometry msg;
+    msg.header.frame_id = "odom";
+    msg.child_frame_id = "base_link";
+
+    // set loop rate, this rate should not be smaller than publish rate of car_speed
+    ros::Rate loop_rate(params().odometry_rate);
+    while (ros::ok())
+    {
+        ros::spinOnce();
+
+        // changes are integrated in order of their stamps up to alignment_delay ago,
+        // readers extrapolate the latest sample to the present
+        ros::Time now = ros::Time::now() - ros::Duration(params().alignment_delay);
+        while (!changes.empty() && changes.begin()->first <= now.toSec())
+        {
+            const OdometryChange& change = changes.begin()->second;
+            if (change.speed)
+            {
+                odometry.set_speed(changes.begin()->first, change.value);
+            }
+            else
+            {
+                odometry.set_steering(changes.begin()->first, change.value);
+            }
+            changes.erase(changes.begin());
+        }
+        odometry.update(now.toSec());
+        const OdometrySample& state = odometry.state();
+        shm.write(state);
+
+        msg.header.stamp = now;
+        msg.pose.pose.position.x = state.x;
+        msg.pose.pose.position.y = state.y;
+        msg.pose.pose.orientation.z = sin(state.yaw / 2);
+        msg.pose.pose.orientation.w = cos(state.yaw / 2);
+        msg.twist.twist.linear.x = state.speed;
+        msg.twist.twist.angular.z = state.speed * tan(state.steering) / params().wheel_base;
+        pub.publish(msg);
+
+        loop_rate.sleep();
+    }
+
+    return 0;
+}
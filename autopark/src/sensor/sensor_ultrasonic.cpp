@@ -0,0 +1,230 @@
+/******************************************************************
+ * Filename: sensor_ultrasonic.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-16
+ * Description: driver of all apa and upa sensors: read measurements
+ * from the device as soon as they arrive, publish them at once to
+ * topic ultrasonic and each to the topic of its sensor (apa_lf ...).
+ * Without ~device a pseudo-device replays ~recording, or measures
+ * the fake ranges of the former sensor nodes, firing the sensors by
+ * the schedule of the current driving mode. The rates of the schedule
+ * are published latched to topic ultrasonic_rates
+ * 
+ ******************************************************************/
+
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+#include <boost/scoped_ptr.hpp>
+#include <ros/ros.h>
+#include <ros/spinner.h>
+#include <sensor_msgs/Range.h>
+#include <std_msgs/Float32.h>
+#include "autopark/FiringRates.h"
+#include "autopark/RangeBatch.h"
+#include "autopark/autoparking.h"
+#include "autopark/firing_scheduler.h"
+#include "autopark/lifecycle.h"
+
+using namespace std;
+
+static const float fake_ranges[ULTRASONIC_CHANNELS] = {2, 1, 1, 4, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1};   // [m]
+static const float fake_noise = 0.005;          // [m]
+static const double duration_rates = 10;        // [s] of simulated slots for the rates of a schedule
+
+static ros::Publisher pub_batch;
+static ros::Publisher pub_range[ULTRASONIC_CHANNELS];
+static ros::Publisher pub_rates;
+static FiringScheduler scheduler;
+static uint8_t stage = STAGE_IDLE;
+static float car_speed = 0;
+static autopark::RangeBatch msg_batch;
+static FILE* file_record = NULL;                // frames are recorded for replaying
+static uint64_t stamp_record = 0;               // [ns] first recorded frame
+
+
+static void publish(const vector<UltrasonicFrame>& frames)
+{
+    msg_batch.header.stamp = ros::Time::now();
+    msg_batch.ranges.clear();
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        const UltrasonicFrame& frame = frames[i];
+        if (frame.channel >= ULTRASONIC_CHANNELS)
+        {
+            ROS_WARN_THROTTLE(1, "ultrasonic: frame of unknown channel %u", frame.channel);
+            continue;
+        }
+        const UltrasonicChannel& channel = ultrasonic_channels[frame.channel];
+
+        // stamp of acquisition, no echo is +inf as in REP 117
+        sensor_msgs::Range msg_range;
+        msg_range.header.stamp.fromNSec(frame.stamp);
+        msg_range.header.frame_id = channel.name;
+        msg_range.radiation_type = sensor_msgs::Range::ULTRASOUND;
+        msg_range.field_of_view = channel.field_of_view;
+        msg_range.min_range = channel.min_range;
+        msg_range.max_range = channel.max_range;
+        msg_range.range = frame.range ? frame.range * 0.001f : numeric_limits<float>::infinity();
+        pub_range[frame.channel].publish(msg_range);
+        msg_batch.ranges.push_back(msg_range);
+
+        if (file_record != NULL)
+        {
+            if (stamp_record == 0)
+            {
+                stamp_record = frame.stamp;
+            }
+            fprintf(file_record, "%.6f %s %.3f\n", (frame.stamp - stamp_record) * 1e-9, channel.name, \
+            frame.range * 0.001);
+        }
+    }
+    pub_batch.publish(msg_batch);
+}
+
+// rates of the sensors by the schedule of the current mode
+static void publish_rates()
+{
+    float rates[ULTRASONIC_CHANNELS];
+    scheduler.rates(duration_rates, rates);
+
+    autopark::FiringRates msg_rates;
+    msg_rates.header.stamp = ros::Time::now();
+    msg_rates.mode = firing_mode_names[scheduler.mode()];
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        msg_rates.channels.push_back(ultrasonic_channels[i].name);
+        msg_rates.rates.push_back(rates[i]);
+    }
+    pub_rates.publish(msg_rates);
+}
+
+// the need of the sensors follows the driving: moving backward, searching, moving forward
+static void update_mode()
+{
+    FiringMode mode = FIRING_IDLE;
+    if (car_speed < 0)
+    {
+        mode = FIRING_BACKWARD;
+    }
+    else if (stage == STAGE_SEARCH)
+    {
+        mode = FIRING_SEARCH;
+    }
+    else if (car_speed > 0)
+    {
+        mode = FIRING_FORWARD;
+    }
+    if (mode != scheduler.mode())
+    {
+        scheduler.set_mode(mode);
+        publish_rates();
+        ROS_INFO("ultrasonic: firing mode %s", firing_mode_names[mode]);
+    }
+}
+
+// callbacks of sub_stage and sub_car_speed
+static void callback_stage(const autopark::PipelineStage::ConstPtr& msg)
+{
+    stage = msg->stage;
+    update_mode();
+}
+
+static void callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
+{
+    car_speed = msg->data;
+    update_mode();
+}
+
+
+int main(int argc, char **argv)
+{
+    ros::init(argc, argv, "sensor_ultrasonic");
+    // load vehicle profile and reload it when it changes: echo times of the schedule
+    watch_parameters(parameter_file);
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+
+    string device = nh_private.param<string>("device", "");
+    string recording = nh_private.param<string>("recording", "");
+    string record = nh_private.param<string>("record", "");
+
+    // queue_size 1 of each sensor to ensure real time data, the batch holds all of them
+    pub_batch = nh.advertise<autopark::RangeBatch>("ultrasonic", 1);
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        pub_range[i] = nh.advertise<sensor_msgs::Range>(ultrasonic_channels[i].name, 1);
+    }
+
+    // device of the sensors, or a pseudo-device
+    ros::Subscriber sub_stage;
+    ros::Subscriber sub_car_speed;
+    int fd;
+    boost::scoped_ptr<PseudoDevice> pseudo_device;
+    if (!device.empty())
+    {
+        fd = open_device(device);
+        if (fd < 0)
+        {
+            ROS_ERROR("ultrasonic: can not open device %s", device.c_str());
+            return 1;
+        }
+    }
+    else
+    {
+        vector<UltrasonicRecord> records;
+        if (recording.empty())
+        {
+            // the mode of the schedule follows the stage of the pipeline and the car speed
+            pub_rates = nh.advertise<autopark::FiringRates>("ultrasonic_rates", 1, true);
+            sub_stage = nh.subscribe<autopark::PipelineStage>("pipeline_stage", 1, callback_stage);
+            sub_car_speed = nh.subscribe<std_msgs::Float32>("car_speed", 1, callback_car_speed);
+            publish_rates();
+            pseudo_device.reset(new FiringDevice(scheduler, fake_ranges, fake_noise));
+        }
+        else if (load_recording(recording, records))
+        {
+            pseudo_device.reset(new ReplayDevice(records, nh_private.param<double>("period", 0.0)));
+            ROS_INFO("ultrasonic: replay %lu measurements of %s", records.size(), recording.c_str());
+        }
+        else
+        {
+            ROS_ERROR("ultrasonic: can not load recording %s", recording.c_str());
+            return 1;
+        }
+        fd = pseudo_device->fd();
+    }
+
+    ros::AsyncSpinner spinner(1);
+    spinner.start();
+
+    if (!record.empty())
+    {
+        file_record = fopen(record.c_str(), "w");
+        if (file_record == NULL)
+        {
+            ROS_ERROR("ultrasonic: can not record to %s", record.c_str());
+        }
+    }
+
+    // publish when measurements arrive: no loop rate
+    UltrasonicDriver driver(fd);
+    while (ros::ok() && driver.poll(0.1, publish))
+    {
+    }
+
+    if (file_record != NULL)
+    {
+        fclose(file_record);
+    }
+    if (!device.empty())
+    {
+        close(fd);
+    }
+
+    return 0;
+}
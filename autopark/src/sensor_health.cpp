@@ -0,0 +1,191 @@
+/******************************************************************
+ * Filename: sensor_health.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-18
+ * Description: define streaming statistics of the health of a sensor
+ * and the filter excluding degraded sensors in the nodes
+ * 
+ ******************************************************************/
+
+#include "autopark/sensor_health.h"
+
+#include <cmath>
+
+#include "autopark/parameters.h"
+#include "autopark/ultrasonic.h"
+
+using namespace std;
+
+static const float stuck_resolution = 0.0005;   // [m] ranges closer are unchanged, below 1 mm of a frame
+static const int health_expire_periods = 3;     // periods of health_rate until the degraded sensors expire
+
+
+// CONSTRUCTOR
+ChannelHealth::ChannelHealth()
+{
+    samples_ = 0;
+    time_last_ = 0;
+    range_last_ = 0;
+    interval_ = 0;
+    interval_var_ = 0;
+    difference_var_ = 0;
+    out_of_range_ = 0;
+    unchanged_ = 0;
+}
+
+void ChannelHealth::update(double time, float range, float min_range, float max_range, bool moving)
+{
+    double alpha = params().health_smoothing;
+    // no echo (+inf) and too close (-inf) are valid as in REP 117
+    bool out = std::isnan(range) || (std::isfinite(range) && (range < min_range || range > max_range));
+
+    if (samples_ == 0)
+    {
+        out_of_range_ = out ? 1 : 0;
+    }
+    else
+    {
+        // incremental mean and variance of the interval
+        double interval = time - time_last_;
+        if (samples_ == 1)
+        {
+            interval_ = interval;
+        }
+        double delta = interval - interval_;
+        interval_ += alpha * delta;
+        interval_var_ = (1 - alpha) * (interval_var_ + alpha * delta * delta);
+
+        // only echoes change: a sensor without echo in free space is not stuck, nor a sensor
+        // of a standing car
+        if (std::isfinite(range) && std::isfinite(range_last_))
+        {
+            double difference = range - range_last_;
+            difference_var_ += alpha * (difference * difference - difference_var_);
+            if (fabs(difference) >= stuck_resolution)
+            {
+                unchanged_ = 0;
+            }
+            else if (moving)
+            {
+                unchanged_++;
+            }
+        }
+        else
+        {
+            unchanged_ = 0;
+        }
+        out_of_range_ += alpha * ((out ? 1 : 0) - out_of_range_);
+    }
+
+    samples_++;
+    time_last_ = time;
+    range_last_ = range;
+}
+
+uint8_t ChannelHealth::status(double time) const
+{
+    // a sensor without measurements is unknown, not degraded
+    if (samples_ == 0)
+    {
+        return 0;
+    }
+    const Parameters& p = params();
+    uint8_t status = 0;
+    if (time - time_last_ > p.health_timeout)
+    {
+        status |= HEALTH_STALE;
+    }
+    if (unchanged_ >= p.health_stuck_samples)
+    {
+        status |= HEALTH_STUCK;
+    }
+
+    // averages are valid after the weights of the first measurements decayed
+    if (samples_ * p.health_smoothing < 1)
+    {
+        return status;
+    }
+    if (rate() < p.health_rate_min)
+    {
+        status |= HEALTH_RATE;
+    }
+    if (jitter() > p.health_jitter_max * interval_)
+    {
+        status |= HEALTH_JITTER;
+    }
+    if (noise() > p.health_noise_max)
+    {
+        status |= HEALTH_NOISE;
+    }
+    if (out_of_range_ > p.health_out_of_range_max)
+    {
+        status |= HEALTH_RANGE;
+    }
+    return status;
+}
+
+float ChannelHealth::rate() const
+{
+    return (interval_ > 0) ? 1 / interval_ : 0;
+}
+
+float ChannelHealth::jitter() const
+{
+    return sqrt(interval_var_);
+}
+
+float ChannelHealth::noise() const
+{
+    return sqrt(difference_var_);
+}
+
+
+// CONSTRUCTOR: subscribe the latched health
+HealthFilter::HealthFilter(ros::NodeHandle& nh, sensor_msgs::Range* ranges, boost::mutex* mutex):degraded_(0), \
+ranges_(ranges), mutex_((mutex != NULL) ? mutex : &own_mutex_)
+{
+    sub_health_ = nh.subscribe<autopark::SensorHealth>("sensor_health", 1, &HealthFilter::callback_health, this);
+    timer_expire_ = nh.createWallTimer(ros::WallDuration(1.0 / params().health_rate), \
+    &HealthFilter::callback_expire, this);
+}
+
+void HealthFilter::callback_health(const autopark::SensorHealth::ConstPtr& msg)
+{
+    boost::mutex::scoped_lock lock(*mutex_);
+    received_ = ros::WallTime::now();
+    uint32_t degraded = msg->degraded;
+    if (degraded != degraded_)
+    {
+        ROS_WARN("sensors excluded: 0x%04x", degraded);
+    }
+    degraded_ = degraded;
+
+    // sensors without measurements since they became degraded are excluded at once
+    for (int i = 0; ranges_ != NULL && i < ULTRASONIC_CHANNELS; i++)
+    {
+        if ((degraded >> i) & 1)
+        {
+            ranges_[i].range = 0;
+        }
+    }
+}
+
+// the summary is latched: if health_monitor stops, its last mask must not exclude sensors forever
+void HealthFilter::callback_expire(const ros::WallTimerEvent& event)
+{
+    boost::mutex::scoped_lock lock(*mutex_);
+    double age = (event.current_real - received_).toSec();
+    if (degraded_ != 0 && age > health_expire_periods / params().health_rate)
+    {
+        ROS_WARN("no sensor_health for %.1f s, sensors 0x%04x are used again", age, (uint32_t)degraded_);
+        degraded_ = 0;
+    }
+}
+
+// a stale, stuck or noisy sensor may miss an object next to the car: it reads as blocked,
+// not as free space
+float HealthFilter::range(int sensor, float range) const
+{
+    return degraded(sensor) ? 0 : range;
+}
@@ -0,0 +1,162 @@
+/******************************************************************
+ * Filename: session_store.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-26
+ * Description: memory-mapped store of the parking session, records
+ * are written alternately and flushed to disk
+ * 
+ ******************************************************************/
+
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "autopark/session_store.h"
+
+using namespace std;
+
+static const int read_retries = 8;      // retries of a record which is written while it is read
+
+// FNV-1a hash of session
+static uint32_t checksum(const ParkingSession& session)
+{
+    const uint8_t* data = (const uint8_t*)&session;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(session); i++)
+    {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+
+// CONSTRUCTOR
+SessionStore::SessionStore()
+{
+    file_ = NULL;
+}
+
+// DESTRUCTOR
+SessionStore::~SessionStore(void)
+{
+    close();
+}
+
+bool SessionStore::open(const char* filename)
+{
+    close();
+
+    int fd = ::open(filename, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size != sizeof(SessionFile) && ftruncate(fd, sizeof(SessionFile)) != 0))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(NULL, sizeof(SessionFile), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    file_ = (SessionFile*)data;
+
+    // new file or other layout: reset both records, then write the header
+    if (strncmp(file_->magic, SESSION_STORE_MAGIC, sizeof(file_->magic)) != 0 || \
+    file_->version != SESSION_STORE_VERSION || file_->size != sizeof(ParkingSession))
+    {
+        memset(file_, 0, sizeof(SessionFile));
+        file_->version = SESSION_STORE_VERSION;
+        file_->size = sizeof(ParkingSession);
+        __sync_synchronize();
+        strncpy(file_->magic, SESSION_STORE_MAGIC, sizeof(file_->magic));
+        msync(file_, sizeof(SessionFile), MS_SYNC);
+    }
+    return true;
+}
+
+void SessionStore::close()
+{
+    if (file_ != NULL)
+    {
+        munmap(file_, sizeof(SessionFile));
+    }
+    file_ = NULL;
+}
+
+// read one record, false if it is empty, being written or torn
+bool SessionStore::read_record(int index, ParkingSession& session, uint64_t& sequence) const
+{
+    const SessionRecord& record = file_->record[index];
+    for (int i = 0; i < read_retries; i++)
+    {
+        sequence = record.sequence;
+        __sync_synchronize();
+        session = record.session;
+        uint32_t sum = record.checksum;
+        __sync_synchronize();
+        if (sequence != 0 && record.sequence == sequence && sum == checksum(session))
+        {
+            return true;
+        }
+        if (sequence != 0 && record.sequence == sequence)
+        {
+            return false;   // torn by a crash while it was written
+        }
+    }
+    return false;
+}
+
+bool SessionStore::load(ParkingSession& session) const
+{
+    if (file_ == NULL)
+    {
+        return false;
+    }
+    ParkingSession candidate;
+    uint64_t sequence;
+    uint64_t latest = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        if (read_record(i, candidate, sequence) && sequence > latest)
+        {
+            session = candidate;
+            latest = sequence;
+        }
+    }
+    return latest != 0;
+}
+
+// write older record: invalidate it, write session, then publish its sequence
+bool SessionStore::store(const ParkingSession& session)
+{
+    if (file_ == NULL)
+    {
+        return false;
+    }
+    uint64_t sequence = 0;
+    int index = 0;
+    for (int i = 0; i < 2; i++)
+    {
+        if (file_->record[i].sequence > sequence)
+        {
+            sequence = file_->record[i].sequence;
+            index = 1 - i;
+        }
+    }
+    SessionRecord& record = file_->record[index];
+    record.sequence = 0;
+    __sync_synchronize();
+    record.session = session;
+    record.checksum = checksum(session);
+    __sync_synchronize();
+    record.sequence = sequence + 1;
+    return msync(file_, sizeof(SessionFile), MS_SYNC) == 0;
+}
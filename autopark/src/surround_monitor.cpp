@@ -9,6 +9,7 @@
 
 #include "autopark/autoparking.h"
 #include "autopark/surround_monitor.h"
+#include "autopark/parking_kernels.h"
 
 using namespace std;
 
@@ -22,11 +23,11 @@ static bool stop_trigger_enable = false;        // flag of stop trigger state
 static bool trigger_check = false;              // flag to enable check function 
 static bool trigger_spinner = false;            // flag to enable spinners
 
-boost::shared_ptr<ros::AsyncSpinner> sp_spinner;   // create a shared_ptr for AsyncSpinner object
+static boost::shared_ptr<ros::AsyncSpinner> sp_spinner;  // create a shared_ptr for AsyncSpinner object
 
 
 // CONSTRUCTOR: called when this object is created to set up subscribers and publishers
-SurroundMonitor::SurroundMonitor()
+SurroundMonitor::SurroundMonitor():health_(nh_, NULL, NULL)
 {
     ROS_INFO("call constructor in surround_monitor");
 
@@ -57,7 +58,7 @@ SurroundMonitor::SurroundMonitor()
     sub_upa_br_ = nh_.subscribe<sensor_msgs::Range>("upa_br", 1, \
     &SurroundMonitor::callback_upa_br, this);
 
-    pub_move_ = nh_.advertise<std_msgs::Float32>("cmd_move", 1);
+    pub_move_ = nh_.advertise<autopark::MoveCommand>("cmd_move_aeb", 1);
 
     pub_forward_ = nh_.advertise<std_msgs::Bool>("forward_enable", 1);
 
@@ -70,15 +71,16 @@ SurroundMonitor::~SurroundMonitor(void)
     ROS_INFO("call destructor in surround_monitor");
 }
 
-// callbacks from custom callback queue
+// callbacks from custom callback queue: car speed and each range are checked at once
 // callback of sub_car_speed
 void SurroundMonitor::callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
 {
     ROS_INFO("call callback of car_speed: speed=%f", msg->data);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_car_speed_.data = msg->data;
 
     // brakedistance = 0.1v + v²/(2µg) = 0.02v + v²/15.68, (µ=0.8, g=9.8 m/s²)
-    brake_distance = 0.1 * fabs(msg_car_speed_.data) + pow(fabs(msg_car_speed_.data), 2) / 15.68;
+    brake_distance = brake_distance_at(msg_car_speed_.data);
 
     // check all car speed and sensor ranges
     check_signals();
@@ -88,86 +90,108 @@ void SurroundMonitor::callback_car_speed(const std_msgs::Float32::ConstPtr& msg)
 void SurroundMonitor::callback_upa_fl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fl: range=%f", msg->range);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_upa_fl_.header.stamp = msg->header.stamp;
     msg_upa_fl_.header.frame_id = msg->header.frame_id;
     msg_upa_fl_.range = msg->range;
+    check_signals();
 }
 
 // callback of sub_upa_fcl_
 void SurroundMonitor::callback_upa_fcl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fcl: range=%f", msg->range);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_upa_fcl_.header.stamp = msg->header.stamp;
     msg_upa_fcl_.header.frame_id = msg->header.frame_id;
     msg_upa_fcl_.range = msg->range;
+    check_signals();
 }
 
 // callback of sub_upa_fcr_
 void SurroundMonitor::callback_upa_fcr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fcr: range=%f", msg->range);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_upa_fcr_.header.stamp = msg->header.stamp;
     msg_upa_fcr_.header.frame_id = msg->header.frame_id;
     msg_upa_fcr_.range = msg->range;
+    check_signals();
 }
 
 // callback of sub_upa_fr_
 void SurroundMonitor::callback_upa_fr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_fr: range=%f", msg->range);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_upa_fr_.header.stamp = msg->header.stamp;
     msg_upa_fr_.header.frame_id = msg->header.frame_id;
     msg_upa_fr_.range = msg->range;
+    check_signals();
 }
 
 // callback of sub_upa_bl_
 void SurroundMonitor::callback_upa_bl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bl: range=%f", msg->range);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_upa_bl_.header.stamp = msg->header.stamp;
     msg_upa_bl_.header.frame_id = msg->header.frame_id;
     msg_upa_bl_.range = msg->range;
+    check_signals();
 }
 
 // callback of sub_upa_bcl_
 void SurroundMonitor::callback_upa_bcl(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bcl: range=%f", msg->range);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_upa_bcl_.header.stamp = msg->header.stamp;
     msg_upa_bcl_.header.frame_id = msg->header.frame_id;
     msg_upa_bcl_.range = msg->range;
+    check_signals();
 }
 
 // callback of sub_upa_bcr_
 void SurroundMonitor::callback_upa_bcr(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_bcr: range=%f", msg->range);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_upa_bcr_.header.stamp = msg->header.stamp;
     msg_upa_bcr_.header.frame_id = msg->header.frame_id;
     msg_upa_bcr_.range = msg->range;
+    check_signals();
 }
 
 // callback of sub_upa_br_
 void SurroundMonitor::callback_upa_br(const sensor_msgs::Range::ConstPtr& msg)
 {
     ROS_INFO("call callback of upa_br: range=%f", msg->range);
+    boost::mutex::scoped_lock lock(mutex_);
     msg_upa_br_.header.stamp = msg->header.stamp;
     msg_upa_br_.header.frame_id = msg->header.frame_id;
     msg_upa_br_.range = msg->range;
+    check_signals();
 }
 
 
 // function for stopping the car when it is too close to object
 void SurroundMonitor::check_signals()
 {
+    // ranges of upas at front and back, degraded upas read as blocked: the car does not
+    // move toward them
+    float ranges_front[4] = {health_.range(UPA_FL, msg_upa_fl_.range), health_.range(UPA_FCL, msg_upa_fcl_.range), \
+    health_.range(UPA_FCR, msg_upa_fcr_.range), health_.range(UPA_FR, msg_upa_fr_.range)};
+    float ranges_back[4] = {health_.range(UPA_BL, msg_upa_bl_.range), health_.range(UPA_BCL, msg_upa_bcl_.range), \
+    health_.range(UPA_BCR, msg_upa_bcr_.range), health_.range(UPA_BR, msg_upa_br_.range)};
+    const sensor_msgs::Range* msgs_front[4] = {&msg_upa_fl_, &msg_upa_fcl_, &msg_upa_fcr_, &msg_upa_fr_};
+    const sensor_msgs::Range* msgs_back[4] = {&msg_upa_bl_, &msg_upa_bcl_, &msg_upa_bcr_, &msg_upa_br_};
+
     // if car moves forward
     if (msg_car_speed_.data > 0)
     {
         // the distance between car and object at front is smaller than brake distance
-        if (msg_upa_fl_.range < brake_distance \
-        || msg_upa_fcl_.range < brake_distance \
-        || msg_upa_fcr_.range < brake_distance \
-        || msg_upa_fr_.range < brake_distance)
+        if (ranges_blocked(ranges_front, 4, brake_distance))
         {
             if (stop_trigger_forward == false)
             {
@@ -180,8 +204,7 @@ void SurroundMonitor::check_signals()
             stop_trigger_enable = true;
 
             // stop
-            msg_cmd_move_.data = 0;
-            pub_move_.publish(msg_cmd_move_);
+            publish_stop(msgs_front, 4);
         }
     }
 
@@ -189,10 +212,7 @@ void SurroundMonitor::check_signals()
     else if (msg_car_speed_.data < 0)
     {
         // the distance between car and object at back is smaller than brake distance
-        if (msg_upa_bl_.range < brake_distance \
-        || msg_upa_bcl_.range < brake_distance \
-        || msg_upa_bcr_.range < brake_distance \
-        || msg_upa_br_.range < brake_distance)
+        if (ranges_blocked(ranges_back, 4, brake_distance))
         {
             if (stop_trigger_backward == false)
             {
@@ -205,8 +225,7 @@ void SurroundMonitor::check_signals()
             stop_trigger_enable = true;
 
             // stop
-            msg_cmd_move_.data = 0;
-            pub_move_.publish(msg_cmd_move_);
+            publish_stop(msgs_back, 4);
         }
     }
 
@@ -214,10 +233,7 @@ void SurroundMonitor::check_signals()
     else
     {
         // the distance between car and object at front is larger than default brake distance
-        if (msg_upa_fl_.range > brake_distance_default \
-        && msg_upa_fcl_.range > brake_distance_default \
-        && msg_upa_fcr_.range > brake_distance_default \
-        && msg_upa_fr_.range > brake_distance_default)
+        if (ranges_clear<ActiveProfile>(ranges_front, 4))
         {
             // reset stop_trigger_forward
             stop_trigger_forward = false;
@@ -228,9 +244,8 @@ void SurroundMonitor::check_signals()
 
             if (stop_trigger_enable)
             {
-                // cancel stop, move forward again with original speed
-                msg_cmd_move_.data = move_speed_old;
-                pub_move_.publish(msg_cmd_move_);
+                // cancel stop: the lease of the stop command expires in controller_arbiter,
+                // then the command of parking in or out is applied again
 
                 // reset move_speed_old
                 move_speed_old = 0;
@@ -243,26 +258,29 @@ void SurroundMonitor::check_signals()
             // disable moving forward
             msg_cmd_forward_.data = false;
             pub_forward_.publish(msg_cmd_forward_);
+
+            // keep the stop until the object is gone: its lease expires in controller_arbiter
+            // otherwise, and the command of parking in or out moves the car again
+            if (stop_trigger_forward)
+            {
+                publish_stop(msgs_front, 4);
+            }
         }
 
         // the distance between car and object at back is larger than default brake distance
-        if (msg_upa_bl_.range > brake_distance_default \
-        && msg_upa_bcl_.range > brake_distance_default \
-        && msg_upa_bcr_.range > brake_distance_default \
-        && msg_upa_br_.range > brake_distance_default)
+        if (ranges_clear<ActiveProfile>(ranges_back, 4))
         {
             // reset stop_trigger_backward
             stop_trigger_backward = false;
 
             // enable moving backward
             msg_cmd_backward_.data = true;
-            pub_forward_.publish(msg_cmd_backward_);
+            pub_backward_.publish(msg_cmd_backward_);
 
             if (stop_trigger_enable)
             {
-                // cancel stop, move backward again with original speed
-                msg_cmd_move_.data = move_speed_old;
-                pub_move_.publish(msg_cmd_move_);
+                // cancel stop: the lease of the stop command expires in controller_arbiter,
+                // then the command of parking in or out is applied again
 
                 // reset move_speed_old
                 move_speed_old = 0;
@@ -275,6 +293,12 @@ void SurroundMonitor::check_signals()
             // disable moving backward
             msg_cmd_backward_.data = false;
             pub_backward_.publish(msg_cmd_backward_);
+
+            // keep the stop until the object is gone
+            if (stop_trigger_backward)
+            {
+                publish_stop(msgs_back, 4);
+            }
         }
     }
 
@@ -289,9 +313,30 @@ void SurroundMonitor::check_signals()
 }
 
 
+// function of publishing a stop, stamped with the newest of the ranges it reacts to:
+// controller_arbiter measures the latency from the measurement to the output
+void SurroundMonitor::publish_stop(const sensor_msgs::Range* ranges[], int count)
+{
+    msg_cmd_move_.header.stamp = ros::Time();
+    for (int i = 0; i < count; i++)
+    {
+        if (ranges[i]->header.stamp > msg_cmd_move_.header.stamp)
+        {
+            msg_cmd_move_.header.stamp = ranges[i]->header.stamp;
+        }
+    }
+    msg_cmd_move_.speed = 0;
+    pub_move_.publish(msg_cmd_move_);
+}
+
+
+// benchmark_decisions links this node without main
+#ifndef AUTOPARK_NO_MAIN
 int main(int argc, char **argv)
 {
     ros::init(argc, argv, "surround_monitor");
+    // load vehicle profile and reload it when it changes
+    watch_parameters(parameter_file);
 
     // instantiating an object of class ChooseParkingSpace
     SurroundMonitor SurroundMonitor_obj;
@@ -302,4 +347,5 @@ int main(int argc, char **argv)
     ros::waitForShutdown();
 
     return 0;
-}
\ No newline at end of file
+}
+#endif
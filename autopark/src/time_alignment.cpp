@@ -0,0 +1,113 @@
+/******************************************************************
+ * Filename: time_alignment.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-19
+ * Description: define the history of a signal by its time of
+ * acquisition and the alignment of car speed and pose
+ * 
+ ******************************************************************/
+
+#include "autopark/time_alignment.h"
+
+#include <algorithm>
+
+#include "autopark/autoparking.h"
+#include "autopark/parameters.h"
+
+using namespace std;
+
+// order of samples by stamp
+static bool stamp_less(double stamp, const TimedValue& sample)
+{
+    return stamp < sample.stamp;
+}
+
+
+// samples older than alignment_history before the latest one are dropped
+void SignalHistory::add(double stamp, float value)
+{
+    TimedValue sample = {stamp, value};
+    if (samples_.empty() || stamp >= samples_.back().stamp)
+    {
+        samples_.push_back(sample);
+    }
+    else
+    {
+        samples_.insert(upper_bound(samples_.begin(), samples_.end(), stamp, stamp_less), sample);
+    }
+    while (samples_.size() > 2 && samples_.back().stamp - samples_[1].stamp > params().alignment_history)
+    {
+        samples_.pop_front();
+    }
+}
+
+bool SignalHistory::at(double stamp, float& value) const
+{
+    if (samples_.empty() || stamp < samples_.front().stamp)
+    {
+        return false;
+    }
+    if (stamp >= samples_.back().stamp)
+    {
+        value = samples_.back().value;
+        return stamp - samples_.back().stamp <= params().alignment_hold;
+    }
+
+    // first sample after stamp, the one before is at or before stamp
+    deque<TimedValue>::const_iterator newer = upper_bound(samples_.begin(), samples_.end(), stamp, stamp_less);
+    deque<TimedValue>::const_iterator older = newer - 1;
+    double ratio = (newer->stamp > older->stamp) ? (stamp - older->stamp) / (newer->stamp - older->stamp) : 0;
+    value = older->value + ratio * (newer->value - older->value);
+    return true;
+}
+
+// trapezoids between the samples from begin to end, the ends are interpolated
+bool SignalHistory::integral(double begin, double end, double& integral) const
+{
+    if (end < begin)
+    {
+        bool valid = this->integral(end, begin, integral);
+        integral = -integral;
+        return valid;
+    }
+    float value_begin, value_end;
+    if (!at(begin, value_begin) || !at(end, value_end))
+    {
+        return false;
+    }
+
+    integral = 0;
+    double stamp = begin;
+    float value = value_begin;
+    deque<TimedValue>::const_iterator next = upper_bound(samples_.begin(), samples_.end(), begin, stamp_less);
+    for (; next != samples_.end() && next->stamp < end; ++next)
+    {
+        integral += 0.5 * (value + next->value) * (next->stamp - stamp);
+        stamp = next->stamp;
+        value = next->value;
+    }
+    integral += 0.5 * (value + value_end) * (end - stamp);
+    return true;
+}
+
+
+// odometry may start after the node
+bool TimeAlignment::odometry_open()
+{
+    return odometry_.is_open() || odometry_.open(odometry_shm_name);
+}
+
+bool TimeAlignment::pose(const ros::Time& stamp, OdometrySample& sample)
+{
+    return odometry_open() && odometry_.at(stamp.toSec(), sample);
+}
+
+bool TimeAlignment::distance(const ros::Time& begin, const ros::Time& end, double& distance)
+{
+    if (odometry_open() && odometry_.distance(begin.toSec(), end.toSec(), distance))
+    {
+        return true;
+    }
+    return speed_.integral(begin.toSec(), end.toSec(), distance);
+}
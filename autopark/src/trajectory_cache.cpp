@@ -0,0 +1,154 @@
+/******************************************************************
+ * Filename: trajectory_cache.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-06-25
+ * Description: record the trajectory of parking in from odometry,
+ * save and load it, and reverse it for parking out
+ * 
+ ******************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "autopark/trajectory_cache.h"
+
+using namespace std;
+
+
+// CONSTRUCTOR
+TrajectoryCache::TrajectoryCache()
+{
+    memset(&header_, 0, sizeof(header_));
+}
+
+// DESTRUCTOR
+TrajectoryCache::~TrajectoryCache(void)
+{
+}
+
+// clear recorded trajectory
+void TrajectoryCache::clear()
+{
+    recorded_.clear();
+}
+
+// record sample each step of driven distance, and at each change of direction (cusp)
+void TrajectoryCache::record(const OdometrySample& sample, double step)
+{
+    if (!recorded_.empty())
+    {
+        const OdometrySample& last = recorded_.back();
+        bool cusp = (sample.speed > 0 && last.speed < 0) || (sample.speed < 0 && last.speed > 0);
+        if (fabs(sample.odometer - last.odometer) < step && !cusp)
+        {
+            return;
+        }
+    }
+    recorded_.push_back(sample);
+}
+
+// save recorded trajectory in car frame at sample end
+bool TrajectoryCache::save(const char* filename, uint32_t type, const OdometrySample& end, const float range[])
+{
+    recorded_.push_back(end);
+
+    double c = cos(end.yaw);
+    double s = sin(end.yaw);
+    samples_.resize(recorded_.size());
+    for (size_t i = 0; i < recorded_.size(); ++i)
+    {
+        double dx = recorded_[i].x - end.x;
+        double dy = recorded_[i].y - end.y;
+        samples_[i].x = c*dx + s*dy;
+        samples_[i].y = -s*dx + c*dy;
+        samples_[i].yaw = normalize_angle(recorded_[i].yaw - end.yaw);
+        samples_[i].speed = recorded_[i].speed;
+        samples_[i].steering = recorded_[i].steering;
+    }
+
+    memset(&header_, 0, sizeof(header_));
+    strncpy(header_.magic, TRAJECTORY_CACHE_MAGIC, sizeof(header_.magic));
+    header_.version = TRAJECTORY_CACHE_VERSION;
+    header_.type = type;
+    header_.count = samples_.size();
+    header_.stamp = end.stamp;
+    header_.odometer = end.odometer;
+    memcpy(header_.range, range, sizeof(header_.range));
+
+    // a crash while writing leaves the old file or no file, never a truncated one
+    string temp = string(filename) + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool saved = (fwrite(&header_, sizeof(header_), 1, file) == 1 && \
+    fwrite(&samples_[0], sizeof(TrajectorySample), samples_.size(), file) == samples_.size());
+    saved = (fclose(file) == 0) && saved;
+    if (!saved || rename(temp.c_str(), filename) != 0)
+    {
+        remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+// load saved trajectory
+bool TrajectoryCache::load(const char* filename)
+{
+    samples_.clear();
+
+    FILE* file = fopen(filename, "rb");
+    if (file == NULL)
+    {
+        return false;
+    }
+    bool loaded = (fread(&header_, sizeof(header_), 1, file) == 1 && \
+    strncmp(header_.magic, TRAJECTORY_CACHE_MAGIC, sizeof(header_.magic)) == 0 && \
+    header_.version == TRAJECTORY_CACHE_VERSION && header_.count > 1);
+    if (loaded)
+    {
+        samples_.resize(header_.count);
+        loaded = (fread(&samples_[0], sizeof(TrajectorySample), samples_.size(), file) == samples_.size());
+    }
+    fclose(file);
+
+    if (!loaded)
+    {
+        samples_.clear();
+    }
+    return loaded;
+}
+
+// reversed trajectory: each move of parking in is driven back in the opposite direction
+void TrajectoryCache::exit_path(Path& path) const
+{
+    path.clear();
+    for (size_t i = samples_.size(); i-- > 0; )
+    {
+        PathPoint point;
+        point.x = samples_[i].x;
+        point.y = samples_[i].y;
+        point.yaw = samples_[i].yaw;
+        point.direction = path.empty() ? 1 : path.back().direction;
+
+        // parking in moved from sample i - 1 to i with the speed of sample i
+        if (i > 0)
+        {
+            if (samples_[i].speed != 0)
+            {
+                point.direction = (samples_[i].speed > 0) ? -1 : 1;
+            }
+            else
+            {
+                double dx = samples_[i - 1].x - samples_[i].x;
+                double dy = samples_[i - 1].y - samples_[i].y;
+                point.direction = (dx*cos(point.yaw) + dy*sin(point.yaw) >= 0) ? 1 : -1;
+            }
+        }
+        path.push_back(point);
+    }
+}
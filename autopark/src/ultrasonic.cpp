@@ -0,0 +1,289 @@
+/******************************************************************
+ * Filename: ultrasonic.cpp
+ * Version: v1.0
+ * Author: Meng Peng
+ * Date: 2020-07-16
+ * Description: define the ultrasonic channels, the driver reading
+ * frames from a device with epoll, and the replaying pseudo-device
+ * 
+ ******************************************************************/
+
+#include "autopark/ultrasonic.h"
+
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <boost/bind.hpp>
+#include <ros/ros.h>
+
+using namespace std;
+
+static const size_t frames_read = 64;           // frames of a read call
+
+const UltrasonicChannel ultrasonic_channels[ULTRASONIC_CHANNELS] = {
+    {"apa_lf", 1, 0.2, 7}, {"apa_lb", 1, 0.2, 7}, {"apa_lb2", 1, 0.2, 7},
+    {"apa_rf", 1, 0.2, 7}, {"apa_rb", 1, 0.2, 7}, {"apa_rb2", 1, 0.2, 7},
+    {"upa_fl", 2, 0.1, 3}, {"upa_fcl", 2, 0.1, 3}, {"upa_fcr", 2, 0.1, 3}, {"upa_fr", 2, 0.1, 3},
+    {"upa_bl", 2, 0.1, 3}, {"upa_bcl", 2, 0.1, 3}, {"upa_bcr", 2, 0.1, 3}, {"upa_br", 2, 0.1, 3}
+};
+
+
+int ultrasonic_channel(const string& name)
+{
+    for (int i = 0; i < ULTRASONIC_CHANNELS; i++)
+    {
+        if (name == ultrasonic_channels[i].name)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool load_recording(const string& filename, vector<UltrasonicRecord>& records)
+{
+    FILE* file = fopen(filename.c_str(), "r");
+    if (file == NULL)
+    {
+        return false;
+    }
+    records.clear();
+    char line[256];
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        double time;
+        char name[32];
+        float range;
+        if (line[0] == '#' || sscanf(line, "%lf %31s %f", &time, name, &range) != 3)
+        {
+            continue;
+        }
+        int channel = ultrasonic_channel(name);
+        if (channel < 0)
+        {
+            ROS_WARN("recording %s: unknown channel %s", filename.c_str(), name);
+            continue;
+        }
+        UltrasonicRecord record;
+        memset(&record, 0, sizeof(record));
+        record.time = time;
+        record.frame.channel = channel;
+        record.frame.range = (uint16_t)lround(range * 1000);
+        records.push_back(record);
+    }
+    fclose(file);
+    return !records.empty();
+}
+
+int open_device(const string& path)
+{
+    return open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+}
+
+
+// CONSTRUCTOR: register the device with epoll
+UltrasonicDriver::UltrasonicDriver(int fd):fd_(fd)
+{
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fd_;
+    if (epoll_fd_ < 0 || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd_, &event) != 0)
+    {
+        ROS_ERROR("epoll of ultrasonic device failed: %s", strerror(errno));
+    }
+}
+
+// DESTRUCTOR
+UltrasonicDriver::~UltrasonicDriver(void)
+{
+    if (epoll_fd_ >= 0)
+    {
+        close(epoll_fd_);
+    }
+}
+
+// read until the device has no more data: false if it is closed or failed
+bool UltrasonicDriver::read_frames(vector<UltrasonicFrame>& frames)
+{
+    char data[frames_read * sizeof(UltrasonicFrame)];
+    while (true)
+    {
+        ssize_t size = read(fd_, data, sizeof(data));
+        if (size < 0)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        if (size == 0)
+        {
+            return false;
+        }
+        buffer_.insert(buffer_.end(), data, data + size);
+
+        // frames may be split between reads of a stream
+        size_t complete = buffer_.size() / sizeof(UltrasonicFrame);
+        size_t first = frames.size();
+        frames.resize(first + complete);
+        memcpy(&frames[first], &buffer_[0], complete * sizeof(UltrasonicFrame));
+        buffer_.erase(buffer_.begin(), buffer_.begin() + complete * sizeof(UltrasonicFrame));
+    }
+}
+
+bool UltrasonicDriver::poll(double timeout, const FrameHandler& handler)
+{
+    struct epoll_event event;
+    int events = epoll_wait(epoll_fd_, &event, 1, (int)(timeout * 1000));
+    if (events < 0)
+    {
+        return errno == EINTR;
+    }
+    if (events == 0)
+    {
+        return true;
+    }
+
+    // frames without a clock of the device are acquired at latest when epoll returned
+    uint64_t stamp = ros::WallTime::now().toNSec();
+    vector<UltrasonicFrame> frames;
+    bool open = read_frames(frames);
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        if (frames[i].stamp == 0)
+        {
+            frames[i].stamp = stamp;
+        }
+    }
+    if (!frames.empty())
+    {
+        handler(frames);
+    }
+    return open && !(event.events & (EPOLLHUP | EPOLLERR));
+}
+
+
+// CONSTRUCTOR: create the pipe
+PseudoDevice::PseudoDevice()
+{
+    running_ = false;
+    // a full pipe drops frames as an overrun of a device, the thread never blocks
+    if (pipe2(fds_, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        ROS_ERROR("pipe of pseudo-device failed: %s", strerror(errno));
+        fds_[0] = fds_[1] = -1;
+    }
+}
+
+// DESTRUCTOR: close the pipe, the thread is stopped by the derived class
+PseudoDevice::~PseudoDevice(void)
+{
+    stop();
+    for (int i = 0; i < 2; i++)
+    {
+        if (fds_[i] >= 0)
+        {
+            close(fds_[i]);
+        }
+    }
+}
+
+int PseudoDevice::fd() const
+{
+    return fds_[0];
+}
+
+void PseudoDevice::start()
+{
+    if (fds_[1] >= 0)
+    {
+        running_ = true;
+        thread_ = boost::thread(boost::bind(&PseudoDevice::thread, this));
+    }
+}
+
+void PseudoDevice::stop()
+{
+    running_ = false;
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+// the end of the frames closes the device
+void PseudoDevice::thread()
+{
+    run();
+    close(fds_[1]);
+    fds_[1] = -1;
+}
+
+bool PseudoDevice::write_frames(vector<UltrasonicFrame>& frames)
+{
+    uint64_t stamp = ros::WallTime::now().toNSec();
+    for (size_t i = 0; i < frames.size(); i++)
+    {
+        frames[i].stamp = stamp;
+    }
+    if (write(fds_[1], &frames[0], frames.size() * sizeof(UltrasonicFrame)) < 0)
+    {
+        if (errno != EAGAIN)
+        {
+            ROS_ERROR("pseudo-device: %s", strerror(errno));
+            return false;
+        }
+        ROS_WARN_THROTTLE(1, "pseudo-device: overrun, %lu frames dropped", frames.size());
+    }
+    return true;
+}
+
+
+// CONSTRUCTOR: start replaying
+ReplayDevice::ReplayDevice(const vector<UltrasonicRecord>& records, double period):records_(records), \
+period_(period)
+{
+    start();
+}
+
+// DESTRUCTOR: stop replaying before the records are destroyed
+ReplayDevice::~ReplayDevice(void)
+{
+    stop();
+}
+
+// write the records of the same time at once, as a device delivers a cycle of measurements
+void ReplayDevice::run()
+{
+    double start = ros::WallTime::now().toSec();
+    size_t i = 0;
+    while (running_ && i < records_.size())
+    {
+        double time = start + records_[i].time;
+        double wait = time - ros::WallTime::now().toSec();
+        if (wait > 0)
+        {
+            boost::this_thread::sleep_for(boost::chrono::microseconds((long)(wait * 1e6)));
+        }
+
+        vector<UltrasonicFrame> frames;
+        for (; i < records_.size() && start + records_[i].time <= time; i++)
+        {
+            frames.push_back(records_[i].frame);
+        }
+        if (!write_frames(frames))
+        {
+            break;
+        }
+
+        if (i == records_.size() && period_ > 0)
+        {
+            start += period_;
+            i = 0;
+        }
+    }
+}